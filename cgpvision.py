@@ -0,0 +1,180 @@
+"""ctypes binding for libcgpvision.so (src/cgpvision.h).
+
+Runs the C++ board pipeline in-process on numpy arrays; images are passed by
+pointer, not copied.  The library is $CGPVISION_LIB if set (any build
+directory), else build/libcgpvision.so next to this file, else the loader's
+search path.
+
+    import cgpvision
+    res = cgpvision.analyze(bgr)              # uint8 HxWx3 (or HxW / HxWx4)
+    res.board, res.letters, res.cgp
+    x = cgpvision.preprocess_tile(crop)       # uint8 48x48, as the CNN sees it
+"""
+import ctypes
+import os
+from pathlib import Path
+
+import numpy as np
+
+ABI_VERSION = 1
+
+OK, E_ARG, E_DECODE, E_BUFFER, E_NOBOARD, E_INTERNAL = 0, -1, -2, -3, -4, -5
+METHOD_AUTO, METHOD_CNN, METHOD_TEMPLATE = 0, 1, 2
+
+
+class Image(ctypes.Structure):
+    _fields_ = [("data", ctypes.c_void_p),
+                ("width", ctypes.c_int32),
+                ("height", ctypes.c_int32),
+                ("stride", ctypes.c_int32),
+                ("channels", ctypes.c_int32)]
+
+
+class Board(ctypes.Structure):
+    _fields_ = [("x", ctypes.c_int32), ("y", ctypes.c_int32),
+                ("width", ctypes.c_int32), ("height", ctypes.c_int32),
+                ("cell_size", ctypes.c_int32), ("is_light", ctypes.c_int32)]
+
+
+class Cell(ctypes.Structure):
+    _fields_ = [("letter", ctypes.c_char),
+                ("is_blank", ctypes.c_uint8),
+                ("subscript", ctypes.c_int8),
+                ("reserved", ctypes.c_uint8),
+                ("confidence", ctypes.c_float)]
+
+
+class Result(ctypes.Structure):
+    _fields_ = [("board", Board),
+                ("cells", Cell * 225),
+                ("cgp_bytes", ctypes.c_char * 320)]
+
+    @property
+    def cgp(self):
+        return self.cgp_bytes.decode()
+
+    @property
+    def letters(self):
+        """15x15 array of single-character strings ('' = empty)."""
+        return np.array([c.letter.decode() for c in self.cells]).reshape(15, 15)
+
+
+class CgpVisionError(RuntimeError):
+    pass
+
+
+def _find_library():
+    env = os.environ.get("CGPVISION_LIB")
+    if env:
+        return env
+    p = Path(__file__).resolve().parent / "build" / "libcgpvision.so"
+    if p.exists():
+        return str(p)
+    return "libcgpvision.so"
+
+
+_lib = ctypes.CDLL(_find_library())
+_lib.cgpv_abi_version.restype = ctypes.c_uint32
+_lib.cgpv_pipeline_version.restype = ctypes.c_uint32
+_lib.cgpv_error_string.restype = ctypes.c_char_p
+_lib.cgpv_error_string.argtypes = [ctypes.c_int]
+_lib.cgpv_cnn_input_size.restype = ctypes.c_int32
+_lib.cgpv_decode.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_void_p,
+                             ctypes.c_size_t, ctypes.POINTER(ctypes.c_int32),
+                             ctypes.POINTER(ctypes.c_int32)]
+_lib.cgpv_detect_board.argtypes = [ctypes.POINTER(Image), ctypes.POINTER(Board)]
+_lib.cgpv_analyze.argtypes = [ctypes.POINTER(Image), ctypes.POINTER(Result)]
+_lib.cgpv_analyze_encoded.argtypes = [ctypes.c_char_p, ctypes.c_size_t,
+                                      ctypes.POINTER(Result)]
+_lib.cgpv_occupancy.argtypes = [ctypes.POINTER(Image), ctypes.c_void_p,
+                                ctypes.POINTER(Board)]
+_lib.cgpv_preprocess_tile.argtypes = [ctypes.POINTER(Image), ctypes.c_void_p,
+                                      ctypes.c_int32]
+_lib.cgpv_classify_tiles.argtypes = [ctypes.POINTER(Image), ctypes.c_int32,
+                                     ctypes.c_int32, ctypes.c_void_p,
+                                     ctypes.POINTER(Cell)]
+
+if _lib.cgpv_abi_version() != ABI_VERSION:
+    raise ImportError(f"libcgpvision ABI {_lib.cgpv_abi_version()}, "
+                      f"binding expects {ABI_VERSION}")
+
+CNN_INPUT_SIZE = _lib.cgpv_cnn_input_size()
+PIPELINE_VERSION = _lib.cgpv_pipeline_version()
+
+
+def _check(rc):
+    if rc != OK:
+        raise CgpVisionError(_lib.cgpv_error_string(rc).decode())
+
+
+def _image(arr):
+    """Describe a uint8 HxW / HxWxC array without copying it.  The caller
+    keeps `arr` alive for the duration of the call."""
+    if arr.dtype != np.uint8:
+        raise TypeError("expected a uint8 array")
+    if arr.ndim == 2:
+        channels = 1
+    elif arr.ndim == 3 and arr.shape[2] in (1, 3, 4):
+        channels = arr.shape[2]
+    else:
+        raise ValueError(f"unsupported image shape {arr.shape}")
+    # Rows may be padded (e.g. a crop of a larger array); pixels must not be.
+    if arr.strides[-1] != 1 or (arr.ndim == 3 and arr.strides[1] != channels):
+        raise ValueError("image pixels must be packed; use np.ascontiguousarray")
+    return Image(arr.ctypes.data, arr.shape[1], arr.shape[0], arr.strides[0], channels)
+
+
+def decode(data):
+    """PNG/JPEG bytes -> uint8 HxWx3 BGR."""
+    w, h = ctypes.c_int32(), ctypes.c_int32()
+    rc = _lib.cgpv_decode(data, len(data), None, 0, ctypes.byref(w), ctypes.byref(h))
+    if rc != E_BUFFER:
+        _check(rc)
+    out = np.empty((h.value, w.value, 3), np.uint8)
+    _check(_lib.cgpv_decode(data, len(data), out.ctypes.data, out.nbytes,
+                            ctypes.byref(w), ctypes.byref(h)))
+    return out
+
+
+def detect_board(img):
+    board = Board()
+    _check(_lib.cgpv_detect_board(ctypes.byref(_image(img)), ctypes.byref(board)))
+    return board
+
+
+def analyze(img):
+    """Full pipeline on a decoded image (or PNG/JPEG bytes)."""
+    res = Result()
+    if isinstance(img, (bytes, bytearray)):
+        _check(_lib.cgpv_analyze_encoded(bytes(img), len(img), ctypes.byref(res)))
+    else:
+        _check(_lib.cgpv_analyze(ctypes.byref(_image(img)), ctypes.byref(res)))
+    return res
+
+
+def occupancy(img):
+    """15x15 bool occupancy mask and the detected board."""
+    out = np.zeros((15, 15), np.uint8)
+    board = Board()
+    _check(_lib.cgpv_occupancy(ctypes.byref(_image(img)), out.ctypes.data,
+                               ctypes.byref(board)))
+    return out.astype(bool), board
+
+
+def preprocess_tile(crop):
+    """Tile crop -> uint8 CNN_INPUT_SIZE^2, exactly as board.cpp feeds the CNN."""
+    out = np.empty((CNN_INPUT_SIZE, CNN_INPUT_SIZE), np.uint8)
+    _check(_lib.cgpv_preprocess_tile(ctypes.byref(_image(crop)), out.ctypes.data,
+                                     out.strides[0]))
+    return out
+
+
+def classify_tiles(crops, method=METHOD_AUTO):
+    """Classify tile crops.  Returns (letters, confidences, scores[n, 26])."""
+    images = (Image * len(crops))(*[_image(c) for c in crops])
+    scores = np.zeros((len(crops), 26), np.float32)
+    cells = (Cell * len(crops))()
+    _check(_lib.cgpv_classify_tiles(images, len(crops), method,
+                                    scores.ctypes.data, cells))
+    return ([c.letter.decode() for c in cells],
+            np.array([c.confidence for c in cells], np.float32), scores)
@@ -0,0 +1,71 @@
+# Embed web/*.html into a generated C++ source (see src/web_assets.h).
+#
+#   cmake -DWEB_DIR=<dir> -DOUT=<web_assets.cpp> [-DBROTLI=<brotli>]
+#         -P embed_web_assets.cmake
+#
+# Each page is stored raw, gzip-compressed (level 9) and, if BROTLI names
+# an executable, brotli-compressed (quality 11).
+
+file(GLOB pages RELATIVE "${WEB_DIR}" "${WEB_DIR}/*.html")
+list(SORT pages)
+
+get_filename_component(out_dir "${OUT}" DIRECTORY)
+set(work_dir "${out_dir}/web_assets")
+file(MAKE_DIRECTORY "${work_dir}")
+
+function(hex_array var file)
+    file(READ "${file}" hex HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," hex "${hex}")
+    set(${var} "${hex}" PARENT_SCOPE)
+endfunction()
+
+set(arrays "")
+set(entries "")
+foreach(page ${pages})
+    get_filename_component(stem "${page}" NAME_WE)
+    string(MAKE_C_IDENTIFIER "${stem}" id)
+    if(stem STREQUAL "index")
+        set(route "/")
+    else()
+        set(route "/${stem}")
+    endif()
+
+    set(src "${WEB_DIR}/${page}")
+    file(SHA1 "${src}" sha)
+    string(SUBSTRING "${sha}" 0 16 etag)
+
+    file(ARCHIVE_CREATE OUTPUT "${work_dir}/${page}.gz" PATHS "${src}"
+         FORMAT raw COMPRESSION GZip COMPRESSION_LEVEL 9)
+
+    hex_array(raw_hex "${src}")
+    hex_array(gz_hex "${work_dir}/${page}.gz")
+    string(APPEND arrays
+        "static const unsigned char ${id}_raw[] = {${raw_hex}};\n"
+        "static const unsigned char ${id}_gz[] = {${gz_hex}};\n")
+    set(br_ref "nullptr, 0")
+
+    if(BROTLI)
+        execute_process(
+            COMMAND "${BROTLI}" -q 11 -f -o "${work_dir}/${page}.br" "${src}"
+            RESULT_VARIABLE br_result)
+        if(br_result EQUAL 0)
+            hex_array(br_hex "${work_dir}/${page}.br")
+            string(APPEND arrays
+                "static const unsigned char ${id}_br[] = {${br_hex}};\n")
+            set(br_ref "${id}_br, sizeof(${id}_br)")
+        endif()
+    endif()
+
+    string(APPEND entries
+        "    {\"${route}\", \"text/html; charset=utf-8\", \"\\\"${etag}\\\"\",\n"
+        "     ${id}_raw, sizeof(${id}_raw), ${id}_gz, sizeof(${id}_gz), ${br_ref}},\n")
+endforeach()
+
+list(LENGTH pages count)
+string(CONCAT content "// Generated by cmake/embed_web_assets.cmake from web/*.html; do not edit.\n"
+                     "#include \"web_assets.h\"\n\n"
+                     "${arrays}\n"
+                     "const WebAsset WEB_ASSETS[] = {\n${entries}};\n"
+                     "const int WEB_ASSET_COUNT = ${count};\n")
+
+file(WRITE "${OUT}" "${content}")
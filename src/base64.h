@@ -0,0 +1,23 @@
+#pragma once
+// Base64 (RFC 4648, with padding) through the dispatched cpu_kernels()
+// encoder.  base64_encode_to() writes into a caller's buffer, so a payload
+// can be encoded in place (see gemini_payload.h).
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cpu_kernels.h"
+
+static inline size_t base64_size(size_t n) { return (n + 2) / 3 * 4; }
+
+// Writes exactly base64_size(n) characters to dst.
+static inline void base64_encode_to(const uint8_t* src, size_t n, char* dst) {
+    cpu_kernels().base64_encode(src, n, dst);
+}
+
+static inline std::string base64_encode(const std::vector<uint8_t>& data) {
+    std::string out(base64_size(data.size()), '\0');
+    base64_encode_to(data.data(), data.size(), out.data());
+    return out;
+}
@@ -1,9 +1,23 @@
 #include "board.h"
+#include "cpu_kernels.h"
+#include "image_decode.h"
+#include "scratch_arena.h"
+#include "stage_graph.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -52,6 +66,7 @@ struct BoardRegion {
     int cell_size;
     bool found;
     bool is_light;
+    cv::Rect2d grid;  // sub-pixel outer grid lines from the fit; empty: use rect
 };
 
 // Compute mean HSV in a small block around (cx, cy).
@@ -66,12 +81,114 @@ static cv::Vec3f mean_hsv_block(const cv::Mat& hsv, int cx, int cy, int radius)
                      static_cast<float>(m[2]));
 }
 
+// ---------------------------------------------------------------------------
+// Board themes.  Mode detection only separates light from dark, so each
+// policy covers a family: LightTheme is standard light and Memento,
+// DarkTheme is standard dark and mahogany (mobile).  The per-pixel kernels
+// below are templates on the policy, instantiated once per mode, so their
+// inner loops carry no mode branch; callers pick the instantiation once per
+// image (see premium_scorer()).
+// ---------------------------------------------------------------------------
+
+struct LightTheme {
+    // Cells that say nothing about alignment: tiles.
+    static bool skip_cell(float h, float s, float val) {
+        // Blue/purple tiles
+        if (h >= 100 && h <= 140 && s > 40 && val >= 40 && val <= 200) return true;
+        // Orange/gold recently-played tiles
+        return h >= 10 && h <= 30 && s > 80 && val > 150;
+    }
+
+    static double premium_cell(float h, float s, float val, int prem, bool is_corner) {
+        bool white   = (s < 30 && val > 180);
+        bool red     = ((h < 12 || h > 162) && s > 50 && val > 35);
+        bool pink    = ((h < 15 || h > 158) && s > 15 && s < 160 && val > 100);
+        bool blue    = (h >= 85 && h <= 130 && s > 35 && val > 35);
+        bool ltblue  = (h >= 75 && h <= 125 && s > 10 && val > 100);
+
+        // Mahogany mobile: TW corners appear warm-white (S≈27, V≈229).
+        // Only penalize TW/center for being truly pure white (S<10),
+        // not warm-white mahogany squares (which legitimately have S 15-30).
+        bool pure_white = (s < 10 && val > 180);
+
+        if (prem == 0) {
+            if (white) return 1.0;
+            if (red || blue) return -2.0;
+        } else if (prem == 4 || prem == 5) {
+            if (red || pink) return is_corner ? 10.0 : 4.0;
+            if (pure_white) return is_corner ? -8.0 : -2.0;
+        } else if (prem == 3) {
+            if (pink) return 2.5;
+            if (white) return -0.3;
+        } else if (prem == 2) {
+            if (blue) return 3.0;
+            if (white) return -0.3;
+        } else if (prem == 1) {
+            if (ltblue) return 2.0;
+        }
+        return 0;
+    }
+
+    // is_tile(): empty premium squares under tooltips, badges and toasts
+    // show enough contrast to pass for tiles on the white board.
+    static constexpr bool overlay_checks = true;
+};
+
+struct DarkTheme {
+    // Beige/tan tiles
+    static bool skip_cell(float h, float s, float val) {
+        return h >= 8 && h <= 42 && s >= 12 && s <= 150 && val > 130;
+    }
+
+    // Ground truth HSV from Woogles dark mode:
+    //   normal: H=0 S=0 V=49 (pure dark gray)
+    //   DL:  H=99  S=117 V=201  (blue-ish)
+    //   TL:  H=102 S=225 V=146  (saturated blue)
+    //   DW:  H=178 S=128 V=169  (cyan/red)
+    //   TW:  H=178 S=176 V=107  (cyan/red)
+    // Mahogany mobile ground truth:
+    //   normal: H=8  S=124 V=69  (dark reddish-brown — looks red but is empty board)
+    //   DW:     H=4  S=114 V=123 (pinkish-red)
+    //   TW:     H=73 S=138 V=105 (teal/green!)
+    //   ctr:    H=5  S=148 V=88  (reddish)
+    static double premium_cell(float h, float s, float val, int prem, bool is_corner) {
+        bool dark_gray = (s < 20 && val >= 35 && val <= 75);
+        bool red    = ((h < 12 || h > 162) && s > 50 && val > 35);
+        bool pink   = ((h < 15 || h > 158) && s > 15 && s < 160 && val > 100);
+        bool blue   = (h >= 85 && h <= 130 && s > 35 && val > 35);
+        bool ltblue = (h >= 75 && h <= 125 && s > 10 && val > 100);
+        // Mahogany mobile TW squares appear teal (H≈73).
+        bool teal   = (h >= 60 && h <= 90 && s > 60 && val > 70 && val < 150);
+
+        if (prem == 0) {
+            if (dark_gray) return 1.0;
+            // Only penalize BRIGHT misplaced red/blue (not dark reddish-brown
+            // mahogany board cells, which have val≈69 and look red but are empty).
+            if ((red || blue) && val > 100) return -2.0;
+        } else if (prem == 4 || prem == 5) {  // TW or center
+            if (red || pink || teal) return is_corner ? 10.0 : 4.0;
+            if (dark_gray) return is_corner ? -8.0 : -2.0;
+        } else if (prem == 3) {  // DW
+            if (pink) return 2.5;
+            if (dark_gray) return -0.3;
+        } else if (prem == 2) {  // TL
+            if (blue) return 3.0;
+            if (dark_gray) return -0.3;
+        } else if (prem == 1) {  // DL
+            if (ltblue) return 2.0;
+        }
+        return 0;
+    }
+
+    static constexpr bool overlay_checks = false;
+};
+
 // Score how well a candidate rect aligns with the known premium pattern.
 // Uses area-mean HSV (not single pixel) for robustness.
 // Corner TW squares are weighted very heavily since they're almost never
 // covered by tiles.
-static double score_premium(const cv::Mat& hsv, cv::Rect r,
-                            bool is_light = false) {
+template <class Theme>
+static double score_premium(const cv::Mat& hsv, cv::Rect r) {
     double cw = r.width / 15.0;
     double ch = r.height / 15.0;
     int sample_r = std::max(2, static_cast<int>(cw * 0.15));
@@ -84,99 +201,24 @@ static double score_premium(const cv::Mat& hsv, cv::Rect r,
 
             cv::Vec3f v = mean_hsv_block(hsv, cx, cy, sample_r);
             float h = v[0], s = v[1], val = v[2];
-            int prem = PREMIUM[row][col];
-
-            if (is_light) {
-                // Light mode: skip blue/purple tiles
-                if (h >= 100 && h <= 140 && s > 40 && val >= 40 && val <= 200)
-                    continue;
-                // Skip orange/gold recently-played tiles
-                if (h >= 10 && h <= 30 && s > 80 && val > 150)
-                    continue;
-                // Skip very dark (outside board)
-                if (val < 25) { score -= 0.5; continue; }
-
-                bool white   = (s < 30 && val > 180);
-                bool red     = ((h < 12 || h > 162) && s > 50 && val > 35);
-                bool pink    = ((h < 15 || h > 158) && s > 15 && s < 160 && val > 100);
-                bool blue    = (h >= 85 && h <= 130 && s > 35 && val > 35);
-                bool ltblue  = (h >= 75 && h <= 125 && s > 10 && val > 100);
-
-                bool is_corner = ((row == 0 || row == 14) &&
-                                  (col == 0 || col == 14));
-
-                // Mahogany mobile: TW corners appear warm-white (S≈27, V≈229).
-                // Only penalize TW/center for being truly pure white (S<10),
-                // not warm-white mahogany squares (which legitimately have S 15-30).
-                bool pure_white = (s < 10 && val > 180);
-
-                if (prem == 0) {
-                    if (white) score += 1.0;
-                    else if (red || blue) score -= 2.0;
-                } else if (prem == 4 || prem == 5) {
-                    if (red || pink) score += (is_corner ? 10.0 : 4.0);
-                    else if (pure_white) score -= (is_corner ? 8.0 : 2.0);
-                } else if (prem == 3) {
-                    if (pink) score += 2.5;
-                    else if (white) score -= 0.3;
-                } else if (prem == 2) {
-                    if (blue) score += 3.0;
-                    else if (white) score -= 0.3;
-                } else if (prem == 1) {
-                    if (ltblue) score += 2.0;
-                }
-            } else {
-                // Dark mode: skip beige/tan tiles
-                if (h >= 8 && h <= 42 && s >= 12 && s <= 150 && val > 130)
-                    continue;
-                // Skip very dark (likely outside board)
-                if (val < 25) { score -= 0.5; continue; }
-
-                // Ground truth HSV from Woogles dark mode:
-                //   normal: H=0 S=0 V=49 (pure dark gray)
-                //   DL:  H=99  S=117 V=201  (blue-ish)
-                //   TL:  H=102 S=225 V=146  (saturated blue)
-                //   DW:  H=178 S=128 V=169  (cyan/red)
-                //   TW:  H=178 S=176 V=107  (cyan/red)
-                // Mahogany mobile ground truth:
-                //   normal: H=8  S=124 V=69  (dark reddish-brown — looks red but is empty board)
-                //   DW:     H=4  S=114 V=123 (pinkish-red)
-                //   TW:     H=73 S=138 V=105 (teal/green!)
-                //   ctr:    H=5  S=148 V=88  (reddish)
-                bool dark_gray = (s < 20 && val >= 35 && val <= 75);
-                bool red    = ((h < 12 || h > 162) && s > 50 && val > 35);
-                bool pink   = ((h < 15 || h > 158) && s > 15 && s < 160 && val > 100);
-                bool blue   = (h >= 85 && h <= 130 && s > 35 && val > 35);
-                bool ltblue = (h >= 75 && h <= 125 && s > 10 && val > 100);
-                // Mahogany mobile TW squares appear teal (H≈73).
-                bool teal   = (h >= 60 && h <= 90 && s > 60 && val > 70 && val < 150);
-
-                bool is_corner = ((row == 0 || row == 14) &&
-                                  (col == 0 || col == 14));
+            if (Theme::skip_cell(h, s, val)) continue;
+            // Skip very dark (likely outside board)
+            if (val < 25) { score -= 0.5; continue; }
 
-                if (prem == 0) {
-                    if (dark_gray) score += 1.0;
-                    // Only penalize BRIGHT misplaced red/blue (not dark reddish-brown
-                    // mahogany board cells, which have val≈69 and look red but are empty).
-                    else if ((red || blue) && val > 100) score -= 2.0;
-                } else if (prem == 4 || prem == 5) {  // TW or center
-                    if (red || pink || teal) score += (is_corner ? 10.0 : 4.0);
-                    else if (dark_gray) score -= (is_corner ? 8.0 : 2.0);
-                } else if (prem == 3) {  // DW
-                    if (pink) score += 2.5;
-                    else if (dark_gray) score -= 0.3;
-                } else if (prem == 2) {  // TL
-                    if (blue) score += 3.0;
-                    else if (dark_gray) score -= 0.3;
-                } else if (prem == 1) {  // DL
-                    if (ltblue) score += 2.0;
-                }
-            }
+            bool is_corner = ((row == 0 || row == 14) &&
+                              (col == 0 || col == 14));
+            score += Theme::premium_cell(h, s, val, PREMIUM[row][col], is_corner);
         }
     }
     return score;
 }
 
+using PremiumScorer = double (*)(const cv::Mat& hsv, cv::Rect r);
+
+static PremiumScorer premium_scorer(bool is_light) {
+    return is_light ? score_premium<LightTheme> : score_premium<DarkTheme>;
+}
+
 // Precision offset scoring for light mode: sample near cell EDGES to detect
 // premium color spillover.  When correctly aligned, each cell's edges show
 // only that cell's color.  When misaligned, premium colors bleed into
@@ -242,82 +284,152 @@ static double score_edges_light(const cv::Mat& hsv, cv::Rect r) {
     return score;
 }
 
-// Find board grid position using Sobel edge projections (for light mode).
-// Light mode boards have prominent dark grid lines on white background.
-// We project vertical/horizontal edge magnitudes onto x/y axes, then search
-// for the (cell_size, origin_x, origin_y) that best aligns 16 evenly-spaced
-// grid lines with the projection peaks.
-static cv::Rect find_board_gridlines(const cv::Mat& gray, cv::Rect search,
-                                      std::ostringstream& log) {
-    cv::Mat sobel_x, sobel_y;
-    cv::Sobel(gray, sobel_x, CV_32F, 1, 0, 3);  // vertical edges
-    cv::Sobel(gray, sobel_y, CV_32F, 0, 1, 3);  // horizontal edges
-
-    int sx0 = search.x, sy0 = search.y;
-    int sx1 = std::min(search.x + search.width, gray.cols);
-    int sy1 = std::min(search.y + search.height, gray.rows);
-
-    // Column-wise sum of |Sobel_x| -> peaks at vertical grid lines
-    std::vector<double> vproj(gray.cols, 0);
-    for (int y = sy0; y < sy1; y++) {
-        const float* row = sobel_x.ptr<float>(y);
-        for (int x = sx0; x < sx1; x++)
-            vproj[x] += std::abs(row[x]);
-    }
-
-    // Row-wise sum of |Sobel_y| -> peaks at horizontal grid lines
-    std::vector<double> hproj(gray.rows, 0);
-    for (int y = sy0; y < sy1; y++) {
-        const float* row = sobel_y.ptr<float>(y);
-        for (int x = sx0; x < sx1; x++)
-            hproj[y] += std::abs(row[x]);
-    }
-
-    // Search over cell_size and origin to maximize gridline alignment.
-    // A 15-cell board has 16 grid lines (boundaries). We look for the
-    // cell_size in a range around search_width/15.
-    double approx_cs = search.width / 15.0;
-    double min_cs = approx_cs * 0.75;
-    double max_cs = approx_cs * 1.05;
-    double cs_step = 0.25;
+// ---------------------------------------------------------------------------
+// Gridline refinement from the edge projections (Step 4b)
+// ---------------------------------------------------------------------------
+//
+// vproj / hproj: per-column |Sobel_x| and per-row |Sobel_y| sums around the
+// board; grid lines show up as peaks 1 cell apart.
+
+// Fit acceptance: lines found per axis (of 16), max residual per line after
+// dropping outliers, pitch change vs. the incoming rect (the search below
+// covers the same ±5%), and max x/y pitch difference (cells are square on
+// every theme; more means a line was mismatched).
+static const int GRID_FIT_MIN_LINES = 11;
+static const double GRID_FIT_MAX_RESIDUAL = 1.0;
+static const double GRID_FIT_MAX_PITCH_CHANGE = 0.05;
+static const double GRID_FIT_MAX_ASPECT = 0.02;
+
+struct GridAxisFit {
+    double origin = 0, pitch = 0;  // line k at origin + k * pitch
+    double rms = 0;                // residual over the lines kept
+    int lines = 0;
+};
+
+// Locate the 16 lines of one axis starting from origin + k * pitch and fit
+// them by least squares, dropping the worst line while its residual exceeds
+// GRID_FIT_MAX_RESIDUAL.  Each line is looked for where the lines found so
+// far predict it, so a pitch that is a few percent off does not walk the
+// windows off the far lines.  The projection is box-smoothed over 3 pixels
+// (a 1px line gives |Sobel| peaks on both sides and none on the line
+// itself), and each peak is refined to sub-pixel with a parabola through
+// its neighbours.  Lines hidden under tiles or labels simply go missing.
+static bool fit_grid_axis(const double* proj, int n, double origin, double pitch,
+                          GridAxisFit& out) {
+    auto smooth = [&](int i) { return proj[i - 1] + proj[i] + proj[i + 1]; };
+    int win = std::max(2, static_cast<int>(pitch * 0.25));
+    double ks[16], ps[16];
+    int m = 0;
+    double o = origin, p = pitch;  // running prediction
+    for (int k = 0; k <= 15; k++) {
+        int c = static_cast<int>(std::lround(o + k * p));
+        int lo = std::max(2, c - win), hi = std::min(n - 3, c + win);
+        if (hi - lo < 2) continue;
+        int best = lo;
+        double sum = 0;
+        for (int i = lo; i <= hi; i++) {
+            double v = smooth(i);
+            sum += v;
+            if (v > smooth(best)) best = i;
+        }
+        // Must be an interior maximum that stands out of its window.
+        if (best == lo || best == hi || smooth(best) < 1.5 * sum / (hi - lo + 1))
+            continue;
+        double a = smooth(best - 1), b = smooth(best), c2 = smooth(best + 1);
+        double den = a - 2 * b + c2;
+        ks[m] = k;
+        ps[m] = best + (den < 0 ? 0.5 * (a - c2) / den : 0);
+        m++;
+        if (m == 1) {
+            o = ps[0] - k * p;
+        } else {
+            double dk = ks[m - 1] - ks[0];
+            if (dk > 0) p = (ps[m - 1] - ps[0]) / dk;
+            o = ps[0] - ks[0] * p;
+        }
+    }
+
+    bool keep[16];
+    std::fill(keep, keep + m, true);
+    for (int kept = m; kept >= GRID_FIT_MIN_LINES; kept--) {
+        double sk = 0, sp = 0, skk = 0, skp = 0;
+        for (int i = 0; i < m; i++) {
+            if (!keep[i]) continue;
+            sk += ks[i]; sp += ps[i]; skk += ks[i] * ks[i]; skp += ks[i] * ps[i];
+        }
+        double det = kept * skk - sk * sk;
+        if (det <= 0) return false;
+        p = (kept * skp - sk * sp) / det;
+        o = (sp - p * sk) / kept;
+
+        int worst = -1;
+        double worst_res = 0, ss = 0;
+        for (int i = 0; i < m; i++) {
+            if (!keep[i]) continue;
+            double res = std::abs(ps[i] - (o + p * ks[i]));
+            ss += res * res;
+            if (res > worst_res) { worst_res = res; worst = i; }
+        }
+        if (worst_res <= GRID_FIT_MAX_RESIDUAL) {
+            out = {o, p, std::sqrt(ss / kept), kept};
+            return true;
+        }
+        keep[worst] = false;
+    }
+    return false;
+}
+
+// Fallback when the fit fails: search (cell_size, origin_x, origin_y) to
+// maximize edge magnitude at the 16 expected grid line positions.  X and Y
+// origins are searched independently for each cell_size, which is both
+// faster and more accurate than a joint 3D search.
+static cv::Rect search_gridlines(const double* vproj, const double* hproj,
+                                 cv::Size img_size, const cv::Rect& best_rect,
+                                 std::ostringstream& log) {
+    double approx_cs = best_rect.width / 15.0;
+    int pos_range = std::max(3, static_cast<int>(approx_cs / 3));
+
+    // Search cell_size at 0.1px precision in ±5% range.
+    int min_cell_10 = static_cast<int>(approx_cs * 9.5);
+    int max_cell_10 = static_cast<int>(approx_cs * 10.5) + 1;
 
     double best_total = -1;
-    int best_ox = sx0, best_oy = sy0;
     double best_cs = approx_cs;
+    int best_ox = best_rect.x, best_oy = best_rect.y;
 
-    for (double cs = min_cs; cs <= max_cs; cs += cs_step) {
-        int board_sz = static_cast<int>(cs * 15);
-        if (board_sz < 50) continue;
+    for (int cell_10 = min_cell_10; cell_10 <= max_cell_10; cell_10++) {
+        double cs = cell_10 / 10.0;
+        int board_sz = static_cast<int>(std::round(cs * 15));
 
-        // Find best x-origin for this cell_size
+        // Best x-origin for this cell_size
         double best_v = -1;
-        int bx = sx0;
-        int ox_max = std::min(sx1 - board_sz, gray.cols - board_sz);
-        for (int ox = sx0; ox <= ox_max; ox++) {
+        int bx = best_rect.x;
+        for (int ox = best_rect.x - pos_range; ox <= best_rect.x + pos_range; ox++) {
+            if (ox < 0 || ox + board_sz > img_size.width) continue;
             double v = 0;
             for (int k = 0; k <= 15; k++) {
                 int gx = ox + static_cast<int>(k * cs);
-                if (gx >= 0 && gx < gray.cols) {
+                if (gx >= 0 && gx < img_size.width) {
                     v += vproj[gx];
                     if (gx > 0) v += vproj[gx - 1] * 0.5;
-                    if (gx + 1 < gray.cols) v += vproj[gx + 1] * 0.5;
+                    if (gx + 1 < img_size.width) v += vproj[gx + 1] * 0.5;
                 }
             }
             if (v > best_v) { best_v = v; bx = ox; }
         }
 
-        // Find best y-origin for this cell_size
+        // Best y-origin for this cell_size
         double best_h = -1;
-        int by = sy0;
-        int oy_max = std::min(sy1 - board_sz, gray.rows - board_sz);
-        for (int oy = sy0; oy <= oy_max; oy++) {
+        int by = best_rect.y;
+        for (int oy = best_rect.y - pos_range; oy <= best_rect.y + pos_range; oy++) {
+            if (oy < 0 || oy + board_sz > img_size.height) continue;
             double h = 0;
             for (int k = 0; k <= 15; k++) {
                 int gy = oy + static_cast<int>(k * cs);
-                if (gy >= 0 && gy < gray.rows) {
+                if (gy >= 0 && gy < img_size.height) {
                     h += hproj[gy];
                     if (gy > 0) h += hproj[gy - 1] * 0.5;
-                    if (gy + 1 < gray.rows) h += hproj[gy + 1] * 0.5;
+                    if (gy + 1 < img_size.height) h += hproj[gy + 1] * 0.5;
                 }
             }
             if (h > best_h) { best_h = h; by = oy; }
@@ -326,58 +438,61 @@ static cv::Rect find_board_gridlines(const cv::Mat& gray, cv::Rect search,
         double total = best_v + best_h;
         if (total > best_total) {
             best_total = total;
+            best_cs = cs;
             best_ox = bx;
             best_oy = by;
-            best_cs = cs;
         }
     }
 
-    int board_size = static_cast<int>(best_cs * 15);
-    if (best_ox + board_size > gray.cols)
-        best_ox = gray.cols - board_size;
-    if (best_oy + board_size > gray.rows)
-        best_oy = gray.rows - board_size;
-    best_ox = std::max(0, best_ox);
-    best_oy = std::max(0, best_oy);
-
-    log << "Gridline detection: cell=" << best_cs
-        << " origin=" << best_ox << "," << best_oy
-        << " size=" << board_size << "\n";
+    int gl_size = static_cast<int>(std::round(best_cs * 15));
+    log << "Grid-line refine: cell=" << best_cs
+        << " (was " << approx_cs << ") pos=" << best_ox
+        << "," << best_oy << " size=" << gl_size << "\n";
+    return cv::Rect(best_ox, best_oy, gl_size, gl_size);
+}
 
-    return cv::Rect(best_ox, best_oy, board_size, board_size);
+// ---------------------------------------------------------------------------
+// Full-image colour conversion (Step 1)
+// ---------------------------------------------------------------------------
+
+// Rows per band: a band of a 1280-wide BGR screenshot is ~60 KB, so it is
+// still in L2 when the second conversion reads it.
+static const int CONVERT_BAND_ROWS = 16;
+
+// gray and hsv of img in one pass over the pixels.  Both conversions are
+// per-pixel, so converting band by band gives the same result as two
+// whole-image cvtColor calls while reading the source once.  Bands run in
+// parallel; the cvtColor calls inside a band then run serially.
+static void convert_gray_hsv(const cv::Mat& img, cv::Mat& gray, cv::Mat& hsv) {
+    gray.create(img.size(), CV_8UC1);
+    hsv.create(img.size(), CV_8UC3);
+    int n_bands = (img.rows + CONVERT_BAND_ROWS - 1) / CONVERT_BAND_ROWS;
+    cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range& r) {
+        for (int b = r.start; b < r.end; b++) {
+            int y0 = b * CONVERT_BAND_ROWS;
+            int y1 = std::min(img.rows, y0 + CONVERT_BAND_ROWS);
+            cv::Mat src = img.rowRange(y0, y1);
+            cv::Mat g = gray.rowRange(y0, y1), h = hsv.rowRange(y0, y1);
+            cv::cvtColor(src, g, cv::COLOR_BGR2GRAY);
+            cv::cvtColor(src, h, cv::COLOR_BGR2HSV);
+        }
+    });
 }
 
 // Forward declarations for label-anchored refinement (defined after CNN section)
 static bool label_net_available();
 static double score_column_labels(const cv::Mat& img, cv::Rect board_rect);
 static double score_row_labels(const cv::Mat& img, cv::Rect board_rect);
+static bool corner_net_seed(const cv::Mat& img, cv::Rect& seed, std::ostringstream& log);
 
 static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log) {
-    // ── Step 1: Contour to get approximate search area ──────────────────
-    cv::Mat gray;
-    cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
-    cv::Mat edges;
-    cv::Canny(gray, edges, 50, 150);
-    cv::Mat dilated;
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
-    cv::dilate(edges, dilated, kernel, cv::Point(-1, -1), 2);
-
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(dilated, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    // ── Step 1: Gray + HSV and the search area ───────────────────────────
+    cv::Mat gray, hsv;
+    gray.allocator = scratch_mat_allocator();
+    hsv.allocator = scratch_mat_allocator();
+    convert_gray_hsv(img, gray, hsv);
 
     cv::Rect search;
-    double best_area = 0;
-    int img_area = img.cols * img.rows;
-    for (const auto& c : contours) {
-        cv::Rect r = cv::boundingRect(c);
-        double area = r.area();
-        double aspect = static_cast<double>(r.width) / r.height;
-        if (area > best_area && area > img_area * 0.04 &&
-            aspect > 0.6 && aspect < 1.6) {
-            best_area = area;
-            search = r;
-        }
-    }
     // Determine if the board likely fills the image width (mobile/memento).
     // Pure aspect ratio is unreliable with cropped screenshots — a desktop
     // crop can be portrait (531x633) and a mobile crop may only be 1.3:1.
@@ -387,11 +502,10 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
     bool wide_board = (img.rows > img.cols * 3 / 2)          // very tall → always mobile
                    || (is_portrait && img.cols >= 800);       // moderately tall + wide
 
-    // For wide-board images, contour detection often picks up player cards
-    // or partial board areas.  Use a generous full-width search area.
-    // For desktop images, dark mode contour detection is unreliable (may
-    // anchor to a UI element right of the board, making the actual board
-    // position unreachable).  Always search from (0,0).
+    // Contour detection was unreliable for both layouts (player cards and
+    // partial boards on mobile, UI elements right of the board on desktop),
+    // so the search area is fixed: the top 3/4 of wide-board images, the
+    // whole image otherwise.
     if (wide_board) {
         int h = img.rows * 3 / 4;
         search = cv::Rect(0, 0, img.cols, h);
@@ -404,8 +518,6 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
     // ── Step 2: Coarse grid search using premium pattern scoring ────────
     // The board is inside the search area. Labels (A-O, 1-15) may consume
     // up to ~20% on top and left. Board size is 60-100% of search area.
-    cv::Mat hsv;
-    cv::cvtColor(img, hsv, cv::COLOR_BGR2HSV);
 
     // Detect light vs dark mode.  Sample 4 corner quadrants of the search
     // area (less likely covered by tiles) + the center.  Light mode boards
@@ -435,8 +547,9 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
     }
 
     // ── Steps 2-4: premium-pattern scoring + gridline refinement ────────
-    // Both light and dark modes use the same pipeline; score_premium
-    // already handles color differences via is_light.
+    // Both light and dark modes use the same pipeline; the scorer is
+    // specialized for the detected mode once, here.
+    PremiumScorer premium = premium_scorer(is_light);
 
     int max_x_offset, max_y_offset, min_size, max_size;
     if (wide_board) {
@@ -461,11 +574,20 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
     cv::Rect best_rect(search.x, search.y, max_size, max_size);
     double best_score = -1e9;
 
+    // A confident corner-CNN seed replaces the coarse and fine searches
+    // (their work lists stay empty); refinement from Step 4a on is shared.
+    cv::Rect seed;
+    bool seeded = corner_net_seed(img, seed, log);
+    if (seeded) {
+        best_rect = seed;
+        best_score = premium(hsv, seed);
+    }
+
     // Flatten the full (size, dy) search space for even thread partitioning.
     // Each work item is a (size, dy) pair; the inner dx loop runs per-item.
     struct CoarseWork { int size, dy; };
-    std::vector<CoarseWork> coarse_work;
-    for (int size = min_size; size <= max_size; size += coarse_size_step)
+    std::pmr::vector<CoarseWork> coarse_work(scratch_resource());
+    for (int size = min_size; !seeded && size <= max_size; size += coarse_size_step)
         for (int dy = 0; dy <= max_y_offset && search.y + dy + size <= img.rows;
              dy += coarse_y_step)
             coarse_work.push_back({size, dy});
@@ -490,7 +612,7 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
                          dx += coarse_x_step) {
                         cv::Rect trial(search.x + dx, search.y + dy,
                                        size, size);
-                        double s = score_premium(hsv, trial, is_light);
+                        double s = premium(hsv, trial);
                         if (s > local_score) {
                             local_score = s;
                             local_best = trial;
@@ -522,10 +644,10 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
 
     // Flatten (size, dy) pairs for even thread partitioning.
     struct FineWork { int size, dy; };
-    std::vector<FineWork> fine_work;
+    std::pmr::vector<FineWork> fine_work(scratch_resource());
     cv::Rect coarse_best = best_rect;
     for (int size = coarse_best.width - fine_size;
-         size <= coarse_best.width + fine_size;
+         !seeded && size <= coarse_best.width + fine_size;
          size += fine_size_step) {
         if (size < 50) continue;
         for (int dy = -fine_pos; dy <= fine_pos; dy += fine_pos_step)
@@ -555,7 +677,7 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
                             x + size > img.cols || y + size > img.rows)
                             continue;
                         cv::Rect trial(x, y, size, size);
-                        double s = score_premium(hsv, trial, is_light);
+                        double s = premium(hsv, trial);
                         if (s > local_score) {
                             local_score = s;
                             local_best = trial;
@@ -580,8 +702,8 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
     {
         int half_cell = best_rect.width / 30;
         cv::Rect prec_best = best_rect;
-        double prec_score = is_light ? score_edges_light(hsv, best_rect)
-                                     : score_premium(hsv, best_rect, false);
+        PremiumScorer precise = is_light ? score_edges_light : premium;
+        double prec_score = precise(hsv, best_rect);
 
         int size_range = wide_board ? 15 : 5;
         {
@@ -606,9 +728,7 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
                                     x + sz > img.cols || y + sz > img.rows)
                                     continue;
                                 cv::Rect trial(x, y, sz, sz);
-                                double s = is_light
-                                    ? score_edges_light(hsv, trial)
-                                    : score_premium(hsv, trial, false);
+                                double s = precise(hsv, trial);
                                 if (s > local_score) {
                                     local_score = s;
                                     local_best = trial;
@@ -635,10 +755,16 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
 
     // ── Step 4b: Gridline refinement via Sobel edge projections ────────
     // All modes have visible grid lines.  Project |Sobel_x| and |Sobel_y|
-    // onto x/y axes, then search (cell_size, origin_x, origin_y) to
-    // maximize edge magnitude at the 16 expected grid line positions.
-    // X and Y origins are searched independently for each cell_size,
-    // which is both faster and more accurate than a joint 3D search.
+    // onto x/y axes, locate the line peaks and fit origin + pitch per axis
+    // (sub-pixel, cells may be non-square); fall back to a search over
+    // (cell_size, origin) when too few lines are found.
+    //
+    // Scope: the fit replaces only this step's search.  4a still seeds it
+    // and 4c/4d still run after it (4d shifts the fitted grid, 4c discards
+    // it in light mode).  Folding 4a, 4c and 4d into the one fit is still
+    // open: 4c needs the shadow extent as a constraint on the outer lines,
+    // 4d the label anchors as a constraint on the origin.
+    cv::Rect2d grid;
     {
         // Compute Sobel edge projections within a padded region.
         int pad = best_rect.width / 10;
@@ -647,88 +773,51 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
         int rx1 = std::min(img.cols, best_rect.x + best_rect.width + pad);
         int ry1 = std::min(img.rows, best_rect.y + best_rect.height + pad);
 
+        // Sobel strip by strip over the padded region only, folding each
+        // strip into the projections while it is in cache.  A strip is a
+        // view into gray, so the filter reads the real neighbouring pixels
+        // at its edges and the sums equal those of a full-image Sobel.
+        // Column-wise sum of |Sobel_x| → peaks at vertical grid lines;
+        // row-wise sum of |Sobel_y| → peaks at horizontal grid lines.
+        const CpuKernels& kern = cpu_kernels();
+        std::pmr::vector<double> vproj(img.cols, 0, scratch_resource());
+        std::pmr::vector<double> hproj(img.rows, 0, scratch_resource());
         cv::Mat sobel_x, sobel_y;
-        cv::Sobel(gray, sobel_x, CV_32F, 1, 0, 3);
-        cv::Sobel(gray, sobel_y, CV_32F, 0, 1, 3);
-
-        // Column-wise sum of |Sobel_x| → peaks at vertical grid lines
-        std::vector<double> vproj(img.cols, 0);
-        for (int y = ry0; y < ry1; y++) {
-            const float* row = sobel_x.ptr<float>(y);
-            for (int x = rx0; x < rx1; x++)
-                vproj[x] += std::abs(row[x]);
-        }
-        // Row-wise sum of |Sobel_y| → peaks at horizontal grid lines
-        std::vector<double> hproj(img.rows, 0);
-        for (int y = ry0; y < ry1; y++) {
-            const float* row = sobel_y.ptr<float>(y);
-            for (int x = rx0; x < rx1; x++)
-                hproj[y] += std::abs(row[x]);
+        sobel_x.allocator = scratch_mat_allocator();
+        sobel_y.allocator = scratch_mat_allocator();
+        for (int y0 = ry0; y0 < ry1; y0 += CONVERT_BAND_ROWS) {
+            int y1 = std::min(ry1, y0 + CONVERT_BAND_ROWS);
+            cv::Mat strip = gray(cv::Rect(rx0, y0, rx1 - rx0, y1 - y0));
+            cv::Sobel(strip, sobel_x, CV_32F, 1, 0, 3);
+            cv::Sobel(strip, sobel_y, CV_32F, 0, 1, 3);
+            for (int y = y0; y < y1; y++) {
+                kern.abs_accumulate(sobel_x.ptr<float>(y - y0), rx1 - rx0,
+                                    vproj.data() + rx0);
+                hproj[y] = kern.abs_sum(sobel_y.ptr<float>(y - y0), rx1 - rx0);
+            }
         }
 
         double approx_cs = best_rect.width / 15.0;
-        int pos_range = std::max(3, static_cast<int>(approx_cs / 3));
-
-        // Search cell_size at 0.1px precision in ±5% range.
-        int min_cell_10 = static_cast<int>(approx_cs * 9.5);
-        int max_cell_10 = static_cast<int>(approx_cs * 10.5) + 1;
-
-        double best_total = -1;
-        double best_cs = approx_cs;
-        int best_ox = best_rect.x, best_oy = best_rect.y;
-
-        for (int cell_10 = min_cell_10; cell_10 <= max_cell_10; cell_10++) {
-            double cs = cell_10 / 10.0;
-            int board_sz = static_cast<int>(std::round(cs * 15));
-
-            // Best x-origin for this cell_size
-            double best_v = -1;
-            int bx = best_rect.x;
-            for (int ox = best_rect.x - pos_range; ox <= best_rect.x + pos_range; ox++) {
-                if (ox < 0 || ox + board_sz > img.cols) continue;
-                double v = 0;
-                for (int k = 0; k <= 15; k++) {
-                    int gx = ox + static_cast<int>(k * cs);
-                    if (gx >= 0 && gx < img.cols) {
-                        v += vproj[gx];
-                        if (gx > 0) v += vproj[gx - 1] * 0.5;
-                        if (gx + 1 < img.cols) v += vproj[gx + 1] * 0.5;
-                    }
-                }
-                if (v > best_v) { best_v = v; bx = ox; }
-            }
-
-            // Best y-origin for this cell_size
-            double best_h = -1;
-            int by = best_rect.y;
-            for (int oy = best_rect.y - pos_range; oy <= best_rect.y + pos_range; oy++) {
-                if (oy < 0 || oy + board_sz > img.rows) continue;
-                double h = 0;
-                for (int k = 0; k <= 15; k++) {
-                    int gy = oy + static_cast<int>(k * cs);
-                    if (gy >= 0 && gy < img.rows) {
-                        h += hproj[gy];
-                        if (gy > 0) h += hproj[gy - 1] * 0.5;
-                        if (gy + 1 < img.rows) h += hproj[gy + 1] * 0.5;
-                    }
-                }
-                if (h > best_h) { best_h = h; by = oy; }
-            }
-
-            double total = best_v + best_h;
-            if (total > best_total) {
-                best_total = total;
-                best_cs = cs;
-                best_ox = bx;
-                best_oy = by;
-            }
+        GridAxisFit fx, fy;
+        bool fitted = fit_grid_axis(vproj.data(), img.cols, best_rect.x, approx_cs, fx)
+                   && fit_grid_axis(hproj.data(), img.rows, best_rect.y, approx_cs, fy)
+                   && std::abs(fx.pitch / approx_cs - 1) <= GRID_FIT_MAX_PITCH_CHANGE
+                   && std::abs(fy.pitch / approx_cs - 1) <= GRID_FIT_MAX_PITCH_CHANGE
+                   && std::abs(fx.pitch / fy.pitch - 1) <= GRID_FIT_MAX_ASPECT;
+        if (fitted) {
+            grid = cv::Rect2d(fx.origin, fy.origin, 15 * fx.pitch, 15 * fy.pitch);
+            best_rect = cv::Rect(static_cast<int>(std::lround(grid.x)),
+                                 static_cast<int>(std::lround(grid.y)),
+                                 static_cast<int>(std::lround(grid.width)),
+                                 static_cast<int>(std::lround(grid.height)));
+            log << "Grid fit: pitch=" << fx.pitch << "x" << fy.pitch
+                << " (was " << approx_cs << ") origin=" << fx.origin << ","
+                << fy.origin << " lines=" << fx.lines << "+" << fy.lines
+                << " rms=" << fx.rms << "/" << fy.rms << "\n";
+        } else {
+            best_rect = search_gridlines(vproj.data(), hproj.data(), img.size(),
+                                         best_rect, log);
         }
-
-        int gl_size = static_cast<int>(std::round(best_cs * 15));
-        log << "Grid-line refine: cell=" << best_cs
-            << " (was " << approx_cs << ") pos=" << best_ox
-            << "," << best_oy << " size=" << gl_size << "\n";
-        best_rect = cv::Rect(best_ox, best_oy, gl_size, gl_size);
     }
 
     // ── Step 4c: Drop-shadow boundary refinement (light mode) ──────────
@@ -750,28 +839,36 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
         int sy0 = best_rect.y + sm, sy1 = best_rect.y + best_rect.height - sm;
         int sx0 = best_rect.x + sm, sx1 = best_rect.x + best_rect.width - sm;
 
-        // Brightness range in a vertical strip (for left/right edges)
+        // Brightness range profiles, built row-major in one pass each:
+        // per column over every other row of the sample band (left/right
+        // edges), and per row over every other column (top/bottom edges).
+        // Only positions the scans below can reach are computed.
+        const CpuKernels& kern = cpu_kernels();
+        auto first_sample = [](int v) { return v < 0 ? v + (1 - v) / 2 * 2 : v; };
+
+        int px0 = std::max(0, best_rect.x - search_ext);
+        int px1 = std::max(px0, std::min(gray.cols,
+                                         best_rect.x + best_rect.width + search_ext));
+        std::pmr::vector<uint8_t> col_mn(px1 - px0, 255, scratch_resource());
+        std::pmr::vector<uint8_t> col_mx(px1 - px0, 0, scratch_resource());
+        for (int y = first_sample(sy0); y < std::min(sy1, gray.rows); y += 2)
+            kern.minmax_accumulate(gray.ptr<uint8_t>(y) + px0, px1 - px0,
+                                   col_mn.data(), col_mx.data());
         auto v_range_col = [&](int x) -> int {
-            if (x < 0 || x >= gray.cols) return 0;
-            uint8_t mn = 255, mx = 0;
-            for (int y = sy0; y < sy1; y += 2) {
-                if (y < 0 || y >= gray.rows) continue;
-                uint8_t v = gray.at<uint8_t>(y, x);
-                mn = std::min(mn, v); mx = std::max(mx, v);
-            }
-            return mx - mn;
+            if (x < px0 || x >= px1) return 0;
+            return col_mx[x - px0] - col_mn[x - px0];
         };
 
-        // Brightness range in a horizontal strip (for top/bottom edges)
+        int py0 = std::max(0, best_rect.y - search_ext);
+        int py1 = std::max(py0, std::min(gray.rows,
+                                         best_rect.y + best_rect.height + search_ext));
+        int rx0 = first_sample(sx0), rx1 = std::min(sx1, gray.cols);
+        std::pmr::vector<int> row_range(py1 - py0, 0, scratch_resource());
+        for (int y = py0; y < py1; y++)
+            row_range[y - py0] = kern.range_step2(gray.ptr<uint8_t>(y) + rx0, rx1 - rx0);
         auto v_range_row = [&](int y) -> int {
-            if (y < 0 || y >= gray.rows) return 0;
-            const uint8_t* rp = gray.ptr<uint8_t>(y);
-            uint8_t mn = 255, mx = 0;
-            for (int x = sx0; x < sx1; x += 2) {
-                if (x < 0 || x >= gray.cols) continue;
-                mn = std::min(mn, rp[x]); mx = std::max(mx, rp[x]);
-            }
-            return mx - mn;
+            if (y < py0 || y >= py1) return 0;
+            return row_range[y - py0];
         };
 
         int range_thresh = 30;
@@ -846,6 +943,7 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
                 << " (was " << best_rect.x << "," << best_rect.y
                 << " " << best_rect.width << "x" << best_rect.height << ")\n";
             best_rect = color_rect;
+            grid = cv::Rect2d();  // the fit found the shadow, not the board
         } else {
             log << "Shadow refine: skipped (too large), would be "
                 << color_rect.x << "," << color_rect.y
@@ -862,29 +960,21 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
         int cs = best_rect.width / 15;
         int coarse_step = 4;
 
+        // Columns fix x and rows fix y, each searched around the same rect:
+        // independent, so both run at once.
+        double best_col_score = 0, best_row_score = 0;
+        int best_dx = 0, best_dy = 0;
+        StageGraph label_stages;
+
         // --- X-axis refinement using column labels ---
-        double best_col_score = score_column_labels(img, best_rect);
-        int best_dx = 0;
-
-        // Early termination: if current position is near-perfect, skip search
-        if (best_col_score < 13.0) {
-            // Coarse search: ±cell_size at 4px steps
-            for (int dx = -cs; dx <= cs; dx += coarse_step) {
-                if (dx == 0) continue;
-                cv::Rect shifted = best_rect;
-                shifted.x += dx;
-                if (shifted.x < 0 || shifted.x + shifted.width > img.cols) continue;
-                double s = score_column_labels(img, shifted);
-                if (s > best_col_score) {
-                    best_col_score = s;
-                    best_dx = dx;
-                }
-            }
-            // Fine search: best ±4px at 1px steps
-            if (best_dx != 0 || best_col_score < 13.0) {
-                int center = best_dx;
-                for (int dx = center - coarse_step; dx <= center + coarse_step; dx++) {
-                    if (dx == best_dx) continue;
+        label_stages.add("label_cols", [&] {
+            best_col_score = score_column_labels(img, best_rect);
+
+            // Early termination: if current position is near-perfect, skip search
+            if (best_col_score < 13.0) {
+                // Coarse search: ±cell_size at 4px steps
+                for (int dx = -cs; dx <= cs; dx += coarse_step) {
+                    if (dx == 0) continue;
                     cv::Rect shifted = best_rect;
                     shifted.x += dx;
                     if (shifted.x < 0 || shifted.x + shifted.width > img.cols) continue;
@@ -894,29 +984,31 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
                         best_dx = dx;
                     }
                 }
+                // Fine search: best ±4px at 1px steps
+                if (best_dx != 0 || best_col_score < 13.0) {
+                    int center = best_dx;
+                    for (int dx = center - coarse_step; dx <= center + coarse_step; dx++) {
+                        if (dx == best_dx) continue;
+                        cv::Rect shifted = best_rect;
+                        shifted.x += dx;
+                        if (shifted.x < 0 || shifted.x + shifted.width > img.cols) continue;
+                        double s = score_column_labels(img, shifted);
+                        if (s > best_col_score) {
+                            best_col_score = s;
+                            best_dx = dx;
+                        }
+                    }
+                }
             }
-        }
+        });
 
         // --- Y-axis refinement using row labels ---
-        double best_row_score = score_row_labels(img, best_rect);
-        int best_dy = 0;
-
-        if (best_row_score < 13.0) {
-            for (int dy = -cs; dy <= cs; dy += coarse_step) {
-                if (dy == 0) continue;
-                cv::Rect shifted = best_rect;
-                shifted.y += dy;
-                if (shifted.y < 0 || shifted.y + shifted.height > img.rows) continue;
-                double s = score_row_labels(img, shifted);
-                if (s > best_row_score) {
-                    best_row_score = s;
-                    best_dy = dy;
-                }
-            }
-            if (best_dy != 0 || best_row_score < 13.0) {
-                int center = best_dy;
-                for (int dy = center - coarse_step; dy <= center + coarse_step; dy++) {
-                    if (dy == best_dy) continue;
+        label_stages.add("label_rows", [&] {
+            best_row_score = score_row_labels(img, best_rect);
+
+            if (best_row_score < 13.0) {
+                for (int dy = -cs; dy <= cs; dy += coarse_step) {
+                    if (dy == 0) continue;
                     cv::Rect shifted = best_rect;
                     shifted.y += dy;
                     if (shifted.y < 0 || shifted.y + shifted.height > img.rows) continue;
@@ -926,8 +1018,23 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
                         best_dy = dy;
                     }
                 }
+                if (best_dy != 0 || best_row_score < 13.0) {
+                    int center = best_dy;
+                    for (int dy = center - coarse_step; dy <= center + coarse_step; dy++) {
+                        if (dy == best_dy) continue;
+                        cv::Rect shifted = best_rect;
+                        shifted.y += dy;
+                        if (shifted.y < 0 || shifted.y + shifted.height > img.rows) continue;
+                        double s = score_row_labels(img, shifted);
+                        if (s > best_row_score) {
+                            best_row_score = s;
+                            best_dy = dy;
+                        }
+                    }
+                }
             }
-        }
+        });
+        label_stages.run();
 
         // Apply correction only if labels were actually detected (avg P > 0.3)
         double avg_col = best_col_score / 15.0;
@@ -938,10 +1045,12 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
 
         if (avg_col > 0.3 && best_dx != 0) {
             best_rect.x += best_dx;
+            grid.x += best_dx;
             log << "  Applied column label correction: dx=" << best_dx << "\n";
         }
         if (avg_row > 0.3 && best_dy != 0) {
             best_rect.y += best_dy;
+            grid.y += best_dy;
             log << "  Applied row label correction: dy=" << best_dy << "\n";
         }
     }
@@ -950,7 +1059,7 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
     log << "Final: rect=" << best_rect.x << "," << best_rect.y
         << " " << best_rect.width << "x" << best_rect.height
         << " cell=" << cell_size << "\n";
-    return {best_rect, cell_size, true, is_light};
+    return {best_rect, cell_size, true, is_light, grid};
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -959,14 +1068,41 @@ static BoardRegion find_board_region(const cv::Mat& img, std::ostringstream& log
 
 using CellImages = cv::Mat[15][15];
 
+// With `only`, cells outside the mask are left empty: classify_cells skips
+// them anyway, and a sequence frame usually changes a handful of cells.
 static void extract_cells(const cv::Mat& img, const BoardRegion& region,
-                          CellImages& cells, std::ostringstream& log) {
-    double cw = static_cast<double>(region.rect.width) / 15.0;
-    double ch = static_cast<double>(region.rect.height) / 15.0;
+                          CellImages& cells, std::ostringstream& log,
+                          const bool (*only)[15] = nullptr) {
     double inset_frac = 0.08;
+    const char* extent = only ? "masked" : "15x15";
+
+    // Fitted grid: crop each cell around its sub-pixel centre, so cells
+    // stay centred across the board instead of drifting by the rounding
+    // of the integer rect.
+    if (region.grid.width > 0 && region.grid.height > 0) {
+        double cw = region.grid.width / 15.0;
+        double ch = region.grid.height / 15.0;
+        cv::Size patch(std::max(1, static_cast<int>(std::lround(cw * (1 - 2 * inset_frac)))),
+                       std::max(1, static_cast<int>(std::lround(ch * (1 - 2 * inset_frac)))));
+        for (int r = 0; r < 15; r++) {
+            for (int c = 0; c < 15; c++) {
+                if (only && !only[r][c]) continue;
+                cv::Point2f centre(static_cast<float>(region.grid.x + (c + 0.5) * cw),
+                                   static_cast<float>(region.grid.y + (r + 0.5) * ch));
+                cells[r][c].allocator = scratch_mat_allocator();
+                cv::getRectSubPix(img, patch, centre, cells[r][c]);
+            }
+        }
+        log << "Extracted " << extent << " cells (sub-pixel, inset="
+            << static_cast<int>(inset_frac * 100) << "%)\n";
+        return;
+    }
 
+    double cw = static_cast<double>(region.rect.width) / 15.0;
+    double ch = static_cast<double>(region.rect.height) / 15.0;
     for (int r = 0; r < 15; r++) {
         for (int c = 0; c < 15; c++) {
+            if (only && !only[r][c]) continue;
             int x0 = region.rect.x + static_cast<int>(c * cw + cw * inset_frac);
             int y0 = region.rect.y + static_cast<int>(r * ch + ch * inset_frac);
             int x1 = region.rect.x + static_cast<int>((c + 1) * cw - cw * inset_frac);
@@ -977,10 +1113,11 @@ static void extract_cells(const cv::Mat& img, const BoardRegion& region,
             x1 = std::max(x0 + 1, std::min(x1, img.cols));
             y1 = std::max(y0 + 1, std::min(y1, img.rows));
 
-            cells[r][c] = img(cv::Rect(x0, y0, x1 - x0, y1 - y0)).clone();
+            cells[r][c].allocator = scratch_mat_allocator();
+            img(cv::Rect(x0, y0, x1 - x0, y1 - y0)).copyTo(cells[r][c]);
         }
     }
-    log << "Extracted 15x15 cells (inset=" << static_cast<int>(inset_frac * 100) << "%)\n";
+    log << "Extracted " << extent << " cells (inset=" << static_cast<int>(inset_frac * 100) << "%)\n";
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -989,7 +1126,7 @@ static void extract_cells(const cv::Mat& img, const BoardRegion& region,
 
 #ifdef HAS_TESSERACT
 static tesseract::TessBaseAPI* get_tess() {
-    static tesseract::TessBaseAPI* api = nullptr;
+    static thread_local tesseract::TessBaseAPI* api = nullptr;
     if (!api) {
         api = new tesseract::TessBaseAPI();
         // OEM_DEFAULT lets Tesseract pick the best engine. The legacy
@@ -1007,8 +1144,45 @@ static tesseract::TessBaseAPI* get_tess() {
 }
 #endif
 
-static bool is_tile(const cv::Mat& cell, bool is_light, int /*row*/, int /*col*/,
-                    std::ostringstream& /*log*/) {
+// The four corner patches (1/5 cell each side) of an inset cell.  Real
+// tiles reach the corners; empty squares show their premium color there.
+static void corner_patches(const cv::Mat& cell, cv::Rect patches[4]) {
+    int kw = std::max(1, cell.cols / 5);
+    int kh = std::max(1, cell.rows / 5);
+    patches[0] = {0,              0,              kw, kh};
+    patches[1] = {cell.cols - kw, 0,              kw, kh};
+    patches[2] = {0,              cell.rows - kh, kw, kh};
+    patches[3] = {cell.cols - kw, cell.rows - kh, kw, kh};
+}
+
+// Mean HSV over the corner patches (each patch converted separately).
+static cv::Scalar corner_mean_hsv(const cv::Mat& cell) {
+    cv::Rect patches[4];
+    corner_patches(cell, patches);
+    cv::Scalar sum(0, 0, 0);
+    for (auto& p : patches) {
+        cv::Mat hsv_p;
+        cv::cvtColor(cell(p), hsv_p, cv::COLOR_BGR2HSV);
+        cv::Scalar m = cv::mean(hsv_p);
+        sum[0] += m[0]; sum[1] += m[1]; sum[2] += m[2];
+    }
+    return cv::Scalar(sum[0]/4, sum[1]/4, sum[2]/4);
+}
+
+// Mean BGR over the corner patches.
+static cv::Scalar corner_mean_bgr(const cv::Mat& cell) {
+    cv::Rect patches[4];
+    corner_patches(cell, patches);
+    cv::Scalar sum(0, 0, 0);
+    for (auto& p : patches) {
+        cv::Scalar m = cv::mean(cell(p));
+        sum[0] += m[0]; sum[1] += m[1]; sum[2] += m[2];
+    }
+    return cv::Scalar(sum[0]/4, sum[1]/4, sum[2]/4);
+}
+
+template <class Theme>
+static bool is_tile(const cv::Mat& cell) {
     // Corner check (light mode): sample the 4 corners of the inset cell.
     // If corners show pure premium-square background color, the cell is empty
     // regardless of what appears in the center (badges, tooltips, etc.).
@@ -1016,23 +1190,9 @@ static bool is_tile(const cv::Mat& cell, bool is_light, int /*row*/, int /*col*/
     // Same color condition as the center is_pink filter, with the same V>160
     // threshold that distinguishes empty premium squares (V~200+) from dark
     // Memento blank tiles (V~120) and crabcat blank tiles (H=145, not pink).
-    if (is_light && cell.channels() == 3) {
-        int kw = std::max(1, cell.cols / 5);
-        int kh = std::max(1, cell.rows / 5);
-        cv::Rect patches[4] = {
-            {0,              0,              kw, kh},
-            {cell.cols - kw, 0,              kw, kh},
-            {0,              cell.rows - kh, kw, kh},
-            {cell.cols - kw, cell.rows - kh, kw, kh},
-        };
-        float ch = 0, cs = 0, cv_val = 0;
-        for (auto& p : patches) {
-            cv::Mat hsv_p;
-            cv::cvtColor(cell(p), hsv_p, cv::COLOR_BGR2HSV);
-            cv::Scalar m = cv::mean(hsv_p);
-            ch += m[0]; cs += m[1]; cv_val += m[2];
-        }
-        ch /= 4; cs /= 4; cv_val /= 4;
+    if (Theme::overlay_checks && cell.channels() == 3) {
+        cv::Scalar chsv = corner_mean_hsv(cell);
+        double ch = chsv[0], cs = chsv[1], cv_val = chsv[2];
         // Pink/red premium (DW/TW): average of all 4 corners
         bool corner_is_premium = ((ch < 12 || ch > 155) && cs > 25 && cv_val > 160);
         if (corner_is_premium) return false;
@@ -1076,7 +1236,7 @@ static bool is_tile(const cv::Mat& cell, bool is_light, int /*row*/, int /*col*/
     // Primary discriminator: contrast from printed letter
     if (contrast >= 28) {
         // Reject light-mode UI overlays that create spurious contrast.
-        if (center.channels() == 3 && is_light) {
+        if (Theme::overlay_checks && center.channels() == 3) {
             cv::Mat hsv;
             cv::cvtColor(center, hsv, cv::COLOR_BGR2HSV);
             cv::Scalar hmean = cv::mean(hsv);
@@ -1107,6 +1267,12 @@ static bool is_tile(const cv::Mat& cell, bool is_light, int /*row*/, int /*col*/
     return false;
 }
 
+using TileTest = bool (*)(const cv::Mat& cell);
+
+static TileTest tile_test(bool is_light) {
+    return is_light ? is_tile<LightTheme> : is_tile<DarkTheme>;
+}
+
 static bool is_blank_tile(const cv::Mat& cell) {
     // Check bottom-right quadrant (where the subscript digit would be).
     // Blank tiles have no subscript, so this area is uniform.
@@ -1229,12 +1395,14 @@ static void blit_glyph(cv::Mat& img, const FT_Bitmap& bmp,
 }
 
 // Render a complete tile: letter centered in upper area, subscript bottom-right.
-static cv::Mat render_tile(FT_Face face, char letter) {
-    cv::Mat img(TMPL_SIZE, TMPL_SIZE, CV_8UC1, cv::Scalar(255));
-    int pts = point_value_of(letter);
+// Blank tiles (with_subscript=false) get the letter only.
+static cv::Mat render_tile(FT_Face face, char letter, int size = TMPL_SIZE,
+                           bool with_subscript = true) {
+    cv::Mat img(size, size, CV_8UC1, cv::Scalar(255));
+    int pts = with_subscript ? point_value_of(letter) : 0;
 
     // ── Main letter: centered in upper ~80% of tile ──
-    int letter_sz = TMPL_SIZE * 58 / 100;  // font pixel size
+    int letter_sz = size * 58 / 100;  // font pixel size
     FT_Set_Pixel_Sizes(face, 0, letter_sz);
     FT_UInt gi = FT_Get_Char_Index(face, static_cast<FT_ULong>(letter));
     if (gi && !FT_Load_Glyph(face, gi, FT_LOAD_RENDER)) {
@@ -1242,8 +1410,8 @@ static cv::Mat render_tile(FT_Face face, char letter) {
         if (bmp.width > 0 && bmp.rows > 0) {
             int asc = static_cast<int>(face->size->metrics.ascender >> 6);
             int desc = static_cast<int>(face->size->metrics.descender >> 6);
-            int area_h = TMPL_SIZE * 80 / 100;
-            int ox = (TMPL_SIZE - static_cast<int>(bmp.width)) / 2;
+            int area_h = size * 80 / 100;
+            int ox = (size - static_cast<int>(bmp.width)) / 2;
             int oy = (area_h + asc - desc) / 2;
             blit_glyph(img, bmp, ox, oy, face->glyph->bitmap_top);
         }
@@ -1252,7 +1420,7 @@ static cv::Mat render_tile(FT_Face face, char letter) {
     // ── Subscript: bottom-right ──
     if (pts > 0) {
         std::string sub = std::to_string(pts);
-        int sub_sz = TMPL_SIZE * 16 / 100;
+        int sub_sz = size * 16 / 100;
         FT_Set_Pixel_Sizes(face, 0, sub_sz);
 
         // Compute total advance width of subscript text
@@ -1263,8 +1431,8 @@ static cv::Mat render_tile(FT_Face face, char letter) {
                 total_adv += static_cast<int>(face->glyph->advance.x >> 6);
         }
 
-        int sub_x = TMPL_SIZE * 92 / 100 - total_adv;
-        int sub_baseline = TMPL_SIZE * 93 / 100;
+        int sub_x = size * 92 / 100 - total_adv;
+        int sub_baseline = size * 93 / 100;
 
         for (char ch : sub) {
             FT_UInt dgi = FT_Get_Char_Index(face, static_cast<FT_ULong>(ch));
@@ -1280,14 +1448,10 @@ static cv::Mat render_tile(FT_Face face, char letter) {
     return img;
 }
 
-static const TileTemplates& get_templates() {
-    static TileTemplates tmpl;
-    if (tmpl.valid) return tmpl;
+// Open the tile font (RobotoMono Bold) from the first path that exists.
+static bool open_tile_font(FT_Library& ft, FT_Face& face) {
+    if (FT_Init_FreeType(&ft)) return false;
 
-    FT_Library ft;
-    if (FT_Init_FreeType(&ft)) return tmpl;
-
-    FT_Face face;
     const char* font_paths[] = {
 #ifdef FONT_PATH
         FONT_PATH,
@@ -1297,14 +1461,20 @@ static const TileTemplates& get_templates() {
         nullptr
     };
 
-    bool loaded = false;
     for (int i = 0; font_paths[i]; i++) {
-        if (FT_New_Face(ft, font_paths[i], 0, &face) == 0) {
-            loaded = true;
-            break;
-        }
+        if (FT_New_Face(ft, font_paths[i], 0, &face) == 0)
+            return true;
     }
-    if (!loaded) { FT_Done_FreeType(ft); return tmpl; }
+    FT_Done_FreeType(ft);
+    return false;
+}
+
+static TileTemplates load_templates() {
+    TileTemplates tmpl;
+
+    FT_Library ft;
+    FT_Face face;
+    if (!open_tile_font(ft, face)) return tmpl;
 
     for (int i = 0; i < 26; i++) {
         cv::Mat tile = render_tile(face, 'A' + i);
@@ -1318,6 +1488,67 @@ static const TileTemplates& get_templates() {
     return tmpl;
 }
 
+// Rendered once; function-local static init is safe when several threads
+// run the pipeline concurrently (e.g. the parallel extract_* tools).
+static const TileTemplates& get_templates() {
+    static const TileTemplates tmpl = load_templates();
+    return tmpl;
+}
+
+// Per-thread font handle for render_tile_mask / render_text_mask.  FreeType
+// faces are not safe to share between threads; each thread keeps its own
+// for the life of the process.
+static FT_Face thread_tile_face() {
+    struct FontHandle {
+        FT_Library ft = nullptr;
+        FT_Face face = nullptr;
+        bool attempted = false;
+    };
+    static thread_local FontHandle h;
+    if (!h.attempted) {
+        h.attempted = true;
+        if (!open_tile_font(h.ft, h.face)) h.face = nullptr;
+    }
+    return h.face;
+}
+
+cv::Mat render_tile_mask(char letter, int size, bool with_subscript) {
+    FT_Face face = thread_tile_face();
+    if (!face || size < 4) return cv::Mat::zeros(std::max(1, size), std::max(1, size), CV_8UC1);
+    cv::Mat img = render_tile(face, static_cast<char>(
+        std::toupper(static_cast<unsigned char>(letter))), size, with_subscript);
+    cv::bitwise_not(img, img);
+    return img;
+}
+
+cv::Mat render_text_mask(const std::string& text, int pixel_size) {
+    FT_Face face = thread_tile_face();
+    if (!face || text.empty() || pixel_size < 2)
+        return cv::Mat::zeros(std::max(1, pixel_size), 1, CV_8UC1);
+    FT_Set_Pixel_Sizes(face, 0, pixel_size);
+
+    int asc = static_cast<int>(face->size->metrics.ascender >> 6);
+    int desc = static_cast<int>(face->size->metrics.descender >> 6);
+    int width = 0;
+    for (char ch : text) {
+        FT_UInt gi = FT_Get_Char_Index(face, static_cast<FT_ULong>(ch));
+        if (gi && !FT_Load_Glyph(face, gi, FT_LOAD_DEFAULT))
+            width += static_cast<int>(face->glyph->advance.x >> 6);
+    }
+    cv::Mat img(std::max(1, asc - desc), std::max(1, width), CV_8UC1,
+                cv::Scalar(255));
+    int pen_x = 0;
+    for (char ch : text) {
+        FT_UInt gi = FT_Get_Char_Index(face, static_cast<FT_ULong>(ch));
+        if (!gi || FT_Load_Glyph(face, gi, FT_LOAD_RENDER)) continue;
+        blit_glyph(img, face->glyph->bitmap, pen_x + face->glyph->bitmap_left,
+                   asc, face->glyph->bitmap_top);
+        pen_x += static_cast<int>(face->glyph->advance.x >> 6);
+    }
+    cv::bitwise_not(img, img);
+    return img;
+}
+
 // ═══════════════════════════════════════════════════════════════════════════════
 // Scrabble tile distribution (for distribution-aware refinement)
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -1331,10 +1562,8 @@ static const int TILE_DIST[26] = {
 // Cell classification with template matching
 // ═══════════════════════════════════════════════════════════════════════════════
 
-// Compute match scores for all 26 templates against a cell image.
-// Cell must already be confirmed as a tile.
-static void compute_scores(const cv::Mat& cell, const TileTemplates& tmpl,
-                            float scores[26]) {
+// Resize, gray, polarity-normalize and blur a tile cell like the templates.
+static cv::Mat prepare_match_image(const cv::Mat& cell) {
     cv::Mat resized;
     cv::resize(cell, resized, cv::Size(TMPL_SIZE, TMPL_SIZE), 0, 0, cv::INTER_CUBIC);
 
@@ -1349,6 +1578,14 @@ static void compute_scores(const cv::Mat& cell, const TileTemplates& tmpl,
     if (m[0] < 128) cv::bitwise_not(gray, gray);
 
     cv::GaussianBlur(gray, gray, cv::Size(3, 3), 1.0);
+    return gray;
+}
+
+// Compute match scores for all 26 templates against a cell image.
+// Cell must already be confirmed as a tile.
+static void compute_scores(const cv::Mat& cell, const TileTemplates& tmpl,
+                            float scores[26]) {
+    cv::Mat gray = prepare_match_image(cell);
 
     // Same-size matching: 1×1 result per template
     for (int i = 0; i < 26; i++) {
@@ -1359,35 +1596,143 @@ static void compute_scores(const cv::Mat& cell, const TileTemplates& tmpl,
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
-// CNN-based tile classification (replaces template matching when model available)
+// Model pools
 // ═══════════════════════════════════════════════════════════════════════════════
+//
+// forward() mutates a Net's internal buffers, and its output Mat points into
+// them, so one Net serves one caller at a time.  Each model keeps a pool of
+// loaded copies shared by every thread, at most one per hardware thread by
+// default, so concurrent requests (and the label_cols/label_rows stages) run
+// in parallel as with per-thread nets but idle threads hold none.  Copies
+// are loaded on first use, when every existing one is busy, and kept for
+// the life of the process; set_model_pool_size() changes the cap.
+
+static std::atomic<int> g_model_pool_size{
+    std::max(1, static_cast<int>(std::thread::hardware_concurrency()))};
+
+void set_model_pool_size(int n) {
+    g_model_pool_size.store(std::max(1, n));
+}
 
-static const int CNN_INPUT_SIZE = 48;
+class ModelPool {
+public:
+    // paths: nullptr-terminated candidates, the first readable one is used.
+    // When the environment variable `env` is set, its path is the only
+    // candidate (a model under evaluation, or a nonexistent path to test
+    // the no-model fallbacks).
+    ModelPool(const char* const* paths, const char* env) : paths_(paths), env_(env) {}
+
+    // A pooled Net, returned to the pool on destruction; empty (and false)
+    // when the model could not be loaded.
+    class Lease {
+    public:
+        Lease(ModelPool* pool, std::unique_ptr<cv::dnn::Net> net)
+            : pool_(pool), net_(std::move(net)) {}
+        Lease(Lease&& o) noexcept : pool_(o.pool_), net_(std::move(o.net_)) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { if (net_) pool_->give_back(std::move(net_)); }
+        explicit operator bool() const { return net_ != nullptr; }
+        cv::dnn::Net* operator->() const { return net_.get(); }
+        cv::dnn::Net& operator*() const { return *net_; }
+    private:
+        ModelPool* pool_;
+        std::unique_ptr<cv::dnn::Net> net_;
+    };
 
-static cv::dnn::Net& get_tile_net() {
-    static cv::dnn::Net net;
-    static bool attempted = false;
-    if (!attempted) {
-        attempted = true;
-        const char* model_paths[] = {
-#ifdef TILE_MODEL_PATH
-            TILE_MODEL_PATH,
-#endif
-            "models/tile_model.onnx",
-            nullptr
-        };
-        for (int i = 0; model_paths[i]; i++) {
+    Lease acquire() {
+        std::unique_lock<std::mutex> lock(mu_);
+        probe_locked();
+        if (!path_) return Lease(this, nullptr);
+        cv_.wait(lock, [&] {
+            return !free_.empty() || loaded_ < g_model_pool_size.load();
+        });
+        if (!free_.empty()) {
+            std::unique_ptr<cv::dnn::Net> net = std::move(free_.back());
+            free_.pop_back();
+            return Lease(this, std::move(net));
+        }
+        loaded_++;
+        lock.unlock();
+        // The path loaded once already; read it again for the new copy.
+        try {
+            auto net = std::make_unique<cv::dnn::Net>(cv::dnn::readNetFromONNX(path_));
+            return Lease(this, std::move(net));
+        } catch (...) {
+            lock.lock();
+            loaded_--;
+            cv_.notify_one();
+            throw;
+        }
+    }
+
+    // Path the model was loaded from, nullptr if no candidate loads.
+    const char* path() {
+        std::lock_guard<std::mutex> lock(mu_);
+        probe_locked();
+        return path_;
+    }
+
+    bool available() { return path() != nullptr; }
+
+private:
+    // Load the first copy from the first candidate that reads.
+    void probe_locked() {
+        if (probed_) return;
+        probed_ = true;
+        const char* forced = std::getenv(env_);
+        if (forced && *forced) override_ = forced;
+        const char* const only[] = {override_.c_str(), nullptr};
+        const char* const* paths = override_.empty() ? paths_ : only;
+        for (int i = 0; paths[i]; i++) {
             try {
-                net = cv::dnn::readNetFromONNX(model_paths[i]);
-                if (!net.empty()) break;
+                auto net = std::make_unique<cv::dnn::Net>(
+                    cv::dnn::readNetFromONNX(paths[i]));
+                if (net->empty()) continue;
+                path_ = paths[i];
+                free_.push_back(std::move(net));
+                loaded_ = 1;
+                return;
             } catch (...) {}
         }
     }
-    return net;
-}
+
+    void give_back(std::unique_ptr<cv::dnn::Net> net) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            free_.push_back(std::move(net));
+        }
+        cv_.notify_one();
+    }
+
+    const char* const* paths_;
+    const char* env_;
+    std::string override_;  // value of env_, path_ may point into it
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool probed_ = false;
+    const char* path_ = nullptr;
+    int loaded_ = 0;
+    std::vector<std::unique_ptr<cv::dnn::Net>> free_;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// CNN-based tile classification (replaces template matching when model available)
+// ═══════════════════════════════════════════════════════════════════════════════
+
+static const int CNN_INPUT_SIZE = 48;
+
+static const char* const TILE_MODEL_PATHS[] = {
+#ifdef TILE_MODEL_PATH
+    TILE_MODEL_PATH,
+#endif
+    "models/tile_model.onnx",
+    nullptr
+};
+static ModelPool g_tile_model(TILE_MODEL_PATHS, "CGP_TILE_MODEL");
 
 static bool tile_net_available() {
-    return !get_tile_net().empty();
+    return g_tile_model.available();
 }
 
 // Preprocess cell for CNN: must exactly match training/dataset.py preprocess().
@@ -1412,6 +1757,10 @@ static cv::Mat preprocess_for_cnn(const cv::Mat& cell) {
     return gray;
 }
 
+cv::Mat preprocess_tile_for_cnn(const cv::Mat& crop) {
+    return preprocess_for_cnn(crop);
+}
+
 // Compute scores using CNN.  Output is softmax probabilities in scores[26].
 static void compute_scores_cnn(const cv::Mat& cell, float scores[26]) {
     cv::Mat gray = preprocess_for_cnn(cell);
@@ -1422,9 +1771,10 @@ static void compute_scores_cnn(const cv::Mat& cell, float scores[26]) {
     cv::Mat blob = cv::dnn::blobFromImage(flt, 1.0, cv::Size(), cv::Scalar(),
                                            false, false, CV_32F);
 
-    cv::dnn::Net& net = get_tile_net();
-    net.setInput(blob);
-    cv::Mat output = net.forward();  // 1x26 raw logits
+    ModelPool::Lease net = g_tile_model.acquire();
+    if (!net) throw std::runtime_error("tile model unavailable");
+    net->setInput(blob);
+    cv::Mat output = net->forward();  // 1x26 raw logits
 
     // Softmax to get probabilities
     const float* logits = output.ptr<float>(0);
@@ -1460,9 +1810,10 @@ static void compute_scores_cnn_batch(const std::vector<cv::Mat>& images,
     cv::Mat blob = cv::dnn::blobFromImages(float_imgs, 1.0, cv::Size(),
                                             cv::Scalar(), false, false, CV_32F);
 
-    cv::dnn::Net& net = get_tile_net();
-    net.setInput(blob);
-    cv::Mat output = net.forward();  // Nx26 raw logits
+    ModelPool::Lease net = g_tile_model.acquire();
+    if (!net) throw std::runtime_error("tile model unavailable");
+    net->setInput(blob);
+    cv::Mat output = net->forward();  // Nx26 raw logits
 
     // Apply softmax per row
     for (int i = 0; i < n; i++) {
@@ -1503,35 +1854,189 @@ static void pick_best(const float scores[26], CellResult& cell) {
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
-// Label CNN: column/row label recognition for grid alignment verification
+// Multi-head tile CNN (optional; replaces the occupancy/blank/tooltip passes)
 // ═══════════════════════════════════════════════════════════════════════════════
+//
+// One forward pass over every cell of the board.  Input is the BGR cell
+// resized to 48x48 (INTER_AREA), float [0,1], NCHW: colour is kept, since
+// occupancy and blank detection depend on it.  Outputs (raw logits, see
+// train_tile_heads.py):
+//   occupancy  N x 3   empty, tile, phantom (tooltip/overlay on an empty square)
+//   letter     N x 26  A-Z (designated letter for blanks)
+//   blank      N x 2   lettered tile, blank
+//   subscript  N x 11  printed point value 0-10, 0 = none
+// Used only with CGP_TILE_HEADS=1 (see tile_heads_enabled()); otherwise, or
+// without the model, classify_cells() runs the heuristic passes.
+
+static const int HEADS_INPUT_SIZE = 48;
+static const int HEADS_SUB_CLASSES = 11;
+enum { OCC_EMPTY, OCC_TILE, OCC_PHANTOM, OCC_CLASSES };
+
+struct TileHeads {
+    float occ[OCC_CLASSES];
+    float letter[26];
+    float blank;  // P(blank)
+    float sub[HEADS_SUB_CLASSES];
+};
 
-static const int NUM_LABEL_CLASSES = 30;  // A-O (0-14) + 1-15 (15-29)
+// Opt-in until an eval_local comparison against tile_model.onnx shows the
+// heads model is at least as accurate on testdata; only then should its
+// presence alone switch classify_cells() over.
+static bool tile_heads_enabled() {
+    static const bool enabled = [] {
+        const char* v = std::getenv("CGP_TILE_HEADS");
+        return v && std::atoi(v) != 0;
+    }();
+    return enabled;
+}
 
-static cv::dnn::Net& get_label_net() {
-    static cv::dnn::Net net;
-    static bool attempted = false;
-    if (!attempted) {
-        attempted = true;
-        const char* model_paths[] = {
-#ifdef LABEL_MODEL_PATH
-            LABEL_MODEL_PATH,
+static const char* const TILE_HEADS_MODEL_PATHS[] = {
+#ifdef TILE_HEADS_MODEL_PATH
+    TILE_HEADS_MODEL_PATH,
 #endif
-            "models/label_model.onnx",
-            nullptr
-        };
-        for (int i = 0; model_paths[i]; i++) {
-            try {
-                net = cv::dnn::readNetFromONNX(model_paths[i]);
-                if (!net.empty()) break;
-            } catch (...) {}
+    "models/tile_heads.onnx",
+    nullptr
+};
+static ModelPool g_heads_model(TILE_HEADS_MODEL_PATHS, "CGP_TILE_HEADS_MODEL");
+
+static bool heads_net_available() {
+    return tile_heads_enabled() && g_heads_model.available();
+}
+
+static void softmax(const float* logits, int n, float* out) {
+    float max_val = *std::max_element(logits, logits + n);
+    float sum = 0;
+    for (int i = 0; i < n; i++) {
+        out[i] = std::exp(logits[i] - max_val);
+        sum += out[i];
+    }
+    for (int i = 0; i < n; i++)
+        out[i] /= sum;
+}
+
+static void compute_tile_heads_batch(const std::vector<cv::Mat>& images,
+                                     std::vector<TileHeads>& out) {
+    int n = static_cast<int>(images.size());
+    out.resize(n);
+    if (n == 0) return;
+
+    std::vector<cv::Mat> float_imgs;
+    float_imgs.reserve(n);
+    for (const cv::Mat& cell : images) {
+        cv::Mat resized, flt;
+        cv::resize(cell, resized, cv::Size(HEADS_INPUT_SIZE, HEADS_INPUT_SIZE),
+                   0, 0, cv::INTER_AREA);
+        if (resized.channels() == 1)
+            cv::cvtColor(resized, resized, cv::COLOR_GRAY2BGR);
+        resized.convertTo(flt, CV_32F, 1.0 / 255.0);
+        float_imgs.push_back(flt);
+    }
+    cv::Mat blob = cv::dnn::blobFromImages(float_imgs, 1.0, cv::Size(),
+                                            cv::Scalar(), false, false, CV_32F);
+
+    static const std::vector<std::string> names = {
+        "occupancy", "letter", "blank", "subscript"};
+    ModelPool::Lease net = g_heads_model.acquire();
+    if (!net) throw std::runtime_error("tile heads model unavailable");
+    net->setInput(blob);
+    std::vector<cv::Mat> outs;
+    net->forward(outs, names);
+
+    for (int i = 0; i < n; i++) {
+        TileHeads& h = out[i];
+        softmax(outs[0].ptr<float>(i), OCC_CLASSES, h.occ);
+        softmax(outs[1].ptr<float>(i), 26, h.letter);
+        float blank[2];
+        softmax(outs[2].ptr<float>(i), 2, blank);
+        h.blank = blank[1];
+        softmax(outs[3].ptr<float>(i), HEADS_SUB_CLASSES, h.sub);
+    }
+}
+
+// classify_cells() with the multi-head CNN: occupancy, letter, blank and
+// subscript for all requested cells from one batch.
+static void classify_cells_heads(const CellImages& cell_imgs,
+                                 CellResult cells[15][15],
+                                 float (*all_scores)[15][26],
+                                 const bool (*only)[15],
+                                 std::ostringstream& log) {
+    struct CellRef { int r, c; };
+    std::pmr::vector<CellRef> refs(scratch_resource());
+    std::vector<cv::Mat> images;
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            if (only && !only[r][c]) continue;
+            if (cell_imgs[r][c].empty()) continue;
+            refs.push_back({r, c});
+            images.push_back(cell_imgs[r][c]);
+        }
+    }
+    std::vector<TileHeads> heads;
+    compute_tile_heads_batch(images, heads);
+
+    int tile_count = 0, phantoms = 0, ocr_fail = 0;
+    for (size_t i = 0; i < refs.size(); i++) {
+        int r = refs[i].r, c = refs[i].c;
+        const TileHeads& h = heads[i];
+        int occ = static_cast<int>(std::max_element(h.occ, h.occ + OCC_CLASSES) - h.occ);
+        if (occ == OCC_PHANTOM) {
+            log << "  Phantom [" << r+1 << "," << (char)('A'+c) << "] p="
+                << (int)(h.occ[OCC_PHANTOM] * 1000) / 1000.0 << "\n";
+            phantoms++;
+        }
+        if (occ != OCC_TILE) continue;
+        tile_count++;
+
+        // A lettered tile's printed value must agree with its letter, so
+        // weight each letter by the subscript head's belief in its value.
+        float* s = all_scores[r][c];
+        bool blank = h.blank >= 0.5f;
+        float sum = 0;
+        for (int j = 0; j < 26; j++) {
+            s[j] = h.letter[j];
+            if (!blank) s[j] *= h.sub[point_value_of('A' + j)];
+            sum += s[j];
+        }
+        if (sum > 0)
+            for (int j = 0; j < 26; j++) s[j] /= sum;
+        else
+            std::memcpy(s, h.letter, sizeof(h.letter));
+
+        CellResult& cell = cells[r][c];
+        pick_best(s, cell);
+        if (cell.letter == '?') {
+            ocr_fail++;
+        } else if (blank) {
+            cell.is_blank = true;
+            cell.subscript = 0;
+            cell.letter = static_cast<char>(
+                std::tolower(static_cast<unsigned char>(cell.letter)));
         }
     }
-    return net;
+
+    if (phantoms > 0)
+        log << "Tile heads: rejected " << phantoms << " phantom(s)\n";
+    log << "Classified: " << tile_count << " tiles, " << ocr_fail << " OCR failures"
+        << " (method=heads, model=" << g_heads_model.path() << ")\n";
 }
 
+// ═══════════════════════════════════════════════════════════════════════════════
+// Label CNN: column/row label recognition for grid alignment verification
+// ═══════════════════════════════════════════════════════════════════════════════
+
+static const int NUM_LABEL_CLASSES = 30;  // A-O (0-14) + 1-15 (15-29)
+
+static const char* const LABEL_MODEL_PATHS[] = {
+#ifdef LABEL_MODEL_PATH
+    LABEL_MODEL_PATH,
+#endif
+    "models/label_model.onnx",
+    nullptr
+};
+static ModelPool g_label_model(LABEL_MODEL_PATHS, "CGP_LABEL_MODEL");
+
 static bool label_net_available() {
-    return !get_label_net().empty();
+    return g_label_model.available();
 }
 
 // Run batched label CNN inference on a vector of crops.
@@ -1553,9 +2058,10 @@ static void compute_label_scores_batch(const std::vector<cv::Mat>& images,
     cv::Mat blob = cv::dnn::blobFromImages(float_imgs, 1.0, cv::Size(),
                                             cv::Scalar(), false, false, CV_32F);
 
-    cv::dnn::Net& net = get_label_net();
-    net.setInput(blob);
-    cv::Mat output = net.forward();  // Nx30 raw logits
+    ModelPool::Lease net = g_label_model.acquire();
+    if (!net) throw std::runtime_error("label model unavailable");
+    net->setInput(blob);
+    cv::Mat output = net->forward();  // Nx30 raw logits
 
     for (int i = 0; i < n; i++) {
         const float* logits = output.ptr<float>(i);
@@ -1644,6 +2150,113 @@ static double score_row_labels(const cv::Mat& img, cv::Rect board_rect) {
     return total;
 }
 
+// ═══════════════════════════════════════════════════════════════════════════════
+// Corner CNN: optional stage-1 seed from board-corner heatmaps
+// ═══════════════════════════════════════════════════════════════════════════════
+//
+// Input: the whole image resized to CORNER_INPUT_SIZE square (INTER_AREA, no
+// aspect preservation), BGR scaled to [0, 1].  Output: 4 sigmoid heatmaps at
+// CORNER_GRID resolution, one per board corner (TL, TR, BR, BL).  Must match
+// train_corner_model.py.  Cost is independent of the screenshot resolution.
+
+static const int CORNER_INPUT_SIZE = 256;
+static const int CORNER_GRID = 64;
+// Every corner peak must reach this, else the grid search runs as before.
+static const float CORNER_MIN_PEAK = 0.5f;
+// The four corners must form an axis-aligned square: side lengths within
+// this fraction of their mean, edges level within it too.
+static const double CORNER_MAX_SKEW = 0.06;
+
+static const char* const CORNER_MODEL_PATHS[] = {
+#ifdef CORNER_MODEL_PATH
+    CORNER_MODEL_PATH,
+#endif
+    "models/corner_model.onnx",
+    nullptr
+};
+static ModelPool g_corner_model(CORNER_MODEL_PATHS, "CGP_CORNER_MODEL");
+
+// Peak of one heatmap, refined by the 3x3 weighted centroid around it.
+// Returns the peak value; (x, y) in heatmap cells.
+static float heatmap_peak(const float* hm, double& x, double& y) {
+    int best = 0;
+    for (int i = 1; i < CORNER_GRID * CORNER_GRID; i++)
+        if (hm[i] > hm[best]) best = i;
+    int px = best % CORNER_GRID, py = best / CORNER_GRID;
+    double sw = 0, sx = 0, sy = 0;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            int qx = px + dx, qy = py + dy;
+            if (qx < 0 || qy < 0 || qx >= CORNER_GRID || qy >= CORNER_GRID) continue;
+            double w = hm[qy * CORNER_GRID + qx];
+            sw += w; sx += w * qx; sy += w * qy;
+        }
+    }
+    x = sw > 0 ? sx / sw : px;
+    y = sw > 0 ? sy / sw : py;
+    return hm[best];
+}
+
+// Board rect from the corner heatmaps, or false when the model is missing,
+// unsure, or the corners do not form a plausible board.
+static bool corner_net_seed(const cv::Mat& img, cv::Rect& seed, std::ostringstream& log) {
+    if (img.empty()) return false;
+    ModelPool::Lease net = g_corner_model.acquire();
+    if (!net) return false;
+
+    cv::Mat thumb;
+    cv::resize(img, thumb, cv::Size(CORNER_INPUT_SIZE, CORNER_INPUT_SIZE), 0, 0,
+               cv::INTER_AREA);
+    cv::Mat blob = cv::dnn::blobFromImage(thumb, 1.0 / 255.0);
+    net->setInput(blob);
+    cv::Mat out;
+    try {
+        out = net->forward();
+    } catch (...) {
+        return false;
+    }
+    if (out.total() != static_cast<size_t>(4 * CORNER_GRID * CORNER_GRID)) return false;
+
+    const float* maps = reinterpret_cast<const float*>(out.data);
+    double cx[4], cy[4];
+    float min_peak = 1;
+    double sx = static_cast<double>(img.cols) / CORNER_GRID;
+    double sy = static_cast<double>(img.rows) / CORNER_GRID;
+    for (int k = 0; k < 4; k++) {
+        double hx, hy;
+        min_peak = std::min(min_peak,
+                            heatmap_peak(maps + k * CORNER_GRID * CORNER_GRID, hx, hy));
+        cx[k] = (hx + 0.5) * sx;
+        cy[k] = (hy + 0.5) * sy;
+    }
+    if (min_peak < CORNER_MIN_PEAK) {
+        log << "Corner CNN: low confidence (" << min_peak << "), searching\n";
+        return false;
+    }
+
+    // 0=TL 1=TR 2=BR 3=BL
+    double sides[4] = {cx[1] - cx[0], cy[2] - cy[1], cx[2] - cx[3], cy[3] - cy[0]};
+    double side = (sides[0] + sides[1] + sides[2] + sides[3]) / 4;
+    bool square = side > 0;
+    for (double d : sides)
+        square = square && std::abs(d - side) <= side * CORNER_MAX_SKEW;
+    square = square && std::abs(cy[1] - cy[0]) <= side * CORNER_MAX_SKEW
+                    && std::abs(cx[3] - cx[0]) <= side * CORNER_MAX_SKEW;
+    if (!square) {
+        log << "Corner CNN: corners not a square board, searching\n";
+        return false;
+    }
+
+    int size = static_cast<int>(std::round(side));
+    int x = static_cast<int>(std::round((cx[0] + cx[3]) / 2));
+    int y = static_cast<int>(std::round((cy[0] + cy[1]) / 2));
+    seed = cv::Rect(x, y, size, size);
+    if ((seed & cv::Rect(0, 0, img.cols, img.rows)) != seed) return false;
+    log << "Corner CNN seed: peak=" << min_peak << " rect=" << seed.x << ","
+        << seed.y << " " << seed.width << "x" << seed.height << "\n";
+    return true;
+}
+
 // Classify a single tile crop (e.g. a rack tile) into a CellResult.
 CellResult classify_single_tile(const cv::Mat& tile_image, bool check_blank) {
     CellResult cell = {};
@@ -1832,22 +2445,143 @@ static void refine_distribution(CellResult cells[15][15],
     }
 }
 
+// Pass 1b / 2b measurements, shared with extract_board_features().
+
+// Mean Sobel magnitude in the border ring (outer 1/4, excluding the inner
+// 1/2).  Real tiles are rounded rectangles inset from the cell boundary, so
+// the tile-to-premium transition puts strong edges here.
+static double border_gradient(const cv::Mat& cell) {
+    cv::Mat gray_cell;
+    if (cell.channels() == 3) cv::cvtColor(cell, gray_cell, cv::COLOR_BGR2GRAY);
+    else gray_cell = cell;
+    cv::Mat grad_x, grad_y;
+    cv::Sobel(gray_cell, grad_x, CV_16S, 1, 0, 3);
+    cv::Sobel(gray_cell, grad_y, CV_16S, 0, 1, 3);
+    cv::Mat abs_gx, abs_gy, grad;
+    cv::convertScaleAbs(grad_x, abs_gx);
+    cv::convertScaleAbs(grad_y, abs_gy);
+    cv::addWeighted(abs_gx, 0.5, abs_gy, 0.5, 0, grad);
+
+    int bx = cell.cols / 4, by = cell.rows / 4;
+    cv::Mat mask = cv::Mat::ones(cell.rows, cell.cols, CV_8U);
+    if (bx > 0 && by > 0 && cell.cols - 2*bx > 0 && cell.rows - 2*by > 0)
+        mask(cv::Rect(bx, by, cell.cols - 2*bx, cell.rows - 2*by)) = 0;
+    return cv::mean(grad, mask)[0];
+}
+
+// Max per-channel distance between the center half of the cell and an
+// empty-square reference color.
+static double center_ref_dist(const cv::Mat& cell, const cv::Scalar& ref) {
+    int cx = cell.cols / 4, cy = cell.rows / 4;
+    int cw = cell.cols / 2, ch = cell.rows / 2;
+    cv::Scalar ctr = cv::mean(cell(cv::Rect(cx, cy, cw, ch)));
+    return std::max({std::abs(ctr[0] - ref[0]),
+                     std::abs(ctr[1] - ref[1]),
+                     std::abs(ctr[2] - ref[2])});
+}
+
+// Laplacian variance in the bottom-right subscript region (60-90% x,
+// 60-90% y).  Returns -1 when the region is too small to measure.
+static double subscript_laplacian_var(const cv::Mat& cell) {
+    int sx = cell.cols * 60 / 100;
+    int sy = cell.rows * 60 / 100;
+    int sw = cell.cols * 30 / 100;
+    int sh = cell.rows * 30 / 100;
+    if (sw < 4 || sh < 4) return -1;
+
+    cv::Mat sub = cell(cv::Rect(sx, sy, sw, sh));
+    cv::Mat sg;
+    if (sub.channels() == 3) cv::cvtColor(sub, sg, cv::COLOR_BGR2GRAY);
+    else sg = sub;
+    cv::Mat lapl;
+    cv::Laplacian(sg, lapl, CV_16S, 3);
+    cv::Scalar lm, ls;
+    cv::meanStdDev(lapl, lm, ls);
+    return ls[0] * ls[0];
+}
+
+// Pass 1b calibration: for each premium type (0-5), average corner BGR
+// from clearly-empty cells (unblurred center contrast <= 8).  A reference is
+// only usable when empty_count[p] >= 2.
+static void calibrate_empty_refs(const CellImages& cell_imgs,
+                                 cv::Scalar empty_ref[6], int empty_count[6]) {
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            const cv::Mat& cell = cell_imgs[r][c];
+            if (cell.empty() || cell.channels() != 3) continue;
+
+            // Quick center contrast check
+            int cx = cell.cols / 5, cy = cell.rows / 5;
+            int cw = cell.cols * 3 / 5, ch = cell.rows * 3 / 5;
+            if (cw <= 0 || ch <= 0) continue;
+            cv::Mat ctr = cell(cv::Rect(cx, cy, cw, ch));
+            cv::Mat gray;
+            cv::cvtColor(ctr, gray, cv::COLOR_BGR2GRAY);
+            cv::Scalar gm, gs;
+            cv::meanStdDev(gray, gm, gs);
+            if (gs[0] > 8) continue;  // not clearly empty
+
+            int p = PREMIUM[r][c];
+            cv::Scalar bgr = corner_mean_bgr(cell);
+            empty_ref[p][0] += bgr[0];
+            empty_ref[p][1] += bgr[1];
+            empty_ref[p][2] += bgr[2];
+            empty_count[p]++;
+        }
+    }
+
+    // Finalize averages
+    for (int p = 0; p < 6; p++) {
+        if (empty_count[p] >= 2) {
+            empty_ref[p][0] /= empty_count[p];
+            empty_ref[p][1] /= empty_count[p];
+            empty_ref[p][2] /= empty_count[p];
+        }
+    }
+}
+
+// With `only`, just the marked cells are (re)classified; the others keep
+// their entries in `cells` and `scores`.  `scores` carries the per-cell
+// letter scores across calls (frame sequences) so the distribution
+// refinement still sees the whole board.
 static void classify_cells(const CellImages& cell_imgs,
                            CellResult cells[15][15],
                            bool is_light,
-                           std::ostringstream& log) {
+                           std::ostringstream& log,
+                           const bool (*only)[15] = nullptr,
+                           float (*scores)[15][26] = nullptr) {
     const auto& tmpl = get_templates();
     // Store all 26 scores per cell for distribution refinement
-    static float all_scores[15][15][26];
-    std::memset(all_scores, 0, sizeof(all_scores));
+    static thread_local float own_scores[15][15][26];
+    float (*all_scores)[15][26] = scores ? scores : own_scores;
+    if (!only) {
+        std::memset(all_scores, 0, sizeof(own_scores));
+    } else {
+        for (int r = 0; r < 15; r++)
+            for (int c = 0; c < 15; c++)
+                if (only[r][c]) {
+                    cells[r][c] = CellResult();
+                    std::memset(all_scores[r][c], 0, sizeof(own_scores[0][0]));
+                }
+    }
+
+    if (heads_net_available()) {
+        classify_cells_heads(cell_imgs, cells, all_scores, only, log);
+        if (tmpl.valid)
+            refine_distribution(cells, all_scores, log);
+        return;
+    }
 
     // Pass 1: detect which cells are tiles (occupancy), collect images for batch CNN
     struct TileRef { int r, c; };
-    std::vector<TileRef> tile_refs;
+    std::pmr::vector<TileRef> tile_refs(scratch_resource());
     std::vector<cv::Mat> tile_images;
+    TileTest occupied = tile_test(is_light);
 
     for (int r = 0; r < 15; r++) {
         for (int c = 0; c < 15; c++) {
+            if (only && !only[r][c]) continue;
+            bool det = occupied(cell_imgs[r][c]);
             // Diagnostic: log HSV for every cell in light mode
             if (is_light) {
                 const cv::Mat& ci = cell_imgs[r][c];
@@ -1862,7 +2596,6 @@ static void classify_cells(const CellImages& cell_imgs,
                     cv::Mat cg;
                     cv::cvtColor(ctr, cg, cv::COLOR_BGR2GRAY);
                     cv::meanStdDev(cg, gm, gs);
-                    bool det = is_tile(ci, is_light, r, c, log);
                     // Temporary: log all cells for dark mode debugging
                     log << "  [" << r+1 << "," << (char)('A'+c) << "]"
                         << (det ? " TILE" : " skip")
@@ -1872,7 +2605,7 @@ static void classify_cells(const CellImages& cell_imgs,
                         << " con=" << (int)gs[0] << "\n";
                 }
             }
-            if (!is_tile(cell_imgs[r][c], is_light, r, c, log)) continue;
+            if (!det) continue;
 
             tile_refs.push_back({r, c});
             tile_images.push_back(cell_imgs[r][c]);
@@ -1884,63 +2617,12 @@ static void classify_cells(const CellImages& cell_imgs,
     // cells, then reject detections whose corners still match the empty
     // reference (tooltip overlays, JPEG-artifact phantoms, etc.).
     {
-        // Helper: average BGR of the 4 corner patches (1/5-cell size).
-        auto corner_bgr = [](const cv::Mat& cell) -> cv::Scalar {
-            int kw = std::max(1, cell.cols / 5);
-            int kh = std::max(1, cell.rows / 5);
-            cv::Rect patches[4] = {
-                {0,              0,              kw, kh},
-                {cell.cols - kw, 0,              kw, kh},
-                {0,              cell.rows - kh, kw, kh},
-                {cell.cols - kw, cell.rows - kh, kw, kh},
-            };
-            cv::Scalar sum(0, 0, 0);
-            for (auto& p : patches) {
-                cv::Scalar m = cv::mean(cell(p));
-                sum[0] += m[0]; sum[1] += m[1]; sum[2] += m[2];
-            }
-            return cv::Scalar(sum[0]/4, sum[1]/4, sum[2]/4);
-        };
-
         // Calibrate: for each premium type (0-5), average corner BGR from
         // clearly-empty cells (contrast < 8).  These establish what each
         // square type looks like without a tile.
         cv::Scalar empty_ref[6] = {};
         int empty_count[6] = {};
-
-        for (int r = 0; r < 15; r++) {
-            for (int c = 0; c < 15; c++) {
-                const cv::Mat& cell = cell_imgs[r][c];
-                if (cell.empty() || cell.channels() != 3) continue;
-
-                // Quick center contrast check
-                int cx = cell.cols / 5, cy = cell.rows / 5;
-                int cw = cell.cols * 3 / 5, ch = cell.rows * 3 / 5;
-                if (cw <= 0 || ch <= 0) continue;
-                cv::Mat ctr = cell(cv::Rect(cx, cy, cw, ch));
-                cv::Mat gray;
-                cv::cvtColor(ctr, gray, cv::COLOR_BGR2GRAY);
-                cv::Scalar gm, gs;
-                cv::meanStdDev(gray, gm, gs);
-                if (gs[0] > 8) continue;  // not clearly empty
-
-                int p = PREMIUM[r][c];
-                cv::Scalar bgr = corner_bgr(cell);
-                empty_ref[p][0] += bgr[0];
-                empty_ref[p][1] += bgr[1];
-                empty_ref[p][2] += bgr[2];
-                empty_count[p]++;
-            }
-        }
-
-        // Finalize averages
-        for (int p = 0; p < 6; p++) {
-            if (empty_count[p] >= 2) {
-                empty_ref[p][0] /= empty_count[p];
-                empty_ref[p][1] /= empty_count[p];
-                empty_ref[p][2] /= empty_count[p];
-            }
-        }
+        calibrate_empty_refs(cell_imgs, empty_ref, empty_count);
 
         log << "Board palette calibrated:";
         for (int p = 0; p < 6; p++) {
@@ -1954,7 +2636,7 @@ static void classify_cells(const CellImages& cell_imgs,
 
         // Filter: reject detections whose corners match the empty reference
         // for their board position's premium type.
-        std::vector<TileRef> kept_refs;
+        std::pmr::vector<TileRef> kept_refs(scratch_resource());
         std::vector<cv::Mat> kept_imgs;
 
         for (size_t i = 0; i < tile_refs.size(); i++) {
@@ -1968,7 +2650,7 @@ static void classify_cells(const CellImages& cell_imgs,
                 continue;
             }
 
-            cv::Scalar bgr = corner_bgr(cell);
+            cv::Scalar bgr = corner_mean_bgr(cell);
             double corner_dist = std::max({std::abs(bgr[0] - empty_ref[p][0]),
                                            std::abs(bgr[1] - empty_ref[p][1]),
                                            std::abs(bgr[2] - empty_ref[p][2])});
@@ -1991,22 +2673,7 @@ static void classify_cells(const CellImages& cell_imgs,
             // cell boundary — the transition from tile to premium creates
             // strong edges.  Tooltip phantoms have no tile shape, so the
             // border is uniform premium color with low gradient.
-            cv::Mat gray_cell;
-            cv::cvtColor(cell, gray_cell, cv::COLOR_BGR2GRAY);
-            cv::Mat grad_x, grad_y;
-            cv::Sobel(gray_cell, grad_x, CV_16S, 1, 0, 3);
-            cv::Sobel(gray_cell, grad_y, CV_16S, 0, 1, 3);
-            cv::Mat abs_gx, abs_gy, grad;
-            cv::convertScaleAbs(grad_x, abs_gx);
-            cv::convertScaleAbs(grad_y, abs_gy);
-            cv::addWeighted(abs_gx, 0.5, abs_gy, 0.5, 0, grad);
-
-            // Border ring: outer 1/4, excluding inner 1/2
-            int bx = cell.cols / 4, by = cell.rows / 4;
-            cv::Mat mask = cv::Mat::ones(cell.rows, cell.cols, CV_8U);
-            if (bx > 0 && by > 0 && cell.cols - 2*bx > 0 && cell.rows - 2*by > 0)
-                mask(cv::Rect(bx, by, cell.cols - 2*bx, cell.rows - 2*by)) = 0;
-            double border_grad = cv::mean(grad, mask)[0];
+            double border_grad = border_gradient(cell);
 
             // Two-tier rejection:
             // 1) bgrad <= 10: definitely phantom (no tile edge visible)
@@ -2017,13 +2684,7 @@ static void classify_cells(const CellImages& cell_imgs,
             if (border_grad <= 10.0) {
                 reject = true;
             } else if (border_grad <= 20.0) {
-                int cx = cell.cols / 4, cy = cell.rows / 4;
-                int cw = cell.cols / 2, ch = cell.rows / 2;
-                cv::Scalar ctr = cv::mean(cell(cv::Rect(cx, cy, cw, ch)));
-                double cdist = std::max({std::abs(ctr[0] - empty_ref[p][0]),
-                                         std::abs(ctr[1] - empty_ref[p][1]),
-                                         std::abs(ctr[2] - empty_ref[p][2])});
-                reject = (cdist < 40);
+                reject = (center_ref_dist(cell, empty_ref[p]) < 40);
             }
 
             if (!reject) {
@@ -2092,22 +2753,8 @@ static void classify_cells(const CellImages& cell_imgs,
 
         float conf = cells[r][c].confidence;
 
-        // Laplacian energy in bottom-right subscript region (60-90% x, 60-90% y)
-        int sx = cell.cols * 60 / 100;
-        int sy = cell.rows * 60 / 100;
-        int sw = cell.cols * 30 / 100;
-        int sh = cell.rows * 30 / 100;
-        if (sw < 4 || sh < 4) continue;
-
-        cv::Mat sub = cell(cv::Rect(sx, sy, sw, sh));
-        cv::Mat sg;
-        if (sub.channels() == 3) cv::cvtColor(sub, sg, cv::COLOR_BGR2GRAY);
-        else sg = sub;
-        cv::Mat lapl;
-        cv::Laplacian(sg, lapl, CV_16S, 3);
-        cv::Scalar lm, ls;
-        cv::meanStdDev(lapl, lm, ls);
-        double lapl_var = ls[0] * ls[0];
+        double lapl_var = subscript_laplacian_var(cell);
+        if (lapl_var < 0) continue;
 
         // Score ratio: how much more confident is top-1 vs top-2?
         float top2 = cells[r][c].cand_scores[1];
@@ -2153,7 +2800,9 @@ static void classify_cells(const CellImages& cell_imgs,
     }
 
     log << "Classified: " << tile_count << " tiles, " << ocr_fail << " OCR failures"
-        << " (method=" << (tile_net_available() ? "CNN" : tmpl.valid ? "template" : "none") << ")\n";
+        << " (method=" << (tile_net_available() ? "CNN" : tmpl.valid ? "template" : "none");
+    if (tile_net_available()) log << ", model=" << g_tile_model.path();
+    log << ")\n";
 
     // Distribution-aware refinement
     if (tmpl.valid && tile_count > 0)
@@ -2236,48 +2885,215 @@ static std::vector<uint8_t> debug_image_rect(const cv::Mat& img,
     return png;
 }
 
+// ═══════════════════════════════════════════════════════════════════════════════
+// ROI decode (CGP_ROI_DECODE)
+// ═══════════════════════════════════════════════════════════════════════════════
+
+static const int ROI_PREVIEW_FACTOR = 2;
+// Band cut around the board found in the preview, in cells: column labels
+// and refinement slack above, the rack (searched up to 2.5 cells below the
+// board) below.
+static const int ROI_CELLS_ABOVE = 2;
+static const int ROI_CELLS_BELOW = 4;
+
+static bool roi_decode_enabled() {
+    static const bool enabled = [] {
+        const char* v = std::getenv("CGP_ROI_DECODE");
+        return v && std::atoi(v) != 0;
+    }();
+    return enabled;
+}
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t pipeline_fingerprint() {
+    static const uint64_t fp = [] {
+        uint64_t h = 1469598103934665603ULL;
+        h = fnv1a(h, &PIPELINE_VERSION, sizeof(PIPELINE_VERSION));
+        bool flags[2] = {tile_heads_enabled(), roi_decode_enabled()};
+        h = fnv1a(h, flags, sizeof(flags));
+        // Models by content: retraining in place must invalidate too.  The
+        // heads model is only looked up (and loaded) when it is switched on.
+        for (ModelPool* m : {&g_tile_model, &g_heads_model, &g_label_model,
+                             &g_corner_model}) {
+            if (m == &g_heads_model && !tile_heads_enabled()) continue;
+            const char* path = m->path();
+            if (!path) {
+                h = fnv1a(h, "-", 1);
+                continue;
+            }
+            std::ifstream f(path, std::ios::binary);
+            std::vector<char> bytes((std::istreambuf_iterator<char>(f)),
+                                    std::istreambuf_iterator<char>());
+            h = fnv1a(h, bytes.data(), bytes.size());
+        }
+        return h;
+    }();
+    return fp;
+}
+
+// Tools parse the "Final: rect=x,y ..." log line; keep it in screenshot
+// coordinates.
+static void shift_final_rect_line(std::string& log, cv::Point origin) {
+    static const char tag[] = "Final: rect=";
+    size_t pos = log.find(tag);
+    if (pos == std::string::npos) return;
+    pos += sizeof(tag) - 1;
+    size_t end = log.find(' ', pos);
+    int x, y;
+    if (end == std::string::npos || std::sscanf(log.c_str() + pos, "%d,%d", &x, &y) != 2)
+        return;
+    log.replace(pos, end - pos,
+                std::to_string(x + origin.x) + "," + std::to_string(y + origin.y));
+}
+
+// process_board_image_debug() on a band of rows.  Returns false, before the
+// caller's hook has seen anything, when the full decode should be used.
+static bool process_board_roi(const std::vector<uint8_t>& image_data,
+                              ProgressCallback on_progress, DetectCallback on_detect,
+                              DebugResult& result) {
+    int w, h;
+    if (!peek_image_size(image_data, w, h) || h <= w * 3 / 2 || !can_decode_rows(image_data))
+        return false;
+
+    auto t0 = std::chrono::steady_clock::now();
+    cv::Mat preview = decode_preview(image_data, ROI_PREVIEW_FACTOR);
+    if (preview.empty()) return false;
+    std::ostringstream preview_log;
+    BoardRegion pre = find_board_region(preview, preview_log);
+    if (!pre.found || pre.cell_size <= 0) return false;
+
+    int cs = pre.cell_size * ROI_PREVIEW_FACTOR;
+    int y0 = std::max(0, pre.rect.y * ROI_PREVIEW_FACTOR - ROI_CELLS_ABOVE * cs);
+    int y1 = std::min(h, (pre.rect.y + pre.rect.height) * ROI_PREVIEW_FACTOR
+                         + ROI_CELLS_BELOW * cs);
+    cv::Mat band = decode_rows(image_data, y0, y1);
+    if (band.empty()) return false;
+    StageTiming decode = {"decode", std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count()};
+
+    // The full-resolution board must still have its labels above and its
+    // rack below inside the band, unless the band reaches the image edge.
+    bool escaped = false;
+    DetectCallback hook = [&](const cv::Mat& bgr, const cv::Rect& rect,
+                              int cell_size, bool is_light) {
+        int above = rect.y, below = bgr.rows - (rect.y + rect.height);
+        if ((y0 > 0 && above < cell_size) || (y1 < h && below < cell_size * 5 / 2)) {
+            escaped = true;
+            return true;
+        }
+        return on_detect && on_detect(bgr, rect, cell_size, is_light);
+    };
+    DebugResult r = process_board_mat_debug(band, on_progress, hook);
+    if (escaped || r.cell_size <= 0) return false;
+
+    r.origin = cv::Point(0, y0);
+    r.board_rect.y += y0;
+    if (!r.board_grid.empty()) r.board_grid.y += y0;
+    shift_final_rect_line(r.log, r.origin);
+    r.log = "ROI decode: rows " + std::to_string(y0) + "-" + std::to_string(y1)
+          + " of " + std::to_string(w) + "x" + std::to_string(h) + "\n" + r.log;
+    r.stages.insert(r.stages.begin(), decode);
+    result = std::move(r);
+    return true;
+}
+
 // ═══════════════════════════════════════════════════════════════════════════════
 // Top-level API
 // ═══════════════════════════════════════════════════════════════════════════════
 
 DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
-                                       ProgressCallback on_progress) {
-    DebugResult result;
-    std::ostringstream log;
+                                       ProgressCallback on_progress,
+                                       DetectCallback on_detect) {
+    if (roi_decode_enabled()) {
+        DebugResult result;
+        if (process_board_roi(image_data, on_progress, on_detect, result)) return result;
+    }
 
+    auto t0 = std::chrono::steady_clock::now();
     cv::Mat img = cv::imdecode(image_data, cv::IMREAD_COLOR);
+    StageTiming decode = {"decode", std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count()};
     if (img.empty()) {
+        DebugResult result;
         result.cgp = "[error: could not decode image]";
         result.log = "Failed to decode image data";
+        result.stages.push_back(decode);
         return result;
     }
+    DebugResult result = process_board_mat_debug(img, on_progress, on_detect);
+    result.stages.insert(result.stages.begin(), decode);
+    return result;
+}
+
+DebugResult process_board_mat_debug(const cv::Mat& img, ProgressCallback on_progress,
+                                    DetectCallback on_detect) {
+    ScratchArena arena;  // cell crops and work lists; freed on return
+    DebugResult result;
+    std::ostringstream log;
+
+    auto stage_t0 = std::chrono::steady_clock::now();
+    auto stage_done = [&](const char* stage) {
+        auto now = std::chrono::steady_clock::now();
+        result.stages.push_back(
+            {stage, std::chrono::duration<double, std::milli>(now - stage_t0).count()});
+        stage_t0 = now;
+    };
+
     log << "Image: " << img.cols << "x" << img.rows << "\n";
 
     // Stage 1: find board region via premium-pattern grid search
     BoardRegion region = find_board_region(img, log);
+    stage_done("detect");
+
+    if (on_detect && region.found && region.cell_size > 0) {
+        bool stop = on_detect(img, region.rect, region.cell_size, region.is_light);
+        stage_done("detect_hook");
+        if (stop) {
+            log << "Stopped after detection\n";
+            result.board_rect = region.rect;
+            result.board_grid = region.grid;
+            result.cell_size = region.cell_size;
+            result.is_light = region.is_light;
+            result.log = log.str();
+            return result;
+        }
+    }
 
     if (on_progress) {
         auto dbg = debug_image_rect(img, region);
         on_progress("Board detected", log.str(), dbg);
+        stage_done("progress");
     }
 
     // Stage 2: extract cells
     CellImages cell_imgs;
     extract_cells(img, region, cell_imgs, log);
+    stage_done("extract");
 
     if (on_progress) {
         CellResult empty[15][15] = {};
         auto dbg = generate_debug_image(img, region, empty);
         on_progress("Cells extracted", log.str(), dbg);
+        stage_done("progress");
     }
 
     // Stage 3: classify
     CellResult cells[15][15] = {};
     classify_cells(cell_imgs, cells, region.is_light, log);
+    stage_done("classify");
 
     if (on_progress) {
         auto dbg = generate_debug_image(img, region, cells);
         on_progress("Classified", log.str(), dbg);
+        stage_done("progress");
     }
 
     // If OCR is failing badly (>10 failures), the rect is probably wrong.
@@ -2292,13 +3108,17 @@ DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
         if (tiles > 3 && failures * 2 > tiles) {
             log << "OCR failures=" << failures << "/" << tiles << " > 50%, retrying detection...\n";
 
-            if (on_progress)
+            if (on_progress) {
                 on_progress("Retrying detection...", log.str(), {});
+                stage_done("progress");
+            }
 
             cv::Mat hsv;
+            hsv.allocator = scratch_mat_allocator();
             cv::cvtColor(img, hsv, cv::COLOR_BGR2HSV);
 
             bool is_light = region.is_light;
+            PremiumScorer premium = premium_scorer(is_light);
 
             // Search a wide range around the current best
             int range = std::max(region.cell_size * 2, 60);
@@ -2308,7 +3128,7 @@ DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
 
             // Flatten (side, dy) pairs for even thread partitioning.
             struct RetryWork { int side, dy; };
-            std::vector<RetryWork> retry_work;
+            std::pmr::vector<RetryWork> retry_work(scratch_resource());
             for (int ds = -size_range; ds <= size_range; ds += size_step) {
                 int side = region.rect.width + ds;
                 if (side < 100) continue;
@@ -2342,8 +3162,7 @@ DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
                                     x + side > img.cols ||
                                     y + side > img.rows) continue;
                                 cv::Rect trial(x, y, side, side);
-                                double s = score_premium(hsv, trial,
-                                                         is_light);
+                                double s = premium(hsv, trial);
                                 if (s > local_score) {
                                     local_score = s;
                                     local_best = trial;
@@ -2362,7 +3181,7 @@ DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
                 }
             }
 
-            region = {best_r, best_r.width / 15, true, is_light};
+            region = {best_r, best_r.width / 15, true, is_light, cv::Rect2d()};
             log << "Retry: score=" << best_score << " rect=" << best_r.x
                 << "," << best_r.y << " " << best_r.width
                 << "x" << best_r.height << "\n";
@@ -2370,10 +3189,12 @@ DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
             extract_cells(img, region, cell_imgs, log);
             std::memset(cells, 0, sizeof(cells));
             classify_cells(cell_imgs, cells, region.is_light, log);
+            stage_done("retry");
 
             if (on_progress) {
                 auto dbg = generate_debug_image(img, region, cells);
                 on_progress("Retry classified", log.str(), dbg);
+                stage_done("progress");
             }
         }
     }
@@ -2381,16 +3202,19 @@ DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
     // Copy cell results and board geometry to DebugResult
     std::memcpy(result.cells, cells, sizeof(cells));
     result.board_rect = region.rect;
+    result.board_grid = region.grid;
     result.cell_size = region.cell_size;
     result.is_light = region.is_light;
 
     // Stage 4: format CGP
     result.cgp = format_cgp(cells);
     log << "CGP: " << result.cgp << "\n";
+    stage_done("format");
 
     // Stage 5: debug image
     result.debug_png = generate_debug_image(img, region, cells);
     log << "Debug image: " << result.debug_png.size() << " bytes\n";
+    stage_done("debug_image");
 
     result.log = log.str();
     return result;
@@ -2399,3 +3223,353 @@ DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
 std::string process_board_image(const std::vector<uint8_t>& image_data) {
     return process_board_image_debug(image_data).cgp;
 }
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Prior-position analysis
+// ═══════════════════════════════════════════════════════════════════════════════
+
+// Prior tiles failing verification; more than this means the prior does not
+// describe the screenshot (different game, wrong turn) and a full analysis
+// runs instead.
+static const int PRIOR_MAX_MISMATCH = 4;
+
+// A prior tile is verified only if its expected letter scores best of all
+// 26, with at least a minimum score and a margin over the runner-up.  The
+// expected letter's score alone is not enough: a look-alike (F under a
+// prior E, Q under O) correlates well with the wrong template too.  The
+// CNN gives softmax probabilities, the templates TM_CCOEFF_NORMED
+// correlations, so each has its own pair.  Placeholders until swept over
+// testdata.
+struct PriorThresholds { float min_match, min_margin; };
+static const PriorThresholds PRIOR_CNN = {0.50f, 0.30f};
+static const PriorThresholds PRIOR_TEMPLATE = {0.25f, 0.05f};
+
+// Board letters of a CGP ('?' for anything not A-Z/a-z).  False if the
+// board part does not describe exactly 15 rows of 15 cells.
+static bool parse_cgp_letters(const std::string& cgp, char letters[15][15]) {
+    std::memset(letters, 0, 15 * 15);
+    std::string board = cgp.substr(0, cgp.find(' '));
+    int row = 0, col = 0;
+    for (size_t i = 0; i < board.size(); i++) {
+        char ch = board[i];
+        if (ch == '/') {
+            if (col != 15) return false;
+            row++;
+            col = 0;
+        } else if (ch >= '0' && ch <= '9') {
+            int n = ch - '0';
+            while (i + 1 < board.size() && board[i + 1] >= '0' && board[i + 1] <= '9')
+                n = n * 10 + (board[++i] - '0');
+            col += n;
+        } else {
+            if (row >= 15 || col >= 15) return false;
+            bool alpha = (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z');
+            letters[row][col++] = alpha ? ch : '?';
+        }
+        if (row >= 15 || col > 15) return false;
+    }
+    return row == 14 && col == 15;
+}
+
+// Whether scores s[26] still read `letter`.  `match` and `best` report the
+// expected letter's score and the letter that won.
+static bool verify_prior_glyph(const float s[26], const PriorThresholds& th,
+                               char letter, float& match, char& best) {
+    int li = std::toupper(static_cast<unsigned char>(letter)) - 'A';
+    if (li < 0 || li >= 26) return false;
+    int top = 0;
+    float runner_up = -1;
+    for (int i = 1; i < 26; i++)
+        if (s[i] > s[top]) top = i;
+    for (int i = 0; i < 26; i++)
+        if (i != top) runner_up = std::max(runner_up, s[i]);
+    match = s[li];
+    best = static_cast<char>('A' + top);
+    return top == li && match >= th.min_match &&
+           match - runner_up >= th.min_margin;
+}
+
+DebugResult process_board_image_with_prior(const std::vector<uint8_t>& image_data,
+                                           const std::string& prev_cgp,
+                                           ProgressCallback on_progress) {
+    char prior[15][15];
+    if (!parse_cgp_letters(prev_cgp, prior))
+        return process_board_image_debug(image_data, on_progress);
+
+    auto t0 = std::chrono::steady_clock::now();
+    cv::Mat img = cv::imdecode(image_data, cv::IMREAD_COLOR);
+    StageTiming decode = {"decode", std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count()};
+    if (img.empty()) return process_board_image_debug(image_data, on_progress);
+
+    ScratchArena arena;
+    DebugResult result;
+    std::ostringstream log;
+    result.stages.push_back(decode);
+    auto stage_t0 = std::chrono::steady_clock::now();
+    auto stage_done = [&](const char* stage) {
+        auto now = std::chrono::steady_clock::now();
+        result.stages.push_back(
+            {stage, std::chrono::duration<double, std::milli>(now - stage_t0).count()});
+        stage_t0 = now;
+    };
+
+    log << "Image: " << img.cols << "x" << img.rows << "\n";
+    BoardRegion region = find_board_region(img, log);
+    stage_done("detect");
+
+    CellImages cell_imgs;
+    extract_cells(img, region, cell_imgs, log);
+    stage_done("extract");
+
+    // Prior tiles: still a tile, and (for non-blanks) still the same glyph.
+    // Everything else (empty squares, mismatches) is classified normally.
+    // Glyphs are scored as classify_cells scores them, the CNN in one
+    // batch over all prior tiles, else the templates.
+    const auto& tmpl = get_templates();
+    CellResult cells[15][15] = {};
+    static thread_local float scores[15][15][26];
+    std::memset(scores, 0, sizeof(scores));
+    bool only[15][15] = {};
+    TileTest occupied = tile_test(region.is_light);
+    bool cnn = tile_net_available();
+    bool check_glyphs = cnn || tmpl.valid;
+    const PriorThresholds& th = cnn ? PRIOR_CNN : PRIOR_TEMPLATE;
+
+    struct PriorRef { int r, c; };
+    std::pmr::vector<PriorRef> glyph_refs(scratch_resource());
+    std::vector<cv::Mat> glyph_imgs;
+    bool present[15][15] = {};
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            char want = prior[r][c];
+            if (want == 0) continue;
+            present[r][c] = want != '?' && occupied(cell_imgs[r][c]);
+            if (present[r][c] && check_glyphs && want >= 'A' && want <= 'Z') {
+                glyph_refs.push_back({r, c});
+                glyph_imgs.push_back(cell_imgs[r][c]);
+            }
+        }
+    }
+    std::pmr::vector<float> glyph_scores(glyph_refs.size() * 26, scratch_resource());
+    if (cnn) {
+        compute_scores_cnn_batch(glyph_imgs, glyph_scores.data());
+    } else if (check_glyphs) {
+        for (size_t i = 0; i < glyph_imgs.size(); i++)
+            compute_scores(glyph_imgs[i], tmpl, &glyph_scores[i * 26]);
+    }
+    const float* glyph_at[15][15] = {};
+    for (size_t i = 0; i < glyph_refs.size(); i++)
+        glyph_at[glyph_refs[i].r][glyph_refs[i].c] = &glyph_scores[i * 26];
+
+    int prior_tiles = 0, mismatched = 0;
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            char want = prior[r][c];
+            if (want == 0) {
+                only[r][c] = true;
+                continue;
+            }
+            prior_tiles++;
+            bool blank = want >= 'a' && want <= 'z';
+            bool ok = present[r][c];
+            float match = 1;
+            char best = '-';
+            if (glyph_at[r][c])
+                ok = verify_prior_glyph(glyph_at[r][c], th, want, match, best);
+            if (!ok) {
+                log << "  Prior mismatch [" << r+1 << "," << (char)('A'+c)
+                    << "] expected " << want << " match=" << match
+                    << " best=" << best << "\n";
+                only[r][c] = true;
+                mismatched++;
+                continue;
+            }
+            // Verified: pin it, so refine_distribution counts it against the
+            // bag and prefers changing the new, less certain cells.
+            char upper = static_cast<char>(std::toupper(static_cast<unsigned char>(want)));
+            CellResult& cr = cells[r][c];
+            cr.letter = want;
+            cr.confidence = 1.0f;
+            cr.is_blank = blank;
+            cr.cand_letters[0] = upper;
+            cr.cand_scores[0] = 1.0f;
+            scores[r][c][upper - 'A'] = 1.0f;
+        }
+    }
+    log << "Prior: " << prior_tiles - mismatched << "/" << prior_tiles
+        << " tiles verified, " << mismatched << " mismatched\n";
+    stage_done("prior_verify");
+
+    if (!region.found || mismatched > PRIOR_MAX_MISMATCH) {
+        log << "Prior rejected, running full analysis\n";
+        DebugResult full = process_board_mat_debug(img, on_progress);
+        full.log = log.str() + full.log;
+        full.stages.insert(full.stages.begin(), result.stages.begin(), result.stages.end());
+        return full;
+    }
+
+    classify_cells(cell_imgs, cells, region.is_light, log, only, scores);
+    stage_done("classify");
+
+    if (on_progress) {
+        auto dbg = generate_debug_image(img, region, cells);
+        on_progress("Classified", log.str(), dbg);
+        stage_done("progress");
+    }
+
+    std::memcpy(result.cells, cells, sizeof(cells));
+    result.board_rect = region.rect;
+    result.board_grid = region.grid;
+    result.cell_size = region.cell_size;
+    result.is_light = region.is_light;
+    result.cgp = format_cgp(cells);
+    log << "CGP: " << result.cgp << "\n";
+    stage_done("format");
+
+    result.debug_png = generate_debug_image(img, region, cells);
+    stage_done("debug_image");
+    result.log = log.str();
+    return result;
+}
+
+bool detect_board_region(const cv::Mat& img, cv::Rect& rect, int& cell_size,
+                         bool& is_light, cv::Rect2d* grid) {
+    std::ostringstream log;
+    BoardRegion region = find_board_region(img, log);
+    rect = region.rect;
+    cell_size = region.cell_size;
+    is_light = region.is_light;
+    if (grid) *grid = region.grid;
+    return region.found && region.cell_size > 0;
+}
+
+void classify_board_region(const cv::Mat& img, const cv::Rect& board_rect,
+                           const cv::Rect2d& grid, bool is_light,
+                           CellResult cells[15][15], float scores[15][15][26],
+                           const bool (*only)[15], std::string* log_out) {
+    ScratchArena arena;
+    std::ostringstream log;
+    BoardRegion region = {board_rect, board_rect.width / 15, true, is_light, grid};
+    CellImages cell_imgs;
+    extract_cells(img, region, cell_imgs, log, only);
+    classify_cells(cell_imgs, cells, is_light, log, only, scores);
+    if (log_out) *log_out = log.str();
+}
+
+bool extract_board_features(const std::vector<uint8_t>& image_data,
+                            BoardFeatures& out, const DebugResult* pipeline) {
+    out = BoardFeatures();
+    cv::Mat img = cv::imdecode(image_data, cv::IMREAD_COLOR);
+    if (img.empty()) return false;
+
+    // Full pipeline once for the final rect (including the OCR retry).
+    DebugResult own;
+    if (!pipeline) {
+        own = process_board_image_debug(image_data);
+        pipeline = &own;
+    }
+    out.board_rect = pipeline->board_rect;
+    out.cell_size = pipeline->cell_size;
+    out.is_light = pipeline->is_light;
+
+    ScratchArena arena;
+    std::ostringstream log;
+    BoardRegion region = {out.board_rect, out.cell_size, true, out.is_light,
+                          pipeline->board_grid};
+    CellImages cell_imgs;
+    extract_cells(img, region, cell_imgs, log);
+
+    cv::Scalar empty_ref[6] = {};
+    int empty_count[6] = {};
+    calibrate_empty_refs(cell_imgs, empty_ref, empty_count);
+
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            const cv::Mat& cell = cell_imgs[r][c];
+            CellFeatures& f = out.cells[r][c];
+            f.premium = PREMIUM[r][c];
+            if (cell.channels() != 3) continue;
+
+            int cx = cell.cols / 5, cy = cell.rows / 5;
+            int cw = cell.cols * 3 / 5, ch = cell.rows * 3 / 5;
+            if (cw > 0 && ch > 0) {
+                cv::Mat center = cell(cv::Rect(cx, cy, cw, ch));
+                cv::Mat gray, hsv;
+                cv::cvtColor(center, gray, cv::COLOR_BGR2GRAY);
+                cv::Scalar m, sd;
+                cv::meanStdDev(gray, m, sd);
+                f.raw_contrast = static_cast<float>(sd[0]);
+                if (gray.cols >= 30 && gray.rows >= 30) {
+                    cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+                    cv::meanStdDev(gray, m, sd);
+                }
+                f.brightness = static_cast<float>(m[0]);
+                f.contrast = static_cast<float>(sd[0]);
+                cv::cvtColor(center, hsv, cv::COLOR_BGR2HSV);
+                cv::Scalar hm = cv::mean(hsv);
+                cv::Scalar bm = cv::mean(center);
+                for (int k = 0; k < 3; k++) {
+                    f.center_hsv[k] = static_cast<float>(hm[k]);
+                    f.center_bgr[k] = static_cast<float>(bm[k]);
+                }
+            }
+
+            int qx = cell.cols / 2, qy = cell.rows / 2;
+            if (cell.cols - qx > 0 && cell.rows - qy > 0) {
+                cv::Mat quad;
+                cv::cvtColor(cell(cv::Rect(qx, qy, cell.cols - qx, cell.rows - qy)),
+                             quad, cv::COLOR_BGR2GRAY);
+                cv::Scalar qm, qs;
+                cv::meanStdDev(quad, qm, qs);
+                f.quad_mean = static_cast<float>(qm[0]);
+                f.quad_stddev = static_cast<float>(qs[0]);
+            }
+
+            cv::Scalar chsv = corner_mean_hsv(cell);
+            for (int k = 0; k < 3; k++) f.corner_hsv[k] = static_cast<float>(chsv[k]);
+            int p = f.premium;
+            if (empty_count[p] >= 2) {
+                cv::Scalar bgr = corner_mean_bgr(cell);
+                f.corner_dist = static_cast<float>(std::max({
+                    std::abs(bgr[0] - empty_ref[p][0]),
+                    std::abs(bgr[1] - empty_ref[p][1]),
+                    std::abs(bgr[2] - empty_ref[p][2])}));
+                f.center_dist = static_cast<float>(center_ref_dist(cell, empty_ref[p]));
+            }
+            f.border_grad = static_cast<float>(border_gradient(cell));
+            if (cell.cols >= 20 && cell.rows >= 20)
+                f.lapl_var = static_cast<float>(subscript_laplacian_var(cell));
+        }
+    }
+
+    // Letter scores for every cell, occupied or not, in one batch.
+    out.cnn = tile_net_available();
+    if (out.cnn) {
+        std::vector<cv::Mat> images;
+        for (int r = 0; r < 15; r++)
+            for (int c = 0; c < 15; c++) images.push_back(cell_imgs[r][c]);
+        std::vector<float> batch(images.size() * 26);
+        compute_scores_cnn_batch(images, batch.data());
+        for (int i = 0; i < 225; i++)
+            std::memcpy(out.cells[i / 15][i % 15].scores, &batch[i * 26],
+                        26 * sizeof(float));
+    } else {
+        const auto& tmpl = get_templates();
+        if (tmpl.valid)
+            for (int r = 0; r < 15; r++)
+                for (int c = 0; c < 15; c++)
+                    compute_scores(cell_imgs[r][c], tmpl, out.cells[r][c].scores);
+    }
+    return true;
+}
+
+std::vector<uint8_t> render_board_debug(const std::vector<uint8_t>& image_data,
+                                        const cv::Rect& board_rect) {
+    cv::Mat img = cv::imdecode(image_data, cv::IMREAD_COLOR);
+    if (img.empty()) return {};
+    BoardRegion region = {board_rect, board_rect.width / 15, true, false,
+                          cv::Rect2d()};
+    CellResult empty[15][15] = {};
+    return generate_debug_image(img, region, empty);
+}
@@ -18,6 +18,17 @@ struct CellResult {
     float cand_scores[5] = {};
 };
 
+// Version of the pipeline's observable output.  Bump whenever a change
+// alters detection, occupancy, classification or rack results, so persisted
+// feature stores (feature_store.h) get recomputed.
+static const uint32_t PIPELINE_VERSION = 2;
+
+// Hash of what decides that output besides the code: PIPELINE_VERSION, the
+// bytes of every CNN model it loads, and the env switches that change its
+// path (CGP_TILE_HEADS, CGP_ROI_DECODE).  Persisted results are only reused
+// under an equal fingerprint; code changes still need a version bump.
+uint64_t pipeline_fingerprint();
+
 // Full board state from vision pipeline.
 struct BoardState {
     cv::Rect board_rect;
@@ -30,6 +41,14 @@ struct BoardState {
 // Get the valid letters for a given Scrabble point value (0 = unknown).
 const char* scrabble_letters_for_points(int pts);
 
+// Wall time of one pipeline stage.
+struct StageTiming {
+    const char* stage;  // "decode", "detect", "detect_hook", "extract",
+                        // "prior_verify", "classify", "retry", "format",
+                        // "debug_image" or "progress" (callbacks)
+    double ms;
+};
+
 // Debug output bundle.
 struct DebugResult {
     std::string cgp;
@@ -37,8 +56,13 @@ struct DebugResult {
     std::string log;
     CellResult cells[15][15] = {};
     cv::Rect board_rect;   // detected board bounding box
+    cv::Rect2d board_grid; // sub-pixel grid fit, empty if board_rect was searched
     int cell_size = 0;     // pixel size of one cell
     bool is_light = false; // true = light/cream theme, false = dark theme
+    std::vector<StageTiming> stages; // in the order the stages ran
+    // Where the image the pipeline saw (and debug_png) sits in the
+    // screenshot: nonzero after an ROI decode, see process_board_image_debug().
+    cv::Point origin;
 };
 
 // Progress callback: (status_message, log_so_far, debug_png_so_far).
@@ -58,9 +82,123 @@ CellResult classify_single_tile(const cv::Mat& tile_image, bool check_blank = tr
 CellResult classify_single_tile_ex(const cv::Mat& tile_image, int method,
                                     float* out_scores = nullptr);
 
+// Most loaded copies kept of each CNN, shared by all threads (default: the
+// hardware thread count).  Offline tools running the pipeline on a fixed
+// number of workers set it to that count before starting them.
+void set_model_pool_size(int n);
+
+// Preprocess a tile or label crop exactly as the CNNs see it: 48x48 INTER_AREA
+// resize, grayscale, polarity normalize, histogram equalize (CV_8UC1).
+// Training data must go through the same path.
+cv::Mat preprocess_tile_for_cnn(const cv::Mat& crop);
+
+// Render a tile face with the OCR template layout (letter centered in the
+// upper area, point-value subscript bottom-right) as a size x size coverage
+// mask (CV_8UC1, 255 = ink).  Used by the synthetic board renderer.
+cv::Mat render_tile_mask(char letter, int size, bool with_subscript = true);
+
+// Render a single line of text in the tile font as a coverage mask
+// (255 = ink).  Height is ascender - descender at the given pixel size.
+cv::Mat render_text_mask(const std::string& text, int pixel_size);
+
+// Detection callback: (bgr_image, board_rect, cell_size, is_light), called
+// once the board has been found in stage 1.  Returning true stops the
+// pipeline there (e.g. on a BoardCache hit): the DebugResult then holds the
+// geometry, log and stage timings but no cells, CGP or debug image.
+// board_rect is in bgr's coordinates, which after an ROI decode is a band of
+// the screenshot starting at DebugResult::origin.
+using DetectCallback = std::function<bool(const cv::Mat& bgr,
+                                          const cv::Rect& board_rect,
+                                          int cell_size, bool is_light)>;
+
 // Process a board screenshot and return a CGP string.
 std::string process_board_image(const std::vector<uint8_t>& image_data);
 
 // Process with debug overlay image and log. Optional progress callback.
+//
+// With CGP_ROI_DECODE=1, tall screenshots that can be partially decoded
+// (image_decode.h) are decoded in two phases: a half-resolution preview to
+// locate the board, then only the rows from above the board labels to below
+// the rack at full resolution.  The pipeline runs on that band; board_rect
+// and board_grid are still screenshot coordinates, while the detection hook,
+// the log and debug_png see the band (DebugResult::origin).  Falls back to a
+// full decode when the preview finds no board or the board ends up too close
+// to the band's edges.
 DebugResult process_board_image_debug(const std::vector<uint8_t>& image_data,
-                                       ProgressCallback on_progress = nullptr);
+                                       ProgressCallback on_progress = nullptr,
+                                       DetectCallback on_detect = nullptr);
+
+// Same, on an already decoded BGR image.
+DebugResult process_board_mat_debug(const cv::Mat& bgr,
+                                    ProgressCallback on_progress = nullptr,
+                                    DetectCallback on_detect = nullptr);
+
+// Analyze a screenshot taken after the position `prev_cgp` (e.g. the next
+// turn during live annotation).  Prior tiles are only verified (still a
+// tile, expected letter still scores best of the 26) and pinned; newly occupied
+// and mismatching cells are classified normally, with the pinned tiles
+// counted in the distribution refinement.  Falls back to the full pipeline
+// when more than a few prior tiles disagree or prev_cgp cannot be parsed.
+DebugResult process_board_image_with_prior(const std::vector<uint8_t>& image_data,
+                                           const std::string& prev_cgp,
+                                           ProgressCallback on_progress = nullptr);
+
+// Stage 1 only: premium-pattern board search on a BGR image, without the
+// OCR-driven retry of the full pipeline.  Returns false if no board was found
+// (rect etc. then hold the best guess).  grid, if given, receives the
+// sub-pixel fitted grid (empty when the fit did not apply).
+bool detect_board_region(const cv::Mat& bgr, cv::Rect& rect, int& cell_size,
+                         bool& is_light, cv::Rect2d* grid = nullptr);
+
+// Stages 2-3 on a known board rect, for callers that track the board
+// themselves (BoardSequence).  Pass the grid from detect_board_region so
+// cells are cropped as in process_board_image (empty: crop from the rect).
+// Cells marked in `only` (all if null) are re-extracted and reclassified;
+// the rest of `cells` and `scores` is kept.  `scores` holds the per-cell
+// letter scores between calls and must be zeroed before the first one.
+void classify_board_region(const cv::Mat& bgr, const cv::Rect& board_rect,
+                           const cv::Rect2d& grid, bool is_light,
+                           CellResult cells[15][15], float scores[15][15][26],
+                           const bool (*only)[15] = nullptr,
+                           std::string* log = nullptr);
+
+// Intermediate per-cell measurements behind the occupancy decision (is_tile,
+// the Pass 1b board-color filter and the Pass 2b tooltip filter), so tools
+// can re-evaluate thresholds without rerunning detection or the CNN.
+struct CellFeatures {
+    int premium = 0;           // premium type at this position (0 = normal)
+    float brightness = 0;      // center 3/5 gray mean (blurred as in is_tile)
+    float contrast = 0;        // center 3/5 gray stddev (blurred as in is_tile)
+    float raw_contrast = 0;    // same, unblurred (palette calibration input)
+    float center_hsv[3] = {};  // center 3/5 mean H, S, V
+    float center_bgr[3] = {};  // center 3/5 mean B, G, R
+    float corner_hsv[3] = {};  // mean H, S, V of the four 1/5 corner patches
+    float corner_dist = -1;    // max |corner BGR - empty ref|, -1 = no reference
+    float center_dist = -1;    // max |center 1/2 BGR - empty ref|, -1 = no reference
+    float border_grad = 0;     // mean Sobel magnitude in the outer 1/4 ring
+    float lapl_var = -1;       // subscript Laplacian variance, -1 = too small
+    float quad_mean = 0;       // bottom-right quadrant gray mean (is_blank_tile)
+    float quad_stddev = 0;     // bottom-right quadrant gray stddev
+    float scores[26] = {};     // CNN softmax (template scores without a model)
+};
+
+struct BoardFeatures {
+    cv::Rect board_rect;       // final rect from process_board_image_debug
+    int cell_size = 0;
+    bool is_light = false;
+    bool cnn = false;          // scores are CNN probabilities
+    CellFeatures cells[15][15];
+};
+
+// Run detection once and measure every cell of the detected board.  Pass
+// the result of an earlier process_board_image_debug() call on the same
+// image as `pipeline` to reuse its rect instead of rerunning the pipeline.
+// Returns false if the image cannot be decoded.
+bool extract_board_features(const std::vector<uint8_t>& image_data,
+                            BoardFeatures& out,
+                            const DebugResult* pipeline = nullptr);
+
+// Debug overlay (board rect + grid) for a known rect, as in
+// DebugResult::debug_png.  Empty if the image cannot be decoded.
+std::vector<uint8_t> render_board_debug(const std::vector<uint8_t>& image_data,
+                                        const cv::Rect& board_rect);
@@ -0,0 +1,189 @@
+#include "board_cache.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+#include <opencv2/imgproc.hpp>
+
+// Rack strip thumbnail: the strip is ~17 cells wide and ~2 cells tall.
+static const int RACK_SIG_W = 136;
+static const int RACK_SIG_H = 16;
+
+// Candidate filter: max differing dHash bits.
+static const int BOARD_HASH_TOL = 10;
+static const int RACK_HASH_TOL = 16;
+
+// Verification: max mean |difference| over any 4x4 block of the rectified
+// board or rack thumbnail.  JPEG requantization and a pixel or two of rect
+// jitter stay well below these; a tile appearing, or a letter changing (E vs
+// F differs by a full stroke within one block), goes far above.
+static const int SIG_BLOCK = 4;
+static const double TILE_BLOCK_TOL = 40;
+static const double EMPTY_BLOCK_TOL = 48;  // premium labels are thin text
+static const double RACK_BLOCK_TOL = 40;
+
+// 64-bit difference hash: 9x8 area-downsample, one bit per horizontal
+// neighbour comparison.
+static uint64_t dhash(const cv::Mat& gray) {
+    cv::Mat small;
+    cv::resize(gray, small, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+    uint64_t h = 0;
+    for (int y = 0; y < 8; y++) {
+        const uint8_t* row = small.ptr<uint8_t>(y);
+        for (int x = 0; x < 8; x++)
+            h = (h << 1) | (row[x] < row[x + 1] ? 1u : 0u);
+    }
+    return h;
+}
+
+// Per-block mean |a - b|, one value per SIG_BLOCK x SIG_BLOCK block.
+static cv::Mat block_diff(const cv::Mat& a, const cv::Mat& b) {
+    cv::Mat diff, blocks;
+    cv::absdiff(a, b, diff);
+    cv::resize(diff, blocks, cv::Size(a.cols / SIG_BLOCK, a.rows / SIG_BLOCK),
+               0, 0, cv::INTER_AREA);
+    return blocks;
+}
+
+bool compute_board_signature(const cv::Mat& bgr, const cv::Rect& board_rect,
+                             int cell_size, BoardSignature& out) {
+    out = BoardSignature();
+    cv::Rect bounds(0, 0, bgr.cols, bgr.rows);
+    if (board_rect.width <= 0 || board_rect.height <= 0
+        || (board_rect & bounds) != board_rect)
+        return false;
+
+    cv::Mat gray;
+    cv::cvtColor(bgr(board_rect), gray, cv::COLOR_BGR2GRAY);
+    int side = 15 * BOARD_SIG_CELL;
+    cv::resize(gray, out.board, cv::Size(side, side), 0, 0, cv::INTER_AREA);
+    out.board_hash = dhash(out.board);
+
+    // Rack strip: the region detect_rack_tiles() searches.  A strip cut off
+    // by the image edge is left out rather than compared partially.
+    if (cell_size > 0) {
+        int bottom = board_rect.y + board_rect.height;
+        cv::Rect strip(board_rect.x - cell_size, bottom + cell_size / 3,
+                       board_rect.width + 2 * cell_size,
+                       cell_size * 5 / 2 - cell_size / 3);
+        if (strip.width > 0 && strip.height > 0 && (strip & bounds) == strip) {
+            cv::Mat rack_gray;
+            cv::cvtColor(bgr(strip), rack_gray, cv::COLOR_BGR2GRAY);
+            cv::resize(rack_gray, out.rack, cv::Size(RACK_SIG_W, RACK_SIG_H),
+                       0, 0, cv::INTER_AREA);
+            out.rack_hash = dhash(out.rack);
+            out.has_rack = true;
+        }
+    }
+    return true;
+}
+
+// Cell-by-cell check of a candidate against its cached occupancy.
+static bool verify(const BoardSignature& sig, const BoardSignature& cached,
+                   const CellResult cells[15][15]) {
+    cv::Mat blocks = block_diff(sig.board, cached.board);
+    const int per_cell = BOARD_SIG_CELL / SIG_BLOCK;
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            double tol = cells[r][c].letter != 0 ? TILE_BLOCK_TOL : EMPTY_BLOCK_TOL;
+            double worst;
+            cv::minMaxLoc(blocks(cv::Rect(c * per_cell, r * per_cell,
+                                          per_cell, per_cell)),
+                          nullptr, &worst);
+            if (worst > tol) return false;
+        }
+    }
+    if (sig.has_rack) {
+        double worst;
+        cv::minMaxLoc(block_diff(sig.rack, cached.rack), nullptr, &worst);
+        if (worst > RACK_BLOCK_TOL) return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// BoardCache
+// ---------------------------------------------------------------------------
+
+bool board_cache_enabled() {
+    static const bool enabled = [] {
+        const char* v = std::getenv("CGP_BOARD_CACHE");
+        return v && std::atoi(v) != 0;
+    }();
+    return enabled;
+}
+
+BoardCache::BoardCache(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+int BoardCache::find_locked(const BoardSignature& sig, const std::string& key) const {
+    int best = -1;
+    for (size_t i = 0; i < entries_.size(); i++) {
+        const Entry& e = entries_[i];
+        if (e.value.key != key || e.sig.has_rack != sig.has_rack) continue;
+        if (std::popcount(e.sig.board_hash ^ sig.board_hash) > BOARD_HASH_TOL) continue;
+        if (sig.has_rack
+            && std::popcount(e.sig.rack_hash ^ sig.rack_hash) > RACK_HASH_TOL)
+            continue;
+        if (best >= 0 && e.last_used < entries_[best].last_used) continue;
+        if (verify(sig, e.sig, e.value.cells)) best = static_cast<int>(i);
+    }
+    return best;
+}
+
+bool BoardCache::lookup(const BoardSignature& sig, const std::string& key,
+                        CachedBoard& out) {
+    if (sig.board.empty()) return false;
+    std::lock_guard<std::mutex> lock(mu_);
+    int i = find_locked(sig, key);
+    if (i < 0) return false;
+    entries_[i].last_used = ++clock_;
+    out = entries_[i].value;
+    return true;
+}
+
+void BoardCache::store(const BoardSignature& sig, const CachedBoard& value) {
+    if (sig.board.empty()) return;
+    std::lock_guard<std::mutex> lock(mu_);
+    int i = find_locked(sig, value.key);
+    if (i < 0 && entries_.size() < capacity_) {
+        entries_.emplace_back();
+        i = static_cast<int>(entries_.size()) - 1;
+    } else if (i < 0) {
+        i = static_cast<int>(std::min_element(entries_.begin(), entries_.end(),
+            [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; })
+            - entries_.begin());
+    }
+    entries_[i].sig = sig;
+    entries_[i].value = value;
+    entries_[i].last_used = ++clock_;
+}
+
+size_t BoardCache::size() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return entries_.size();
+}
+
+std::string process_board_image_cached(const std::vector<uint8_t>& image_data,
+                                       BoardCache& cache) {
+    if (!board_cache_enabled()) return process_board_image(image_data);
+    BoardSignature sig;
+    bool have_sig = false;
+    CachedBoard hit;
+    bool cached = false;
+    DebugResult dr = process_board_image_debug(image_data, nullptr,
+        [&](const cv::Mat& bgr, const cv::Rect& rect, int cell_size, bool) {
+            have_sig = compute_board_signature(bgr, rect, cell_size, sig);
+            cached = have_sig && cache.lookup(sig, "", hit);
+            return cached;
+        });
+    if (cached) return hit.cgp;
+    if (have_sig) {
+        CachedBoard value;
+        value.cgp = dr.cgp;
+        std::memcpy(value.cells, dr.cells, sizeof(value.cells));
+        cache.store(sig, value);
+    }
+    return dr.cgp;
+}
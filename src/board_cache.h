@@ -0,0 +1,101 @@
+#pragma once
+// Near-duplicate screenshot cache keyed by the rectified board.
+//
+// Screenshots of the same position differ in crop, status bar and JPEG
+// quality, so caches keyed on the encoded bytes miss them.  A BoardSignature
+// is taken after stage 1 (board detection) only: the detected board is
+// resampled to a fixed 15x15 grid of BOARD_SIG_CELL-pixel gray cells and the
+// rack strip below it to a fixed-size thumbnail, each summarized by a 64-bit
+// difference hash.
+//
+// lookup() scans for entries whose board and rack hashes are within a few
+// bits, then verifies the candidate cell by cell against its cached
+// occupancy before returning the stored result:
+//
+//   occupied cells   every 4x4 block of the rectified cell must match (so a
+//                    different letter on the same square is a miss)
+//   empty cells      same check, which fails as soon as a tile appears
+//   rack strip       the same block check over the rack thumbnail
+//
+// A hit therefore skips extraction, classification and, in cgptest, every
+// Gemini and Woogles call.
+//
+// Off unless CGP_BOARD_CACHE=1 (board_cache_enabled()): the hash and block
+// tolerances in board_cache.cpp are first estimates, not yet tuned against
+// testdata, and a false hit silently answers with another position.
+
+#include "board.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+static const int BOARD_SIG_CELL = 16;  // rectified cell side in pixels
+
+// Perceptual fingerprint of a detected board and the rack strip below it.
+struct BoardSignature {
+    uint64_t board_hash = 0;  // dHash of the rectified board
+    uint64_t rack_hash = 0;   // dHash of the rack strip (0 without has_rack)
+    bool has_rack = false;    // rack strip lies fully inside the image
+    cv::Mat board;            // CV_8UC1, 15 * BOARD_SIG_CELL square
+    cv::Mat rack;             // CV_8UC1 thumbnail, empty without has_rack
+};
+
+// Fingerprint the board at `board_rect` (as found by stage 1 of the
+// pipeline, see DetectCallback).  Returns false if the rect is empty or not
+// inside the image.
+bool compute_board_signature(const cv::Mat& bgr, const cv::Rect& board_rect,
+                             int cell_size, BoardSignature& out);
+
+// Result stored per signature.
+struct CachedBoard {
+    std::string key;                // caller-defined; only an equal key hits
+    std::string cgp;
+    CellResult cells[15][15] = {};  // occupancy used to verify a hit
+    std::vector<std::string> extra; // caller-defined, returned with a hit
+};
+
+// CGP_BOARD_CACHE=1 in the environment; read once.
+bool board_cache_enabled();
+
+// ---------------------------------------------------------------------------
+// Thread-safe LRU of signature -> CachedBoard.  Lookups are a linear scan
+// with popcount over at most `capacity` entries, then one verification.
+// ---------------------------------------------------------------------------
+class BoardCache {
+public:
+    explicit BoardCache(size_t capacity = 64);
+    BoardCache(const BoardCache&) = delete;
+    BoardCache& operator=(const BoardCache&) = delete;
+
+    // Most recently used verified near-duplicate of `sig` stored under
+    // `key`, if any.
+    bool lookup(const BoardSignature& sig, const std::string& key, CachedBoard& out);
+
+    // Insert, replacing a verified near-duplicate with the same key or the
+    // least recently used entry when full.
+    void store(const BoardSignature& sig, const CachedBoard& value);
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        BoardSignature sig;
+        CachedBoard value;
+        uint64_t last_used = 0;
+    };
+    int find_locked(const BoardSignature& sig, const std::string& key) const;
+
+    mutable std::mutex mu_;
+    std::vector<Entry> entries_;
+    size_t capacity_;
+    uint64_t clock_ = 0;
+};
+
+// process_board_image() through `cache`: on a hit only detection runs.
+// Without board_cache_enabled() this is process_board_image().
+std::string process_board_image_cached(const std::vector<uint8_t>& image_data,
+                                       BoardCache& cache);
@@ -0,0 +1,206 @@
+#include "cgpvision.h"
+
+#include "board.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+static_assert(sizeof(cgpv_cell) == 8, "cgpv_cell is part of the ABI");
+static_assert(sizeof(cgpv_board) == 24, "cgpv_board is part of the ABI");
+
+// Wrap a caller buffer without copying.  The const_cast is safe: the
+// pipeline only reads its input.
+static bool wrap_image(const cgpv_image* image, cv::Mat& out) {
+    if (!image || !image->data || image->width <= 0 || image->height <= 0)
+        return false;
+    int type;
+    switch (image->channels) {
+    case 1: type = CV_8UC1; break;
+    case 3: type = CV_8UC3; break;
+    case 4: type = CV_8UC4; break;
+    default: return false;
+    }
+    if (image->stride < image->width * image->channels) return false;
+    out = cv::Mat(image->height, image->width, type,
+                  const_cast<uint8_t*>(image->data),
+                  static_cast<size_t>(image->stride));
+    return true;
+}
+
+// The pipeline works on BGR; convert only when the caller passed another format.
+static bool wrap_bgr(const cgpv_image* image, cv::Mat& out) {
+    cv::Mat m;
+    if (!wrap_image(image, m)) return false;
+    if (m.channels() == 1) cv::cvtColor(m, out, cv::COLOR_GRAY2BGR);
+    else if (m.channels() == 4) cv::cvtColor(m, out, cv::COLOR_BGRA2BGR);
+    else out = m;
+    return true;
+}
+
+static cgpv_cell to_cell(const CellResult& cr) {
+    cgpv_cell c = {};
+    c.letter = cr.letter;
+    c.is_blank = cr.is_blank;
+    c.subscript = static_cast<int8_t>(cr.subscript);
+    c.confidence = cr.confidence;
+    return c;
+}
+
+static void to_board(const cv::Rect& r, int cell_size, bool is_light,
+                     cgpv_board* out) {
+    out->x = r.x;
+    out->y = r.y;
+    out->width = r.width;
+    out->height = r.height;
+    out->cell_size = cell_size;
+    out->is_light = is_light;
+}
+
+static int fill_result(const DebugResult& dr, cgpv_result* out) {
+    std::memset(out, 0, sizeof(*out));
+    if (dr.cell_size <= 0) return CGPV_E_NOBOARD;
+    to_board(dr.board_rect, dr.cell_size, dr.is_light, &out->board);
+    for (int r = 0; r < 15; r++)
+        for (int c = 0; c < 15; c++)
+            out->cells[r * 15 + c] = to_cell(dr.cells[r][c]);
+    std::snprintf(out->cgp, sizeof(out->cgp), "%s", dr.cgp.c_str());
+    return CGPV_OK;
+}
+
+// Runs f() and maps any exception to CGPV_E_INTERNAL.
+template <class F>
+static int guarded(F f) {
+    try {
+        return f();
+    } catch (const std::exception&) {
+        return CGPV_E_INTERNAL;
+    } catch (...) {
+        return CGPV_E_INTERNAL;
+    }
+}
+
+uint32_t cgpv_abi_version(void) {
+    return CGPV_ABI_VERSION;
+}
+
+uint32_t cgpv_pipeline_version(void) {
+    return PIPELINE_VERSION;
+}
+
+const char* cgpv_error_string(int code) {
+    switch (code) {
+    case CGPV_OK: return "ok";
+    case CGPV_E_ARG: return "invalid argument";
+    case CGPV_E_DECODE: return "could not decode image";
+    case CGPV_E_BUFFER: return "output buffer too small";
+    case CGPV_E_NOBOARD: return "no board found";
+    case CGPV_E_INTERNAL: return "internal error";
+    default: return "unknown error";
+    }
+}
+
+int cgpv_decode(const uint8_t* bytes, size_t n_bytes, uint8_t* out,
+                size_t out_size, int32_t* width, int32_t* height) {
+    if (!bytes || n_bytes == 0 || !width || !height) return CGPV_E_ARG;
+    return guarded([&]() -> int {
+        cv::Mat buf(1, static_cast<int>(n_bytes), CV_8UC1, const_cast<uint8_t*>(bytes));
+        cv::Mat img = cv::imdecode(buf, cv::IMREAD_COLOR);
+        if (img.empty()) return CGPV_E_DECODE;
+        *width = img.cols;
+        *height = img.rows;
+        size_t need = img.total() * 3;
+        if (!out || out_size < need) return CGPV_E_BUFFER;
+        cv::Mat dst(img.rows, img.cols, CV_8UC3, out);
+        img.copyTo(dst);
+        return CGPV_OK;
+    });
+}
+
+int cgpv_detect_board(const cgpv_image* image, cgpv_board* out) {
+    if (!out) return CGPV_E_ARG;
+    return guarded([&]() -> int {
+        cv::Mat img;
+        if (!wrap_bgr(image, img)) return CGPV_E_ARG;
+        cv::Rect rect;
+        int cell_size = 0;
+        bool is_light = false;
+        bool found = detect_board_region(img, rect, cell_size, is_light);
+        to_board(rect, cell_size, is_light, out);
+        return found ? CGPV_OK : CGPV_E_NOBOARD;
+    });
+}
+
+int cgpv_analyze(const cgpv_image* image, cgpv_result* out) {
+    if (!out) return CGPV_E_ARG;
+    return guarded([&]() -> int {
+        cv::Mat img;
+        if (!wrap_bgr(image, img)) return CGPV_E_ARG;
+        return fill_result(process_board_mat_debug(img), out);
+    });
+}
+
+int cgpv_analyze_encoded(const uint8_t* bytes, size_t n_bytes, cgpv_result* out) {
+    if (!bytes || n_bytes == 0 || !out) return CGPV_E_ARG;
+    return guarded([&]() -> int {
+        cv::Mat buf(1, static_cast<int>(n_bytes), CV_8UC1, const_cast<uint8_t*>(bytes));
+        cv::Mat img = cv::imdecode(buf, cv::IMREAD_COLOR);
+        if (img.empty()) return CGPV_E_DECODE;
+        return fill_result(process_board_mat_debug(img), out);
+    });
+}
+
+int cgpv_occupancy(const cgpv_image* image, uint8_t out[225], cgpv_board* board) {
+    if (!out) return CGPV_E_ARG;
+    return guarded([&]() -> int {
+        cv::Mat img;
+        if (!wrap_bgr(image, img)) return CGPV_E_ARG;
+        DebugResult dr = process_board_mat_debug(img);
+        std::memset(out, 0, 225);
+        if (board) to_board(dr.board_rect, dr.cell_size, dr.is_light, board);
+        if (dr.cell_size <= 0) return CGPV_E_NOBOARD;
+        for (int r = 0; r < 15; r++)
+            for (int c = 0; c < 15; c++)
+                out[r * 15 + c] = dr.cells[r][c].letter != 0;
+        return CGPV_OK;
+    });
+}
+
+int32_t cgpv_cnn_input_size(void) {
+    return 48;
+}
+
+int cgpv_preprocess_tile(const cgpv_image* crop, uint8_t* out, int32_t out_stride) {
+    if (!out || out_stride < cgpv_cnn_input_size()) return CGPV_E_ARG;
+    return guarded([&]() -> int {
+        cv::Mat m;
+        if (!wrap_image(crop, m)) return CGPV_E_ARG;
+        if (m.channels() == 4) cv::cvtColor(m, m, cv::COLOR_BGRA2BGR);
+        cv::Mat gray = preprocess_tile_for_cnn(m);
+        if (gray.rows != cgpv_cnn_input_size() || gray.cols != cgpv_cnn_input_size())
+            return CGPV_E_INTERNAL;
+        cv::Mat dst(gray.rows, gray.cols, CV_8UC1, out, static_cast<size_t>(out_stride));
+        gray.copyTo(dst);
+        return CGPV_OK;
+    });
+}
+
+int cgpv_classify_tiles(const cgpv_image* crops, int32_t n, int32_t method,
+                        float* scores, cgpv_cell* out) {
+    if (!crops || n < 0 || !out || method < CGPV_METHOD_AUTO
+        || method > CGPV_METHOD_TEMPLATE)
+        return CGPV_E_ARG;
+    return guarded([&]() -> int {
+        for (int32_t i = 0; i < n; i++) {
+            cv::Mat tile;
+            if (!wrap_bgr(&crops[i], tile)) return CGPV_E_ARG;
+            float s[26] = {};
+            out[i] = to_cell(classify_single_tile_ex(tile, method, s));
+            if (scores) std::memcpy(scores + 26 * i, s, sizeof(s));
+        }
+        return CGPV_OK;
+    });
+}
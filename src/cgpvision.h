@@ -0,0 +1,129 @@
+/*
+ * libcgpvision — C ABI over the board vision pipeline, for in-process use
+ * from Python (ctypes) and other non-C++ callers.
+ *
+ * Images are passed as caller-owned pixel buffers (cgpv_image) and are read
+ * in place; nothing is copied unless the pipeline needs a different pixel
+ * format (gray or BGRA input is converted to BGR).  Results are written into
+ * caller-provided structs and arrays.  Every function returns CGPV_OK or a
+ * negative CGPV_E_* code and never throws.
+ *
+ * ABI rules: structs and enums only ever grow at the end of a new
+ * CGPV_ABI_VERSION; existing fields and functions keep their meaning.
+ * Check cgpv_abi_version() at load time.
+ *
+ * All functions are thread-safe.
+ */
+#ifndef CGPVISION_H
+#define CGPVISION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CGPV_ABI_VERSION 1
+
+#if defined(__GNUC__)
+#define CGPV_API __attribute__((visibility("default")))
+#else
+#define CGPV_API
+#endif
+
+enum {
+    CGPV_OK = 0,
+    CGPV_E_ARG = -1,       /* null pointer, bad size or channel count */
+    CGPV_E_DECODE = -2,    /* encoded image could not be decoded */
+    CGPV_E_BUFFER = -3,    /* output buffer too small (size reported) */
+    CGPV_E_NOBOARD = -4,   /* no board found */
+    CGPV_E_INTERNAL = -5   /* OpenCV or other internal failure */
+};
+
+/* Classification method for cgpv_classify_tiles(). */
+enum {
+    CGPV_METHOD_AUTO = 0,      /* CNN if the model loaded, else templates */
+    CGPV_METHOD_CNN = 1,
+    CGPV_METHOD_TEMPLATE = 2
+};
+
+/* A caller-owned 8-bit image.  numpy: data = arr.ctypes.data,
+ * stride = arr.strides[0]; rows may be padded, pixels must be packed. */
+typedef struct cgpv_image {
+    const uint8_t* data;
+    int32_t width;
+    int32_t height;
+    int32_t stride;    /* bytes from one row to the next */
+    int32_t channels;  /* 1 = gray, 3 = BGR, 4 = BGRA */
+} cgpv_image;
+
+typedef struct cgpv_board {
+    int32_t x, y, width, height;  /* board rect in image pixels */
+    int32_t cell_size;
+    int32_t is_light;             /* 1 = light/cream theme */
+} cgpv_board;
+
+typedef struct cgpv_cell {
+    char letter;        /* 0 = empty, 'A'-'Z' tile, 'a'-'z' designated
+                           blank, '?' blank or unreadable */
+    uint8_t is_blank;
+    int8_t subscript;   /* point value read from the tile, 0 = unread */
+    uint8_t reserved;
+    float confidence;
+} cgpv_cell;
+
+typedef struct cgpv_result {
+    cgpv_board board;
+    cgpv_cell cells[225];  /* row-major, cells[row * 15 + col] */
+    char cgp[320];         /* pipeline CGP (no rack), NUL-terminated */
+} cgpv_result;
+
+CGPV_API uint32_t cgpv_abi_version(void);
+
+/* PIPELINE_VERSION of the linked pipeline (changes when results change). */
+CGPV_API uint32_t cgpv_pipeline_version(void);
+
+CGPV_API const char* cgpv_error_string(int code);
+
+/* Decode PNG/JPEG bytes to packed BGR (stride = width * 3).  Width and
+ * height are always reported; with out == NULL or out_size too small the
+ * call returns CGPV_E_BUFFER so the caller can allocate and call again. */
+CGPV_API int cgpv_decode(const uint8_t* bytes, size_t n_bytes,
+                         uint8_t* out, size_t out_size,
+                         int32_t* width, int32_t* height);
+
+/* Board search only (no OCR retry). */
+CGPV_API int cgpv_detect_board(const cgpv_image* image, cgpv_board* out);
+
+/* Full pipeline: detection, occupancy, classification. */
+CGPV_API int cgpv_analyze(const cgpv_image* image, cgpv_result* out);
+
+/* Full pipeline on encoded PNG/JPEG bytes. */
+CGPV_API int cgpv_analyze_encoded(const uint8_t* bytes, size_t n_bytes,
+                                  cgpv_result* out);
+
+/* Occupancy mask from the full pipeline: out[row * 15 + col] = 1 where a
+ * tile was found.  board may be NULL. */
+CGPV_API int cgpv_occupancy(const cgpv_image* image, uint8_t out[225],
+                            cgpv_board* board);
+
+/* Side of the square CNN input produced by cgpv_preprocess_tile(). */
+CGPV_API int32_t cgpv_cnn_input_size(void);
+
+/* Preprocess one tile crop exactly as the tile CNN sees it (resize, gray,
+ * polarity normalize, equalize) into a size x size uint8 buffer. */
+CGPV_API int cgpv_preprocess_tile(const cgpv_image* crop, uint8_t* out,
+                                  int32_t out_stride);
+
+/* Classify n tile crops.  scores (optional) receives n * 26 per-letter
+ * scores; out receives n cells.  Crops are board cells (blank check on). */
+CGPV_API int cgpv_classify_tiles(const cgpv_image* crops, int32_t n,
+                                 int32_t method, float* scores,
+                                 cgpv_cell* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CGPVISION_H */
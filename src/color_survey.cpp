@@ -1,7 +1,9 @@
 // Sample brightness/contrast/HSV at every cell across all test images,
 // grouped by (board_style, premium_type, tile_vs_empty).
 // Only uses images where the board rect is correct (occupancy errors <= 2).
+// Stats are the is_tile() center measurements from the feature store.
 #include "board.h"
+#include "feature_store.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -10,8 +12,6 @@
 #include <cmath>
 #include <algorithm>
 #include <filesystem>
-#include <opencv2/imgcodecs.hpp>
-#include <opencv2/imgproc.hpp>
 
 namespace fs = std::filesystem;
 
@@ -75,11 +75,20 @@ struct Sample {
 
 int main(int argc, char* argv[]) {
     std::setbuf(stdout, nullptr);
-    if (argc < 2) {
-        std::cerr << "Usage: color_survey <testdata_dir>\n";
+    std::string store_path = FEATURE_STORE_DEFAULT_PATH;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--store" && i + 1 < argc) store_path = argv[++i];
+        else if (arg == "--no-store") store_path.clear();
+        else positional.push_back(arg);
+    }
+    if (positional.empty()) {
+        std::cerr << "Usage: color_survey [--store FILE | --no-store] <testdata_dir>\n";
         return 1;
     }
-    std::string dir = argv[1];
+    std::string dir = positional[0];
+    FeatureStore store(store_path);
 
     // [style][premium_type][tile=1/empty=0] -> samples
     std::vector<Sample> data[N_STYLES][6][2];
@@ -106,13 +115,13 @@ int main(int argc, char* argv[]) {
         // Read image and run board detection
         std::ifstream ifs(path, std::ios::binary);
         std::vector<uint8_t> imgdata(std::istreambuf_iterator<char>(ifs), {});
-        auto dr = process_board_image_debug(imgdata);
+        const FeatureRecord& rec = store.get(imgdata);
 
         // Check board is reasonably detected (few occupancy errors)
         int errors = 0;
         for (int r = 0; r < 15; r++)
             for (int c = 0; c < 15; c++) {
-                bool detected = (dr.cells[r][c].letter != 0);
+                bool detected = (rec.cells[r][c].letter != 0);
                 bool actual = gt_occ[r][c];
                 if (detected != actual) errors++;
             }
@@ -124,42 +133,16 @@ int main(int argc, char* argv[]) {
             continue;
         }
 
-        // Decode image and extract cell stats
-        cv::Mat img = cv::imdecode(imgdata, cv::IMREAD_COLOR);
-
-        // Parse board rect from debug log
-        int bx = 0, by = 0, bw = 0;
-        auto pos = dr.log.find("Final: rect=");
-        if (pos != std::string::npos)
-            sscanf(dr.log.c_str() + pos, "Final: rect=%d,%d %dx%d", &bx, &by, &bw, &bw);
-        if (bw == 0) continue;
-
-        double cw = bw / 15.0;
-        int inset_x = (int)(cw * 0.2), inset_y = (int)(cw * 0.2);
-        int inner_w = (int)(cw * 0.6), inner_h = (int)(cw * 0.6);
+        if (rec.board_rect[2] == 0) continue;
 
         for (int r = 0; r < 15; r++) {
             for (int c = 0; c < 15; c++) {
-                int x0 = bx + (int)(c * cw) + inset_x;
-                int y0 = by + (int)(r * cw) + inset_y;
-                if (x0 < 0 || y0 < 0 || x0 + inner_w > img.cols || y0 + inner_h > img.rows)
-                    continue;
-
-                cv::Mat cell = img(cv::Rect(x0, y0, inner_w, inner_h));
-                cv::Mat gray;
-                cv::cvtColor(cell, gray, cv::COLOR_BGR2GRAY);
-                cv::Scalar gm, gs;
-                cv::meanStdDev(gray, gm, gs);
-
-                cv::Mat hsv;
-                cv::cvtColor(cell, hsv, cv::COLOR_BGR2HSV);
-                cv::Scalar hm = cv::mean(hsv);
-
+                const CellFeatures& f = rec.features[r][c];
                 int prem = PREMIUM[r][c];
                 int is_tile = gt_occ[r][c] ? 1 : 0;
                 data[style][prem][is_tile].push_back({
-                    (float)gm[0], (float)gs[0],
-                    (float)hm[0], (float)hm[1], (float)hm[2]
+                    f.brightness, f.contrast,
+                    f.center_hsv[0], f.center_hsv[1], f.center_hsv[2]
                 });
             }
         }
@@ -168,6 +151,8 @@ int main(int argc, char* argv[]) {
         std::fprintf(stderr, "\r%d files...", n_files);
     }
     std::fprintf(stderr, "\n");
+    if (!store.save())
+        std::fprintf(stderr, "Failed to write feature store %s\n", store_path.c_str());
 
     // Print summary stats
     for (int st = 0; st < N_STYLES; st++) {
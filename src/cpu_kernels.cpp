@@ -0,0 +1,324 @@
+#include "cpu_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Kernel bodies.  Force-inlined into each variant below so the vectorizer
+// sees them under that variant's target ISA.  None needs FP reassociation
+// (the reduction keeps explicit lanes), so -O3 vectorizes them as written.
+// ---------------------------------------------------------------------------
+
+#define KERNEL_BODY static inline __attribute__((always_inline))
+
+static const int SUM_LANES = 8;
+
+KERNEL_BODY void abs_accumulate_body(const float* src, int n, double* acc) {
+    for (int i = 0; i < n; i++)
+        acc[i] += std::abs(src[i]);
+}
+
+KERNEL_BODY double abs_sum_body(const float* src, int n) {
+    double part[SUM_LANES] = {};
+    int i = 0;
+    for (; i + SUM_LANES <= n; i += SUM_LANES)
+        for (int j = 0; j < SUM_LANES; j++)
+            part[j] += std::abs(src[i + j]);
+    double sum = 0;
+    for (int j = 0; j < SUM_LANES; j++) sum += part[j];
+    for (; i < n; i++) sum += std::abs(src[i]);
+    return sum;
+}
+
+KERNEL_BODY void minmax_accumulate_body(const uint8_t* __restrict src, int n,
+                                        uint8_t* __restrict mn,
+                                        uint8_t* __restrict mx) {
+    for (int i = 0; i < n; i++) {
+        mn[i] = std::min(mn[i], src[i]);
+        mx[i] = std::max(mx[i], src[i]);
+    }
+}
+
+KERNEL_BODY int range_step2_body(const uint8_t* src, int n) {
+    if (n <= 0) return 0;
+    uint8_t mn = 255, mx = 0;
+    for (int i = 0; i < n; i += 2) {
+        mn = std::min(mn, src[i]);
+        mx = std::max(mx, src[i]);
+    }
+    return mx - mn;
+}
+
+// ---------------------------------------------------------------------------
+// Base64.  The vectorizer can't do the table lookup, so the SIMD variants
+// are written with intrinsics (Muła's pshufb method); every variant finishes
+// the last few bytes with the scalar loop.
+// ---------------------------------------------------------------------------
+
+static const char B64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void base64_encode_baseline(const uint8_t* src, size_t n, char* dst) {
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3, dst += 4) {
+        uint32_t v = (uint32_t(src[i]) << 16) | (uint32_t(src[i + 1]) << 8) | src[i + 2];
+        dst[0] = B64[v >> 18];
+        dst[1] = B64[(v >> 12) & 0x3F];
+        dst[2] = B64[(v >> 6) & 0x3F];
+        dst[3] = B64[v & 0x3F];
+    }
+    if (i < n) {
+        uint32_t v = uint32_t(src[i]) << 16;
+        if (i + 1 < n) v |= uint32_t(src[i + 1]) << 8;
+        dst[0] = B64[v >> 18];
+        dst[1] = B64[(v >> 12) & 0x3F];
+        dst[2] = i + 1 < n ? B64[(v >> 6) & 0x3F] : '=';
+        dst[3] = '=';
+    }
+}
+
+#ifdef CPU_KERNELS_X86
+// pshufb arguments, high byte first.  SHUFFLE orders each 3-byte group as
+// b1 b0 b2 b1 in its 32-bit lane; OFFSETS is the ASCII offset of each index
+// range (0-25 'A', 26-51 'a' - 26, 52-61 '0' - 52, 62 '+' - 62, 63 '/' - 63).
+#define BASE64_SHUFFLE 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+#define BASE64_OFFSETS 0, 0, 65, -16, -19, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, 71
+
+// 12 input bytes (in the low 12 of `in`) to 16 characters.
+__attribute__((target("sse4.2,popcnt")))
+static inline __m128i base64_step_sse42(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(BASE64_SHUFFLE));
+    // Split each lane into four 6-bit indices, one per byte.
+    __m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)),
+                                 _mm_set1_epi32(0x04000040));
+    __m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)),
+                                 _mm_set1_epi32(0x01000010));
+    __m128i idx = _mm_or_si128(hi, lo);
+    // Range number: 0 for 0-25, 1 for 26-51, 2..13 for 52-63.
+    __m128i range = _mm_or_si128(
+        _mm_subs_epu8(idx, _mm_set1_epi8(51)),
+        _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+    return _mm_add_epi8(idx, _mm_shuffle_epi8(_mm_set_epi8(BASE64_OFFSETS), range));
+}
+
+// Same, 12 bytes per 128-bit lane.
+__attribute__((target("avx2")))
+static inline __m256i base64_step_avx2(__m256i in) {
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(BASE64_SHUFFLE, BASE64_SHUFFLE));
+    __m256i hi = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)),
+                                    _mm256_set1_epi32(0x04000040));
+    __m256i lo = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)),
+                                    _mm256_set1_epi32(0x01000010));
+    __m256i idx = _mm256_or_si256(hi, lo);
+    __m256i range = _mm256_or_si256(
+        _mm256_subs_epu8(idx, _mm256_set1_epi8(51)),
+        _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx),
+                         _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(
+        idx, _mm256_shuffle_epi8(_mm256_set_epi8(BASE64_OFFSETS, BASE64_OFFSETS), range));
+}
+
+// Loads 16 bytes per 12 encoded, so leaves at least 4 to the scalar loop.
+__attribute__((target("sse4.2,popcnt")))
+static void base64_encode_sse42(const uint8_t* src, size_t n, char* dst) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 12, dst += 16) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), base64_step_sse42(in));
+    }
+    base64_encode_baseline(src + i, n - i, dst);
+}
+
+__attribute__((target("avx2")))
+static void base64_encode_avx2(const uint8_t* src, size_t n, char* dst) {
+    size_t i = 0;
+    for (; i + 28 <= n; i += 24, dst += 32) {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), base64_step_avx2(in));
+    }
+    base64_encode_baseline(src + i, n - i, dst);
+}
+
+// AVX-512 has nothing the AVX2 loop needs.
+static void base64_encode_avx512(const uint8_t* src, size_t n, char* dst) {
+    base64_encode_avx2(src, n, dst);
+}
+#endif
+
+// One entry point per kernel and ISA level.
+#define DEFINE_VARIANT(name, target)                                          \
+    target static void abs_accumulate_##name(const float* src, int n,         \
+                                             double* acc) {                   \
+        abs_accumulate_body(src, n, acc);                                     \
+    }                                                                         \
+    target static double abs_sum_##name(const float* src, int n) {            \
+        return abs_sum_body(src, n);                                          \
+    }                                                                         \
+    target static void minmax_accumulate_##name(const uint8_t* src, int n,    \
+                                                uint8_t* mn, uint8_t* mx) {   \
+        minmax_accumulate_body(src, n, mn, mx);                               \
+    }                                                                         \
+    target static int range_step2_##name(const uint8_t* src, int n) {         \
+        return range_step2_body(src, n);                                      \
+    }
+
+DEFINE_VARIANT(baseline, )
+#ifdef CPU_KERNELS_X86
+DEFINE_VARIANT(sse42, __attribute__((target("sse4.2,popcnt"))))
+DEFINE_VARIANT(avx2, __attribute__((target("avx2"))))
+DEFINE_VARIANT(avx512, __attribute__((target("avx512f,avx512bw,avx512vl"))))
+#endif
+
+// ---------------------------------------------------------------------------
+// Dispatch table
+// ---------------------------------------------------------------------------
+
+struct Variant {
+    CpuKernels k;
+    bool (*supported)();
+};
+
+static bool always() { return true; }
+
+#ifdef CPU_KERNELS_X86
+static bool has_sse42() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+}
+static bool has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+static bool has_avx512() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512vl");
+}
+#endif
+
+#define VARIANT_KERNELS(name) \
+    abs_accumulate_##name, abs_sum_##name, minmax_accumulate_##name, range_step2_##name, \
+    base64_encode_##name
+
+// Best first.
+static const Variant VARIANTS[] = {
+#ifdef CPU_KERNELS_X86
+    {{"avx512", VARIANT_KERNELS(avx512)}, has_avx512},
+    {{"avx2", VARIANT_KERNELS(avx2)}, has_avx2},
+    {{"sse4.2", VARIANT_KERNELS(sse42)}, has_sse42},
+#endif
+    {{"baseline", VARIANT_KERNELS(baseline)}, always},
+};
+
+static const CpuKernels& select_kernels() {
+    if (const char* want = std::getenv("CGP_ISA")) {
+        for (const Variant& v : VARIANTS)
+            if (std::strcmp(v.k.isa, want) == 0 && v.supported()) return v.k;
+    }
+    for (const Variant& v : VARIANTS)
+        if (v.supported()) return v.k;
+    return VARIANTS[std::size(VARIANTS) - 1].k;
+}
+
+const CpuKernels& cpu_kernels() {
+    static const CpuKernels& k = select_kernels();
+    return k;
+}
+
+std::vector<const CpuKernels*> cpu_kernel_variants() {
+    std::vector<const CpuKernels*> out;
+    for (const Variant& v : VARIANTS)
+        if (v.supported()) out.push_back(&v.k);
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Self-test
+// ---------------------------------------------------------------------------
+
+bool cpu_kernels_self_test(std::string* report) {
+    // Lengths around the vector widths plus board-sized rows; the +1 source
+    // offset makes every row start unaligned.
+    const int lengths[] = {0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 640, 1283};
+    const int max_n = 1283;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> dist(-1020.0f, 1020.0f);
+    std::vector<float> src(max_n + 1);
+    for (float& f : src) f = dist(rng);
+    std::vector<uint8_t> pix(max_n + 1);
+    for (uint8_t& p : pix) p = static_cast<uint8_t>(rng());
+
+    const CpuKernels& ref = VARIANTS[std::size(VARIANTS) - 1].k;
+    std::vector<double> want(max_n), got(max_n);
+    std::vector<uint8_t> want_mn(max_n), want_mx(max_n), got_mn(max_n), got_mx(max_n);
+    for (const CpuKernels* k : cpu_kernel_variants()) {
+        for (int n : lengths) {
+            for (int off = 0; off <= 1; off++) {
+                const float* s = src.data() + off;
+                std::fill(want.begin(), want.end(), 1.5);
+                std::fill(got.begin(), got.end(), 1.5);
+                ref.abs_accumulate(s, n, want.data());
+                k->abs_accumulate(s, n, got.data());
+                if (std::memcmp(want.data(), got.data(), sizeof(double) * max_n) != 0) {
+                    if (report)
+                        *report = std::string(k->isa) + " abs_accumulate differs at n="
+                                + std::to_string(n);
+                    return false;
+                }
+                double a = ref.abs_sum(s, n), b = k->abs_sum(s, n);
+                if (std::memcmp(&a, &b, sizeof(double)) != 0) {
+                    if (report)
+                        *report = std::string(k->isa) + " abs_sum differs at n="
+                                + std::to_string(n);
+                    return false;
+                }
+
+                const uint8_t* p = pix.data() + off;
+                for (int i = 0; i < max_n; i++) {
+                    want_mn[i] = got_mn[i] = static_cast<uint8_t>(160 + i % 64);
+                    want_mx[i] = got_mx[i] = static_cast<uint8_t>(96 - i % 64);
+                }
+                ref.minmax_accumulate(p, n, want_mn.data(), want_mx.data());
+                k->minmax_accumulate(p, n, got_mn.data(), got_mx.data());
+                if (want_mn != got_mn || want_mx != got_mx) {
+                    if (report)
+                        *report = std::string(k->isa) + " minmax_accumulate differs at n="
+                                + std::to_string(n);
+                    return false;
+                }
+                if (ref.range_step2(p, n) != k->range_step2(p, n)) {
+                    if (report)
+                        *report = std::string(k->isa) + " range_step2 differs at n="
+                                + std::to_string(n);
+                    return false;
+                }
+            }
+        }
+        // Every length up to a few SIMD steps, so each tail and padding
+        // case follows each block count.
+        for (int n = 0; n <= 100; n++) {
+            std::string want_b64((n + 2) / 3 * 4, '\0'), got_b64(want_b64.size(), '\0');
+            ref.base64_encode(pix.data() + 1, n, want_b64.data());
+            k->base64_encode(pix.data() + 1, n, got_b64.data());
+            if (want_b64 != got_b64) {
+                if (report)
+                    *report = std::string(k->isa) + " base64_encode differs at n="
+                            + std::to_string(n);
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+// Hand-written hot loops of board_lib, built once per x86 ISA level.
+//
+// The library is compiled for the baseline ISA (plain -O3, no -march) so the
+// same binary runs on every host.  Each kernel here is also compiled with
+// SSE4.2, AVX2 and AVX-512 enabled, and cpu_kernels() picks the best variant
+// the CPU supports on first use.  Set CGP_ISA=baseline|sse4.2|avx2|avx512 to
+// force a variant (benchmarks, bisecting a suspected codegen problem); an
+// unsupported or unknown name is ignored.
+//
+// Every pixel kernel runs the same source with the same lane order in each
+// variant, so results are bit-identical across variants; base64_encode has
+// intrinsics variants but exact output too.  cpu_kernels_self_test() checks
+// both.
+// OpenCV calls are not covered: OpenCV dispatches its own kernels.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CpuKernels {
+    const char* isa;  // "avx512", "avx2", "sse4.2" or "baseline"
+
+    // acc[i] += |src[i]| for i in [0, n)
+    void (*abs_accumulate)(const float* src, int n, double* acc);
+
+    // Sum of |src[i]| for i in [0, n), in 8 interleaved partial sums.  Exact
+    // (and so equal to a sequential sum) for integer-valued input such as a
+    // Sobel response of an 8-bit image.
+    double (*abs_sum)(const float* src, int n);
+
+    // mn[i] = min(mn[i], src[i]) and mx[i] = max(mx[i], src[i]) for i in
+    // [0, n): per-column min/max profile of a band, one row at a time.
+    void (*minmax_accumulate)(const uint8_t* src, int n, uint8_t* mn, uint8_t* mx);
+
+    // max - min of src[0], src[2], src[4], ... (even offsets below n); 0 for
+    // n <= 0.  Per-row range profile sampled every other pixel.
+    int (*range_step2)(const uint8_t* src, int n);
+
+    // Padded base64 (RFC 4648) of src[0, n) into dst[0, (n + 2) / 3 * 4);
+    // see base64.h.
+    void (*base64_encode)(const uint8_t* src, size_t n, char* dst);
+};
+
+// Variant selected for this CPU.
+const CpuKernels& cpu_kernels();
+
+// All variants this CPU can run, best first; the last one is baseline.
+std::vector<const CpuKernels*> cpu_kernel_variants();
+
+// Run every supported variant against baseline on synthetic input.  Returns
+// false on any mismatch and, with `report`, describes the first one.
+bool cpu_kernels_self_test(std::string* report = nullptr);
@@ -2,16 +2,19 @@
 // No Gemini, no server — just iterate testdata, run process_board_image_debug,
 // compare output CGP against expected CGP per-cell.
 //
-// Usage: eval_local <testdata_dir> [--html <output.html>]
+// Usage: eval_local <testdata_dir> [--html <output.html>] [--rack-html <output.html>]
+//                   [--store FILE | --no-store]
 //   --html: generate a self-contained HTML debug page for non-perfect cases
+//   Pipeline results come from the feature store (default
+//   pipeline_features.bin); --no-store reruns everything, e.g. for timing.
 #include "board.h"
+#include "feature_store.h"
 #include "rack.h"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
-#include <chrono>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -680,26 +683,38 @@ h1 { color: #eee; font-size: 1.2rem; margin-bottom: 4px; }
 int main(int argc, char* argv[]) {
     std::setbuf(stdout, nullptr);
     if (argc < 2) {
-        std::cerr << "Usage: eval_local <testdata_dir> [--html <output.html>] [--rack-html <output.html>]\n";
+        std::cerr << "Usage: eval_local <testdata_dir> [--html <output.html>] [--rack-html <output.html>]"
+                     " [--store FILE | --no-store]\n";
         return 1;
     }
     std::string dir = argv[1];
     std::string html_path;
     std::string rack_html_path;
-    for (int i = 2; i < argc - 1; i++) {
-        if (std::string(argv[i]) == "--html") {
+    std::string store_path = FEATURE_STORE_DEFAULT_PATH;
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--no-store") {
+            store_path.clear();
+        } else if (i + 1 >= argc) {
+            break;
+        } else if (std::string(argv[i]) == "--html") {
             html_path = argv[i+1];
             i++;
         } else if (std::string(argv[i]) == "--rack-html") {
             rack_html_path = argv[i+1];
             i++;
+        } else if (std::string(argv[i]) == "--store") {
+            store_path = argv[i+1];
+            i++;
         }
     }
+    FeatureStore store(store_path);
 
     int n_files = 0;
     int total_tiles = 0, total_correct = 0, total_occ_errors = 0;
     int perfect_cases = 0;
     double total_ms = 0;
+    double mode_ms[2] = {0, 0};  // by board mode (dark, light), this run only
+    int mode_cases[2] = {0, 0};
 
     // Per-letter confusion tracking
     int per_letter_total[26] = {};
@@ -741,18 +756,24 @@ int main(int argc, char* argv[]) {
         std::ifstream ifs(path, std::ios::binary);
         std::vector<uint8_t> imgdata(std::istreambuf_iterator<char>(ifs), {});
 
-        auto t0 = std::chrono::high_resolution_clock::now();
-        auto dr = process_board_image_debug(imgdata);
-        auto t1 = std::chrono::high_resolution_clock::now();
-        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        // Timing is the pipeline run that produced the record, which may
+        // come from an earlier invocation; the per-mode split counts only
+        // records computed now, so it compares like with like.
+        int computed_before = store.computed();
+        const FeatureRecord& rec = store.get(imgdata);
+        double ms = rec.pipeline_ms;
         total_ms += ms;
+        if (store.computed() > computed_before) {
+            mode_ms[rec.is_light ? 1 : 0] += ms;
+            mode_cases[rec.is_light ? 1 : 0]++;
+        }
 
         // Compare per-cell
         int tiles = 0, correct = 0, occ_err = 0;
         for (int r = 0; r < 15; r++) {
             for (int c = 0; c < 15; c++) {
                 char exp_ch = gt[r][c];
-                char got_ch = dr.cells[r][c].letter;
+                char got_ch = rec.cells[r][c].letter;
                 bool exp_tile = (exp_ch != 0);
 
                 if (exp_tile != (got_ch != 0)) {
@@ -789,18 +810,10 @@ int main(int argc, char* argv[]) {
         CellResult rack_cr[7] = {};
         std::vector<RackTile> rack_tiles_vec;
 
-        if (dr.cell_size > 0 && !expected_rack.empty()) {
+        if (rec.cell_size > 0 && !expected_rack.empty()) {
             has_rack = true;
-            bool is_light = detect_board_mode(imgdata,
-                dr.board_rect.x, dr.board_rect.y, dr.cell_size);
-            rack_tiles_vec = detect_rack_tiles(imgdata,
-                dr.board_rect.x, dr.board_rect.y, dr.cell_size, is_light);
-
-            rack_n_rt = static_cast<int>(rack_tiles_vec.size());
-            for (int i = 0; i < rack_n_rt && i < 7; i++)
-                rack_cr[i] = classify_rack_tile_full(rack_tiles_vec[i]);
-            refine_rack(rack_cr, std::min(rack_n_rt, 7), dr.cells);
-            alphagram_tiebreak(rack_cr, std::min(rack_n_rt, 7));
+            rack_n_rt = rec.n_rack;
+            std::memcpy(rack_cr, rec.rack, sizeof(rack_cr));
             for (int i = 0; i < rack_n_rt && i < 7; i++) {
                 char ch = rack_cr[i].letter;
                 got_rack += (ch >= 'A' && ch <= 'Z') ? ch : '?';
@@ -878,15 +891,22 @@ int main(int argc, char* argv[]) {
         // Collect failing case for HTML report
         bool board_fail = (wrong > 0 || occ_err > 0);
         bool rack_fail = (has_rack && !rack_ok);
+        bool want_rack_tiles = (!html_path.empty() && rack_fail)
+                               || (!rack_html_path.empty() && has_rack);
+        if (want_rack_tiles)
+            rack_tiles_vec = stored_rack_tiles(rec, imgdata);
+
         if (!html_path.empty() && (board_fail || rack_fail)) {
+            // The log isn't stored; rerun the pipeline for failing cases only.
+            auto dr = process_board_image_debug(imgdata);
             FailCase fc;
             fc.name = name;
             fc.orig_png = imgdata;
             fc.debug_png = dr.debug_png;
             std::memcpy(fc.gt, gt, sizeof(gt));
-            std::memcpy(fc.cells, dr.cells, sizeof(fc.cells));
+            std::memcpy(fc.cells, rec.cells, sizeof(fc.cells));
             fc.log = dr.log;
-            fc.got_cgp = dr.cgp;
+            fc.got_cgp = rec.cgp;
             fc.tiles = tiles;
             fc.correct = correct;
             fc.occ_err = occ_err;
@@ -919,7 +939,7 @@ int main(int argc, char* argv[]) {
                     i < (int)rack_tiles_vec.size() ? rack_tiles_vec[i].png
                                                    : std::vector<uint8_t>{});
             rc.rack_region_png = make_rack_region_image(
-                imgdata, dr.board_rect.x, dr.board_rect.y, dr.cell_size,
+                imgdata, rec.board_rect[0], rec.board_rect[1], rec.cell_size,
                 rack_tiles_vec);
             rack_eval_cases.push_back(std::move(rc));
         }
@@ -944,7 +964,16 @@ int main(int argc, char* argv[]) {
     }
     std::printf("\n");
     std::printf("Perfect cases: %d/%d\n", perfect_cases, n_files);
-    std::printf("Total time: %.0fms (%.1fms/case)\n", total_ms, total_ms / n_files);
+    std::printf("Total time: %.0fms (%.1fms/case, %d of %d cases from store)\n",
+                total_ms, total_ms / n_files, store.hits(), n_files);
+    for (int m = 1; m >= 0; m--)
+        if (mode_cases[m] > 0)
+            std::printf("  %s mode: %d cases run now, %.1fms/case\n", m ? "light" : "dark",
+                        mode_cases[m], mode_ms[m] / mode_cases[m]);
+    if (mode_cases[0] + mode_cases[1] == 0)
+        std::printf("  (per-mode timing: every case came from the store; use --no-store)\n");
+    if (!store.save())
+        std::fprintf(stderr, "Failed to write feature store %s\n", store_path.c_str());
 
     std::printf("\nPer-letter board accuracy:\n");
     for (int i = 0; i < 26; i++) {
@@ -0,0 +1,217 @@
+// Extract labeled board tile crops from testdata (image + CGP pairs) for the
+// tile CNN.  Runs board detection, cuts each occupied cell with the same 8%
+// inset as extract_cells(), and labels it from the CGP ground truth (blank
+// tiles are labeled with their designated letter, as the CNN reads them).
+//
+// Images are processed in parallel and crops are written preprocessed
+// (preprocess_tile_for_cnn) into packed shards, see shard.h.
+//
+// Output: training_data/index.json, shard_NNN.bin, shard_NNN.meta.tsv
+#include "board.h"
+#include "shard.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace fs = std::filesystem;
+
+// Parse CGP board section into a 15x15 letter grid.
+static void parse_cgp_letters(const std::string& cgp, char letters[15][15]) {
+    std::memset(letters, 0, 15 * 15);
+    auto sp = cgp.find(' ');
+    std::string board = (sp != std::string::npos) ? cgp.substr(0, sp) : cgp;
+    int row = 0, col = 0;
+    for (size_t i = 0; i < board.size() && row < 15; i++) {
+        char ch = board[i];
+        if (ch == '/') { row++; col = 0; }
+        else if (ch >= '0' && ch <= '9') {
+            int n = ch - '0';
+            while (i + 1 < board.size() && board[i+1] >= '0' && board[i+1] <= '9')
+                n = n * 10 + (board[++i] - '0');
+            col += n;
+        } else if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z')) {
+            if (row < 15 && col < 15) letters[row][col] = ch;
+            col++;
+        }
+    }
+}
+
+// Classify board theme from filename.
+static std::string classify_theme(const std::string& name) {
+    if (name.find("_memento") != std::string::npos) return "memento";
+    if (name.find("_mahogany_desktop") != std::string::npos) return "mahogany_desk";
+    if (name.find("_mahogany_mobile") != std::string::npos) return "mahogany_mob";
+    if (name.find("_light_desktop") != std::string::npos) return "light_desk";
+    if (name.find("_dark_desktop") != std::string::npos) return "dark_desk";
+    if (name.find("_light_mobile") != std::string::npos) return "light_mob";
+    if (name.find("_dark_mobile") != std::string::npos) return "dark_mob";
+    return "original";
+}
+
+struct WorkItem { std::string path, name, cgp_path; };
+
+// Per-thread tallies, merged after join.
+struct Stats { int files = 0, tiles = 0, skipped = 0; };
+
+// Run the pipeline on one image and append its tile crops to `out`.
+static void extract_one(const WorkItem& wi, const ShardWriter& writer,
+                        std::vector<ShardRecord>& out, Stats& st) {
+    std::string theme = classify_theme(wi.name);
+
+    // Read CGP ground truth
+    std::ifstream cgp_ifs(wi.cgp_path);
+    std::string cgp_line;
+    std::getline(cgp_ifs, cgp_line);
+    char gt_letters[15][15];
+    parse_cgp_letters(cgp_line, gt_letters);
+
+    // Read image and run board detection
+    std::ifstream ifs(wi.path, std::ios::binary);
+    std::vector<uint8_t> imgdata(std::istreambuf_iterator<char>(ifs), {});
+    auto dr = process_board_image_debug(imgdata);
+    if (dr.cell_size <= 0 || dr.board_rect.width <= 0) {
+        std::fprintf(stderr, "  SKIP %s (no board rect)\n", wi.name.c_str());
+        st.skipped++;
+        return;
+    }
+
+    // A misplaced grid would mislabel every crop, so require the detected
+    // occupancy to agree with the CGP.
+    int mismatches = 0;
+    for (int r = 0; r < 15; r++)
+        for (int c = 0; c < 15; c++) {
+            bool detected = (dr.cells[r][c].letter != 0);
+            bool actual = (gt_letters[r][c] != 0);
+            if (detected != actual) mismatches++;
+        }
+    if (mismatches > 2) {
+        std::fprintf(stderr, "  SKIP %s (occ mismatches=%d)\n",
+                     wi.name.c_str(), mismatches);
+        st.skipped++;
+        return;
+    }
+
+    cv::Mat img = cv::imdecode(imgdata, cv::IMREAD_COLOR);
+    if (img.empty()) {
+        st.skipped++;
+        return;
+    }
+
+    const cv::Rect& rect = dr.board_rect;
+    double cw = static_cast<double>(rect.width) / 15.0;
+    double ch = static_cast<double>(rect.height) / 15.0;
+    double inset_frac = 0.08;
+
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            char gt = gt_letters[r][c];
+            if (gt == 0) continue;
+
+            int x0 = rect.x + static_cast<int>(c * cw + cw * inset_frac);
+            int y0 = rect.y + static_cast<int>(r * ch + ch * inset_frac);
+            int x1 = rect.x + static_cast<int>((c + 1) * cw - cw * inset_frac);
+            int y1 = rect.y + static_cast<int>((r + 1) * ch - ch * inset_frac);
+
+            x0 = std::max(0, std::min(x0, img.cols - 1));
+            y0 = std::max(0, std::min(y0, img.rows - 1));
+            x1 = std::max(x0 + 1, std::min(x1, img.cols));
+            y1 = std::max(y0 + 1, std::min(y1, img.rows));
+
+            cv::Mat cell = img(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+            char upper = static_cast<char>(
+                std::toupper(static_cast<unsigned char>(gt)));
+            ShardRecord rec;
+            if (!writer.make_record(preprocess_tile_for_cnn(cell), upper - 'A', rec))
+                continue;
+            rec.theme = theme;
+            rec.source = wi.name;
+            rec.pos = "r" + std::to_string(r) + "c" + std::to_string(c);
+            out.push_back(std::move(rec));
+            st.tiles++;
+        }
+    }
+
+    st.files++;
+}
+
+int main(int argc, char* argv[]) {
+    std::setbuf(stdout, nullptr);
+    int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) n_threads = std::max(1, std::atoi(argv[++i]));
+        else positional.push_back(arg);
+    }
+    if (positional.empty()) {
+        std::cerr << "Usage: extract_crops [-j N] <testdata_dir> [output_dir]\n";
+        return 1;
+    }
+    std::string dir = positional[0];
+    std::string out_dir = (positional.size() >= 2) ? positional[1] : "training_data";
+    fs::create_directories(out_dir);
+
+    std::vector<std::string> classes;
+    for (int i = 0; i < 26; i++)
+        classes.push_back(std::string(1, 'A' + i));
+
+    std::vector<WorkItem> work;
+    for (auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        if (ext != ".png" && ext != ".jpg") continue;
+        std::string name = entry.path().stem().string();
+        std::string cgp_path = dir + "/" + name + ".cgp";
+        if (!fs::exists(cgp_path)) continue;
+        work.push_back({entry.path().string(), name, cgp_path});
+    }
+    std::sort(work.begin(), work.end(),
+              [](const WorkItem& a, const WorkItem& b) { return a.name < b.name; });
+
+    ShardWriter writer(out_dir, classes, 48);
+    n_threads = std::min(n_threads, std::max(1, static_cast<int>(work.size())));
+    set_model_pool_size(n_threads);  // one copy of each CNN per worker
+    std::vector<Stats> stats(n_threads);
+    std::vector<std::thread> threads(n_threads);
+    std::atomic<int> n_done{0};
+
+    for (int t = 0; t < n_threads; t++) {
+        threads[t] = std::thread([&, t]() {
+            std::vector<ShardRecord> recs;
+            for (int wi = t; wi < static_cast<int>(work.size()); wi += n_threads) {
+                extract_one(work[wi], writer, recs, stats[t]);
+                writer.add_batch(recs);
+                int done = ++n_done;
+                std::fprintf(stderr, "\r%d/%d files...", done,
+                             static_cast<int>(work.size()));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    Stats total;
+    for (const auto& s : stats) {
+        total.files += s.files;
+        total.tiles += s.tiles;
+        total.skipped += s.skipped;
+    }
+    if (!writer.finish()) {
+        std::fprintf(stderr, "\nFailed to write shards to %s\n", out_dir.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "\nDone: %d files, %d tiles, %d skipped (%d threads)\n",
+                 total.files, total.tiles, total.skipped, n_threads);
+
+    // Print per-letter counts
+    const auto& counts = writer.class_counts();
+    std::printf("\nPer-letter tile crop counts:\n");
+    for (int i = 0; i < 26; i++)
+        std::printf("  %c: %d\n", 'A' + i, counts[i]);
+}
@@ -5,12 +5,20 @@
 // Column labels: A-O above the board (classes 0-14)
 // Row labels: 1-15 left of the board (classes 15-29)
 //
-// Output: label_training_data/col_A/ ... col_O/, row_01/ ... row_15/
+// Images are processed in parallel (one pipeline run per worker thread) and
+// crops are written preprocessed into packed shards (see shard.h):
+//
+// Output: label_training_data/index.json, shard_NNN.bin, shard_NNN.meta.tsv
 #include "board.h"
+#include "shard.h"
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -49,163 +57,191 @@ static std::string classify_theme(const std::string& name) {
     return "original";
 }
 
+struct WorkItem { std::string path, name, cgp_path; };
+
+// Per-thread tallies, merged after join.
+struct Stats { int files = 0, col_crops = 0, row_crops = 0, skipped = 0; };
+
+// Run the pipeline on one image and append its label crops to `out`.
+static void extract_one(const WorkItem& wi, const ShardWriter& writer,
+                        std::vector<ShardRecord>& out, Stats& st) {
+    std::string theme = classify_theme(wi.name);
+
+    // Skip memento theme (no labels)
+    if (theme == "memento") {
+        st.skipped++;
+        return;
+    }
+
+    // Read CGP ground truth
+    std::ifstream cgp_ifs(wi.cgp_path);
+    std::string cgp_line;
+    std::getline(cgp_ifs, cgp_line);
+    char gt_letters[15][15];
+    parse_cgp_letters(cgp_line, gt_letters);
+
+    // Read image and run board detection
+    std::ifstream ifs(wi.path, std::ios::binary);
+    std::vector<uint8_t> imgdata(std::istreambuf_iterator<char>(ifs), {});
+    auto dr = process_board_image_debug(imgdata);
+
+    // Parse board rect from debug log
+    int bx = 0, by = 0, bw = 0, bh = 0;
+    auto pos = dr.log.find("Final: rect=");
+    if (pos != std::string::npos)
+        std::sscanf(dr.log.c_str() + pos,
+                    "Final: rect=%d,%d %dx%d", &bx, &by, &bw, &bh);
+    if (bw == 0) {
+        std::fprintf(stderr, "  SKIP %s (no board rect)\n", wi.name.c_str());
+        st.skipped++;
+        return;
+    }
+
+    // Check occupancy agreement between detection and CGP
+    int mismatches = 0;
+    for (int r = 0; r < 15; r++)
+        for (int c = 0; c < 15; c++) {
+            bool detected = (dr.cells[r][c].letter != 0);
+            bool actual = (gt_letters[r][c] != 0);
+            if (detected != actual) mismatches++;
+        }
+    if (mismatches > 2) {
+        std::fprintf(stderr, "  SKIP %s (occ mismatches=%d)\n",
+                     wi.name.c_str(), mismatches);
+        st.skipped++;
+        return;
+    }
+
+    // Decode image and extract label crops
+    cv::Mat img = cv::imdecode(imgdata, cv::IMREAD_COLOR);
+    double cw = static_cast<double>(bw) / 15.0;
+    double ch = static_cast<double>(bh) / 15.0;
+    double crop_size = 0.8 * std::min(cw, ch);
+    int crop_px = std::max(8, static_cast<int>(crop_size));
+
+    auto add_crop = [&](double cx, double cy, int label, const std::string& where) {
+        int x0 = static_cast<int>(cx - crop_px / 2.0);
+        int y0 = static_cast<int>(cy - crop_px / 2.0);
+        int x1 = x0 + crop_px;
+        int y1 = y0 + crop_px;
+
+        // Clamp to image bounds
+        x0 = std::max(0, x0);
+        y0 = std::max(0, y0);
+        x1 = std::min(img.cols, x1);
+        y1 = std::min(img.rows, y1);
+
+        if (x1 - x0 < 4 || y1 - y0 < 4) return false;
+
+        ShardRecord rec;
+        cv::Mat crop = img(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+        if (!writer.make_record(preprocess_tile_for_cnn(crop), label, rec))
+            return false;
+        rec.theme = theme;
+        rec.source = wi.name;
+        rec.pos = where;
+        out.push_back(std::move(rec));
+        return true;
+    };
+
+    // Column labels: A-O, centered above each column
+    for (int c = 0; c < 15; c++) {
+        if (add_crop(bx + (c + 0.5) * cw, by - 0.4 * ch, c,
+                     "c" + std::to_string(c)))
+            st.col_crops++;
+    }
+
+    // Row labels: 1-15, centered left of each row
+    for (int r = 0; r < 15; r++) {
+        if (add_crop(bx - 0.5 * cw, by + (r + 0.5) * ch, 15 + r,
+                     "r" + std::to_string(r)))
+            st.row_crops++;
+    }
+
+    st.files++;
+}
+
 int main(int argc, char* argv[]) {
     std::setbuf(stdout, nullptr);
-    if (argc < 2) {
-        std::cerr << "Usage: extract_label_crops <testdata_dir> [output_dir]\n";
+    int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) n_threads = std::max(1, std::atoi(argv[++i]));
+        else positional.push_back(arg);
+    }
+    if (positional.empty()) {
+        std::cerr << "Usage: extract_label_crops [-j N] <testdata_dir> [output_dir]\n";
         return 1;
     }
-    std::string dir = argv[1];
-    std::string out_dir = (argc >= 3) ? argv[2] : "label_training_data";
-
-    // Create output directories: col_A..col_O, row_01..row_15
+    std::string dir = positional[0];
+    std::string out_dir = (positional.size() >= 2) ? positional[1] : "label_training_data";
+    fs::create_directories(out_dir);
+
+    // Class names double as the old per-class folder names:
+    // col_A..col_O, row_01..row_15
+    std::vector<std::string> classes;
+    for (int i = 0; i < 15; i++)
+        classes.push_back("col_" + std::string(1, 'A' + i));
     for (int i = 0; i < 15; i++) {
-        std::string col_dir = out_dir + "/col_" + std::string(1, 'A' + i);
-        fs::create_directories(col_dir);
         char buf[16];
-        std::snprintf(buf, sizeof(buf), "/row_%02d", i + 1);
-        fs::create_directories(out_dir + buf);
+        std::snprintf(buf, sizeof(buf), "row_%02d", i + 1);
+        classes.push_back(buf);
     }
 
-    int n_files = 0, n_col_crops = 0, n_row_crops = 0, n_skipped = 0;
-
+    std::vector<WorkItem> work;
     for (auto& entry : fs::directory_iterator(dir)) {
-        std::string path = entry.path().string();
-        std::string name = entry.path().stem().string();
         std::string ext = entry.path().extension().string();
         if (ext != ".png" && ext != ".jpg") continue;
-
+        std::string name = entry.path().stem().string();
         std::string cgp_path = dir + "/" + name + ".cgp";
         if (!fs::exists(cgp_path)) continue;
-
-        std::string theme = classify_theme(name);
-
-        // Skip memento theme (no labels)
-        if (theme == "memento") {
-            n_skipped++;
-            continue;
-        }
-
-        // Read CGP ground truth
-        std::ifstream cgp_ifs(cgp_path);
-        std::string cgp_line;
-        std::getline(cgp_ifs, cgp_line);
-        char gt_letters[15][15];
-        parse_cgp_letters(cgp_line, gt_letters);
-
-        // Read image and run board detection
-        std::ifstream ifs(path, std::ios::binary);
-        std::vector<uint8_t> imgdata(std::istreambuf_iterator<char>(ifs), {});
-        auto dr = process_board_image_debug(imgdata);
-
-        // Parse board rect from debug log
-        int bx = 0, by = 0, bw = 0, bh = 0;
-        auto pos = dr.log.find("Final: rect=");
-        if (pos != std::string::npos)
-            std::sscanf(dr.log.c_str() + pos,
-                        "Final: rect=%d,%d %dx%d", &bx, &by, &bw, &bh);
-        if (bw == 0) {
-            std::fprintf(stderr, "  SKIP %s (no board rect)\n", name.c_str());
-            n_skipped++;
-            continue;
-        }
-
-        // Check occupancy agreement between detection and CGP
-        int mismatches = 0;
-        for (int r = 0; r < 15; r++)
-            for (int c = 0; c < 15; c++) {
-                bool detected = (dr.cells[r][c].letter != 0);
-                bool actual = (gt_letters[r][c] != 0);
-                if (detected != actual) mismatches++;
+        work.push_back({entry.path().string(), name, cgp_path});
+    }
+    std::sort(work.begin(), work.end(),
+              [](const WorkItem& a, const WorkItem& b) { return a.name < b.name; });
+
+    ShardWriter writer(out_dir, classes, 48);
+    n_threads = std::min(n_threads, std::max(1, static_cast<int>(work.size())));
+    set_model_pool_size(n_threads);  // one copy of each CNN per worker
+    std::vector<Stats> stats(n_threads);
+    std::vector<std::thread> threads(n_threads);
+    std::atomic<int> n_done{0};
+
+    for (int t = 0; t < n_threads; t++) {
+        threads[t] = std::thread([&, t]() {
+            std::vector<ShardRecord> recs;
+            for (int wi = t; wi < static_cast<int>(work.size()); wi += n_threads) {
+                extract_one(work[wi], writer, recs, stats[t]);
+                writer.add_batch(recs);
+                int done = ++n_done;
+                std::fprintf(stderr, "\r%d/%d files...", done,
+                             static_cast<int>(work.size()));
             }
-        if (mismatches > 2) {
-            std::fprintf(stderr, "  SKIP %s (occ mismatches=%d)\n",
-                         name.c_str(), mismatches);
-            n_skipped++;
-            continue;
-        }
-
-        // Decode image and extract label crops
-        cv::Mat img = cv::imdecode(imgdata, cv::IMREAD_COLOR);
-        double cw = static_cast<double>(bw) / 15.0;
-        double ch = static_cast<double>(bh) / 15.0;
-        double crop_size = 0.8 * std::min(cw, ch);
-        int crop_px = std::max(8, static_cast<int>(crop_size));
-
-        // Column labels: A-O, centered above each column
-        for (int c = 0; c < 15; c++) {
-            double cx = bx + (c + 0.5) * cw;
-            double cy = by - 0.4 * ch;
-
-            int x0 = static_cast<int>(cx - crop_px / 2.0);
-            int y0 = static_cast<int>(cy - crop_px / 2.0);
-            int x1 = x0 + crop_px;
-            int y1 = y0 + crop_px;
-
-            // Clamp to image bounds
-            x0 = std::max(0, x0);
-            y0 = std::max(0, y0);
-            x1 = std::min(img.cols, x1);
-            y1 = std::min(img.rows, y1);
-
-            if (x1 - x0 < 4 || y1 - y0 < 4) continue;
-
-            cv::Mat crop = img(cv::Rect(x0, y0, x1 - x0, y1 - y0));
-            std::string col_name = "col_" + std::string(1, 'A' + c);
-            std::string fname = theme + "_" + name + "_c" + std::to_string(c) + ".png";
-            cv::imwrite(out_dir + "/" + col_name + "/" + fname, crop);
-            n_col_crops++;
-        }
-
-        // Row labels: 1-15, centered left of each row
-        for (int r = 0; r < 15; r++) {
-            double cx = bx - 0.5 * cw;
-            double cy = by + (r + 0.5) * ch;
-
-            int x0 = static_cast<int>(cx - crop_px / 2.0);
-            int y0 = static_cast<int>(cy - crop_px / 2.0);
-            int x1 = x0 + crop_px;
-            int y1 = y0 + crop_px;
-
-            x0 = std::max(0, x0);
-            y0 = std::max(0, y0);
-            x1 = std::min(img.cols, x1);
-            y1 = std::min(img.rows, y1);
-
-            if (x1 - x0 < 4 || y1 - y0 < 4) continue;
-
-            cv::Mat crop = img(cv::Rect(x0, y0, x1 - x0, y1 - y0));
-            char buf[16];
-            std::snprintf(buf, sizeof(buf), "row_%02d", r + 1);
-            std::string fname = theme + "_" + name + "_r" + std::to_string(r) + ".png";
-            cv::imwrite(out_dir + "/" + buf + "/" + fname, crop);
-            n_row_crops++;
-        }
-
-        n_files++;
-        std::fprintf(stderr, "\r%d files, %d col crops, %d row crops, %d skipped...",
-                     n_files, n_col_crops, n_row_crops, n_skipped);
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    Stats total;
+    for (const auto& s : stats) {
+        total.files += s.files;
+        total.col_crops += s.col_crops;
+        total.row_crops += s.row_crops;
+        total.skipped += s.skipped;
+    }
+    if (!writer.finish()) {
+        std::fprintf(stderr, "\nFailed to write shards to %s\n", out_dir.c_str());
+        return 1;
     }
-    std::fprintf(stderr, "\nDone: %d files, %d col crops, %d row crops, %d skipped\n",
-                 n_files, n_col_crops, n_row_crops, n_skipped);
+    std::fprintf(stderr, "\nDone: %d files, %d col crops, %d row crops, %d skipped (%d threads)\n",
+                 total.files, total.col_crops, total.row_crops, total.skipped, n_threads);
 
     // Print per-class counts
+    const auto& counts = writer.class_counts();
     std::printf("\nColumn label crop counts:\n");
-    for (int i = 0; i < 15; i++) {
-        int count = 0;
-        std::string d = out_dir + "/col_" + std::string(1, 'A' + i);
-        if (fs::exists(d))
-            for (auto& e : fs::directory_iterator(d)) { (void)e; count++; }
-        std::printf("  %c: %d\n", 'A' + i, count);
-    }
+    for (int i = 0; i < 15; i++)
+        std::printf("  %c: %d\n", 'A' + i, counts[i]);
     std::printf("\nRow label crop counts:\n");
-    for (int i = 0; i < 15; i++) {
-        int count = 0;
-        char buf[16];
-        std::snprintf(buf, sizeof(buf), "row_%02d", i + 1);
-        std::string d = out_dir + "/" + buf;
-        if (fs::exists(d))
-            for (auto& e : fs::directory_iterator(d)) { (void)e; count++; }
-        std::printf("  %2d: %d\n", i + 1, count);
-    }
+    for (int i = 0; i < 15; i++)
+        std::printf("  %2d: %d\n", i + 1, counts[15 + i]);
 }
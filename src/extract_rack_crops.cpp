@@ -2,14 +2,22 @@
 // Uses detect_rack_tiles to find tile positions, prepare_rack_crop to normalize,
 // and CGP rack field for ground truth labels.
 //
-// Output: rack_training_data/<LETTER>/<theme>_<stem>_t<I>.png
-//         rack_training_data/?/<theme>_<stem>_t<I>.png  (blank tiles)
+// Images are processed in parallel and crops are written preprocessed
+// (prepare_rack_crop + preprocess_tile_for_cnn) into packed shards, see shard.h.
+// Classes 0-25 are A-Z, class 26 is blank.
+//
+// Output: rack_training_data/index.json, shard_NNN.bin, shard_NNN.meta.tsv
 #include "board.h"
 #include "rack.h"
+#include "shard.h"
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -101,131 +109,177 @@ static cv::Mat prepare_rack_crop_for_training(const cv::Mat& crop) {
     return sq.clone();
 }
 
-int main(int argc, char* argv[]) {
-    std::setbuf(stdout, nullptr);
-    if (argc < 2) {
-        std::cerr << "Usage: extract_rack_crops <testdata_dir> [output_dir]\n";
-        return 1;
-    }
-    std::string dir = argv[1];
-    std::string out_dir = (argc >= 3) ? argv[2] : "rack_training_data";
+struct WorkItem { std::string path, name, cgp_path; };
+
+// Per-thread tallies, merged after join.
+struct Stats { int files = 0, tiles = 0, blanks = 0, skipped = 0, unmatched = 0; };
 
-    // Create output directories for each letter + blank
-    for (int i = 0; i < 26; i++) {
-        fs::create_directories(out_dir + "/" + std::string(1, 'A' + i));
+static const int BLANK_CLASS = 26;
+
+// Run board + rack detection on one image and append its rack crops to `out`.
+static void extract_one(const WorkItem& wi, const ShardWriter& writer,
+                        std::vector<ShardRecord>& out, Stats& st) {
+    // Read CGP ground truth
+    std::ifstream cgp_ifs(wi.cgp_path);
+    std::string cgp_line;
+    std::getline(cgp_ifs, cgp_line);
+
+    // Parse expected rack
+    std::string expected_rack = parse_cgp_rack(cgp_line);
+    if (expected_rack.empty()) return;
+    std::string sorted_rack = sort_rack(expected_rack);
+
+    std::string theme = classify_theme(wi.name);
+
+    // Read image
+    std::ifstream ifs(wi.path, std::ios::binary);
+    std::vector<uint8_t> imgdata(std::istreambuf_iterator<char>(ifs), {});
+
+    // Run board detection to get board rect + cell size
+    auto dr = process_board_image_debug(imgdata);
+    if (dr.cell_size <= 0) {
+        st.skipped++;
+        return;
     }
-    fs::create_directories(out_dir + "/_blank");
 
-    int n_files = 0, n_tiles = 0, n_blanks = 0, n_skipped = 0;
-    int n_matched = 0, n_unmatched = 0;
+    // Detect rack tiles
+    bool is_light = detect_board_mode(imgdata,
+        dr.board_rect.x, dr.board_rect.y, dr.cell_size);
+    auto rack_tiles = detect_rack_tiles(imgdata,
+        dr.board_rect.x, dr.board_rect.y, dr.cell_size, is_light);
 
-    for (auto& entry : fs::directory_iterator(dir)) {
-        std::string path = entry.path().string();
-        std::string name = entry.path().stem().string();
-        std::string ext = entry.path().extension().string();
-        if (ext != ".png" && ext != ".jpg") continue;
+    int n_rt = static_cast<int>(rack_tiles.size());
+    if (n_rt == 0 || n_rt > 7) {
+        st.skipped++;
+        return;
+    }
 
-        std::string cgp_path = dir + "/" + name + ".cgp";
-        if (!fs::exists(cgp_path)) continue;
+    // Classify rack tiles to check if they match expected
+    CellResult rack_cr[7] = {};
+    for (int i = 0; i < n_rt && i < 7; i++)
+        rack_cr[i] = classify_rack_tile_full(rack_tiles[i]);
+    refine_rack(rack_cr, std::min(n_rt, 7), dr.cells);
+    alphagram_tiebreak(rack_cr, std::min(n_rt, 7));
 
-        // Read CGP ground truth
-        std::ifstream cgp_ifs(cgp_path);
-        std::string cgp_line;
-        std::getline(cgp_ifs, cgp_line);
+    std::string got_rack;
+    for (int i = 0; i < n_rt && i < 7; i++) {
+        char ch = rack_cr[i].letter;
+        got_rack += (ch >= 'A' && ch <= 'Z') ? ch : '?';
+    }
+    std::string got_sorted = sort_rack(got_rack);
+
+    // Only extract crops when the classifier already gets the rack right.
+    // This ensures labels are correct (bootstrapping from known-good matches).
+    if (sorted_rack != got_sorted) {
+        st.unmatched++;
+        return;
+    }
 
-        // Parse expected rack
-        std::string expected_rack = parse_cgp_rack(cgp_line);
-        if (expected_rack.empty()) continue;
-        std::string sorted_rack = sort_rack(expected_rack);
+    // Label each tile by what the classifier identified it as.
+    // Since sorted_rack == got_sorted, every classification is correct.
+    for (int i = 0; i < n_rt && i < 7; i++) {
+        char label = rack_cr[i].letter;
 
-        std::string theme = classify_theme(name);
+        // Decode the tile crop
+        cv::Mat raw(1, static_cast<int>(rack_tiles[i].png.size()), CV_8UC1,
+                    const_cast<uint8_t*>(rack_tiles[i].png.data()));
+        cv::Mat crop = cv::imdecode(raw, cv::IMREAD_COLOR);
+        if (crop.empty()) continue;
 
-        // Read image
-        std::ifstream ifs(path, std::ios::binary);
-        std::vector<uint8_t> imgdata(std::istreambuf_iterator<char>(ifs), {});
+        // Apply prepare_rack_crop (same as inference pipeline)
+        cv::Mat prepared = prepare_rack_crop_for_training(crop);
 
-        // Run board detection to get board rect + cell size
-        auto dr = process_board_image_debug(imgdata);
-        if (dr.cell_size <= 0) {
-            n_skipped++;
+        bool blank = (label < 'A' || label > 'Z');
+        ShardRecord rec;
+        if (!writer.make_record(preprocess_tile_for_cnn(prepared),
+                                blank ? BLANK_CLASS : label - 'A', rec))
             continue;
-        }
+        rec.theme = theme;
+        rec.source = wi.name;
+        rec.pos = "t" + std::to_string(i);
+        out.push_back(std::move(rec));
+        if (blank) st.blanks++;
+        else st.tiles++;
+    }
 
-        // Detect rack tiles
-        bool is_light = detect_board_mode(imgdata,
-            dr.board_rect.x, dr.board_rect.y, dr.cell_size);
-        auto rack_tiles = detect_rack_tiles(imgdata,
-            dr.board_rect.x, dr.board_rect.y, dr.cell_size, is_light);
+    st.files++;
+}
 
-        int n_rt = static_cast<int>(rack_tiles.size());
-        if (n_rt == 0 || n_rt > 7) {
-            n_skipped++;
-            continue;
-        }
+int main(int argc, char* argv[]) {
+    std::setbuf(stdout, nullptr);
+    int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) n_threads = std::max(1, std::atoi(argv[++i]));
+        else positional.push_back(arg);
+    }
+    if (positional.empty()) {
+        std::cerr << "Usage: extract_rack_crops [-j N] <testdata_dir> [output_dir]\n";
+        return 1;
+    }
+    std::string dir = positional[0];
+    std::string out_dir = (positional.size() >= 2) ? positional[1] : "rack_training_data";
+    fs::create_directories(out_dir);
 
-        // Classify rack tiles to check if they match expected
-        CellResult rack_cr[7] = {};
-        for (int i = 0; i < n_rt && i < 7; i++)
-            rack_cr[i] = classify_rack_tile_full(rack_tiles[i]);
-        refine_rack(rack_cr, std::min(n_rt, 7), dr.cells);
-        alphagram_tiebreak(rack_cr, std::min(n_rt, 7));
-
-        std::string got_rack;
-        for (int i = 0; i < n_rt && i < 7; i++) {
-            char ch = rack_cr[i].letter;
-            got_rack += (ch >= 'A' && ch <= 'Z') ? ch : '?';
-        }
-        std::string got_sorted = sort_rack(got_rack);
+    std::vector<std::string> classes;
+    for (int i = 0; i < 26; i++)
+        classes.push_back(std::string(1, 'A' + i));
+    classes.push_back("_blank");
 
-        // Only extract crops when the classifier already gets the rack right.
-        // This ensures labels are correct (bootstrapping from known-good matches).
-        if (sorted_rack != got_sorted) {
-            n_unmatched++;
-            continue;
-        }
+    std::vector<WorkItem> work;
+    for (auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        if (ext != ".png" && ext != ".jpg") continue;
+        std::string name = entry.path().stem().string();
+        std::string cgp_path = dir + "/" + name + ".cgp";
+        if (!fs::exists(cgp_path)) continue;
+        work.push_back({entry.path().string(), name, cgp_path});
+    }
+    std::sort(work.begin(), work.end(),
+              [](const WorkItem& a, const WorkItem& b) { return a.name < b.name; });
+
+    ShardWriter writer(out_dir, classes, 48);
+    n_threads = std::min(n_threads, std::max(1, static_cast<int>(work.size())));
+    set_model_pool_size(n_threads);  // one copy of each CNN per worker
+    std::vector<Stats> stats(n_threads);
+    std::vector<std::thread> threads(n_threads);
+    std::atomic<int> n_done{0};
 
-        // Label each tile by what the classifier identified it as.
-        // Since sorted_rack == got_sorted, every classification is correct.
-        for (int i = 0; i < n_rt && i < 7; i++) {
-            char label = rack_cr[i].letter;
-
-            // Decode the tile crop
-            cv::Mat raw(1, static_cast<int>(rack_tiles[i].png.size()), CV_8UC1,
-                        const_cast<uint8_t*>(rack_tiles[i].png.data()));
-            cv::Mat crop = cv::imdecode(raw, cv::IMREAD_COLOR);
-            if (crop.empty()) continue;
-
-            // Apply prepare_rack_crop (same as inference pipeline)
-            cv::Mat prepared = prepare_rack_crop_for_training(crop);
-
-            std::string fname = theme + "_" + name + "_t" + std::to_string(i) + ".png";
-
-            if (label == '?') {
-                cv::imwrite(out_dir + "/_blank/" + fname, prepared);
-                n_blanks++;
-            } else {
-                char upper = static_cast<char>(
-                    std::toupper(static_cast<unsigned char>(label)));
-                cv::imwrite(out_dir + "/" + std::string(1, upper) + "/" + fname, prepared);
-                n_tiles++;
+    for (int t = 0; t < n_threads; t++) {
+        threads[t] = std::thread([&, t]() {
+            std::vector<ShardRecord> recs;
+            for (int wi = t; wi < static_cast<int>(work.size()); wi += n_threads) {
+                extract_one(work[wi], writer, recs, stats[t]);
+                writer.add_batch(recs);
+                int done = ++n_done;
+                std::fprintf(stderr, "\r%d/%d files...", done,
+                             static_cast<int>(work.size()));
             }
-        }
+        });
+    }
+    for (auto& th : threads) th.join();
 
-        n_matched++;
-        n_files++;
-        std::fprintf(stderr, "\r%d files, %d tiles, %d blanks, %d skipped...",
-                     n_files, n_tiles, n_blanks, n_skipped);
+    Stats total;
+    for (const auto& s : stats) {
+        total.files += s.files;
+        total.tiles += s.tiles;
+        total.blanks += s.blanks;
+        total.skipped += s.skipped;
+        total.unmatched += s.unmatched;
     }
-    std::fprintf(stderr, "\nDone: %d files, %d tiles, %d blanks, %d skipped, %d unmatched\n",
-                 n_files, n_tiles, n_blanks, n_skipped, n_unmatched);
+    if (!writer.finish()) {
+        std::fprintf(stderr, "\nFailed to write shards to %s\n", out_dir.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "\nDone: %d files, %d tiles, %d blanks, %d skipped, %d unmatched (%d threads)\n",
+                 total.files, total.tiles, total.blanks, total.skipped,
+                 total.unmatched, n_threads);
 
     // Print per-letter counts
+    const auto& counts = writer.class_counts();
     std::printf("\nPer-letter rack crop counts:\n");
-    for (int i = 0; i < 26; i++) {
-        int count = 0;
-        std::string ldir = out_dir + "/" + std::string(1, 'A' + i);
-        if (fs::exists(ldir))
-            for (auto& e : fs::directory_iterator(ldir)) { (void)e; count++; }
-        std::printf("  %c: %d\n", 'A' + i, count);
-    }
+    for (int i = 0; i < 26; i++)
+        std::printf("  %c: %d\n", 'A' + i, counts[i]);
+    std::printf("  ?: %d\n", counts[BLANK_CLASS]);
 }
@@ -0,0 +1,238 @@
+#include "feature_store.h"
+#include "stage_graph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <opencv2/imgcodecs.hpp>
+
+uint64_t feature_image_hash(const std::vector<uint8_t>& image_data) {
+    uint64_t h = 1469598103934665603ULL;
+    for (uint8_t b : image_data) {
+        h ^= b;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void compute_feature_record(const std::vector<uint8_t>& image_data,
+                            FeatureRecord& out) {
+    out = FeatureRecord();
+    out.image_hash = feature_image_hash(image_data);
+    out.pipeline_version = PIPELINE_VERSION;
+
+    // Stage graph: the rack read starts from the detection hook and the
+    // feature pass from the finished board, so both overlap the board
+    // pipeline or each other.  pipeline_ms stays the board pipeline alone.
+    DebugResult dr;
+    BoardFeatures bf;
+    RackRead rack;
+    cv::Mat rack_img;
+    cv::Rect rack_rect;
+    int rack_cs = 0;
+    StageGraph stages;
+    StageGraph::Node detected = 0;
+    StageGraph::Node board = stages.add("board", [&] {
+        auto on_detect = [&](const cv::Mat& bgr, const cv::Rect& rect,
+                             int cell_size, bool) {
+            rack_img = bgr;
+            rack_rect = rect;
+            rack_cs = cell_size;
+            stages.open(detected);
+            return false;
+        };
+        auto t0 = std::chrono::steady_clock::now();
+        dr = process_board_image_debug(image_data, nullptr, on_detect);
+        out.pipeline_ms = static_cast<float>(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0).count());
+    });
+    detected = stages.add_signal("detected", board);
+    stages.add("features", [&] {
+        out.valid = extract_board_features(image_data, bf, &dr);
+    }, {board});
+    stages.add("rack_read", [&] {
+        if (rack_cs > 0) rack = read_rack(rack_img, rack_rect, rack_cs);
+    }, {detected});
+    stages.run();
+    rack.translate(dr.origin);
+    if (!out.valid) return;
+
+    out.is_light = dr.is_light;
+    out.cnn = bf.cnn;
+    out.board_rect[0] = dr.board_rect.x;
+    out.board_rect[1] = dr.board_rect.y;
+    out.board_rect[2] = dr.board_rect.width;
+    out.board_rect[3] = dr.board_rect.height;
+    out.cell_size = dr.cell_size;
+    std::snprintf(out.cgp, sizeof(out.cgp), "%s", dr.cgp.c_str());
+    std::memcpy(out.cells, dr.cells, sizeof(out.cells));
+    std::memcpy(out.features, bf.cells, sizeof(out.features));
+
+    if (dr.cell_size <= 0) return;
+    // Detection moved the rect after the hook (OCR-failure retry).
+    if (!rack.matches(dr.board_rect, dr.cell_size))
+        rack = read_rack(image_data, dr.board_rect, dr.cell_size);
+    out.rack_light = rack.is_light;
+    out.n_rack = rack.n;
+    for (int i = 0; i < out.n_rack; i++) {
+        const cv::Rect& r = rack.tiles[i].rect;
+        out.rack_rect[i][0] = r.x;
+        out.rack_rect[i][1] = r.y;
+        out.rack_rect[i][2] = r.width;
+        out.rack_rect[i][3] = r.height;
+        out.rack_blank[i] = rack.tiles[i].is_blank;
+        out.rack[i] = rack.results[i];
+    }
+    refine_rack(out.rack, out.n_rack, dr.cells);
+    alphagram_tiebreak(out.rack, out.n_rack);
+}
+
+std::vector<RackTile> stored_rack_tiles(const FeatureRecord& rec,
+                                        const std::vector<uint8_t>& image_data) {
+    std::vector<RackTile> tiles;
+    if (rec.n_rack <= 0) return tiles;
+    cv::Mat img = cv::imdecode(image_data, cv::IMREAD_COLOR);
+    for (int i = 0; i < rec.n_rack; i++) {
+        cv::Rect r(rec.rack_rect[i][0], rec.rack_rect[i][1],
+                   rec.rack_rect[i][2], rec.rack_rect[i][3]);
+        RackTile rt{r, {}, rec.rack_blank[i] != 0};
+        cv::Rect clipped = r & cv::Rect(0, 0, img.cols, img.rows);
+        if (!img.empty() && clipped.area() > 0)
+            cv::imencode(".png", img(clipped), rt.png);
+        tiles.push_back(std::move(rt));
+    }
+    return tiles;
+}
+
+// ---------------------------------------------------------------------------
+
+FeatureStore::FeatureStore(std::string path) : path_(std::move(path)) {
+    map_file();
+}
+
+FeatureStore::~FeatureStore() {
+    unmap_file();
+}
+
+void FeatureStore::map_file() {
+    if (path_.empty()) return;
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < FEATURE_STORE_HEADER_SIZE) {
+        ::close(fd);
+        return;
+    }
+    void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                     MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return;
+
+    FeatureStoreHeader hdr;
+    std::memcpy(&hdr, p, sizeof(hdr));
+    size_t need = FEATURE_STORE_HEADER_SIZE
+                  + static_cast<size_t>(hdr.count) * sizeof(FeatureRecord);
+    if (std::memcmp(hdr.magic, FEATURE_STORE_MAGIC, 8) != 0
+        || hdr.version != FEATURE_STORE_VERSION
+        || hdr.pipeline_version != PIPELINE_VERSION
+        || hdr.record_size != sizeof(FeatureRecord)
+        || hdr.fingerprint != pipeline_fingerprint()
+        || need > static_cast<size_t>(st.st_size)) {
+        ::munmap(p, static_cast<size_t>(st.st_size));
+        return;
+    }
+    map_ = p;
+    map_size_ = static_cast<size_t>(st.st_size);
+    records_ = reinterpret_cast<const FeatureRecord*>(
+        static_cast<const char*>(p) + FEATURE_STORE_HEADER_SIZE);
+    count_ = hdr.count;
+}
+
+void FeatureStore::unmap_file() {
+    if (map_) ::munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    records_ = nullptr;
+    count_ = 0;
+}
+
+const FeatureRecord* FeatureStore::find_mapped(uint64_t hash) const {
+    const FeatureRecord* end = records_ + count_;
+    const FeatureRecord* it = std::lower_bound(
+        records_, end, hash,
+        [](const FeatureRecord& r, uint64_t h) { return r.image_hash < h; });
+    return (it != end && it->image_hash == hash) ? it : nullptr;
+}
+
+const FeatureRecord& FeatureStore::get(const std::vector<uint8_t>& image_data) {
+    uint64_t hash = feature_image_hash(image_data);
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (const FeatureRecord* r = find_mapped(hash)) {
+            hits_++;
+            return *r;
+        }
+        auto it = pending_.find(hash);
+        if (it != pending_.end()) {
+            hits_++;
+            return *it->second;
+        }
+    }
+
+    // Compute outside the lock so workers run the pipeline concurrently.
+    auto rec = std::make_unique<FeatureRecord>();
+    compute_feature_record(image_data, *rec);
+
+    std::lock_guard<std::mutex> lock(mu_);
+    computed_++;
+    auto& slot = pending_[hash];
+    if (!slot) slot = std::move(rec);
+    return *slot;
+}
+
+bool FeatureStore::save() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (path_.empty() || pending_.empty()) return true;
+
+    std::vector<const FeatureRecord*> all;
+    all.reserve(count_ + pending_.size());
+    for (uint32_t i = 0; i < count_; i++) all.push_back(&records_[i]);
+    for (const auto& kv : pending_) all.push_back(kv.second.get());
+    std::sort(all.begin(), all.end(),
+              [](const FeatureRecord* a, const FeatureRecord* b) {
+                  return a->image_hash < b->image_hash;
+              });
+
+    std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary);
+        if (!os) return false;
+        FeatureStoreHeader hdr = {};
+        std::memcpy(hdr.magic, FEATURE_STORE_MAGIC, 8);
+        hdr.version = FEATURE_STORE_VERSION;
+        hdr.pipeline_version = PIPELINE_VERSION;
+        hdr.record_size = sizeof(FeatureRecord);
+        hdr.count = static_cast<uint32_t>(all.size());
+        hdr.fingerprint = pipeline_fingerprint();
+        os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        for (const FeatureRecord* r : all)
+            os.write(reinterpret_cast<const char*>(r), sizeof(FeatureRecord));
+        if (!os) return false;
+    }
+
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) return false;
+
+    // Pending records are now in the file; remap so lookups see them there.
+    unmap_file();
+    pending_.clear();
+    map_file();
+    return true;
+}
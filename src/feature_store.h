@@ -0,0 +1,130 @@
+#pragma once
+// Persistent per-image pipeline results for the diagnostic tools.
+//
+// occ_test, occ_diag, color_survey, cell_hsv, eval_local and cgptest
+// --rack-diag all need the same pipeline outputs for the same testdata
+// images.  A feature store keeps one fixed-size record per image so each
+// image goes through the pipeline once per pipeline fingerprint:
+//
+//   64-byte header   magic, format version, PIPELINE_VERSION, record size,
+//                    record count, pipeline fingerprint
+//   count records    FeatureRecord, sorted by image_hash
+//
+// The file is mmap()ed read-only and looked up by binary search; new records
+// are kept in memory until save() rewrites the file.  A header whose format
+// version, pipeline version, record size or fingerprint differs from this
+// build's is treated as empty.  The fingerprint (pipeline_fingerprint())
+// covers the model files and the env switches, so retraining a model in
+// place or setting CGP_TILE_HEADS invalidates every record without a
+// version bump; a code change that alters results still needs one.
+//
+// Records are raw structs in host byte order; the file is a local cache, not
+// an interchange format.
+
+#include "board.h"
+#include "rack.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+static const char FEATURE_STORE_MAGIC[8] = {'C', 'G', 'P', 'F', 'E', 'A', 'T', '1'};
+static const uint32_t FEATURE_STORE_VERSION = 2;
+static const int FEATURE_STORE_HEADER_SIZE = 64;
+
+// Default store location, relative to the working directory.
+static const char FEATURE_STORE_DEFAULT_PATH[] = "pipeline_features.bin";
+
+struct FeatureStoreHeader {
+    char magic[8];
+    uint32_t version;          // FEATURE_STORE_VERSION
+    uint32_t pipeline_version; // PIPELINE_VERSION of every record
+    uint32_t record_size;      // sizeof(FeatureRecord)
+    uint32_t count;
+    uint32_t reserved0;
+    uint64_t fingerprint;      // pipeline_fingerprint() of the writer
+    uint32_t reserved[6];
+};
+static_assert(sizeof(FeatureStoreHeader) == FEATURE_STORE_HEADER_SIZE,
+              "feature store header layout must stay 64 bytes");
+
+// Everything the diagnostic tools read from one pipeline run.
+struct alignas(8) FeatureRecord {
+    uint64_t image_hash = 0;       // feature_image_hash() of the encoded file
+    uint32_t pipeline_version = 0;
+    uint8_t valid = 0;             // image decoded
+    uint8_t is_light = 0;          // board theme from detection
+    uint8_t rack_light = 0;        // detect_board_mode(), used for the rack
+    uint8_t cnn = 0;               // letter scores come from the tile CNN
+    int32_t board_rect[4] = {};    // x, y, width, height
+    int32_t cell_size = 0;
+    float pipeline_ms = 0;         // process_board_image_debug() wall time
+    char cgp[320] = {};            // pipeline CGP, NUL-terminated
+    CellResult cells[15][15] = {}; // final per-cell results
+    CellFeatures features[15][15]; // extract_board_features() measurements
+    int32_t n_rack = 0;            // detected rack tiles (at most 7)
+    int32_t rack_rect[7][4] = {};  // RackTile::rect
+    uint8_t rack_blank[7] = {};    // RackTile::is_blank
+    CellResult rack[7] = {};       // after refine_rack + alphagram_tiebreak
+
+    cv::Rect rect() const {
+        return {board_rect[0], board_rect[1], board_rect[2], board_rect[3]};
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<FeatureRecord>,
+              "feature records are written and mapped as raw bytes");
+
+// 64-bit FNV-1a over the encoded image bytes.
+uint64_t feature_image_hash(const std::vector<uint8_t>& image_data);
+
+// Run the pipeline (board, per-cell features, rack) on one image.
+void compute_feature_record(const std::vector<uint8_t>& image_data,
+                            FeatureRecord& out);
+
+// Rebuild the rack tiles of a record (rects + PNG crops) from the image, for
+// tools that show the crops.
+std::vector<RackTile> stored_rack_tiles(const FeatureRecord& rec,
+                                        const std::vector<uint8_t>& image_data);
+
+// ---------------------------------------------------------------------------
+// Lookup-or-compute cache over a store file.  get() may be called from
+// several threads; references stay valid until save() or destruction.
+// ---------------------------------------------------------------------------
+class FeatureStore {
+public:
+    // Empty path = no file: every get() computes and save() is a no-op.
+    explicit FeatureStore(std::string path);
+    ~FeatureStore();
+    FeatureStore(const FeatureStore&) = delete;
+    FeatureStore& operator=(const FeatureStore&) = delete;
+
+    // Stored record for this image, computing (and remembering) it if absent.
+    const FeatureRecord& get(const std::vector<uint8_t>& image_data);
+
+    // Merge new records into the file (written to a temp file, then renamed).
+    bool save();
+
+    int hits() const { return hits_; }
+    int computed() const { return computed_; }
+
+private:
+    const FeatureRecord* find_mapped(uint64_t hash) const;
+    void map_file();
+    void unmap_file();
+
+    std::string path_;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const FeatureRecord* records_ = nullptr;  // inside map_
+    uint32_t count_ = 0;
+
+    std::mutex mu_;
+    std::unordered_map<uint64_t, std::unique_ptr<FeatureRecord>> pending_;
+    int hits_ = 0;
+    int computed_ = 0;
+};
@@ -0,0 +1,109 @@
+#pragma once
+// Gemini generateContent request body, assembled in one allocation.
+//
+// Parts are recorded as segments and written out by build(), which sizes the
+// body exactly and base64-encodes images straight into it.  Concatenating
+// strings instead copies a multi-megabyte screenshot encoding several times
+// per request.
+//
+// Text is copied when added.  Images are referenced, not copied: a PNG or
+// base64 string passed by reference must outlive build(); pass a PNG by
+// rvalue to hand it over instead.  Text must already be escaped for a JSON
+// string, as the prompts in testapp.cpp are.
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "base64.h"
+
+class GeminiPayload {
+public:
+    // {"contents":[{"parts":[{"text":"<prompt>"}
+    explicit GeminiPayload(std::string_view prompt) {
+        literal("{\"contents\":[{\"parts\":[{\"text\":\"");
+        copy(prompt);
+        literal("\"}");
+    }
+    // Segments point into owned_*; a move keeps deque elements in place.
+    GeminiPayload(const GeminiPayload&) = delete;
+    GeminiPayload& operator=(const GeminiPayload&) = delete;
+    GeminiPayload(GeminiPayload&&) = default;
+
+    // ,{"text":"<text>"}
+    GeminiPayload& text(std::string_view text) {
+        literal(",{\"text\":\"");
+        copy(text);
+        literal("\"}");
+        return *this;
+    }
+
+    // ,{"inlineData":{"mimeType":"image/png","data":"<base64 of png>"}}
+    GeminiPayload& png(const std::vector<uint8_t>& png) {
+        literal(",{\"inlineData\":{\"mimeType\":\"image/png\",\"data\":\"");
+        segs_.push_back({reinterpret_cast<const char*>(png.data()), png.size(), true});
+        literal("\"}}");
+        return *this;
+    }
+    GeminiPayload& png(std::vector<uint8_t>&& png) {
+        return this->png(owned_png_.emplace_back(std::move(png)));
+    }
+
+    // Same, from an encoding shared with another payload or the client.
+    GeminiPayload& png_b64(std::string_view b64) {
+        literal(",{\"inlineData\":{\"mimeType\":\"image/png\",\"data\":\"");
+        segs_.push_back({b64.data(), b64.size(), false});
+        literal("\"}}");
+        return *this;
+    }
+
+    // Length of build(gen_config).
+    size_t size(std::string_view gen_config = {}) const {
+        size_t total = CLOSE.size() + gen_config.size() + 1;
+        for (const Segment& s : segs_) total += s.encode ? base64_size(s.size) : s.size;
+        return total;
+    }
+
+    // Closes the parts.  gen_config: "" or ",\"generationConfig\":{...}".
+    std::string build(std::string_view gen_config = {}) const {
+        std::string out(size(gen_config), '\0');
+        char* dst = out.data();
+        for (const Segment& s : segs_) {
+            if (s.encode) {
+                base64_encode_to(reinterpret_cast<const uint8_t*>(s.data), s.size, dst);
+                dst += base64_size(s.size);
+            } else {
+                std::memcpy(dst, s.data, s.size);
+                dst += s.size;
+            }
+        }
+        std::memcpy(dst, CLOSE.data(), CLOSE.size());
+        dst += CLOSE.size();
+        if (!gen_config.empty()) std::memcpy(dst, gen_config.data(), gen_config.size());
+        dst[gen_config.size()] = '}';
+        return out;
+    }
+
+private:
+    static constexpr std::string_view CLOSE = "]}]";
+
+    struct Segment {
+        const char* data;
+        size_t size;
+        bool encode;  // raw bytes to base64-encode, else JSON text
+    };
+
+    // String literals live forever; no copy.
+    void literal(std::string_view s) { segs_.push_back({s.data(), s.size(), false}); }
+    void copy(std::string_view s) {
+        const std::string& held = owned_text_.emplace_back(s);
+        segs_.push_back({held.data(), held.size(), false});
+    }
+
+    std::vector<Segment> segs_;
+    // deque: elements never move, so segments can point into them.
+    std::deque<std::string> owned_text_;
+    std::deque<std::vector<uint8_t>> owned_png_;
+};
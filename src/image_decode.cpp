@@ -0,0 +1,314 @@
+#include "image_decode.h"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <opencv2/imgcodecs.hpp>
+
+#ifdef HAS_LIBPNG
+#include <png.h>
+#endif
+#ifdef HAS_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Header parsing
+// ---------------------------------------------------------------------------
+
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static uint32_t be32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+static int be16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+static bool is_png(const std::vector<uint8_t>& d) {
+    return d.size() >= 33 && std::memcmp(d.data(), PNG_SIGNATURE, 8) == 0
+        && std::memcmp(d.data() + 12, "IHDR", 4) == 0;
+}
+
+static bool is_jpeg(const std::vector<uint8_t>& d) {
+    return d.size() >= 4 && d[0] == 0xFF && d[1] == 0xD8 && d[2] == 0xFF;
+}
+
+// Chunks before the first IDAT: interlacing (IHDR) and EXIF (eXIf).
+static bool png_streamable(const std::vector<uint8_t>& d) {
+    if (d[28] != 0) return false;  // IHDR interlace method
+    size_t i = 8;
+    while (i + 8 <= d.size()) {
+        uint32_t len = be32(&d[i]);
+        const uint8_t* type = &d[i + 4];
+        if (std::memcmp(type, "IDAT", 4) == 0) return true;
+        if (std::memcmp(type, "eXIf", 4) == 0) return false;
+        if (len > d.size() - i - 12) return false;
+        i += 12 + len;  // length, type, data, CRC
+    }
+    return false;
+}
+
+// Walk the JPEG markers up to the frame header.  Returns false if there is
+// no SOF; `exif` reports an APP1 Exif segment before it.
+static bool jpeg_scan(const std::vector<uint8_t>& d, int& width, int& height, bool& exif) {
+    exif = false;
+    size_t i = 2;
+    while (i + 4 <= d.size()) {
+        if (d[i] != 0xFF) return false;
+        int marker = d[i + 1];
+        if (marker == 0xFF) { i++; continue; }  // fill byte
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { i += 2; continue; }
+        int len = be16(&d[i + 2]);
+        if (len < 2) return false;
+        if (marker == 0xE1 && i + 10 <= d.size() && std::memcmp(&d[i + 4], "Exif", 4) == 0)
+            exif = true;
+        bool sof = marker >= 0xC0 && marker <= 0xCF
+                && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (sof) {
+            if (i + 9 > d.size()) return false;
+            height = be16(&d[i + 5]);
+            width = be16(&d[i + 7]);
+            return width > 0 && height > 0;
+        }
+        i += 2 + len;
+    }
+    return false;
+}
+
+bool peek_image_size(const std::vector<uint8_t>& data, int& width, int& height) {
+    if (is_png(data)) {
+        uint32_t w = be32(&data[16]), h = be32(&data[20]);
+        if (w == 0 || h == 0 || w > INT32_MAX || h > INT32_MAX) return false;
+        width = static_cast<int>(w);
+        height = static_cast<int>(h);
+        return true;
+    }
+    bool exif;
+    return is_jpeg(data) && jpeg_scan(data, width, height, exif);
+}
+
+bool can_decode_rows(const std::vector<uint8_t>& data) {
+#ifdef HAS_LIBPNG
+    if (is_png(data)) return png_streamable(data);
+#endif
+#if defined(HAS_LIBJPEG) && defined(LIBJPEG_TURBO_VERSION)
+    int w, h;
+    bool exif;
+    if (is_jpeg(data)) return jpeg_scan(data, w, h, exif) && !exif;
+#endif
+    (void)data;
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// PNG: row streaming
+// ---------------------------------------------------------------------------
+
+#ifdef HAS_LIBPNG
+
+struct PngSource {
+    const uint8_t* data;
+    size_t size, pos;
+};
+
+static void png_read_mem(png_structp png, png_bytep out, size_t len) {
+    auto* src = static_cast<PngSource*>(png_get_io_ptr(png));
+    if (src->size - src->pos < len) png_error(png, "truncated");
+    std::memcpy(out, src->data + src->pos, len);
+    src->pos += len;
+}
+
+static void png_error_jump(png_structp png, png_const_charp) {
+    png_longjmp(png, 1);
+}
+
+static void png_quiet(png_structp, png_const_charp) {}
+
+using PngRowFn = void (*)(int y, const uint8_t* bgr, void* ctx);
+
+// Decode rows [0, y_end) as 8-bit BGR, the conversions cv::imdecode applies
+// for IMREAD_COLOR, handing each one to fn.  Rows after y_end are never
+// inflated.  Errors longjmp back here, so only plain data lives in this
+// frame; fn must not throw.
+static bool png_stream_rows(const std::vector<uint8_t>& data, int width, int y_end,
+                            PngRowFn fn, void* ctx) {
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
+                                             png_error_jump, png_quiet);
+    if (!png) return false;
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        png_destroy_read_struct(&png, nullptr, nullptr);
+        return false;
+    }
+    PngSource src = {data.data(), data.size(), 0};
+    png_bytep volatile row = nullptr;
+    if (setjmp(png_jmpbuf(png))) {
+        png_free(png, row);
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+    png_set_read_fn(png, &src, png_read_mem);
+    png_read_info(png, info);
+    png_set_expand(png);
+    png_set_strip_16(png);
+    png_set_strip_alpha(png);
+    png_set_gray_to_rgb(png);
+    png_set_bgr(png);
+    png_read_update_info(png, info);
+    bool ok = static_cast<int>(png_get_image_width(png, info)) == width
+           && png_get_rowbytes(png, info) == static_cast<size_t>(width) * 3
+           && png_get_interlace_type(png, info) == PNG_INTERLACE_NONE;
+    if (ok) {
+        row = static_cast<png_bytep>(png_malloc(png, static_cast<size_t>(width) * 3));
+        for (int y = 0; y < y_end; y++) {
+            png_read_row(png, row, nullptr);
+            fn(y, row, ctx);
+        }
+        png_free(png, row);
+    }
+    png_destroy_read_struct(&png, &info, nullptr);
+    return ok;
+}
+
+struct PngBand {
+    cv::Mat* out;
+    int y0;
+};
+
+static void png_band_row(int y, const uint8_t* bgr, void* ctx) {
+    auto* band = static_cast<PngBand*>(ctx);
+    if (y >= band->y0)
+        std::memcpy(band->out->ptr(y - band->y0), bgr, band->out->cols * 3);
+}
+
+// factor x factor box average of each block of full-resolution rows.
+struct PngPreview {
+    cv::Mat* out;
+    int factor;
+    std::vector<uint32_t> acc;  // out->cols * 3 sums
+};
+
+static void png_preview_row(int y, const uint8_t* bgr, void* ctx) {
+    auto* pv = static_cast<PngPreview*>(ctx);
+    int f = pv->factor, n = pv->out->cols;
+    if (y / f >= pv->out->rows) return;
+    for (int x = 0; x < n; x++)
+        for (int k = 0; k < f; k++)
+            for (int ch = 0; ch < 3; ch++)
+                pv->acc[x * 3 + ch] += bgr[(x * f + k) * 3 + ch];
+    if (y % f == f - 1) {
+        uint8_t* dst = pv->out->ptr(y / f);
+        uint32_t area = f * f;
+        for (int i = 0; i < n * 3; i++) {
+            dst[i] = static_cast<uint8_t>((pv->acc[i] + area / 2) / area);
+            pv->acc[i] = 0;
+        }
+    }
+}
+
+#endif  // HAS_LIBPNG
+
+// ---------------------------------------------------------------------------
+// JPEG: scanline skipping (libjpeg-turbo)
+// ---------------------------------------------------------------------------
+
+#if defined(HAS_LIBJPEG) && defined(LIBJPEG_TURBO_VERSION)
+
+struct JpegError {
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+static void jpeg_error_jump(j_common_ptr cinfo) {
+    std::longjmp(reinterpret_cast<JpegError*>(cinfo->err)->jump, 1);
+}
+
+static void jpeg_quiet(j_common_ptr) {}
+
+// Decode rows [y0, y1) as BGR into out (y1 - y0 rows).  The rows above are
+// entropy-decoded but skip IDCT and colour conversion; the rows below are
+// never touched.
+static bool jpeg_decode_rows(const std::vector<uint8_t>& data, int y0, int y1, cv::Mat& out) {
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpeg_error_jump;
+    err.mgr.output_message = jpeg_quiet;
+    jpeg_create_decompress(&cinfo);
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_mem_src(&cinfo, data.data(), static_cast<unsigned long>(data.size()));
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_EXT_BGR;
+    jpeg_start_decompress(&cinfo);
+    bool ok = static_cast<int>(cinfo.output_width) == out.cols
+           && static_cast<int>(cinfo.output_height) >= y1
+           && cinfo.output_components == 3;
+    if (ok) {
+        if (y0 > 0) jpeg_skip_scanlines(&cinfo, y0);
+        while (static_cast<int>(cinfo.output_scanline) < y1) {
+            JSAMPROW row = out.ptr(static_cast<int>(cinfo.output_scanline) - y0);
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+    }
+    jpeg_abort_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return ok;
+}
+
+#endif  // HAS_LIBJPEG && LIBJPEG_TURBO_VERSION
+
+// ---------------------------------------------------------------------------
+// Entry points
+// ---------------------------------------------------------------------------
+
+cv::Mat decode_preview(const std::vector<uint8_t>& data, int factor) {
+    int flag;
+    switch (factor) {
+        case 2: flag = cv::IMREAD_REDUCED_COLOR_2; break;
+        case 4: flag = cv::IMREAD_REDUCED_COLOR_4; break;
+        case 8: flag = cv::IMREAD_REDUCED_COLOR_8; break;
+        default: return {};
+    }
+#ifdef HAS_LIBPNG
+    // OpenCV decodes PNGs at full size and then shrinks them.
+    int w, h;
+    if (is_png(data) && png_streamable(data) && peek_image_size(data, w, h)
+        && w >= factor && h >= factor) {
+        cv::Mat out(h / factor, w / factor, CV_8UC3);
+        PngPreview pv = {&out, factor, std::vector<uint32_t>(out.cols * 3, 0)};
+        if (png_stream_rows(data, w, out.rows * factor, png_preview_row, &pv)) return out;
+        return {};
+    }
+#endif
+    int jw, jh;
+    bool exif;
+    if (is_jpeg(data) && (!jpeg_scan(data, jw, jh, exif) || exif)) return {};
+    cv::Mat raw(1, static_cast<int>(data.size()), CV_8UC1, const_cast<uint8_t*>(data.data()));
+    return cv::imdecode(raw, flag);
+}
+
+cv::Mat decode_rows(const std::vector<uint8_t>& data, int y0, int y1) {
+    int w, h;
+    if (!can_decode_rows(data) || !peek_image_size(data, w, h)) return {};
+    y0 = std::max(0, y0);
+    y1 = std::min(h, y1);
+    if (y0 >= y1) return {};
+    cv::Mat out(y1 - y0, w, CV_8UC3);
+#ifdef HAS_LIBPNG
+    if (is_png(data)) {
+        PngBand band = {&out, y0};
+        return png_stream_rows(data, w, y1, png_band_row, &band) ? out : cv::Mat();
+    }
+#endif
+#if defined(HAS_LIBJPEG) && defined(LIBJPEG_TURBO_VERSION)
+    if (is_jpeg(data))
+        return jpeg_decode_rows(data, y0, y1, out) ? out : cv::Mat();
+#endif
+    return {};
+}
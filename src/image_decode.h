@@ -0,0 +1,35 @@
+#pragma once
+// Partial decoding of PNG/JPEG screenshots.
+//
+// Most of a tall mobile screenshot (status bar, chat, buttons) is never
+// looked at once the board is found.  decode_preview() decodes at reduced
+// resolution to locate the board; decode_rows() then decodes just a band of
+// rows at full resolution.
+//
+// PNG rows are streamed through libpng (HAS_LIBPNG): the preview never holds
+// a full-resolution image, and decode_rows() stops inflating after the last
+// wanted row and keeps only the wanted ones.  JPEG previews use DCT scaling
+// (IMREAD_REDUCED_COLOR_*); JPEG bands skip the rows above with libjpeg-turbo
+// (HAS_LIBJPEG).  decode_rows() output matches the same rows of
+// cv::imdecode(data, IMREAD_COLOR) exactly.
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// Width and height from the PNG IHDR or JPEG SOF header, without decoding.
+bool peek_image_size(const std::vector<uint8_t>& data, int& width, int& height);
+
+// Whether decode_rows() can stream this image: a non-interlaced PNG, or a
+// JPEG, without EXIF (which imdecode would apply as an orientation) and with
+// the library above built in.
+bool can_decode_rows(const std::vector<uint8_t>& data);
+
+// BGR image at 1/factor resolution (factor 2, 4 or 8), for locating the
+// board only: pixel values differ slightly from a resized full decode.
+// Empty on failure.
+cv::Mat decode_preview(const std::vector<uint8_t>& data, int factor);
+
+// Rows [y0, y1) at full resolution, BGR.  Empty if !can_decode_rows() or on
+// a decode error.
+cv::Mat decode_rows(const std::vector<uint8_t>& data, int y0, int y1);
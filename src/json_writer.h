@@ -0,0 +1,146 @@
+#pragma once
+// Streaming JSON writer for the test bench's responses.
+//
+// Values are appended to one buffer that is kept between lines, so an
+// NDJSON stream reuses its allocation: serialize a line, send() it to the
+// httplib sink, and the next line writes over the same capacity.  Commas
+// are inserted automatically; keys and strings are escaped here and only
+// here (json_escape_append).
+//
+//   JsonWriter w;
+//   w.begin_object().key("status").string(msg).end_object().line();
+//   w.send(sink);
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "base64.h"
+
+// Appends s as the body of a JSON string: quotes, backslashes and control
+// characters escaped, everything else (including UTF-8) copied as is.
+static inline void json_escape_append(std::string& out, std::string_view s) {
+    static const char HEX[] = "0123456789abcdef";
+    size_t run = 0;  // start of the pending unescaped run
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n";  break;
+            case '\r': out += "\\r";  break;
+            case '\t': out += "\\t";  break;
+            default:
+                out += "\\u00";
+                out += HEX[c >> 4];
+                out += HEX[c & 0xF];
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+}
+
+class JsonWriter {
+public:
+    JsonWriter& begin_object() { value(); buf_ += '{'; comma_ = false; return *this; }
+    JsonWriter& end_object() { buf_ += '}'; comma_ = true; return *this; }
+    JsonWriter& begin_array() { value(); buf_ += '['; comma_ = false; return *this; }
+    JsonWriter& end_array() { buf_ += ']'; comma_ = true; return *this; }
+
+    // Object key; the next call writes its value.
+    JsonWriter& key(std::string_view k) {
+        value();
+        buf_ += '"';
+        json_escape_append(buf_, k);
+        buf_ += "\":";
+        comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& string(std::string_view s) {
+        value();
+        buf_ += '"';
+        json_escape_append(buf_, s);
+        buf_ += '"';
+        comma_ = true;
+        return *this;
+    }
+    JsonWriter& string(char c) { return string(std::string_view(&c, 1)); }
+
+    JsonWriter& number(long long n) {
+        value();
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), n);
+        buf_.append(tmp, res.ptr);
+        comma_ = true;
+        return *this;
+    }
+
+    JsonWriter& boolean(bool b) { return raw(b ? "true" : "false"); }
+    JsonWriter& null() { return raw("null"); }
+
+    // Already-serialized JSON value (e.g. a Woogles lookup result).
+    JsonWriter& raw(std::string_view json) {
+        value();
+        buf_ += json;
+        comma_ = true;
+        return *this;
+    }
+
+    // Already-serialized members ("k":v,...) of the open object, e.g. the
+    // str() of a writer that wrote only key/value pairs.
+    JsonWriter& members(std::string_view json) {
+        if (json.empty()) return *this;
+        value();
+        buf_ += json;
+        comma_ = true;
+        return *this;
+    }
+
+    // "data:image/png;base64,..." string, encoded straight into the buffer.
+    JsonWriter& png_data_uri(const std::vector<uint8_t>& png) {
+        static const std::string_view prefix = "\"data:image/png;base64,";
+        value();
+        size_t at = buf_.size() + prefix.size();
+        buf_.resize(at + base64_size(png.size()) + 1);
+        buf_.replace(at - prefix.size(), prefix.size(), prefix);
+        base64_encode_to(png.data(), png.size(), buf_.data() + at);
+        buf_.back() = '"';
+        comma_ = true;
+        return *this;
+    }
+    // Same, from an encoding already made for a Gemini request.
+    JsonWriter& png_data_uri(std::string_view b64) {
+        value();
+        buf_ += "\"data:image/png;base64,";
+        buf_ += b64;
+        buf_ += '"';
+        comma_ = true;
+        return *this;
+    }
+
+    // Ends an NDJSON line; the next value starts a new top-level one.
+    JsonWriter& line() { buf_ += '\n'; comma_ = false; return *this; }
+
+    const std::string& str() const { return buf_; }
+
+    // Writes the buffer to an httplib::DataSink (or anything with
+    // write(const char*, size_t)) and empties it, keeping its capacity.  May
+    // be called mid-value: a streamed array continues where it left off.
+    template <class Sink>
+    void send(Sink& sink) {
+        sink.write(buf_.data(), buf_.size());
+        buf_.clear();
+    }
+
+private:
+    void value() {
+        if (comma_) buf_ += ',';
+    }
+
+    std::string buf_;
+    bool comma_ = false;  // a value was just completed at this level
+};
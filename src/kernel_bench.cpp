@@ -0,0 +1,94 @@
+// Self-test and per-ISA timing of board_lib's dispatched kernels
+// (cpu_kernels.h).
+//
+// Checks that every variant this CPU supports matches baseline, then times
+// each one on board-sized synthetic rows: Sobel rows for the stage-1 edge
+// projections, gray rows for the light-mode shadow range profiles, and a
+// screenshot-sized buffer for the Gemini payload base64.  Exits non-zero if
+// the self-test fails, so it can gate a deploy to a new host type.
+//
+// Usage: kernel_bench [passes]     (default 200)
+#include "base64.h"
+#include "cpu_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    std::setbuf(stdout, nullptr);  // unbuffered output
+    int passes = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+
+    std::string report;
+    if (!cpu_kernels_self_test(&report)) {
+        std::printf("Self-test FAILED: %s\n", report.c_str());
+        return 1;
+    }
+    std::printf("Self-test passed; selected: %s\n\n", cpu_kernels().isa);
+
+    // Sobel response of an 8-bit image: integers in [-1020, 1020].
+    const int w = 1200, h = 1200;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(-1020, 1020);
+    std::vector<float> img(static_cast<size_t>(w) * h);
+    for (float& f : img) f = static_cast<float>(dist(rng));
+    std::vector<uint8_t> gray(static_cast<size_t>(w) * h);
+    for (uint8_t& p : gray) p = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> png(3 << 20);
+    for (uint8_t& p : png) p = static_cast<uint8_t>(rng());
+    std::string b64(base64_size(png.size()), '\0');
+
+    std::printf("%-10s %14s %14s %14s %14s %14s\n", "ISA", "accumulate ms", "sum ms",
+                "minmax ms", "range ms", "base64 ms");
+    double base_acc = 0, base_sum = 0, base_mm = 0, base_rng = 0, base_b64 = 0;
+    auto variants = cpu_kernel_variants();
+    for (auto it = variants.rbegin(); it != variants.rend(); ++it) {
+        const CpuKernels& k = **it;
+        std::vector<double> vproj(w), hproj(h);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; p++)
+            for (int y = 0; y < h; y++)
+                k.abs_accumulate(&img[static_cast<size_t>(y) * w], w, vproj.data());
+        auto t1 = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; p++)
+            for (int y = 0; y < h; y++)
+                hproj[y] += k.abs_sum(&img[static_cast<size_t>(y) * w], w);
+        auto t2 = std::chrono::steady_clock::now();
+        std::vector<uint8_t> mn(w, 255), mx(w, 0);
+        for (int p = 0; p < passes; p++)
+            for (int y = 0; y < h; y += 2)
+                k.minmax_accumulate(&gray[static_cast<size_t>(y) * w], w, mn.data(), mx.data());
+        auto t3 = std::chrono::steady_clock::now();
+        int range_sum = 0;
+        for (int p = 0; p < passes; p++)
+            for (int y = 0; y < h; y++)
+                range_sum += k.range_step2(&gray[static_cast<size_t>(y) * w], w);
+        auto t4 = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; p += 10)
+            k.base64_encode(png.data(), png.size(), b64.data());
+        auto t5 = std::chrono::steady_clock::now();
+
+        auto ms = [&](auto a, auto b) {
+            return std::chrono::duration<double, std::milli>(b - a).count() / passes;
+        };
+        double acc_ms = ms(t0, t1), sum_ms = ms(t1, t2), mm_ms = ms(t2, t3), rng_ms = ms(t3, t4);
+        double b64_ms = ms(t4, t5) * passes / ((passes + 9) / 10);
+        if (base_acc == 0) {
+            base_acc = acc_ms; base_sum = sum_ms; base_mm = mm_ms; base_rng = rng_ms;
+            base_b64 = b64_ms;
+        }
+        std::printf("%-10s %8.3f (%.1fx) %8.3f (%.1fx) %8.3f (%.1fx) %8.3f (%.1fx)"
+                    " %8.3f (%.1fx)%s\n",
+                    k.isa, acc_ms, base_acc / acc_ms, sum_ms, base_sum / sum_ms,
+                    mm_ms, base_mm / mm_ms, rng_ms, base_rng / rng_ms,
+                    b64_ms, base_b64 / b64_ms, &k == &cpu_kernels() ? "  *" : "");
+        // Keep the results live.
+        if (vproj[w / 2] < 0 || hproj[h / 2] < 0 || mn[w / 2] > mx[w / 2] || range_sum < 0)
+            std::printf("?\n");
+    }
+    return 0;
+}
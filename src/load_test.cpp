@@ -0,0 +1,293 @@
+// Load generator for cgptest's analysis endpoints.
+//
+// Replays the testdata images against /analyze or /analyze-gemini, reads the
+// NDJSON progress stream of every response and reports throughput plus
+// latency percentiles for
+//   first progress  first complete NDJSON line
+//   final result    last line carrying "cgp"
+//
+// Usage: load_test [options] [testdata_dir]     (default dir: testdata)
+//
+//   --host URL        server (default http://localhost:8080)
+//   --endpoint PATH   /analyze (default) or /analyze-gemini
+//   -c N              closed loop: N clients, each sends its next request
+//                     as soon as the previous one finishes (default 1)
+//   --rate R          open loop: start R requests/s regardless of
+//                     responses; latencies count from the scheduled start,
+//                     so time spent queued behind slow responses shows up
+//   --max-inflight N  open-loop client connections (default 256)
+//   -n N              total requests (default: one per image)
+//   --filter STR      only images whose name contains STR
+//   --skip-woogles    send skip_woogles (as the eval runner does)
+//   --timeout S       per-request read timeout in seconds (default 180)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <httplib.h>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct Image {
+    std::string name;      // file name, sent as the multipart filename
+    std::string mime;
+    std::string data;
+};
+
+struct Sample {
+    bool ok = false;
+    double first_ms = -1;  // first NDJSON line
+    double final_ms = -1;  // last line with "cgp"
+    double total_ms = 0;   // response fully read
+    size_t bytes = 0;
+    std::string error;
+};
+
+static std::vector<Image> load_images(const std::string& dir, const std::string& filter) {
+    std::vector<Image> out;
+    for (auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        if (ext != ".png" && ext != ".jpg" && ext != ".jpeg") continue;
+        std::string name = entry.path().filename().string();
+        if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+        std::ifstream ifs(entry.path(), std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(ifs)),
+                          std::istreambuf_iterator<char>());
+        out.push_back({name, ext == ".png" ? "image/png" : "image/jpeg", std::move(data)});
+    }
+    std::sort(out.begin(), out.end(),
+              [](const Image& a, const Image& b) { return a.name < b.name; });
+    return out;
+}
+
+static const char BOUNDARY[] = "----cgpbot-load-test-boundary";
+
+static std::string multipart_body(const Image& img, bool skip_woogles) {
+    std::string body;
+    body += std::string("--") + BOUNDARY + "\r\n";
+    body += "Content-Disposition: form-data; name=\"image\"; filename=\"" + img.name + "\"\r\n";
+    body += "Content-Type: " + img.mime + "\r\n\r\n";
+    body += img.data;
+    body += "\r\n";
+    if (skip_woogles) {
+        body += std::string("--") + BOUNDARY + "\r\n";
+        body += "Content-Disposition: form-data; name=\"skip_woogles\"\r\n\r\n1\r\n";
+    }
+    body += std::string("--") + BOUNDARY + "--\r\n";
+    return body;
+}
+
+// Send one request and time its NDJSON stream against `start`.
+static Sample run_request(httplib::Client& cli, const std::string& endpoint,
+                          const std::string& body, Clock::time_point start) {
+    Sample s;
+    auto ms_since = [&]() {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    std::string pending;  // bytes after the last newline
+    httplib::Request req;
+    req.method = "POST";
+    req.path = endpoint;
+    req.set_header("Content-Type", std::string("multipart/form-data; boundary=") + BOUNDARY);
+    req.body = body;
+    req.content_receiver = [&](const char* data, size_t len, uint64_t, uint64_t) {
+        s.bytes += len;
+        pending.append(data, len);
+        size_t nl;
+        while ((nl = pending.find('\n')) != std::string::npos) {
+            double t = ms_since();
+            if (s.first_ms < 0) s.first_ms = t;
+            if (pending.find("\"cgp\"") < nl) s.final_ms = t;
+            pending.erase(0, nl + 1);
+        }
+        return true;
+    };
+
+    httplib::Response res;
+    httplib::Error err = httplib::Error::Success;
+    bool sent = cli.send(req, res, err);
+    s.total_ms = ms_since();
+    if (!sent)
+        s.error = httplib::to_string(err);
+    else if (res.status != 200)
+        s.error = "HTTP " + std::to_string(res.status);
+    else if (s.final_ms < 0)
+        s.error = "no final result";
+    s.ok = s.error.empty();
+    return s;
+}
+
+static double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t rank = static_cast<size_t>(p / 100.0 * v.size() + 0.999999);
+    return v[std::clamp<size_t>(rank, 1, v.size()) - 1];
+}
+
+static void print_latency(const char* label, const std::vector<double>& v) {
+    if (v.empty()) {
+        std::printf("  %-15s (no samples)\n", label);
+        return;
+    }
+    double sum = 0;
+    for (double x : v) sum += x;
+    std::printf("  %-15s mean %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f ms\n",
+                label, sum / v.size(), percentile(v, 50), percentile(v, 90),
+                percentile(v, 99), *std::max_element(v.begin(), v.end()));
+}
+
+int main(int argc, char* argv[]) {
+    std::setbuf(stdout, nullptr);
+    std::string host = "http://localhost:8080";
+    std::string endpoint = "/analyze";
+    std::string dir = "testdata";
+    std::string filter;
+    int concurrency = 1, max_inflight = 256, n_requests = 0, timeout_sec = 180;
+    double rate = 0;
+    bool skip_woogles = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) host = argv[++i];
+        else if (arg == "--endpoint" && i + 1 < argc) endpoint = argv[++i];
+        else if (arg == "-c" && i + 1 < argc) concurrency = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--rate" && i + 1 < argc) rate = std::atof(argv[++i]);
+        else if (arg == "--max-inflight" && i + 1 < argc)
+            max_inflight = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "-n" && i + 1 < argc) n_requests = std::atoi(argv[++i]);
+        else if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--skip-woogles") skip_woogles = true;
+        else if (arg == "--timeout" && i + 1 < argc) timeout_sec = std::atoi(argv[++i]);
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Usage: load_test [--host URL] [--endpoint /analyze|/analyze-gemini]\n"
+                         "                 [-c N | --rate R [--max-inflight N]] [-n N]\n"
+                         "                 [--filter STR] [--skip-woogles] [--timeout S]"
+                         " [testdata_dir]\n";
+            return 1;
+        } else dir = arg;
+    }
+
+    auto images = load_images(dir, filter);
+    if (images.empty()) {
+        std::cerr << "No images found in " << dir << "\n";
+        return 1;
+    }
+    if (n_requests <= 0) n_requests = static_cast<int>(images.size());
+    std::vector<std::string> bodies;
+    bodies.reserve(images.size());
+    for (const auto& img : images) bodies.push_back(multipart_body(img, skip_woogles));
+
+    bool open_loop = rate > 0;
+    int n_workers = std::min(open_loop ? max_inflight : concurrency, n_requests);
+    if (open_loop)
+        std::printf("%s%s: %d requests over %zu images, open loop at %.2f req/s\n",
+                    host.c_str(), endpoint.c_str(), n_requests, images.size(), rate);
+    else
+        std::printf("%s%s: %d requests over %zu images, closed loop with %d clients\n",
+                    host.c_str(), endpoint.c_str(), n_requests, images.size(), concurrency);
+
+    std::vector<Sample> samples(n_requests);
+    std::atomic<int> n_done{0};
+
+    // Open loop: a scheduler releases request i at t0 + i / rate; workers
+    // pick releases off the queue.  Closed loop: workers claim the next
+    // index as soon as they are free and time it from the actual send.
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<std::pair<int, Clock::time_point>> released;
+    bool scheduling_done = false;
+    std::atomic<int> next_index{0};
+
+    auto t0 = Clock::now();
+    std::vector<std::thread> workers(n_workers);
+    for (int t = 0; t < n_workers; t++) {
+        workers[t] = std::thread([&]() {
+            httplib::Client cli(host);
+            cli.set_connection_timeout(10);
+            cli.set_read_timeout(timeout_sec);
+            for (;;) {
+                int i;
+                Clock::time_point start;
+                if (open_loop) {
+                    std::unique_lock<std::mutex> lock(mu);
+                    cv.wait(lock, [&] { return !released.empty() || scheduling_done; });
+                    if (released.empty()) return;
+                    i = released.front().first;
+                    start = released.front().second;
+                    released.pop_front();
+                } else {
+                    i = next_index++;
+                    if (i >= n_requests) return;
+                    start = Clock::now();
+                }
+                samples[i] = run_request(cli, endpoint, bodies[i % bodies.size()], start);
+                int done = ++n_done;
+                if (done % 10 == 0 || done == n_requests)
+                    std::fprintf(stderr, "\r%d/%d requests...", done, n_requests);
+            }
+        });
+    }
+
+    if (open_loop) {
+        for (int i = 0; i < n_requests; i++) {
+            auto when = t0 + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(i / rate));
+            std::this_thread::sleep_until(when);
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                released.emplace_back(i, when);
+            }
+            cv.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            scheduling_done = true;
+        }
+        cv.notify_all();
+    }
+    for (auto& th : workers) th.join();
+    double wall = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::fprintf(stderr, "\n");
+
+    std::vector<double> first, final_, total;
+    size_t bytes = 0;
+    int n_ok = 0;
+    std::vector<std::pair<std::string, int>> errors;
+    for (int i = 0; i < n_requests; i++) {
+        const Sample& s = samples[i];
+        bytes += s.bytes;
+        if (!s.ok) {
+            auto it = std::find_if(errors.begin(), errors.end(),
+                                   [&](const auto& e) { return e.first == s.error; });
+            if (it == errors.end()) errors.push_back({s.error, 1});
+            else it->second++;
+            continue;
+        }
+        n_ok++;
+        first.push_back(s.first_ms);
+        final_.push_back(s.final_ms);
+        total.push_back(s.total_ms);
+    }
+
+    std::printf("\nCompleted %d/%d in %.2f s: %.2f req/s, %.1f MB received\n",
+                n_ok, n_requests, wall, n_ok / wall, bytes / 1e6);
+    print_latency("first progress", first);
+    print_latency("final result", final_);
+    print_latency("stream end", total);
+    for (const auto& e : errors)
+        std::printf("  error x%d: %s\n", e.second, e.first.c_str());
+    return n_ok == n_requests ? 0 : 1;
+}
@@ -6,6 +6,7 @@
 #include <dpp/dpp.h>
 
 #include "board.h"
+#include "board_cache.h"
 
 // ---------------------------------------------------------------------------
 // Returns true if the filename looks like an image we should process.
@@ -21,6 +22,11 @@ static bool is_image(const std::string& filename) {
     return false;
 }
 
+// Re-posted screenshots of the same position (different crop or JPEG
+// quality) are answered from here after board detection alone, when
+// CGP_BOARD_CACHE=1 is set.
+static BoardCache g_board_cache;
+
 int main() {
     const char* token_env = std::getenv("CGPBOT_TOKEN");
     if (!token_env) {
@@ -62,7 +68,7 @@ int main() {
                     }
 
                     std::vector<uint8_t> buf(res.body.begin(), res.body.end());
-                    std::string cgp = process_board_image(buf);
+                    std::string cgp = process_board_image_cached(buf, g_board_cache);
 
                     bot.message_create(dpp::message(channel_id,
                         "```\n" + cgp + "\n```")
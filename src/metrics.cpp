@@ -0,0 +1,195 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+enum class MetricKind { Counter, Gauge, Histogram };
+
+struct MetricSeries {
+    std::string name, labels, help;
+    MetricKind kind;
+    uint32_t slot;
+};
+
+// One thread's copy of every slot.  Only the owning thread writes it.
+struct MetricShard {
+    std::atomic<uint64_t> v[METRICS_MAX_SLOTS];
+};
+
+struct MetricRegistry {
+    std::mutex mu;
+    std::vector<MetricSeries> series;
+    uint32_t next_slot = 1;  // slot 0 absorbs writes from overflowed series
+    std::vector<MetricShard*> live;
+    std::vector<MetricShard*> spare;  // zeroed shards from exited threads
+    uint64_t retired[METRICS_MAX_SLOTS] = {};
+};
+
+// Never destroyed: worker threads may exit after static destructors run.
+static MetricRegistry& registry() {
+    static MetricRegistry* r = new MetricRegistry;
+    return *r;
+}
+
+static MetricShard* acquire_shard() {
+    MetricRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mu);
+    MetricShard* s;
+    if (!r.spare.empty()) {
+        s = r.spare.back();
+        r.spare.pop_back();
+    } else {
+        s = new MetricShard;
+        for (auto& v : s->v) v.store(0, std::memory_order_relaxed);
+    }
+    r.live.push_back(s);
+    return s;
+}
+
+// Fold an exiting thread's values into the retired totals and recycle it.
+static void retire_shard(MetricShard* s) {
+    MetricRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mu);
+    for (int i = 0; i < METRICS_MAX_SLOTS; i++)
+        r.retired[i] += s->v[i].exchange(0, std::memory_order_relaxed);
+    r.live.erase(std::find(r.live.begin(), r.live.end(), s));
+    r.spare.push_back(s);
+}
+
+struct ShardOwner {
+    MetricShard* shard = nullptr;
+    ~ShardOwner() {
+        if (shard) retire_shard(shard);
+    }
+};
+
+static thread_local ShardOwner t_owner;
+
+static inline void slot_add(uint32_t slot, uint64_t n) {
+    if (!t_owner.shard) t_owner.shard = acquire_shard();
+    t_owner.shard->v[slot].fetch_add(n, std::memory_order_relaxed);
+}
+
+static uint32_t register_series(const std::string& name, const std::string& labels,
+                                const std::string& help, MetricKind kind) {
+    MetricRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mu);
+    for (const MetricSeries& s : r.series)
+        if (s.name == name && s.labels == labels) return s.slot;
+
+    uint32_t n = kind == MetricKind::Histogram ? METRICS_HIST_BUCKETS + 2 : 1;
+    if (r.next_slot + n > static_cast<uint32_t>(METRICS_MAX_SLOTS)) {
+        std::cerr << "metrics: out of slots, dropping " << name << "{"
+                  << labels << "}\n";
+        return 0;
+    }
+    r.series.push_back({name, labels, help, kind, r.next_slot});
+    r.next_slot += n;
+    return r.series.back().slot;
+}
+
+static std::string with_labels(const std::string& labels, const char* extra) {
+    std::string out = "{" + labels;
+    if (!labels.empty() && extra[0]) out += ",";
+    out += extra;
+    out += "}";
+    return out == "{}" ? "" : out;
+}
+
+void Counter::inc(uint64_t n) const {
+    slot_add(slot, n);
+}
+
+void Gauge::add(int64_t n) const {
+    // Two's-complement wraparound: the per-shard sums still add up.
+    slot_add(slot, static_cast<uint64_t>(n));
+}
+
+void Histogram::observe(double seconds) const {
+    if (slot == 0) return;
+    int b = 0;
+    while (b < METRICS_HIST_BUCKETS && seconds > METRICS_HIST_BOUNDS[b]) b++;
+    slot_add(slot + b, 1);
+    slot_add(slot + METRICS_HIST_BUCKETS + 1,
+             static_cast<uint64_t>(std::max(0.0, seconds) * 1e6));
+}
+
+Counter metrics_counter(const std::string& name, const std::string& labels,
+                        const std::string& help) {
+    return {register_series(name, labels, help, MetricKind::Counter)};
+}
+
+Gauge metrics_gauge(const std::string& name, const std::string& labels,
+                    const std::string& help) {
+    return {register_series(name, labels, help, MetricKind::Gauge)};
+}
+
+Histogram metrics_histogram(const std::string& name, const std::string& labels,
+                            const std::string& help) {
+    return {register_series(name, labels, help, MetricKind::Histogram)};
+}
+
+std::string metrics_scrape() {
+    MetricRegistry& r = registry();
+    std::vector<MetricSeries> series;
+    std::vector<uint64_t> v(METRICS_MAX_SLOTS);
+    {
+        std::lock_guard<std::mutex> lock(r.mu);
+        series = r.series;
+        for (int i = 0; i < METRICS_MAX_SLOTS; i++) v[i] = r.retired[i];
+        for (const MetricShard* s : r.live)
+            for (int i = 0; i < METRICS_MAX_SLOTS; i++)
+                v[i] += s->v[i].load(std::memory_order_relaxed);
+    }
+
+    // The exposition format wants each family's samples together.
+    std::stable_sort(series.begin(), series.end(),
+                     [](const MetricSeries& a, const MetricSeries& b) { return a.name < b.name; });
+
+    std::string out;
+    char buf[64];
+    for (size_t i = 0; i < series.size(); i++) {
+        const MetricSeries& s = series[i];
+        if (i == 0 || series[i - 1].name != s.name) {
+            static const char* kind_names[] = {"counter", "gauge", "histogram"};
+            out += "# HELP " + s.name + " " + s.help + "\n";
+            out += "# TYPE " + s.name + " " + kind_names[static_cast<int>(s.kind)] + "\n";
+        }
+        switch (s.kind) {
+        case MetricKind::Counter:
+            std::snprintf(buf, sizeof(buf), " %" PRIu64 "\n", v[s.slot]);
+            out += s.name + with_labels(s.labels, "") + buf;
+            break;
+        case MetricKind::Gauge:
+            std::snprintf(buf, sizeof(buf), " %" PRId64 "\n",
+                          static_cast<int64_t>(v[s.slot]));
+            out += s.name + with_labels(s.labels, "") + buf;
+            break;
+        case MetricKind::Histogram: {
+            uint64_t cum = 0;
+            for (int b = 0; b <= METRICS_HIST_BUCKETS; b++) {
+                cum += v[s.slot + b];
+                char le[32];
+                if (b < METRICS_HIST_BUCKETS)
+                    std::snprintf(le, sizeof(le), "le=\"%g\"", METRICS_HIST_BOUNDS[b]);
+                else
+                    std::snprintf(le, sizeof(le), "le=\"+Inf\"");
+                std::snprintf(buf, sizeof(buf), " %" PRIu64 "\n", cum);
+                out += s.name + "_bucket" + with_labels(s.labels, le) + buf;
+            }
+            std::snprintf(buf, sizeof(buf), " %.6f\n",
+                          v[s.slot + METRICS_HIST_BUCKETS + 1] / 1e6);
+            out += s.name + "_sum" + with_labels(s.labels, "") + buf;
+            std::snprintf(buf, sizeof(buf), " %" PRIu64 "\n", cum);
+            out += s.name + "_count" + with_labels(s.labels, "") + buf;
+            break;
+        }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,84 @@
+#pragma once
+// Process-wide counters, gauges and latency histograms for cgptest, exposed
+// in the Prometheus text format by metrics_scrape().
+//
+// Every series owns a fixed range of slots.  Each thread that records a value
+// gets its own shard of slots on first use; inc()/observe() are a relaxed
+// atomic add on the calling thread's shard, so the hot path never takes a
+// lock or touches a cache line another thread writes.  metrics_scrape() sums
+// the live shards plus the totals folded in from threads that have exited.
+//
+// Registration (metrics_counter() etc.) takes a mutex and is meant to happen
+// once per series; keep the returned handle.  Registering the same name and
+// labels again returns the same series.
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Total slots across all series (a histogram uses METRICS_HIST_BUCKETS + 2).
+static const int METRICS_MAX_SLOTS = 2048;
+
+// Latency histogram bucket upper bounds, in seconds.
+static const int METRICS_HIST_BUCKETS = 14;
+static const double METRICS_HIST_BOUNDS[METRICS_HIST_BUCKETS] = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 20, 40, 80};
+
+struct Counter {
+    uint32_t slot = 0;
+    void inc(uint64_t n = 1) const;
+};
+
+// Up/down value; inc() and dec() may happen on different threads.
+struct Gauge {
+    uint32_t slot = 0;
+    void inc() const { add(1); }
+    void dec() const { add(-1); }
+    void add(int64_t n) const;
+};
+
+struct Histogram {
+    uint32_t slot = 0;
+    void observe(double seconds) const;
+    void observe_ms(double ms) const { observe(ms / 1000.0); }
+};
+
+// labels is the inside of the braces, e.g. "endpoint=\"/analyze\"" (or empty).
+Counter metrics_counter(const std::string& name, const std::string& labels,
+                        const std::string& help);
+Gauge metrics_gauge(const std::string& name, const std::string& labels,
+                    const std::string& help);
+Histogram metrics_histogram(const std::string& name, const std::string& labels,
+                            const std::string& help);
+
+// All series in Prometheus text exposition format 0.0.4.
+std::string metrics_scrape();
+
+// Observes the wall time between construction and destruction.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram h)
+        : h_(h), t0_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        h_.observe(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0_).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram h_;
+    std::chrono::steady_clock::time_point t0_;
+};
+
+// Holds a gauge incremented for its lifetime (in-flight work).
+class ScopedGauge {
+public:
+    explicit ScopedGauge(Gauge g) : g_(g) { g_.inc(); }
+    ~ScopedGauge() { g_.dec(); }
+    ScopedGauge(const ScopedGauge&) = delete;
+    ScopedGauge& operator=(const ScopedGauge&) = delete;
+
+private:
+    Gauge g_;
+};
@@ -1,6 +1,8 @@
 // Generate a diagnostic HTML page showing imperfect occupancy masks.
 // For each imperfect case: debug image with board rect + FP/FN overlay + mask grid.
+// Pipeline results and per-cell stats come from the feature store.
 #include "board.h"
+#include "feature_store.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -71,12 +73,21 @@ static std::string base64_encode(const std::vector<uint8_t>& data) {
 
 int main(int argc, char* argv[]) {
     std::setbuf(stdout, nullptr);
-    if (argc < 2) {
-        std::cerr << "Usage: occ_diag <testdata_dir> [output.html]\n";
+    std::string store_path = FEATURE_STORE_DEFAULT_PATH;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--store" && i + 1 < argc) store_path = argv[++i];
+        else if (arg == "--no-store") store_path.clear();
+        else positional.push_back(arg);
+    }
+    if (positional.empty()) {
+        std::cerr << "Usage: occ_diag [--store FILE | --no-store] <testdata_dir> [output.html]\n";
         return 1;
     }
-    std::string dir = argv[1];
-    std::string outpath = argc >= 3 ? argv[2] : "occ_diag.html";
+    std::string dir = positional[0];
+    std::string outpath = positional.size() >= 2 ? positional[1] : "occ_diag.html";
+    FeatureStore store(store_path);
 
     struct CellInfo {
         float bri, con, h, s, v;
@@ -116,14 +127,14 @@ int main(int argc, char* argv[]) {
 
         std::ifstream ifs(path, std::ios::binary);
         std::vector<uint8_t> data(std::istreambuf_iterator<char>(ifs), {});
-        auto dr = process_board_image_debug(data);
+        const FeatureRecord& rec = store.get(data);
 
         int fp = 0, fn = 0;
         std::string fp_cells, fn_cells;
         bool det_occ[15][15];
         for (int r = 0; r < 15; r++)
             for (int c = 0; c < 15; c++) {
-                det_occ[r][c] = (dr.cells[r][c].letter != 0);
+                det_occ[r][c] = (rec.cells[r][c].letter != 0);
                 bool actual = gt_occ[r][c];
                 if (det_occ[r][c] && !actual) {
                     fp++;
@@ -141,12 +152,10 @@ int main(int argc, char* argv[]) {
         if (fp == 0 && fn == 0) { n_perfect++; continue; }
 
         // Draw FP/FN overlays on the debug image
-        cv::Mat dbg_img = cv::imdecode(dr.debug_png, cv::IMREAD_COLOR);
+        cv::Mat dbg_img = cv::imdecode(render_board_debug(data, rec.rect()),
+                                       cv::IMREAD_COLOR);
         if (!dbg_img.empty()) {
-            int bx = 0, by = 0, bw = 0;
-            auto pos = dr.log.find("Final: rect=");
-            if (pos != std::string::npos)
-                sscanf(dr.log.c_str() + pos, "Final: rect=%d,%d %dx%d", &bx, &by, &bw, &bw);
+            int bx = rec.board_rect[0], by = rec.board_rect[1], bw = rec.board_rect[2];
             if (bw > 0) {
                 double cw = bw / 15.0;
                 for (int r = 0; r < 15; r++) {
@@ -187,48 +196,25 @@ int main(int argc, char* argv[]) {
             std::memcpy(c.det_occ, det_occ, sizeof(det_occ));
             std::memcpy(c.gt_occ, gt_occ, sizeof(gt_occ));
 
-            // Extract per-cell stats for mouseover tooltips
-            std::memset(c.cell_info, 0, sizeof(c.cell_info));
-            cv::Mat orig_img = cv::imdecode(data, cv::IMREAD_COLOR);
-            if (!orig_img.empty()) {
-                double cellw = bw / 15.0;
-                const double inset = 0.08;
-                for (int row = 0; row < 15; row++) {
-                    for (int col = 0; col < 15; col++) {
-                        int x0 = bx + (int)(col * cellw + cellw * inset);
-                        int y0 = by + (int)(row * cellw + cellw * inset);
-                        int iw = (int)((1.0 - 2*inset) * cellw);
-                        int ih = iw;
-                        if (x0 < 0 || y0 < 0) continue;
-                        if (x0 + iw > orig_img.cols) iw = orig_img.cols - x0;
-                        if (y0 + ih > orig_img.rows) ih = orig_img.rows - y0;
-                        if (iw <= 0 || ih <= 0) continue;
-                        cv::Mat cell = orig_img(cv::Rect(x0, y0, iw, ih));
-                        // Center 60% (same as is_tile)
-                        int cx2 = iw / 5, cy2 = ih / 5;
-                        int ccw2 = iw * 3 / 5, cch2 = ih * 3 / 5;
-                        if (ccw2 <= 0 || cch2 <= 0) continue;
-                        cv::Mat center = cell(cv::Rect(cx2, cy2, ccw2, cch2));
-                        cv::Mat gray, hsvmat;
-                        cv::cvtColor(center, gray, cv::COLOR_BGR2GRAY);
-                        cv::cvtColor(center, hsvmat, cv::COLOR_BGR2HSV);
-                        cv::Scalar gm, gs;
-                        cv::meanStdDev(gray, gm, gs);
-                        cv::Scalar hm = cv::mean(hsvmat);
-                        c.cell_info[row][col] = {
-                            (float)gm[0], (float)gs[0],
-                            (float)hm[0], (float)hm[1], (float)hm[2],
-                            dr.cells[row][col].letter
-                        };
-                    }
+            // Per-cell stats for mouseover tooltips (unblurred center contrast)
+            for (int row = 0; row < 15; row++) {
+                for (int col = 0; col < 15; col++) {
+                    const CellFeatures& f = rec.features[row][col];
+                    c.cell_info[row][col] = {
+                        f.brightness, f.raw_contrast,
+                        f.center_hsv[0], f.center_hsv[1], f.center_hsv[2],
+                        rec.cells[row][col].letter
+                    };
                 }
             }
 
             cases.push_back(std::move(c));
         }
     }
-    std::fprintf(stderr, "\n%d files, %d perfect, %d imperfect\n",
-        n_files, n_perfect, (int)cases.size());
+    std::fprintf(stderr, "\n%d files, %d perfect, %d imperfect (%d from store)\n",
+        n_files, n_perfect, (int)cases.size(), store.hits());
+    if (!store.save())
+        std::fprintf(stderr, "Failed to write feature store %s\n", store_path.c_str());
 
     // Generate HTML
     std::ofstream html(outpath);
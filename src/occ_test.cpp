@@ -1,5 +1,11 @@
 // Occupancy mask accuracy: compare is_tile() results against ground truth CGP
+//
+// Usage: occ_test [--store FILE | --no-store] <testdata_dir> [filter]
+//   Pipeline results come from the feature store (default
+//   pipeline_features.bin); images are only rerun when new or when
+//   PIPELINE_VERSION, the models or CGP_TILE_HEADS / CGP_ROI_DECODE change.
 #include "board.h"
+#include "feature_store.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -40,12 +46,21 @@ static void parse_cgp_occupancy(const std::string& cgp, bool occ[15][15]) {
 
 int main(int argc, char* argv[]) {
     std::setbuf(stdout, nullptr);  // unbuffered output
-    if (argc < 2) {
-        std::cerr << "Usage: occ_test <testdata_dir> [filter]\n";
+    std::string store_path = FEATURE_STORE_DEFAULT_PATH;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--store" && i + 1 < argc) store_path = argv[++i];
+        else if (arg == "--no-store") store_path.clear();
+        else positional.push_back(arg);
+    }
+    if (positional.empty()) {
+        std::cerr << "Usage: occ_test [--store FILE | --no-store] <testdata_dir> [filter]\n";
         return 1;
     }
-    std::string dir = argv[1];
-    std::string filter = argc >= 3 ? argv[2] : "";
+    std::string dir = positional[0];
+    std::string filter = positional.size() >= 2 ? positional[1] : "";
+    FeatureStore store(store_path);
 
     struct Result {
         std::string name;
@@ -79,13 +94,13 @@ int main(int argc, char* argv[]) {
         // Run board detection
         std::ifstream ifs(path, std::ios::binary);
         std::vector<uint8_t> data(std::istreambuf_iterator<char>(ifs), {});
-        auto dr = process_board_image_debug(data);
+        const FeatureRecord& rec = store.get(data);
 
         // Compare occupancy
         int fp = 0, fn = 0, tiles = 0, empty = 0;
         for (int r = 0; r < 15; r++) {
             for (int c = 0; c < 15; c++) {
-                bool detected = (dr.cells[r][c].letter != 0);
+                bool detected = (rec.cells[r][c].letter != 0);
                 bool actual = gt_occ[r][c];
                 if (actual) tiles++;
                 else empty++;
@@ -108,7 +123,7 @@ int main(int argc, char* argv[]) {
                 std::printf("  ");
                 for (int r = 0; r < 15; r++)
                     for (int c = 0; c < 15; c++) {
-                        bool detected = (dr.cells[r][c].letter != 0);
+                        bool detected = (rec.cells[r][c].letter != 0);
                         bool actual = gt_occ[r][c];
                         if (detected && !actual)
                             std::printf(" +%c%d", 'A'+c, r+1);
@@ -121,7 +136,10 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    std::printf("\n=== Summary (%d files) ===\n", n_files);
+    if (!store.save())
+        std::fprintf(stderr, "\nFailed to write feature store %s\n", store_path.c_str());
+
+    std::printf("\n=== Summary (%d files, %d from store) ===\n", n_files, store.hits());
     std::printf("Total tiles: %d  Total empty: %d\n", grand_tiles, grand_empty);
     std::printf("False positives: %d (%.2f%% of empty)\n", grand_fp,
         grand_empty > 0 ? 100.0 * grand_fp / grand_empty : 0.0);
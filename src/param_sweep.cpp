@@ -0,0 +1,593 @@
+// Occupancy / rack threshold sweep over cached per-cell features.
+//
+// Runs the pipeline once per testdata image (in parallel) to collect the
+// measurements the occupancy filters threshold on (extract_board_features)
+// plus rack tile letters at several bottom-trim settings, optionally caching
+// them on disk.  Every combination of the threshold grid is then evaluated
+// against the CGP ground truth across all cores, and the Pareto-optimal
+// (FP, FN) settings are printed per theme.
+//
+// Usage: param_sweep [-j N] [--cache FILE] [--set name=v1,v2,..]... <testdata_dir> [filter]
+//
+// Grid axes (defaults in brackets are the values board.cpp uses today):
+//   contrast [28]   is_tile center contrast minimum
+//   bri      [50]   is_tile brightness minimum
+//   pink_s   [25]   pink/red premium overlay: S above
+//   pink_v   [160]  pink/red premium overlay: V above (corner and center)
+//   blue_con [55]   blue premium overlay: reject below this contrast
+//   gray_s   [35]   gray overlay: S below
+//   gray_v   [200]  gray overlay: V above
+//   cdist_c  [20]   Pass 1b: corner distance at or below which edges are checked
+//   bgrad_lo [10]   Pass 1b: border gradient at or below which to reject
+//   bgrad_hi [20]   Pass 1b: border gradient at or below which to check center
+//   cdist    [40]   Pass 1b: center distance below which to reject
+//   lvar     [1]    Pass 2b: scale on the Laplacian variance tiers
+//   ratio    [8000] Pass 2b: top1/top2 score ratio tier
+//
+// The rack sweep classifies the primary crop only (no multi-crop averaging,
+// pool refinement or alphagram tiebreak), so its absolute accuracy is below
+// eval_local's; it is meant for comparing trims against each other.
+#include "board.h"
+#include "rack.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <opencv2/imgcodecs.hpp>
+
+namespace fs = std::filesystem;
+
+static_assert(std::is_trivially_copyable_v<CellFeatures>,
+              "CellFeatures is cached as raw bytes");
+
+static const char CACHE_MAGIC[8] = {'C', 'G', 'P', 'S', 'W', 'E', 'E', 'P'};
+static const uint32_t CACHE_VERSION = 2;  // bump when CellFeatures or RACK_TRIMS change
+
+static const int RACK_TRIMS[] = {5, 10, 15, 20, 25};
+static const int N_TRIMS = sizeof(RACK_TRIMS) / sizeof(RACK_TRIMS[0]);
+
+// Parse CGP board section into a 15x15 occupancy grid.
+static void parse_cgp_occupancy(const std::string& cgp, bool occ[15][15]) {
+    std::memset(occ, 0, sizeof(bool) * 225);
+    auto sp = cgp.find(' ');
+    std::string board = (sp != std::string::npos) ? cgp.substr(0, sp) : cgp;
+    int row = 0, col = 0;
+    for (size_t i = 0; i < board.size() && row < 15; i++) {
+        char ch = board[i];
+        if (ch == '/') { row++; col = 0; }
+        else if (ch >= '0' && ch <= '9') {
+            int n = ch - '0';
+            while (i + 1 < board.size() && board[i+1] >= '0' && board[i+1] <= '9')
+                n = n * 10 + (board[++i] - '0');
+            col += n;
+        } else if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z')) {
+            if (row < 15 && col < 15) occ[row][col] = true;
+            col++;
+        }
+    }
+}
+
+// Classify board theme from filename.
+static std::string classify_theme(const std::string& name) {
+    if (name.find("_memento") != std::string::npos) return "memento";
+    if (name.find("_mahogany_desktop") != std::string::npos) return "mahogany_desk";
+    if (name.find("_mahogany_mobile") != std::string::npos) return "mahogany_mob";
+    if (name.find("_light_desktop") != std::string::npos) return "light_desk";
+    if (name.find("_dark_desktop") != std::string::npos) return "dark_desk";
+    if (name.find("_light_mobile") != std::string::npos) return "light_mob";
+    if (name.find("_dark_mobile") != std::string::npos) return "dark_mob";
+    return "original";
+}
+
+// Everything the sweep needs from one image.
+struct ImageRecord {
+    std::string name;
+    uint64_t file_size = 0;
+    bool valid = false;
+    bool gt[15][15] = {};
+    BoardFeatures feat;
+    std::string rack_expected;
+    std::vector<uint8_t> rack_blank;          // per detected tile
+    std::vector<char> rack_letters;           // [tile * N_TRIMS + trim]
+};
+
+static void compute_record(const std::string& path, const std::string& cgp_path,
+                           ImageRecord& rec) {
+    std::ifstream cgp_ifs(cgp_path);
+    std::string cgp_line;
+    std::getline(cgp_ifs, cgp_line);
+    parse_cgp_occupancy(cgp_line, rec.gt);
+    rec.rack_expected = parse_cgp_rack(cgp_line);
+
+    std::ifstream ifs(path, std::ios::binary);
+    std::vector<uint8_t> data(std::istreambuf_iterator<char>(ifs), {});
+    rec.valid = extract_board_features(data, rec.feat);
+    if (!rec.valid || rec.feat.cell_size <= 0 || rec.rack_expected.empty()) return;
+
+    const cv::Rect& br = rec.feat.board_rect;
+    bool is_light = detect_board_mode(data, br.x, br.y, rec.feat.cell_size);
+    auto tiles = detect_rack_tiles(data, br.x, br.y, rec.feat.cell_size, is_light);
+    int n = std::min(static_cast<int>(tiles.size()), 7);
+    rec.rack_blank.assign(n, 0);
+    rec.rack_letters.assign(n * N_TRIMS, '?');
+    for (int i = 0; i < n; i++) {
+        if (tiles[i].is_blank) { rec.rack_blank[i] = 1; continue; }
+        cv::Mat crop = cv::imdecode(tiles[i].png, cv::IMREAD_COLOR);
+        if (crop.empty()) continue;
+        for (int t = 0; t < N_TRIMS; t++) {
+            CellResult cr = classify_single_tile_ex(prepare_rack_crop(crop, RACK_TRIMS[t]), 0);
+            rec.rack_letters[i * N_TRIMS + t] = static_cast<char>(
+                std::toupper(static_cast<unsigned char>(cr.letter)));
+        }
+    }
+}
+
+// ── Feature cache ───────────────────────────────────────────────────────────
+
+template <typename T>
+static void put(std::ostream& os, const T& v) {
+    os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+template <typename T>
+static bool get(std::istream& is, T& v) {
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+static void put_str(std::ostream& os, const std::string& s) {
+    put(os, static_cast<uint32_t>(s.size()));
+    os.write(s.data(), s.size());
+}
+static bool get_str(std::istream& is, std::string& s) {
+    uint32_t n = 0;
+    if (!get(is, n) || n > (1u << 20)) return false;
+    s.resize(n);
+    return static_cast<bool>(is.read(s.data(), n));
+}
+
+static bool save_cache(const std::string& path, const std::vector<ImageRecord>& recs) {
+    std::ofstream os(path, std::ios::binary);
+    if (!os) return false;
+    os.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    put(os, CACHE_VERSION);
+    put(os, PIPELINE_VERSION);
+    put(os, static_cast<uint32_t>(recs.size()));
+    for (const auto& r : recs) {
+        put_str(os, r.name);
+        put(os, r.file_size);
+        put(os, static_cast<uint8_t>(r.valid));
+        os.write(reinterpret_cast<const char*>(r.gt), sizeof(r.gt));
+        const BoardFeatures& f = r.feat;
+        int32_t geo[5] = {f.board_rect.x, f.board_rect.y, f.board_rect.width,
+                          f.board_rect.height, f.cell_size};
+        os.write(reinterpret_cast<const char*>(geo), sizeof(geo));
+        put(os, static_cast<uint8_t>(f.is_light));
+        put(os, static_cast<uint8_t>(f.cnn));
+        os.write(reinterpret_cast<const char*>(f.cells), sizeof(f.cells));
+        put_str(os, r.rack_expected);
+        put_str(os, std::string(r.rack_blank.begin(), r.rack_blank.end()));
+        put_str(os, std::string(r.rack_letters.begin(), r.rack_letters.end()));
+    }
+    return static_cast<bool>(os);
+}
+
+static std::map<std::string, ImageRecord> load_cache(const std::string& path) {
+    std::map<std::string, ImageRecord> out;
+    std::ifstream is(path, std::ios::binary);
+    char magic[8];
+    uint32_t version = 0, pipeline = 0, n = 0;
+    if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, CACHE_MAGIC, 8) != 0
+        || !get(is, version) || version != CACHE_VERSION
+        || !get(is, pipeline) || pipeline != PIPELINE_VERSION || !get(is, n))
+        return out;
+    for (uint32_t i = 0; i < n; i++) {
+        ImageRecord r;
+        uint8_t valid = 0, light = 0, cnn = 0;
+        int32_t geo[5];
+        std::string blank, letters;
+        if (!get_str(is, r.name) || !get(is, r.file_size) || !get(is, valid)
+            || !is.read(reinterpret_cast<char*>(r.gt), sizeof(r.gt))
+            || !is.read(reinterpret_cast<char*>(geo), sizeof(geo))
+            || !get(is, light) || !get(is, cnn)
+            || !is.read(reinterpret_cast<char*>(r.feat.cells), sizeof(r.feat.cells))
+            || !get_str(is, r.rack_expected) || !get_str(is, blank)
+            || !get_str(is, letters))
+            return {};
+        r.valid = valid;
+        r.feat.board_rect = cv::Rect(geo[0], geo[1], geo[2], geo[3]);
+        r.feat.cell_size = geo[4];
+        r.feat.is_light = light;
+        r.feat.cnn = cnn;
+        r.rack_blank.assign(blank.begin(), blank.end());
+        r.rack_letters.assign(letters.begin(), letters.end());
+        std::string key = r.name;
+        out[key] = std::move(r);
+    }
+    return out;
+}
+
+// ── Occupancy decision ──────────────────────────────────────────────────────
+
+struct Params {
+    float contrast = 28, bri = 50;
+    float pink_s = 25, pink_v = 160, blue_con = 55, gray_s = 35, gray_v = 200;
+    float cdist_c = 20, bgrad_lo = 10, bgrad_hi = 20, cdist = 40;
+    float lvar = 1, ratio = 8000;
+};
+
+struct Axis {
+    const char* name;
+    float Params::* field;
+    std::vector<float> values;
+};
+
+// Flattened cell with everything the decision reads.
+struct SweepCell {
+    CellFeatures f;
+    float top1, top2;
+    bool light, gt;
+    int theme;
+};
+
+// Mirrors is_tile(), the Pass 1b board-color filter and the Pass 2b tooltip
+// filter in board.cpp with every threshold taken from `P`.  Keep in sync.
+static bool occupied(const SweepCell& sc, const Params& P) {
+    const CellFeatures& f = sc.f;
+    auto pink = [&](const float* hsv) {
+        return (hsv[0] < 12 || hsv[0] > 155) && hsv[1] > P.pink_s && hsv[2] > P.pink_v;
+    };
+    if (sc.light && pink(f.corner_hsv)) return false;
+    if (f.brightness < P.bri || f.contrast < P.contrast) return false;
+    if (sc.light) {
+        const float* hsv = f.center_hsv;
+        if (pink(hsv)) return false;
+        bool blue = (hsv[0] >= 85 && hsv[0] <= 120 && hsv[1] > 30 && hsv[2] > 200);
+        if (blue && f.contrast < P.blue_con) return false;
+        if (hsv[1] < P.gray_s && hsv[2] > P.gray_v) return false;
+    }
+
+    if (f.corner_dist >= 0 && f.corner_dist <= P.cdist_c) {
+        if (f.border_grad <= P.bgrad_lo) return false;
+        if (f.border_grad <= P.bgrad_hi && f.center_dist < P.cdist) return false;
+    }
+
+    // '?' cells (top score < 0.2) skip the tooltip filter.
+    if (f.premium == 0 || f.lapl_var < 0 || sc.top1 < 0.2f) return true;
+    double conf = sc.top1, lv = f.lapl_var / P.lvar;
+    double ratio = (sc.top2 > 0) ? conf / sc.top2 : 1e15;
+    if (conf < 0.95 && lv > 50000) return false;
+    if (conf < 0.999 && lv > 100000) return false;
+    if (conf < 0.9998 && lv > 200000) return false;
+    if (ratio < P.ratio && lv > 150000) return false;
+    return true;
+}
+
+static std::vector<float> parse_float_list(const std::string& s) {
+    std::vector<float> out;
+    std::stringstream ss(s);
+    std::string tok;
+    while (std::getline(ss, tok, ','))
+        if (!tok.empty()) out.push_back(static_cast<float>(std::atof(tok.c_str())));
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    std::setbuf(stdout, nullptr);
+    int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string cache_path;
+    std::vector<std::string> positional;
+
+    // Default grid: a few steps either side of today's value on the axes
+    // most often retuned; the rest are fixed unless --set widens them.
+    std::vector<Axis> axes = {
+        {"contrast", &Params::contrast, {22, 25, 28, 31, 34}},
+        {"bri",      &Params::bri,      {50}},
+        {"pink_s",   &Params::pink_s,   {25}},
+        {"pink_v",   &Params::pink_v,   {150, 160, 170}},
+        {"blue_con", &Params::blue_con, {45, 55, 65}},
+        {"gray_s",   &Params::gray_s,   {25, 35, 45}},
+        {"gray_v",   &Params::gray_v,   {200}},
+        {"cdist_c",  &Params::cdist_c,  {15, 20, 25}},
+        {"bgrad_lo", &Params::bgrad_lo, {8, 10, 12}},
+        {"bgrad_hi", &Params::bgrad_hi, {16, 20, 24}},
+        {"cdist",    &Params::cdist,    {30, 40, 50}},
+        {"lvar",     &Params::lvar,     {0.5f, 1, 2}},
+        {"ratio",    &Params::ratio,    {8000}},
+    };
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            n_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else if (arg == "--set" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            auto eq = spec.find('=');
+            auto it = std::find_if(axes.begin(), axes.end(), [&](const Axis& a) {
+                return eq != std::string::npos && spec.compare(0, eq, a.name) == 0
+                       && std::strlen(a.name) == eq;
+            });
+            std::vector<float> vals = (eq != std::string::npos)
+                ? parse_float_list(spec.substr(eq + 1)) : std::vector<float>{};
+            if (it == axes.end() || vals.empty()) {
+                std::cerr << "Bad --set " << spec << "\n";
+                return 1;
+            }
+            it->values = vals;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.empty()) {
+        std::cerr << "Usage: param_sweep [-j N] [--cache FILE] [--set name=v1,v2,..]"
+                     " <testdata_dir> [filter]\n";
+        return 1;
+    }
+    std::string dir = positional[0];
+    std::string filter = positional.size() >= 2 ? positional[1] : "";
+
+    struct WorkItem { std::string path, name, cgp_path; uint64_t size; };
+    std::vector<WorkItem> work;
+    for (auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        if (ext != ".png" && ext != ".jpg") continue;
+        std::string name = entry.path().stem().string();
+        if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+        std::string cgp_path = dir + "/" + name + ".cgp";
+        if (!fs::exists(cgp_path)) continue;
+        work.push_back({entry.path().string(), name, cgp_path,
+                        static_cast<uint64_t>(entry.file_size())});
+    }
+    std::sort(work.begin(), work.end(),
+              [](const WorkItem& a, const WorkItem& b) { return a.name < b.name; });
+    if (work.empty()) {
+        std::cerr << "No image/CGP pairs in " << dir << "\n";
+        return 1;
+    }
+
+    // ── Phase 1: features (cached by name + file size) ──
+    auto t0 = std::chrono::steady_clock::now();
+    auto cached = cache_path.empty() ? std::map<std::string, ImageRecord>{}
+                                     : load_cache(cache_path);
+    std::vector<ImageRecord> recs(work.size());
+    std::vector<int> todo;
+    for (size_t i = 0; i < work.size(); i++) {
+        auto it = cached.find(work[i].name);
+        if (it != cached.end() && it->second.file_size == work[i].size) {
+            recs[i] = std::move(it->second);
+        } else {
+            recs[i].name = work[i].name;
+            recs[i].file_size = work[i].size;
+            todo.push_back(static_cast<int>(i));
+        }
+    }
+    if (!todo.empty()) {
+        int nt = std::min(n_threads, static_cast<int>(todo.size()));
+        std::vector<std::thread> threads(nt);
+        std::atomic<int> n_done{0};
+        for (int t = 0; t < nt; t++) {
+            threads[t] = std::thread([&, t]() {
+                for (int k = t; k < static_cast<int>(todo.size()); k += nt) {
+                    const WorkItem& wi = work[todo[k]];
+                    compute_record(wi.path, wi.cgp_path, recs[todo[k]]);
+                    int done = ++n_done;
+                    std::fprintf(stderr, "\r%d/%d images...", done,
+                                 static_cast<int>(todo.size()));
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+        std::fprintf(stderr, "\n");
+        if (!cache_path.empty() && !save_cache(cache_path, recs))
+            std::fprintf(stderr, "Failed to write cache %s\n", cache_path.c_str());
+    }
+    double feat_secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - t0).count();
+    std::printf("Features: %d images (%d computed, %d cached) in %.1f s\n",
+                static_cast<int>(recs.size()), static_cast<int>(todo.size()),
+                static_cast<int>(recs.size() - todo.size()), feat_secs);
+
+    // Theme table; index 0 aggregates everything.
+    std::vector<std::string> themes = {"all"};
+    std::vector<int> rec_theme(recs.size(), 0);
+    for (size_t i = 0; i < recs.size(); i++) {
+        std::string th = classify_theme(recs[i].name);
+        auto it = std::find(themes.begin(), themes.end(), th);
+        rec_theme[i] = static_cast<int>(it - themes.begin());
+        if (it == themes.end()) themes.push_back(th);
+    }
+    int n_themes = static_cast<int>(themes.size());
+
+    std::vector<SweepCell> cells;
+    std::vector<int> theme_tiles(n_themes, 0), theme_empty(n_themes, 0);
+    std::vector<int> theme_images(n_themes, 0);
+    for (size_t i = 0; i < recs.size(); i++) {
+        const ImageRecord& r = recs[i];
+        if (!r.valid) continue;
+        theme_images[0]++;
+        theme_images[rec_theme[i]]++;
+        for (int row = 0; row < 15; row++)
+            for (int col = 0; col < 15; col++) {
+                SweepCell sc;
+                sc.f = r.feat.cells[row][col];
+                float s[26];
+                std::memcpy(s, sc.f.scores, sizeof(s));
+                std::partial_sort(s, s + 2, s + 26, std::greater<float>());
+                sc.top1 = s[0];
+                sc.top2 = s[1];
+                sc.light = r.feat.is_light;
+                sc.gt = r.gt[row][col];
+                sc.theme = rec_theme[i];
+                cells.push_back(sc);
+                (sc.gt ? theme_tiles : theme_empty)[0]++;
+                (sc.gt ? theme_tiles : theme_empty)[sc.theme]++;
+            }
+    }
+
+    // ── Phase 2: evaluate the grid ──
+    // Combination k decodes as mixed-radix digits over the axes.
+    size_t n_combos = 1;
+    for (const auto& a : axes) n_combos *= a.values.size();
+    auto decode = [&](size_t k, Params& P, std::vector<int>* digits) {
+        for (size_t a = axes.size(); a-- > 0;) {
+            size_t n = axes[a].values.size();
+            int d = static_cast<int>(k % n);
+            k /= n;
+            P.*(axes[a].field) = axes[a].values[d];
+            if (digits) (*digits)[a] = d;
+        }
+    };
+
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<int> fp(n_combos * n_themes, 0), fn(n_combos * n_themes, 0);
+    {
+        int nt = static_cast<int>(std::min<size_t>(n_threads, n_combos));
+        std::vector<std::thread> threads(nt);
+        for (int t = 0; t < nt; t++) {
+            threads[t] = std::thread([&, t]() {
+                Params P;
+                for (size_t k = t; k < n_combos; k += nt) {
+                    decode(k, P, nullptr);
+                    int* cfp = &fp[k * n_themes];
+                    int* cfn = &fn[k * n_themes];
+                    for (const SweepCell& sc : cells) {
+                        bool det = occupied(sc, P);
+                        if (det && !sc.gt) cfp[sc.theme]++;
+                        if (!det && sc.gt) cfn[sc.theme]++;
+                    }
+                    for (int th = 1; th < n_themes; th++) {
+                        cfp[0] += cfp[th];
+                        cfn[0] += cfn[th];
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+    }
+    double sweep_secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - t1).count();
+    std::printf("Sweep: %zu settings x %zu cells in %.2f s (%d threads)\n",
+                n_combos, cells.size(), sweep_secs, n_threads);
+
+    // Baseline: the thresholds board.cpp uses today.
+    const Params current;
+    std::vector<int> cur_fp(n_themes, 0), cur_fn(n_themes, 0);
+    for (const SweepCell& sc : cells) {
+        bool det = occupied(sc, current);
+        if (det && !sc.gt) { cur_fp[sc.theme]++; cur_fp[0]++; }
+        if (!det && sc.gt) { cur_fn[sc.theme]++; cur_fn[0]++; }
+    }
+
+    // Among settings with equal (FP, FN), report the one closest to today's
+    // values (fewest grid steps away).
+    std::vector<int> varied;
+    for (size_t a = 0; a < axes.size(); a++)
+        if (axes[a].values.size() > 1) varied.push_back(static_cast<int>(a));
+    auto steps_from_current = [&](const std::vector<int>& digits) {
+        int steps = 0;
+        for (int a : varied) {
+            float cur = current.*(axes[a].field);
+            int cur_idx = 0;
+            for (size_t d = 0; d < axes[a].values.size(); d++)
+                if (std::abs(axes[a].values[d] - cur)
+                    < std::abs(axes[a].values[cur_idx] - cur))
+                    cur_idx = static_cast<int>(d);
+            steps += std::abs(digits[a] - cur_idx);
+        }
+        return steps;
+    };
+
+    // ── Pareto table per theme ──
+    for (int th = 0; th < n_themes; th++) {
+        std::printf("\n=== %s (%d images, %d tiles, %d empty) current FP=%d FN=%d ===\n",
+                    themes[th].c_str(), theme_images[th], theme_tiles[th],
+                    theme_empty[th], cur_fp[th], cur_fn[th]);
+        struct Point { int fp, fn, steps; size_t k; };
+        std::vector<Point> pts;
+        pts.reserve(n_combos);
+        std::vector<int> digits(axes.size());
+        Params P;
+        for (size_t k = 0; k < n_combos; k++) {
+            decode(k, P, &digits);
+            pts.push_back({fp[k * n_themes + th], fn[k * n_themes + th],
+                           steps_from_current(digits), k});
+        }
+        std::sort(pts.begin(), pts.end(), [](const Point& a, const Point& b) {
+            if (a.fp != b.fp) return a.fp < b.fp;
+            if (a.fn != b.fn) return a.fn < b.fn;
+            return a.steps < b.steps;
+        });
+
+        std::printf("  %4s %4s %5s", "FP", "FN", "steps");
+        for (int a : varied) std::printf(" %8s", axes[a].name);
+        std::printf("\n");
+        int best_fn = -1;
+        for (const Point& p : pts) {
+            if (best_fn >= 0 && p.fn >= best_fn) continue;
+            best_fn = p.fn;
+            decode(p.k, P, nullptr);
+            std::printf("  %4d %4d %5d", p.fp, p.fn, p.steps);
+            for (int a : varied) std::printf(" %8g", P.*(axes[a].field));
+            std::printf("\n");
+        }
+    }
+
+    // ── Rack bottom-trim sweep ──
+    std::vector<int> rack_total(n_themes, 0), rack_cases(n_themes, 0);
+    std::vector<int> rack_correct(n_themes * N_TRIMS, 0), rack_perfect(n_themes * N_TRIMS, 0);
+    for (size_t i = 0; i < recs.size(); i++) {
+        const ImageRecord& r = recs[i];
+        if (r.rack_blank.empty()) continue;
+        std::string exp_sorted = sort_rack(r.rack_expected);
+        int n = static_cast<int>(r.rack_blank.size());
+        for (int th : {0, rec_theme[i]}) {
+            rack_total[th] += static_cast<int>(exp_sorted.size());
+            rack_cases[th]++;
+        }
+        for (int t = 0; t < N_TRIMS; t++) {
+            std::string got;
+            for (int ti = 0; ti < n; ti++) {
+                char ch = r.rack_blank[ti] ? '?' : r.rack_letters[ti * N_TRIMS + t];
+                got += (ch >= 'A' && ch <= 'Z') ? ch : '?';
+            }
+            std::string got_sorted = sort_rack(got);
+            int correct = 0;
+            size_t ei = 0, gi = 0;
+            while (ei < exp_sorted.size() && gi < got_sorted.size()) {
+                if (exp_sorted[ei] == got_sorted[gi]) { correct++; ei++; gi++; }
+                else if (exp_sorted[ei] < got_sorted[gi]) ei++;
+                else gi++;
+            }
+            for (int th : {0, rec_theme[i]}) {
+                rack_correct[th * N_TRIMS + t] += correct;
+                if (got_sorted == exp_sorted) rack_perfect[th * N_TRIMS + t]++;
+            }
+        }
+    }
+    std::printf("\n=== Rack bottom trim (primary crop only; current 15%%) ===\n");
+    std::printf("  %-14s %6s", "theme", "racks");
+    for (int t = 0; t < N_TRIMS; t++) std::printf("   trim%2d%%", RACK_TRIMS[t]);
+    std::printf("\n");
+    for (int th = 0; th < n_themes; th++) {
+        if (rack_cases[th] == 0) continue;
+        std::printf("  %-14s %6d", themes[th].c_str(), rack_cases[th]);
+        for (int t = 0; t < N_TRIMS; t++)
+            std::printf("  %3d/%-4d", rack_correct[th * N_TRIMS + t], rack_total[th]);
+        std::printf("\n  %-14s %6s", "", "perfect");
+        for (int t = 0; t < N_TRIMS; t++)
+            std::printf("  %8d", rack_perfect[th * N_TRIMS + t]);
+        std::printf("\n");
+    }
+}
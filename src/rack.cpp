@@ -33,7 +33,10 @@ bool detect_board_mode(const std::vector<uint8_t>& image_data,
                 const_cast<uint8_t*>(image_data.data()));
     cv::Mat img = cv::imdecode(raw, cv::IMREAD_COLOR);
     if (img.empty()) return false;
+    return detect_board_mode(img, bx, by, cell_sz);
+}
 
+bool detect_board_mode(const cv::Mat& img, int bx, int by, int cell_sz) {
     cv::Mat hsv;
     cv::cvtColor(img, hsv, cv::COLOR_BGR2HSV);
 
@@ -58,13 +61,13 @@ bool detect_board_mode(const std::vector<uint8_t>& image_data,
 // Prepare a rack tile crop for CNN classification:
 // 1. Adaptive bottom trim (capped at 25%)
 // 2. Square the crop: center-crop if wide, pad with border replication if tall
-static cv::Mat prepare_rack_crop(const cv::Mat& crop) {
+cv::Mat prepare_rack_crop(const cv::Mat& crop, int trim_pct) {
     cv::Mat gray;
     cv::cvtColor(crop, gray, cv::COLOR_BGR2GRAY);
 
     // Adaptive bottom trim: detect uniform-brightness bars at bottom
     // (e.g., memento score margin bar). Cap at 25% to avoid trimming letter content.
-    int trim_bot = crop.rows * 15 / 100;
+    int trim_bot = crop.rows * trim_pct / 100;
     int max_trim = crop.rows / 4;  // cap at 25%
     for (int y = crop.rows - 1; y > crop.rows / 2; y--) {
         cv::Mat row_data = gray.row(y);
@@ -188,6 +191,33 @@ CellResult classify_rack_tile_full(const RackTile& rt) {
     return cr;
 }
 
+RackRead read_rack(const cv::Mat& bgr, const cv::Rect& board_rect, int cell_sz) {
+    RackRead rr;
+    rr.board_rect = board_rect;
+    rr.cell_size = cell_sz;
+    rr.is_light = detect_board_mode(bgr, board_rect.x, board_rect.y, cell_sz);
+    rr.tiles = detect_rack_tiles(bgr, board_rect.x, board_rect.y, cell_sz, rr.is_light);
+    rr.n = std::min(static_cast<int>(rr.tiles.size()), 7);
+    for (int i = 0; i < rr.n; i++)
+        rr.results[i] = classify_rack_tile_full(rr.tiles[i]);
+    return rr;
+}
+
+RackRead read_rack(const std::vector<uint8_t>& image_data,
+                   const cv::Rect& board_rect, int cell_sz) {
+    cv::Mat raw(1, static_cast<int>(image_data.size()), CV_8UC1,
+                const_cast<uint8_t*>(image_data.data()));
+    cv::Mat img = cv::imdecode(raw, cv::IMREAD_COLOR);
+    if (img.empty()) {
+        // Same as the separate calls: dark mode, no tiles.
+        RackRead rr;
+        rr.board_rect = board_rect;
+        rr.cell_size = cell_sz;
+        return rr;
+    }
+    return read_rack(img, board_rect, cell_sz);
+}
+
 void refine_rack(CellResult rack_results[], int n_tiles,
                  const CellResult board_cells[15][15]) {
     if (n_tiles <= 0) return;
@@ -361,12 +391,19 @@ std::vector<RackTile> detect_rack_tiles(
     int bx, int by, int cell_sz,
     bool is_light_mode)
 {
-    std::vector<RackTile> tiles;
     cv::Mat raw(1, static_cast<int>(image_data.size()), CV_8UC1,
                 const_cast<uint8_t*>(image_data.data()));
     cv::Mat img = cv::imdecode(raw, cv::IMREAD_COLOR);
-    if (img.empty()) return tiles;
+    if (img.empty()) return {};
+    return detect_rack_tiles(img, bx, by, cell_sz, is_light_mode);
+}
 
+std::vector<RackTile> detect_rack_tiles(
+    const cv::Mat& img,
+    int bx, int by, int cell_sz,
+    bool is_light_mode)
+{
+    std::vector<RackTile> tiles;
     int board_bottom = by + 15 * cell_sz;
     int search_top = board_bottom + cell_sz / 3;
     int search_bottom = std::min(img.rows, board_bottom + cell_sz * 5 / 2);
@@ -784,7 +821,8 @@ std::vector<RackTile> detect_rack_tiles(
 }
 
 void draw_rack_debug(std::vector<uint8_t>& debug_png,
-                     const std::vector<RackTile>& rack_tiles)
+                     const std::vector<RackTile>& rack_tiles,
+                     cv::Point origin)
 {
     if (rack_tiles.empty() || debug_png.empty()) return;
     cv::Mat raw(1, static_cast<int>(debug_png.size()), CV_8UC1,
@@ -796,7 +834,7 @@ void draw_rack_debug(std::vector<uint8_t>& debug_png,
         cv::Scalar color = rt.is_blank
             ? cv::Scalar(255, 0, 255)
             : cv::Scalar(0, 255, 255);
-        cv::rectangle(img, rt.rect, color, 2);
+        cv::rectangle(img, rt.rect - origin, color, 2);
     }
 
     std::vector<uint8_t> out;
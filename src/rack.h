@@ -27,16 +27,49 @@ std::string sort_rack(const std::string& rack);
 // Detect whether the board is in light mode or dark mode.
 bool detect_board_mode(const std::vector<uint8_t>& image_data,
                        int bx, int by, int cell_sz);
+bool detect_board_mode(const cv::Mat& bgr, int bx, int by, int cell_sz);
 
 // Detect rack tiles below the board.
 std::vector<RackTile> detect_rack_tiles(
     const std::vector<uint8_t>& image_data,
     int bx, int by, int cell_sz, bool is_light_mode);
+std::vector<RackTile> detect_rack_tiles(
+    const cv::Mat& bgr, int bx, int by, int cell_sz, bool is_light_mode);
+
+// Prepare a decoded rack tile crop for the CNN: trim trim_pct% off the
+// bottom (more if a uniform bar is found there, up to 25%), then square it.
+cv::Mat prepare_rack_crop(const cv::Mat& crop, int trim_pct = 15);
 
 // Classify a rack tile: decode PNG, trim bottom 15%, center-crop to square,
 // classify with CNN. Returns full CellResult (including top-5 candidates).
 CellResult classify_rack_tile_full(const RackTile& rt);
 
+// Everything about the rack that needs only the board rect, not the board's
+// letters: mode, tile detection and the raw per-tile CNN reads.  Finish with
+// refine_rack() and alphagram_tiebreak() once the board cells are known.
+struct RackRead {
+    cv::Rect board_rect;
+    int cell_size = 0;        // 0: not read
+    bool is_light = false;    // detect_board_mode()
+    std::vector<RackTile> tiles;
+    CellResult results[7] = {};
+    int n = 0;                // classified tiles, min(tiles.size(), 7)
+
+    bool matches(const cv::Rect& rect, int cs) const {
+        return cell_size > 0 && cell_size == cs && board_rect == rect;
+    }
+
+    // Move to screenshot coordinates after reading from an ROI-decoded band
+    // (DebugResult::origin).
+    void translate(cv::Point origin) {
+        board_rect += origin;
+        for (RackTile& t : tiles) t.rect += origin;
+    }
+};
+RackRead read_rack(const cv::Mat& bgr, const cv::Rect& board_rect, int cell_sz);
+RackRead read_rack(const std::vector<uint8_t>& image_data,
+                   const cv::Rect& board_rect, int cell_sz);
+
 // Refine rack classification using remaining tile pool constraints.
 void refine_rack(CellResult rack_results[], int n_tiles,
                  const CellResult board_cells[15][15]);
@@ -44,6 +77,8 @@ void refine_rack(CellResult rack_results[], int n_tiles,
 // Alphagram tiebreaker: prefer top-5 candidates that maintain sorted order.
 void alphagram_tiebreak(CellResult rack_results[], int n_tiles);
 
-// Draw rack tile detections on the debug image.
+// Draw rack tile detections on the debug image, which starts at `origin` in
+// the screenshot (DebugResult::origin).
 void draw_rack_debug(std::vector<uint8_t>& debug_png,
-                     const std::vector<RackTile>& rack_tiles);
+                     const std::vector<RackTile>& rack_tiles,
+                     cv::Point origin = {});
@@ -0,0 +1,107 @@
+#include "scratch_arena.h"
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+// Reusable first block of the outermost arena on each thread.  Grown to the
+// largest request seen, up to a cap so one huge screenshot does not pin
+// memory on every worker thread forever.
+static const size_t ARENA_INITIAL_BLOCK = 1 << 20;
+static const size_t ARENA_MAX_BLOCK = 32 << 20;
+
+static thread_local std::vector<std::byte> t_block;
+static thread_local bool t_block_busy = false;
+static thread_local ScratchArena* t_current = nullptr;
+
+// ---------------------------------------------------------------------------
+// ScratchArena
+// ---------------------------------------------------------------------------
+
+ScratchArena::BlockLease::BlockLease() {
+    if (t_block_busy) return;  // nested arena: plain heap chunks
+    t_block_busy = true;
+    if (t_block.empty()) t_block.resize(ARENA_INITIAL_BLOCK);
+    data = t_block.data();
+    size = t_block.size();
+}
+
+ScratchArena::BlockLease::~BlockLease() {
+    if (!data) return;
+    size_t want = std::min(high_water + high_water / 4, ARENA_MAX_BLOCK);
+    if (want > t_block.size()) {
+        t_block.clear();
+        t_block.shrink_to_fit();
+        t_block.resize(want);
+    }
+    t_block_busy = false;
+}
+
+ScratchArena::ScratchArena()
+    : prev_(t_current), counted_(block_.data, block_.size), mats_(&counted_) {
+    t_current = this;
+}
+
+ScratchArena::~ScratchArena() {
+    t_current = prev_;
+    block_.high_water = used();
+}
+
+size_t ScratchArena::used() const { return counted_.used(); }
+
+ScratchArena::Resource::Resource(void* buffer, size_t size)
+    : mono_(buffer ? std::pmr::monotonic_buffer_resource(buffer, size)
+                   : std::pmr::monotonic_buffer_resource(ARENA_INITIAL_BLOCK)) {}
+
+size_t ScratchArena::Resource::used() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return used_;
+}
+
+void* ScratchArena::Resource::do_allocate(size_t bytes, size_t align) {
+    std::lock_guard<std::mutex> lock(mu_);
+    used_ += bytes + align;
+    return mono_.allocate(bytes, align);
+}
+
+// Same layout rules as OpenCV's StdMatAllocator.
+cv::UMatData* ScratchArena::MatAlloc::allocate(int dims, const int* sizes, int type,
+                                               void* data0, size_t* step,
+                                               cv::AccessFlag, cv::UMatUsageFlags) const {
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+    void* data = data0 ? data0 : res_->allocate(std::max<size_t>(total, 1), 64);
+    auto* u = new (res_->allocate(sizeof(cv::UMatData), alignof(cv::UMatData)))
+        cv::UMatData(this);
+    u->data = u->origdata = static_cast<unsigned char*>(data);
+    u->size = total;
+    if (data0) u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+}
+
+void ScratchArena::MatAlloc::deallocate(cv::UMatData* u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    u->~UMatData();
+}
+
+// ---------------------------------------------------------------------------
+
+std::pmr::memory_resource* scratch_resource() {
+    return t_current ? t_current->resource() : std::pmr::get_default_resource();
+}
+
+cv::MatAllocator* scratch_mat_allocator() {
+    return t_current ? t_current->mat_allocator() : nullptr;
+}
@@ -0,0 +1,99 @@
+#pragma once
+// Per-request scratch memory for the board pipeline.
+//
+// One image allocates hundreds of short-lived buffers (225 cell crops, work
+// lists, edge projections).  A ScratchArena hands them out from a monotonic
+// buffer and frees everything at once when it goes out of scope.  The
+// outermost arena on a thread starts from a thread-local block that is kept
+// between requests and grown to the high-water mark, so a warm thread
+// serves a whole request without touching malloc.
+//
+// Pipeline code does not take the arena as a parameter: constructing one
+// makes it the thread's current arena until it is destroyed, and
+//   scratch_resource()       std::pmr resource for scratch containers
+//   scratch_mat_allocator()  cv::MatAllocator for scratch cv::Mats; assign
+//                            it to Mat::allocator before the Mat is created
+//                            (clone() ignores it, copyTo() honours it)
+// return the current arena's, or the default heap ones without an arena.
+//
+// Anything allocated from an arena must be destroyed before it: declare the
+// arena before the scratch it serves, and never hand arena memory to results,
+// caches or other threads that outlive the call.
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+#include <opencv2/core.hpp>
+
+class ScratchArena {
+public:
+    ScratchArena();
+    ~ScratchArena();
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &counted_; }
+    cv::MatAllocator* mat_allocator() { return &mats_; }
+
+    // Bytes handed out so far (including alignment padding).
+    size_t used() const;
+
+private:
+    // Monotonic buffer with a byte count.  Locked because OpenCV may create
+    // Mats from its worker threads.
+    class Resource : public std::pmr::memory_resource {
+    public:
+        Resource(void* buffer, size_t size);
+        size_t used() const;
+
+    private:
+        void* do_allocate(size_t bytes, size_t align) override;
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        mutable std::mutex mu_;
+        std::pmr::monotonic_buffer_resource mono_;
+        size_t used_ = 0;
+    };
+
+    // Mat data and headers from the arena; deallocate only runs the header's
+    // destructor, the memory goes with the arena.
+    class MatAlloc : public cv::MatAllocator {
+    public:
+        explicit MatAlloc(std::pmr::memory_resource* res) : res_(res) {}
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0,
+                               size_t* step, cv::AccessFlag flags,
+                               cv::UMatUsageFlags usage) const override;
+        bool allocate(cv::UMatData* u, cv::AccessFlag, cv::UMatUsageFlags) const override {
+            return u != nullptr;
+        }
+        void deallocate(cv::UMatData* u) const override;
+
+    private:
+        std::pmr::memory_resource* res_;
+    };
+
+    // The thread's reusable block, if no outer arena holds it.  Declared
+    // before counted_ so it is given back (and grown) after counted_ is gone.
+    struct BlockLease {
+        BlockLease();
+        ~BlockLease();
+        void* data = nullptr;
+        size_t size = 0;
+        size_t high_water = 0;  // set by ~ScratchArena
+    };
+
+    ScratchArena* prev_;  // current arena before this one
+    BlockLease block_;
+    Resource counted_;
+    MatAlloc mats_;
+};
+
+// Current thread's arena resource, or std::pmr::get_default_resource().
+std::pmr::memory_resource* scratch_resource();
+
+// Current thread's arena Mat allocator, or nullptr (OpenCV's default).
+cv::MatAllocator* scratch_mat_allocator();
@@ -0,0 +1,93 @@
+// Frame-sequence analysis of a screen recording or screenshot burst.
+//
+// Feeds the frames of a directory (sorted by name) through a BoardSequence
+// and prints the CGP every time the position changes, then throughput.
+// Extract frames from a recording first, e.g.
+//   ffmpeg -i game.mp4 -vf fps=10 frames/%05d.png
+//
+// Usage: seq_analyze [--full] <frames_dir>
+//   --full  also time single-image mode (process_board_image) per frame
+#include "board.h"
+#include "sequence.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char* argv[]) {
+    std::setbuf(stdout, nullptr);  // unbuffered output
+    bool compare_full = false;
+    std::string dir;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--full") compare_full = true;
+        else dir = arg;
+    }
+    if (dir.empty()) {
+        std::cerr << "Usage: seq_analyze [--full] <frames_dir>\n";
+        return 1;
+    }
+
+    std::vector<fs::path> frames;
+    for (auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".webp")
+            frames.push_back(entry.path());
+    }
+    std::sort(frames.begin(), frames.end());
+    if (frames.empty()) {
+        std::cerr << "No frames in " << dir << "\n";
+        return 1;
+    }
+
+    BoardSequence seq;
+    int positions = 0, redetects = 0, lost = 0;
+    long cells_reclassified = 0;
+    double seq_ms = 0, full_ms = 0;
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        cv::Mat img = cv::imread(frames[i].string(), cv::IMREAD_COLOR);
+        if (img.empty()) {
+            std::fprintf(stderr, "%s: could not decode\n", frames[i].filename().c_str());
+            continue;
+        }
+        SequenceFrame f = seq.push(img);
+        seq_ms += f.ms;
+        redetects += f.redetected;
+        cells_reclassified += f.cells_changed;
+        if (!f.board_found) lost++;
+
+        if (compare_full) {
+            auto t0 = std::chrono::steady_clock::now();
+            process_board_mat_debug(img);
+            full_ms += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count();
+        }
+
+        if (f.position_changed) {
+            positions++;
+            std::printf("%s  %s\n", frames[i].filename().c_str(), f.cgp.c_str());
+        }
+        std::fprintf(stderr, "\r  %zu/%zu frames", i + 1, frames.size());
+    }
+    std::fprintf(stderr, "\n");
+
+    int n = static_cast<int>(frames.size());
+    std::printf("\n%d frames, %d positions, %d redetections, %d without board\n",
+                n, positions, redetects, lost);
+    std::printf("Sequence mode: %.1f ms/frame (%.1f fps), %.1f cells reclassified/frame\n",
+                seq_ms / n, n * 1000.0 / std::max(seq_ms, 1e-3),
+                static_cast<double>(cells_reclassified) / n);
+    if (compare_full)
+        std::printf("Single-image mode: %.1f ms/frame (%.1f fps)\n",
+                    full_ms / n, n * 1000.0 / std::max(full_ms, 1e-3));
+    return 0;
+}
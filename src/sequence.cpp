@@ -0,0 +1,161 @@
+#include "sequence.h"
+
+#include "gemini_parse.h"
+#include "rack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <opencv2/imgproc.hpp>
+
+// A cell counts as changed when any 1/4-cell block of it differs from the
+// reference by more than this mean gray level (video compression noise
+// stays well below; a tile, letter or highlight change goes far above).
+static const int SEQ_BLOCKS = 4;
+static const double SEQ_CELL_DIFF = 16;
+
+// More changed cells than this in one frame is not a move (at most 7 tiles
+// plus the last-move highlight): the board moved, so search again.
+static const int SEQ_MAX_CHANGED_CELLS = 40;
+
+// Pixel span of cell (r, c) inside a board ROI of the given size.
+static cv::Rect cell_span(const cv::Size& board, int r, int c) {
+    int x0 = c * board.width / 15, x1 = (c + 1) * board.width / 15;
+    int y0 = r * board.height / 15, y1 = (r + 1) * board.height / 15;
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+// Mark cells whose worst block differs from the reference.
+static int changed_cells(const cv::Mat& gray, const cv::Mat& ref, bool mask[15][15]) {
+    cv::Mat diff, blocks;
+    cv::absdiff(gray, ref, diff);
+    cv::resize(diff, blocks, cv::Size(15 * SEQ_BLOCKS, 15 * SEQ_BLOCKS), 0, 0,
+               cv::INTER_AREA);
+    int n = 0;
+    for (int r = 0; r < 15; r++)
+        for (int c = 0; c < 15; c++) {
+            double worst;
+            cv::minMaxLoc(blocks(cv::Rect(c * SEQ_BLOCKS, r * SEQ_BLOCKS,
+                                          SEQ_BLOCKS, SEQ_BLOCKS)),
+                          nullptr, &worst);
+            mask[r][c] = worst > SEQ_CELL_DIFF;
+            n += mask[r][c];
+        }
+    return n;
+}
+
+static bool strip_changed(const cv::Mat& gray, const cv::Mat& ref) {
+    if (gray.size() != ref.size()) return true;
+    cv::Mat diff, blocks;
+    cv::absdiff(gray, ref, diff);
+    // Blocks about a quarter of a cell on each side, as on the board.
+    int bs = std::max(1, gray.rows / 8);
+    cv::resize(diff, blocks, cv::Size(std::max(1, gray.cols / bs), 8), 0, 0,
+               cv::INTER_AREA);
+    double worst;
+    cv::minMaxLoc(blocks, nullptr, &worst);
+    return worst > SEQ_CELL_DIFF;
+}
+
+void BoardSequence::reset() {
+    tracking_ = false;
+    n_rack_ = 0;
+    rack_.clear();
+    last_cgp_.clear();
+    std::memset(cells_, 0, sizeof(cells_));
+    std::memset(scores_, 0, sizeof(scores_));
+}
+
+bool BoardSequence::redetect(const cv::Mat& bgr) {
+    std::string last_cgp = std::move(last_cgp_);
+    reset();
+    last_cgp_ = std::move(last_cgp);  // a re-found board may hold the same position
+    if (!detect_board_region(bgr, rect_, cell_size_, is_light_, &grid_)) return false;
+    tracking_ = true;
+    frame_size_ = bgr.size();
+
+    // Rack strip: the region detect_rack_tiles() searches.
+    int bottom = rect_.y + rect_.height;
+    rack_strip_ = cv::Rect(rect_.x - cell_size_, bottom + cell_size_ / 3,
+                           rect_.width + 2 * cell_size_,
+                           cell_size_ * 5 / 2 - cell_size_ / 3)
+                  & cv::Rect(0, 0, bgr.cols, bgr.rows);
+    return true;
+}
+
+void BoardSequence::read_rack(const cv::Mat& bgr) {
+    bool rack_light = detect_board_mode(bgr, rect_.x, rect_.y, cell_size_);
+    auto tiles = detect_rack_tiles(bgr, rect_.x, rect_.y, cell_size_, rack_light);
+    n_rack_ = std::min(static_cast<int>(tiles.size()), 7);
+    for (int i = 0; i < n_rack_; i++)
+        rack_raw_[i] = classify_rack_tile_full(tiles[i]);
+}
+
+// Rack refinement depends on the board (remaining tile pool), so it is
+// redone whenever either changes.
+void BoardSequence::refine_rack_string() {
+    CellResult rack[7] = {};
+    std::copy(rack_raw_, rack_raw_ + n_rack_, rack);
+    refine_rack(rack, n_rack_, cells_);
+    alphagram_tiebreak(rack, n_rack_);
+    rack_.clear();
+    for (int i = 0; i < n_rack_; i++) {
+        char ch = rack[i].letter;
+        rack_ += (ch >= 'A' && ch <= 'Z') ? ch : '?';
+    }
+}
+
+SequenceFrame BoardSequence::push(const cv::Mat& bgr) {
+    auto t0 = std::chrono::steady_clock::now();
+    SequenceFrame out;
+
+    bool mask[15][15] = {};
+    bool full = !tracking_ || bgr.size() != frame_size_;
+    cv::Mat gray;
+    if (!full) {
+        cv::cvtColor(bgr(rect_), gray, cv::COLOR_BGR2GRAY);
+        out.cells_changed = changed_cells(gray, ref_board_, mask);
+        full = out.cells_changed > SEQ_MAX_CHANGED_CELLS;
+    }
+
+    if (full) {
+        out.redetected = true;
+        if (!redetect(bgr)) {
+            out.ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count();
+            return out;
+        }
+        cv::cvtColor(bgr(rect_), gray, cv::COLOR_BGR2GRAY);
+        classify_board_region(bgr, rect_, grid_, is_light_, cells_, scores_);
+        ref_board_ = gray.clone();
+        out.cells_changed = 225;
+    } else if (out.cells_changed > 0) {
+        classify_board_region(bgr, rect_, grid_, is_light_, cells_, scores_, mask);
+        for (int r = 0; r < 15; r++)
+            for (int c = 0; c < 15; c++)
+                if (mask[r][c]) {
+                    cv::Rect span = cell_span(gray.size(), r, c);
+                    gray(span).copyTo(ref_board_(span));
+                }
+    }
+    out.board_found = true;
+
+    if (!rack_strip_.empty()) {
+        cv::Mat rack_gray;
+        cv::cvtColor(bgr(rack_strip_), rack_gray, cv::COLOR_BGR2GRAY);
+        if (full || strip_changed(rack_gray, ref_rack_)) {
+            read_rack(bgr);
+            ref_rack_ = rack_gray;
+            out.rack_changed = true;
+        }
+    }
+    if (out.cells_changed > 0 || out.rack_changed) refine_rack_string();
+
+    out.cgp = cells_to_cgp(cells_) + " " + rack_ + "/ 0/0 0 lex NWL23;";
+    out.position_changed = out.cgp != last_cgp_;
+    last_cgp_ = out.cgp;
+    out.ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+    return out;
+}
@@ -0,0 +1,71 @@
+#pragma once
+// Frame-sequence mode for screen recordings and screenshot bursts.
+//
+// Consecutive frames of a live game mostly repeat each other, so a
+// BoardSequence keeps the board rect, the per-cell results and a gray
+// reference of the board and rack strip between frames:
+//
+//   1. Verify the rect: diff the board against the reference cell by cell.
+//      A frame size change, or more cells changing at once than any move
+//      can cause (scroll, zoom, app switch), falls back to the full stage-1
+//      search and a full reclassification.
+//   2. Reclassify only the changed cells (classify_board_region with a
+//      mask) and re-read the rack only when its strip changed.
+//   3. Report a new CGP only when the position differs from the last one.
+//
+// The reference is refreshed only for cells that were reclassified, so an
+// animation that changes a cell a little every frame still triggers once
+// the accumulated difference passes the threshold.
+
+#include "board.h"
+
+#include <string>
+
+#include <opencv2/core.hpp>
+
+struct SequenceFrame {
+    bool board_found = false;       // a board is being tracked
+    bool redetected = false;        // full stage-1 search ran on this frame
+    int cells_changed = 0;          // cells reclassified on this frame
+    bool rack_changed = false;      // rack re-read on this frame
+    bool position_changed = false;  // cgp differs from the previous frame's
+    std::string cgp;                // current position, board + rack
+    double ms = 0;                  // time spent in push()
+};
+
+class BoardSequence {
+public:
+    BoardSequence() = default;
+    BoardSequence(const BoardSequence&) = delete;
+    BoardSequence& operator=(const BoardSequence&) = delete;
+
+    // Process the next frame (BGR, in capture order).
+    SequenceFrame push(const cv::Mat& bgr);
+
+    // Forget the tracked board; the next frame is treated as the first.
+    void reset();
+
+    const CellResult (&cells() const)[15][15] { return cells_; }
+    const std::string& rack() const { return rack_; }
+
+private:
+    bool redetect(const cv::Mat& bgr);
+    void read_rack(const cv::Mat& bgr);
+    void refine_rack_string();
+
+    bool tracking_ = false;
+    cv::Size frame_size_;
+    cv::Rect rect_;
+    cv::Rect2d grid_;       // fitted sub-pixel grid, empty: crop from rect_
+    int cell_size_ = 0;
+    bool is_light_ = false;
+    cv::Rect rack_strip_;   // empty if it falls outside the frame
+    cv::Mat ref_board_;     // gray board at rect_, as last classified
+    cv::Mat ref_rack_;      // gray rack strip, as last read
+    CellResult cells_[15][15] = {};
+    float scores_[15][15][26] = {};
+    CellResult rack_raw_[7] = {};  // before refine_rack / alphagram_tiebreak
+    int n_rack_ = 0;
+    std::string rack_;
+    std::string last_cgp_;
+};
@@ -0,0 +1,197 @@
+#pragma once
+// Packed training-crop shards — shared by the extract_* tools.
+//
+// A shard directory holds a handful of fixed-layout binary files plus an
+// index, so training code can np.memmap() the crops instead of decoding
+// thousands of tiny PNGs every epoch:
+//
+//   index.json            classes, crop size, per-shard record counts
+//   shard_000.bin         64-byte header, then count * H * W uint8 crops
+//                         (already preprocessed exactly like
+//                         preprocess_tile_for_cnn), then count int32 labels
+//   shard_000.meta.tsv    one line per record: index, label, theme, source, pos
+//
+// All integers are little-endian.  Records within a shard are grouped by
+// source image; the order across images depends on worker scheduling.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+static const char SHARD_MAGIC[8] = {'C', 'G', 'P', 'S', 'H', 'R', 'D', '1'};
+static const uint32_t SHARD_VERSION = 1;
+static const int SHARD_HEADER_SIZE = 64;
+
+struct ShardHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;        // number of records
+    uint32_t crop_w;
+    uint32_t crop_h;
+    uint32_t num_classes;
+    uint32_t crops_offset; // byte offset of the first crop
+    uint32_t labels_offset;
+    uint32_t reserved[7];
+};
+static_assert(sizeof(ShardHeader) == SHARD_HEADER_SIZE,
+              "shard header layout must stay 64 bytes");
+
+// One preprocessed crop waiting to be written.
+struct ShardRecord {
+    std::vector<uint8_t> pixels; // crop_w * crop_h grayscale
+    int label = 0;
+    std::string theme;
+    std::string source;          // testdata stem the crop came from
+    std::string pos;             // e.g. "r3c7", "c4", "t2"
+};
+
+// ---------------------------------------------------------------------------
+// Collects records from any number of worker threads and spills them into
+// shard files of at most max_per_shard records.  add_batch() takes a lock;
+// workers should hand over all crops of one image at once.
+// ---------------------------------------------------------------------------
+class ShardWriter {
+public:
+    ShardWriter(std::string out_dir, std::vector<std::string> classes,
+                int crop_size, int max_per_shard = 65536)
+        : out_dir_(std::move(out_dir)), classes_(std::move(classes)),
+          crop_size_(crop_size), max_per_shard_(max_per_shard),
+          class_counts_(classes_.size(), 0) {}
+
+    // Convert a preprocessed single-channel crop into a record.  Returns
+    // false if the crop does not have the writer's dimensions.
+    bool make_record(const cv::Mat& gray, int label, ShardRecord& rec) const {
+        if (gray.type() != CV_8UC1 || gray.cols != crop_size_
+            || gray.rows != crop_size_)
+            return false;
+        rec.pixels.resize(static_cast<size_t>(crop_size_) * crop_size_);
+        for (int y = 0; y < crop_size_; y++)
+            std::memcpy(rec.pixels.data() + static_cast<size_t>(y) * crop_size_,
+                        gray.ptr<uint8_t>(y), crop_size_);
+        rec.label = label;
+        return true;
+    }
+
+    void add_batch(std::vector<ShardRecord>& batch) {
+        std::lock_guard<std::mutex> lk(mu_);
+        for (auto& rec : batch) {
+            if (rec.label >= 0 && rec.label < static_cast<int>(class_counts_.size()))
+                class_counts_[rec.label]++;
+            pending_.push_back(std::move(rec));
+            if (static_cast<int>(pending_.size()) >= max_per_shard_)
+                flush_locked();
+        }
+        batch.clear();
+    }
+
+    // Write any remaining records and the index.  Returns false on I/O error.
+    bool finish() {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!pending_.empty()) flush_locked();
+        if (!ok_) return false;
+
+        std::string path = out_dir_ + "/index.json";
+        FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return false;
+        std::fprintf(f, "{\n  \"format\": \"cgp-shard\",\n  \"version\": %u,\n",
+                     SHARD_VERSION);
+        std::fprintf(f, "  \"crop_size\": %d,\n  \"header_size\": %d,\n",
+                     crop_size_, SHARD_HEADER_SIZE);
+        std::fprintf(f, "  \"classes\": [");
+        for (size_t i = 0; i < classes_.size(); i++)
+            std::fprintf(f, "%s\"%s\"", i ? ", " : "", classes_[i].c_str());
+        std::fprintf(f, "],\n  \"class_counts\": [");
+        for (size_t i = 0; i < class_counts_.size(); i++)
+            std::fprintf(f, "%s%d", i ? ", " : "", class_counts_[i]);
+        std::fprintf(f, "],\n  \"total\": %d,\n  \"shards\": [\n", total_);
+        for (size_t i = 0; i < shards_.size(); i++)
+            std::fprintf(f, "    {\"file\": \"%s\", \"meta\": \"%s\", \"count\": %d}%s\n",
+                         shards_[i].file.c_str(), shards_[i].meta.c_str(),
+                         shards_[i].count, i + 1 < shards_.size() ? "," : "");
+        std::fprintf(f, "  ]\n}\n");
+        return std::fclose(f) == 0;
+    }
+
+    int total() const { return total_; }
+    const std::vector<int>& class_counts() const { return class_counts_; }
+
+private:
+    struct ShardInfo { std::string file, meta; int count; };
+
+    void flush_locked() {
+        char name[32];
+        std::snprintf(name, sizeof(name), "shard_%03d", static_cast<int>(shards_.size()));
+        std::string bin_name = std::string(name) + ".bin";
+        std::string meta_name = std::string(name) + ".meta.tsv";
+
+        uint32_t n = static_cast<uint32_t>(pending_.size());
+        size_t crop_bytes = static_cast<size_t>(crop_size_) * crop_size_;
+
+        ShardHeader hdr = {};
+        std::memcpy(hdr.magic, SHARD_MAGIC, sizeof(hdr.magic));
+        hdr.version = SHARD_VERSION;
+        hdr.count = n;
+        hdr.crop_w = static_cast<uint32_t>(crop_size_);
+        hdr.crop_h = static_cast<uint32_t>(crop_size_);
+        hdr.num_classes = static_cast<uint32_t>(classes_.size());
+        hdr.crops_offset = SHARD_HEADER_SIZE;
+        // Keep the label array 4-byte aligned for np.memmap(dtype=int32).
+        size_t labels_off = SHARD_HEADER_SIZE + crop_bytes * n;
+        labels_off = (labels_off + 3) & ~static_cast<size_t>(3);
+        hdr.labels_offset = static_cast<uint32_t>(labels_off);
+
+        FILE* f = std::fopen((out_dir_ + "/" + bin_name).c_str(), "wb");
+        FILE* m = std::fopen((out_dir_ + "/" + meta_name).c_str(), "w");
+        if (!f || !m) {
+            if (f) std::fclose(f);
+            if (m) std::fclose(m);
+            ok_ = false;
+            pending_.clear();
+            return;
+        }
+        std::fwrite(&hdr, sizeof(hdr), 1, f);
+        for (const auto& rec : pending_)
+            std::fwrite(rec.pixels.data(), 1, crop_bytes, f);
+        static const uint8_t zeros[4] = {};
+        size_t written = SHARD_HEADER_SIZE + crop_bytes * n;
+        if (labels_off > written)
+            std::fwrite(zeros, 1, labels_off - written, f);
+        for (const auto& rec : pending_) {
+            int32_t lbl = rec.label;
+            std::fwrite(&lbl, sizeof(lbl), 1, f);
+        }
+        if (std::fclose(f) != 0) ok_ = false;
+
+        std::fprintf(m, "index\tlabel\ttheme\tsource\tpos\n");
+        for (uint32_t i = 0; i < n; i++) {
+            const auto& rec = pending_[i];
+            std::fprintf(m, "%u\t%s\t%s\t%s\t%s\n", i,
+                         rec.label >= 0 && rec.label < static_cast<int>(classes_.size())
+                             ? classes_[rec.label].c_str() : "?",
+                         rec.theme.c_str(), rec.source.c_str(), rec.pos.c_str());
+        }
+        if (std::fclose(m) != 0) ok_ = false;
+
+        shards_.push_back({bin_name, meta_name, static_cast<int>(n)});
+        total_ += static_cast<int>(n);
+        pending_.clear();
+    }
+
+    std::string out_dir_;
+    std::vector<std::string> classes_;
+    int crop_size_;
+    int max_per_shard_;
+    std::vector<int> class_counts_;
+
+    std::mutex mu_;
+    std::vector<ShardRecord> pending_;
+    std::vector<ShardInfo> shards_;
+    int total_ = 0;
+    bool ok_ = true;
+};
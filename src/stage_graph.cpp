@@ -0,0 +1,164 @@
+#include "stage_graph.h"
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+// ---------------------------------------------------------------------------
+// Worker pool shared by all graphs.  A function-local static: created on
+// first use, so it is destroyed before anything that was constructed
+// earlier (the model pools in board.cpp), and its destructor drains the
+// queue and joins every worker at exit.
+// ---------------------------------------------------------------------------
+
+class StagePool {
+public:
+    StagePool() {
+        // The caller of run() is a worker too; board search stages spawn
+        // their own threads, so a few workers are enough.
+        int n = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1, 7);
+        for (int i = 0; i < n; i++)
+            workers_.emplace_back([this] { work(); });
+    }
+
+    ~StagePool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : workers_) t.join();
+    }
+
+    void post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void work() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;  // stopping, queue drained
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
+
+static void pool_post(std::function<void()> task) {
+    static StagePool pool;
+    pool.post(std::move(task));
+}
+
+// ---------------------------------------------------------------------------
+// StageGraph
+// ---------------------------------------------------------------------------
+
+StageGraph::StageGraph() : st_(std::make_shared<State>()) {}
+
+StageGraph::Node StageGraph::add(const char* name, std::function<void()> fn,
+                                 std::initializer_list<Node> deps) {
+    Node n = static_cast<Node>(st_->stages.size());
+    Stage s;
+    s.name = name;
+    s.fn = std::move(fn);
+    s.waiting = static_cast<int>(deps.size());
+    st_->stages.push_back(std::move(s));
+    for (Node d : deps) st_->stages[d].dependents.push_back(n);
+    return n;
+}
+
+StageGraph::Node StageGraph::add_signal(const char* name, Node owner) {
+    Node n = static_cast<Node>(st_->stages.size());
+    Stage s;
+    s.name = name;
+    s.is_signal = true;
+    st_->stages.push_back(std::move(s));
+    st_->stages[owner].signals.push_back(n);
+    return n;
+}
+
+void StageGraph::open(Node signal) {
+    std::lock_guard<std::mutex> lock(st_->mu);
+    if (!st_->stages[signal].done) finish(st_, signal, false);
+}
+
+void StageGraph::run() {
+    std::unique_lock<std::mutex> lock(st_->mu);
+    for (Node n = 0; n < static_cast<Node>(st_->stages.size()); n++) {
+        const Stage& s = st_->stages[n];
+        if (!s.is_signal && s.waiting == 0 && !s.queued && !s.done)
+            make_ready(st_, n);
+    }
+    while (st_->finished < static_cast<int>(st_->stages.size()))
+        if (!run_one(st_, lock)) st_->cv.wait(lock);
+    if (st_->error) std::rethrow_exception(st_->error);
+}
+
+void StageGraph::make_ready(const std::shared_ptr<State>& st, Node n) {
+    st->stages[n].queued = true;
+    st->ready.push_back(n);
+    // Offer it to the pool; whoever gets the lock first runs it, the
+    // other finds nothing to do.
+    pool_post([st] {
+        std::unique_lock<std::mutex> lock(st->mu);
+        run_one(st, lock);
+    });
+}
+
+void StageGraph::finish(const std::shared_ptr<State>& st, Node n, bool failed) {
+    Stage& s = st->stages[n];
+    s.done = true;
+    s.failed = s.failed || failed;
+    st->finished++;
+    for (Node sig : s.signals)
+        if (!st->stages[sig].done) finish(st, sig, s.failed);
+    for (Node d : s.dependents) {
+        Stage& dep = st->stages[d];
+        dep.failed = dep.failed || s.failed;
+        if (--dep.waiting > 0) continue;
+        if (dep.failed)
+            finish(st, d, true);  // skip
+        else
+            make_ready(st, d);
+    }
+    st->cv.notify_all();
+}
+
+bool StageGraph::run_one(const std::shared_ptr<State>& st,
+                         std::unique_lock<std::mutex>& lock) {
+    if (st->ready.empty()) return false;
+    Node n = st->ready.back();
+    st->ready.pop_back();
+    std::function<void()>& fn = st->stages[n].fn;
+
+    lock.unlock();
+    bool failed = false;
+    std::exception_ptr error;
+    try {
+        fn();
+    } catch (...) {
+        failed = true;
+        error = std::current_exception();
+    }
+    lock.lock();
+
+    if (error && !st->error) st->error = error;
+    finish(st, n, failed);
+    return true;
+}
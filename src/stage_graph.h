@@ -0,0 +1,80 @@
+#pragma once
+// Small dependency graph for the stages of one image.
+//
+// Stages that only need part of an earlier stage's output (rack reading
+// needs the board rect, not the board's letters) are declared with their
+// real dependencies and run as soon as those are met, on a shared pool of
+// persistent workers, started on first use and joined at exit.
+//
+//   StageGraph g;
+//   auto board = g.add("board", [&] { dr = process_board_image_debug(...); });
+//   auto detected = g.add_signal("detected", board);  // g.open() from on_detect
+//   g.add("rack_read", [&] { ... }, {detected});
+//   g.run();
+//
+// run() blocks until every stage has finished, and the calling thread runs
+// stages itself while it waits, so graphs may nest (a stage can run its own
+// graph) without starving the pool.  A stage whose dependency threw is
+// skipped; run() rethrows the first exception.
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class StageGraph {
+public:
+    using Node = int;
+
+    StageGraph();
+    StageGraph(const StageGraph&) = delete;
+    StageGraph& operator=(const StageGraph&) = delete;
+
+    // Stage that runs fn once every stage in deps has finished.
+    Node add(const char* name, std::function<void()> fn,
+             std::initializer_list<Node> deps = {});
+
+    // Stage without work that finishes when open() is called on it, or
+    // when owner finishes, whichever comes first.  Lets a stage release its
+    // dependents part-way through (e.g. from a detection callback).
+    Node add_signal(const char* name, Node owner);
+    void open(Node signal);
+
+    // Run all stages; see above.
+    void run();
+
+private:
+    struct Stage {
+        const char* name;
+        std::function<void()> fn;
+        std::vector<Node> dependents;
+        std::vector<Node> signals;  // owned signals, opened when this finishes
+        int waiting = 0;            // unfinished dependencies
+        bool is_signal = false;
+        bool queued = false;
+        bool done = false;
+        bool failed = false;        // threw, or a dependency did
+    };
+
+    // Shared with pool helpers, which may outlive run().
+    struct State {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::vector<Stage> stages;
+        std::vector<Node> ready;
+        int finished = 0;
+        std::exception_ptr error;
+    };
+
+    // Both called with State::mu held.
+    static void make_ready(const std::shared_ptr<State>& st, Node n);
+    static void finish(const std::shared_ptr<State>& st, Node n, bool failed);
+    // Run one ready stage if there is one; false if there was none.
+    static bool run_one(const std::shared_ptr<State>& st,
+                        std::unique_lock<std::mutex>& lock);
+
+    std::shared_ptr<State> st_;
+};
@@ -0,0 +1,363 @@
+#include "synth.h"
+
+#include "board.h"
+#include "rack.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Theme palettes (BGR), sampled from real Woogles screenshots in testdata/.
+// Mahogany values come from the HSV ground truth noted in score_premium().
+// ═══════════════════════════════════════════════════════════════════════════════
+
+static const int PREMIUM[15][15] = {
+    {4,0,0,1,0,0,0,4,0,0,0,1,0,0,4},
+    {0,3,0,0,0,2,0,0,0,2,0,0,0,3,0},
+    {0,0,3,0,0,0,1,0,1,0,0,0,3,0,0},
+    {1,0,0,3,0,0,0,1,0,0,0,3,0,0,1},
+    {0,0,0,0,3,0,0,0,0,0,3,0,0,0,0},
+    {0,2,0,0,0,2,0,0,0,2,0,0,0,2,0},
+    {0,0,1,0,0,0,1,0,1,0,0,0,1,0,0},
+    {4,0,0,1,0,0,0,5,0,0,0,1,0,0,4},
+    {0,0,1,0,0,0,1,0,1,0,0,0,1,0,0},
+    {0,2,0,0,0,2,0,0,0,2,0,0,0,2,0},
+    {0,0,0,0,3,0,0,0,0,0,3,0,0,0,0},
+    {1,0,0,3,0,0,0,1,0,0,0,3,0,0,1},
+    {0,0,3,0,0,0,1,0,1,0,0,0,3,0,0},
+    {0,3,0,0,0,2,0,0,0,2,0,0,0,3,0},
+    {4,0,0,1,0,0,0,4,0,0,0,1,0,0,4},
+};
+
+struct SynthPalette {
+    cv::Scalar page, panel, grid, label;
+    cv::Scalar square[6];      // normal, DL, TL, DW, TW, center
+    cv::Scalar caption;        // premium-square tooltip text
+    cv::Scalar tile, tile_text;
+    cv::Scalar recent, recent_text;
+    cv::Scalar blank_disc, blank_text;
+    cv::Scalar rack_tile, rack_text;
+    cv::Scalar button;
+    bool wood_grain;
+};
+
+static const SynthPalette PALETTES[] = {
+    // Light
+    {{245, 245, 245}, {255, 255, 255}, {195, 195, 195}, {90, 90, 90},
+     {{255, 255, 255}, {245, 231, 185}, {202, 136, 59},
+      {192, 192, 246}, {46, 46, 169}, {192, 192, 246}},
+     {70, 70, 70},
+     {139, 38, 107}, {255, 255, 255},
+     {0, 176, 244}, {51, 51, 51},
+     {90, 20, 70}, {255, 255, 255},
+     {139, 38, 107}, {255, 255, 255},
+     {140, 90, 20}, false},
+    // Dark
+    {{39, 39, 39}, {56, 56, 56}, {35, 35, 35}, {200, 200, 200},
+     {{49, 49, 49}, {201, 173, 109}, {146, 93, 17},
+      {90, 84, 169}, {37, 33, 107}, {90, 84, 169}},
+     {230, 230, 230},
+     {187, 173, 186}, {60, 45, 60},
+     {174, 229, 251}, {60, 60, 60},
+     {110, 50, 100}, {255, 255, 255},
+     {187, 173, 186}, {60, 45, 60},
+     {230, 200, 120}, false},
+    // Mahogany
+    {{28, 30, 40}, {40, 44, 56}, {25, 30, 45}, {200, 200, 200},
+     {{35, 44, 69}, {150, 120, 90}, {140, 80, 30},
+      {68, 75, 123}, {73, 105, 48}, {37, 45, 88}},
+     {225, 225, 225},
+     {150, 200, 230}, {40, 40, 40},
+     {110, 190, 240}, {40, 40, 40},
+     {70, 60, 120}, {255, 255, 255},
+     {150, 200, 230}, {40, 40, 40},
+     {70, 110, 160}, true},
+    // Memento
+    {{255, 255, 255}, {255, 255, 255}, {204, 204, 204}, {90, 90, 90},
+     {{255, 255, 255}, {245, 231, 185}, {202, 136, 59},
+      {192, 192, 246}, {46, 46, 169}, {192, 192, 246}},
+     {70, 70, 70},
+     {139, 38, 107}, {255, 255, 255},
+     {0, 176, 244}, {51, 51, 51},
+     {90, 20, 70}, {255, 255, 255},
+     {0, 176, 244}, {51, 51, 51},
+     {140, 90, 20}, false},
+};
+
+bool parse_synth_theme(const std::string& name, SynthTheme& out) {
+    if (name == "light") out = SynthTheme::Light;
+    else if (name == "dark") out = SynthTheme::Dark;
+    else if (name == "mahogany") out = SynthTheme::Mahogany;
+    else if (name == "memento") out = SynthTheme::Memento;
+    else return false;
+    return true;
+}
+
+const char* synth_theme_name(SynthTheme theme) {
+    switch (theme) {
+        case SynthTheme::Light:    return "light";
+        case SynthTheme::Dark:     return "dark";
+        case SynthTheme::Mahogany: return "mahogany";
+        case SynthTheme::Memento:  return "memento";
+    }
+    return "light";
+}
+
+std::string synth_variant_name(const SynthOptions& opt) {
+    std::string name = synth_theme_name(opt.theme);
+    if (opt.theme != SynthTheme::Memento)
+        name += opt.mobile ? "_mobile" : "_desktop";
+    if (opt.tooltip) name += "_tooltip";
+    if (opt.jpeg_quality > 0)
+        name += (opt.jpeg_quality < 40) ? "_lowjpeg" : "_jpeg";
+    return name;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Glyph cache + compositing
+// ═══════════════════════════════════════════════════════════════════════════════
+
+// Glyph masks depend only on (text, size), so each thread renders them once
+// and afterwards a board is pure fills and alpha blends.
+static const cv::Mat& cached_tile_mask(char letter, int size, bool subscript) {
+    static thread_local std::map<uint32_t, cv::Mat> cache;
+    uint32_t key = static_cast<uint8_t>(letter)
+        | (static_cast<uint32_t>(size) << 8) | (subscript ? 1u << 30 : 0u);
+    auto it = cache.find(key);
+    if (it == cache.end())
+        it = cache.emplace(key, render_tile_mask(letter, size, subscript)).first;
+    return it->second;
+}
+
+static const cv::Mat& cached_text_mask(const std::string& text, int px) {
+    static thread_local std::map<std::string, cv::Mat> cache;
+    std::string key = text + "@" + std::to_string(px);
+    auto it = cache.find(key);
+    if (it == cache.end())
+        it = cache.emplace(key, render_text_mask(text, px)).first;
+    return it->second;
+}
+
+// Alpha-blend `color` into img through an 8-bit coverage mask at (x, y).
+static void blend_mask(cv::Mat& img, const cv::Mat& mask, int x, int y,
+                       const cv::Scalar& color) {
+    for (int my = 0; my < mask.rows; my++) {
+        int py = y + my;
+        if (py < 0 || py >= img.rows) continue;
+        const uint8_t* m = mask.ptr<uint8_t>(my);
+        cv::Vec3b* row = img.ptr<cv::Vec3b>(py);
+        for (int mx = 0; mx < mask.cols; mx++) {
+            int px = x + mx;
+            if (px < 0 || px >= img.cols || m[mx] == 0) continue;
+            int a = m[mx];
+            for (int k = 0; k < 3; k++)
+                row[px][k] = static_cast<uint8_t>(
+                    (row[px][k] * (255 - a) + static_cast<int>(color[k]) * a) / 255);
+        }
+    }
+}
+
+// Draw text centered on (cx, cy).
+static void draw_text_centered(cv::Mat& img, const std::string& text, int px,
+                               int cx, int cy, const cv::Scalar& color) {
+    const cv::Mat& m = cached_text_mask(text, px);
+    blend_mask(img, m, cx - m.cols / 2, cy - m.rows / 2, color);
+}
+
+// Mahogany boards are textured; a cheap sinusoidal grain is enough to give
+// the occupancy contrast checks something realistic to reject.
+static void add_wood_grain(cv::Mat& img, cv::Rect r) {
+    r &= cv::Rect(0, 0, img.cols, img.rows);
+    for (int y = r.y; y < r.y + r.height; y++) {
+        cv::Vec3b* row = img.ptr<cv::Vec3b>(y);
+        for (int x = r.x; x < r.x + r.width; x++) {
+            double g = std::sin(y * 0.45 + 3.0 * std::sin(x * 0.031)) * 5.0;
+            for (int k = 0; k < 3; k++)
+                row[x][k] = cv::saturate_cast<uint8_t>(row[x][k] + g);
+        }
+    }
+}
+
+// Parse the board part of a CGP into letters (0 = empty, a-z = blank).
+static void parse_board(const std::string& cgp, char letters[15][15]) {
+    std::memset(letters, 0, 15 * 15);
+    auto sp = cgp.find(' ');
+    std::string board = (sp != std::string::npos) ? cgp.substr(0, sp) : cgp;
+    int row = 0, col = 0;
+    for (size_t i = 0; i < board.size() && row < 15; i++) {
+        char ch = board[i];
+        if (ch == '/') { row++; col = 0; }
+        else if (ch >= '0' && ch <= '9') {
+            int n = ch - '0';
+            while (i + 1 < board.size() && board[i+1] >= '0' && board[i+1] <= '9')
+                n = n * 10 + (board[++i] - '0');
+            col += n;
+        } else if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z')) {
+            if (row < 15 && col < 15) letters[row][col] = ch;
+            col++;
+        }
+    }
+}
+
+// Pick one maximal word (run of >= 2 tiles) to color as the last play.
+static void pick_recent_word(const char letters[15][15], std::mt19937& rng,
+                             bool recent[15][15]) {
+    std::memset(recent, 0, sizeof(bool) * 225);
+    struct Run { int r, c, len; bool horiz; };
+    std::vector<Run> runs;
+    for (int r = 0; r < 15; r++)
+        for (int c = 0; c < 15; c++) {
+            if (!letters[r][c]) continue;
+            if (c == 0 || !letters[r][c - 1]) {
+                int len = 0;
+                while (c + len < 15 && letters[r][c + len]) len++;
+                if (len >= 2) runs.push_back({r, c, len, true});
+            }
+            if (r == 0 || !letters[r - 1][c]) {
+                int len = 0;
+                while (r + len < 15 && letters[r + len][c]) len++;
+                if (len >= 2) runs.push_back({r, c, len, false});
+            }
+        }
+    if (runs.empty()) return;
+    const Run& w = runs[rng() % runs.size()];
+    for (int i = 0; i < w.len; i++) {
+        if (w.horiz) recent[w.r][w.c + i] = true;
+        else recent[w.r + i][w.c] = true;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// Renderer
+// ═══════════════════════════════════════════════════════════════════════════════
+
+SynthImage render_synthetic_board(const std::string& cgp,
+                                  const SynthOptions& opt) {
+    const SynthPalette& pal = PALETTES[static_cast<int>(opt.theme)];
+    bool memento = (opt.theme == SynthTheme::Memento);
+    bool col_labels = opt.labels && !memento;
+    bool row_labels = col_labels && !opt.mobile;
+    std::mt19937 rng(opt.seed);
+
+    int cs = std::max(8, opt.cell_size);
+    int gw = std::max(1, cs / 30);             // grid line width
+    int board_px = cs * 15;
+
+    // Page layout around the board, in cells.
+    int margin_left = row_labels ? cs : std::max(2, cs / 10);
+    int margin_top = memento ? cs * 3 / 2 : (col_labels ? cs : cs / 3);
+    int margin_right = opt.mobile ? std::max(2, cs / 10) : cs * 2;
+    int rack_tile = opt.mobile ? cs * 13 / 10 : cs;
+    int rack_gap = std::max(2, rack_tile / 9);
+    int rack_top_gap = cs * 9 / 10;
+    int rack_area = opt.rack ? rack_top_gap + rack_tile + cs : cs / 2;
+
+    int width = margin_left + board_px + margin_right;
+    int height = margin_top + board_px + rack_area;
+
+    SynthImage out;
+    out.cgp = cgp;
+    out.cell_size = cs;
+    out.board_rect = cv::Rect(margin_left, margin_top, board_px, board_px);
+    const cv::Rect& br = out.board_rect;
+
+    cv::Mat img(height, width, CV_8UC3, pal.page);
+    if (!opt.mobile && !memento)
+        cv::rectangle(img, cv::Rect(br.x + board_px + cs / 3, br.y,
+                                    margin_right - cs / 2, board_px / 3),
+                      pal.panel, cv::FILLED);
+
+    char letters[15][15];
+    parse_board(cgp, letters);
+    bool recent[15][15] = {};
+    if (opt.highlight_last) pick_recent_word(letters, rng, recent);
+
+    // Grid: fill the board with line color, then paint each cell interior.
+    cv::rectangle(img, cv::Rect(br.x, br.y, board_px + gw, board_px + gw),
+                  pal.grid, cv::FILLED);
+    int inner = cs - gw;
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            cv::Rect cell(br.x + c * cs + gw, br.y + r * cs + gw, inner, inner);
+            int prem = PREMIUM[r][c];
+            char ch = letters[r][c];
+            if (!ch) {
+                img(cell).setTo(pal.square[prem]);
+                if (pal.wood_grain) add_wood_grain(img, cell);
+                if (opt.tooltip && prem >= 1 && prem <= 4) {
+                    static const char* CAPTION[] = {"", "2L", "3L", "2W", "3W"};
+                    draw_text_centered(img, CAPTION[prem], std::max(6, cs * 3 / 10),
+                                       cell.x + inner / 2, cell.y + inner / 2,
+                                       pal.caption);
+                }
+                continue;
+            }
+
+            bool blank = (ch >= 'a' && ch <= 'z');
+            bool is_recent = recent[r][c];
+            img(cell).setTo(is_recent ? pal.recent : pal.tile);
+            cv::Scalar text = is_recent ? pal.recent_text : pal.tile_text;
+            if (blank) {
+                cv::circle(img, cv::Point(cell.x + inner / 2, cell.y + inner / 2),
+                           inner * 38 / 100, pal.blank_disc, cv::FILLED, cv::LINE_AA);
+                text = pal.blank_text;
+            }
+            blend_mask(img, cached_tile_mask(ch, inner, !blank), cell.x, cell.y, text);
+        }
+    }
+
+    // Labels: centered where score_column_labels / score_row_labels look.
+    int label_px = std::max(6, cs * 42 / 100);
+    if (col_labels)
+        for (int c = 0; c < 15; c++)
+            draw_text_centered(img, std::string(1, static_cast<char>('A' + c)), label_px,
+                               br.x + c * cs + cs / 2, br.y - cs * 4 / 10, pal.label);
+    if (row_labels)
+        for (int r = 0; r < 15; r++)
+            draw_text_centered(img, std::to_string(r + 1), label_px,
+                               br.x - cs / 2, br.y + r * cs + cs / 2, pal.label);
+
+    // Rack: centered under the board, flanked by the two round buttons.
+    if (opt.rack) {
+        std::string rack = parse_cgp_rack(cgp);
+        int n = std::min(7, static_cast<int>(rack.size()));
+        int rack_w = n * rack_tile + std::max(0, n - 1) * rack_gap;
+        int rx = br.x + (board_px - rack_w) / 2;
+        int ry = br.y + board_px + rack_top_gap;
+        for (int i = 0; i < n; i++) {
+            cv::Rect t(rx + i * (rack_tile + rack_gap), ry, rack_tile, rack_tile);
+            img(t & cv::Rect(0, 0, img.cols, img.rows)).setTo(pal.rack_tile);
+            char ch = rack[i];
+            if (ch >= 'A' && ch <= 'Z')
+                blend_mask(img, cached_tile_mask(ch, rack_tile, true), t.x, t.y,
+                           pal.rack_text);
+        }
+        if (!memento) {
+            int rad = rack_tile * 45 / 100;
+            int cy = ry + rack_tile / 2;
+            cv::circle(img, cv::Point(br.x + cs + rad, cy), rad, pal.button,
+                       cv::FILLED, cv::LINE_AA);
+            cv::circle(img, cv::Point(br.x + board_px - cs - rad, cy), rad,
+                       pal.button, cv::FILLED, cv::LINE_AA);
+        }
+    }
+
+    if (opt.jpeg_quality > 0) {
+        std::vector<uint8_t> jpg;
+        cv::imencode(".jpg", img, jpg,
+                     {cv::IMWRITE_JPEG_QUALITY, std::min(100, opt.jpeg_quality)});
+        img = cv::imdecode(jpg, cv::IMREAD_COLOR);
+    }
+    out.bgr = img;
+    return out;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Synthetic Woogles-style board screenshots rendered straight from a CGP.
+// Geometry follows the real layouts closely enough that the detection,
+// occupancy and rack stages run unmodified, and the ground truth (board rect,
+// cell size, CGP) is known exactly.
+
+enum class SynthTheme { Light, Dark, Mahogany, Memento };
+
+struct SynthOptions {
+    SynthTheme theme = SynthTheme::Light;
+    int cell_size = 34;        // pixels per board cell (any resolution)
+    bool mobile = false;       // mobile layout: column labels only, larger rack
+    bool labels = true;        // A-O / 1-15 labels (Memento never has them)
+    bool rack = true;          // draw the CGP rack below the board
+    bool tooltip = false;      // premium-square captions ("2W", "3L", ...)
+    bool highlight_last = true;// color one word like the most recent play
+    int jpeg_quality = 0;      // >0: round-trip through JPEG at this quality
+    uint32_t seed = 1;         // picks the highlighted word, tooltip squares
+};
+
+struct SynthImage {
+    cv::Mat bgr;               // rendered screenshot (after JPEG round-trip)
+    cv::Rect board_rect;       // exact 15x15 board area in `bgr`
+    int cell_size = 0;
+    std::string cgp;           // the input position
+};
+
+// Parse a theme name as used in testdata filenames ("light", "dark",
+// "mahogany", "memento").  Returns false for unknown names.
+bool parse_synth_theme(const std::string& name, SynthTheme& out);
+const char* synth_theme_name(SynthTheme theme);
+
+// Render one screenshot.  Thread-safe; glyph masks are cached per thread so
+// repeated renders at the same cell size only composite.
+SynthImage render_synthetic_board(const std::string& cgp,
+                                  const SynthOptions& opt);
+
+// Testdata-style filename suffix for these options, e.g.
+// "light_desktop_tooltip_jpeg" or "memento_lowjpeg".
+std::string synth_variant_name(const SynthOptions& opt);
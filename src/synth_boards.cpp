@@ -0,0 +1,215 @@
+// Render synthetic board screenshots from CGP positions.
+//
+// Writes testdata-style pairs (<name>.png + <name>.cgp) so the output can be
+// fed straight into occ_test, eval_local and the extract_* training tools,
+// or renders in memory only (--bench) to measure throughput.
+//
+// Usage: synth_boards [options] <cgp_dir | cgp_list_file> <output_dir>
+//        synth_boards --bench N [options] <cgp_dir | cgp_list_file>
+//
+//   --themes a,b,..   light,dark,mahogany,memento (default: all)
+//   --cell N[,N..]    cell size(s) in pixels (default: 34)
+//   --mobile          mobile layout (column labels only, larger rack)
+//   --variants        also emit _tooltip, _jpeg (q=60) and _lowjpeg (q=20)
+//   -j N              worker threads (default: all cores)
+#include "synth.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/imgcodecs.hpp>
+
+namespace fs = std::filesystem;
+
+struct Position { std::string name, cgp; };
+
+// Testdata stems look like <game>_tNN_<theme>_<layout>[_variant]; keep the
+// <game>_tNN part so each position is rendered once.
+static std::string position_stem(const std::string& stem) {
+    static const char* themes[] = {"_light", "_dark", "_mahogany", "_memento"};
+    size_t cut = std::string::npos;
+    for (const char* t : themes) cut = std::min(cut, stem.find(t));
+    return cut == std::string::npos ? stem : stem.substr(0, cut);
+}
+
+static std::vector<Position> load_positions(const std::string& src) {
+    std::vector<Position> out;
+    if (fs::is_directory(src)) {
+        std::vector<std::string> seen;
+        for (auto& entry : fs::directory_iterator(src)) {
+            if (entry.path().extension() != ".cgp") continue;
+            std::string stem = position_stem(entry.path().stem().string());
+            if (std::find(seen.begin(), seen.end(), stem) != seen.end()) continue;
+            seen.push_back(stem);
+            std::ifstream ifs(entry.path());
+            std::string line;
+            if (std::getline(ifs, line) && !line.empty())
+                out.push_back({stem, line});
+        }
+        std::sort(out.begin(), out.end(),
+                  [](const Position& a, const Position& b) { return a.name < b.name; });
+    } else {
+        std::ifstream ifs(src);
+        std::string line;
+        int n = 0;
+        while (std::getline(ifs, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "pos%05d", n++);
+            out.push_back({buf, line});
+        }
+    }
+    return out;
+}
+
+static std::vector<int> parse_int_list(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string tok;
+    while (std::getline(ss, tok, ','))
+        if (!tok.empty()) out.push_back(std::atoi(tok.c_str()));
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    std::setbuf(stdout, nullptr);
+    std::vector<SynthTheme> themes = {SynthTheme::Light, SynthTheme::Dark,
+                                      SynthTheme::Mahogany, SynthTheme::Memento};
+    std::vector<int> cells = {34};
+    bool mobile = false, variants = false;
+    int bench_n = 0;
+    int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--themes" && i + 1 < argc) {
+            themes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string tok;
+            while (std::getline(ss, tok, ',')) {
+                SynthTheme t;
+                if (!parse_synth_theme(tok, t)) {
+                    std::cerr << "Unknown theme: " << tok << "\n";
+                    return 1;
+                }
+                themes.push_back(t);
+            }
+        } else if (arg == "--cell" && i + 1 < argc) {
+            cells = parse_int_list(argv[++i]);
+        } else if (arg == "--mobile") {
+            mobile = true;
+        } else if (arg == "--variants") {
+            variants = true;
+        } else if (arg == "--bench" && i + 1 < argc) {
+            bench_n = std::atoi(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            n_threads = std::max(1, std::atoi(argv[++i]));
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.empty() || (bench_n <= 0 && positional.size() < 2)
+        || themes.empty() || cells.empty()) {
+        std::cerr << "Usage: synth_boards [--themes a,b] [--cell N[,N]] [--mobile]"
+                     " [--variants] [-j N] <cgp_dir|cgp_list> <output_dir>\n"
+                     "       synth_boards --bench N [options] <cgp_dir|cgp_list>\n";
+        return 1;
+    }
+
+    auto positions = load_positions(positional[0]);
+    if (positions.empty()) {
+        std::cerr << "No CGP positions found in " << positional[0] << "\n";
+        return 1;
+    }
+
+    // Every (position, theme, cell size, variant) combination is one job.
+    struct Job { int pos; SynthOptions opt; };
+    std::vector<Job> jobs;
+    for (int p = 0; p < static_cast<int>(positions.size()); p++)
+        for (SynthTheme t : themes)
+            for (int cs : cells) {
+                SynthOptions opt;
+                opt.theme = t;
+                opt.cell_size = cs;
+                opt.mobile = mobile;
+                opt.seed = static_cast<uint32_t>(p * 7919 + cs);
+                jobs.push_back({p, opt});
+                if (!variants) continue;
+                SynthOptions v = opt;
+                v.tooltip = true;
+                jobs.push_back({p, v});
+                v.jpeg_quality = 60;
+                jobs.push_back({p, v});
+                v.jpeg_quality = 20;
+                jobs.push_back({p, v});
+            }
+
+    // Bench: cycle through the job list in memory, no encoding or I/O
+    // beyond the optional JPEG round-trip.
+    if (bench_n > 0) {
+        n_threads = std::min(n_threads, bench_n);
+        std::vector<long long> pixels(n_threads, 0);
+        std::vector<std::thread> threads(n_threads);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int t = 0; t < n_threads; t++) {
+            threads[t] = std::thread([&, t]() {
+                for (int i = t; i < bench_n; i += n_threads) {
+                    const Job& job = jobs[i % jobs.size()];
+                    auto si = render_synthetic_board(positions[job.pos].cgp, job.opt);
+                    pixels[t] += static_cast<long long>(si.bgr.total());
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+        double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0).count();
+        long long total_px = 0;
+        for (long long p : pixels) total_px += p;
+        std::printf("Rendered %d boards in %.3f s (%d threads): %.0f boards/s, %.1f Mpx/s\n",
+                    bench_n, secs, n_threads, bench_n / secs, total_px / secs / 1e6);
+        return 0;
+    }
+
+    std::string out_dir = positional[1];
+    fs::create_directories(out_dir);
+    n_threads = std::min(n_threads, static_cast<int>(jobs.size()));
+    std::vector<std::thread> threads(n_threads);
+    std::atomic<int> n_done{0};
+    std::atomic<int> n_failed{0};
+
+    for (int t = 0; t < n_threads; t++) {
+        threads[t] = std::thread([&, t]() {
+            for (int i = t; i < static_cast<int>(jobs.size()); i += n_threads) {
+                const Job& job = jobs[i];
+                const Position& pos = positions[job.pos];
+                auto si = render_synthetic_board(pos.cgp, job.opt);
+
+                std::string name = "syn_" + pos.name + "_" + synth_variant_name(job.opt);
+                if (cells.size() > 1) name += "_c" + std::to_string(job.opt.cell_size);
+                if (!cv::imwrite(out_dir + "/" + name + ".png", si.bgr)) {
+                    n_failed++;
+                    continue;
+                }
+                std::ofstream cgp_ofs(out_dir + "/" + name + ".cgp");
+                cgp_ofs << pos.cgp << "\n";
+                int done = ++n_done;
+                if (done % 50 == 0)
+                    std::fprintf(stderr, "\r%d/%d images...", done,
+                                 static_cast<int>(jobs.size()));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    std::fprintf(stderr, "\nDone: %d images from %d positions, %d failed\n",
+                 n_done.load(), static_cast<int>(positions.size()), n_failed.load());
+    return n_failed > 0 ? 1 : 0;
+}
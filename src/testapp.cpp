@@ -1,15 +1,21 @@
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <future>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <string>
@@ -20,8 +26,17 @@
 
 #include <httplib.h>
 
+#include "base64.h"
 #include "board.h"
+#include "board_cache.h"
+#include "cpu_kernels.h"
+#include "feature_store.h"
+#include "gemini_payload.h"
+#include "json_writer.h"
+#include "metrics.h"
 #include "rack.h"
+#include "stage_graph.h"
+#include "web_assets.h"
 
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
@@ -198,42 +213,12 @@ static std::shared_ptr<std::vector<uint8_t>> g_last_image;
 static std::mutex g_last_image_mutex;
 
 // ---------------------------------------------------------------------------
-// Minimal JSON-safe escaping (CGP has no quotes/backslashes, but be safe).
+// JSON string escaping for hand-built JSON; see json_writer.h.
 // ---------------------------------------------------------------------------
 static std::string json_escape(const std::string& s) {
     std::string out;
     out.reserve(s.size());
-    for (char c : s) {
-        switch (c) {
-            case '"':  out += "\\\""; break;
-            case '\\': out += "\\\\"; break;
-            case '\n': out += "\\n";  break;
-            default:   out += c;
-        }
-    }
-    return out;
-}
-
-// ---------------------------------------------------------------------------
-// Base64 encoder for debug image.
-// ---------------------------------------------------------------------------
-static const char B64[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-static std::string base64_encode(const std::vector<uint8_t>& data) {
-    std::string out;
-    out.reserve((data.size() + 2) / 3 * 4);
-    size_t i = 0;
-    while (i < data.size()) {
-        uint32_t a = data[i++];
-        uint32_t b = (i < data.size()) ? data[i++] : 0;
-        uint32_t c = (i < data.size()) ? data[i++] : 0;
-        uint32_t triple = (a << 16) | (b << 8) | c;
-        out += B64[(triple >> 18) & 0x3F];
-        out += B64[(triple >> 12) & 0x3F];
-        out += (i > data.size() + 1) ? '=' : B64[(triple >> 6) & 0x3F];
-        out += (i > data.size()) ? '=' : B64[triple & 0x3F];
-    }
+    json_escape_append(out, s);
     return out;
 }
 
@@ -260,66 +245,198 @@ static void load_dotenv() {
 }
 
 // ---------------------------------------------------------------------------
-// Build JSON response from DebugResult.
+// Result fields of a DebugResult, written into an open JSON object.
 // ---------------------------------------------------------------------------
-static std::string make_json_response(const DebugResult& dr,
-                                       const std::string& rack = "") {
-    std::string json = "{\"cgp\":\"" + json_escape(dr.cgp) + "\"";
-
-    if (!rack.empty()) {
-        json += ",\"rack\":\"" + json_escape(rack) + "\"";
-    }
+static void write_result_fields(JsonWriter& w, const DebugResult& dr,
+                                const std::string& rack = "") {
+    w.key("cgp").string(dr.cgp);
+    if (!rack.empty()) w.key("rack").string(rack);
 
     // Per-cell detail array for the UI (letter, confidence, subscript, blank)
-    json += ",\"cells\":[";
+    w.key("cells").begin_array();
     for (int r = 0; r < 15; r++) {
-        if (r > 0) json += ",";
-        json += "[";
+        w.begin_array();
         for (int c = 0; c < 15; c++) {
-            if (c > 0) json += ",";
             const auto& cell = dr.cells[r][c];
             if (cell.letter == 0) {
-                json += "null";
-            } else {
-                char ltr = static_cast<char>(std::toupper(
-                    static_cast<unsigned char>(cell.letter)));
-                json += "{\"l\":\"";
-                json += (ltr >= 'A' && ltr <= 'Z') ? ltr : '?';
-                json += "\",\"c\":";
-                json += std::to_string(static_cast<int>(cell.confidence * 100));
-                json += ",\"s\":";
-                json += std::to_string(cell.subscript);
-                json += ",\"b\":";
-                json += cell.is_blank ? "true" : "false";
-                // Top-5 candidates
-                json += ",\"cands\":[";
-                for (int k = 0; k < 5; k++) {
-                    if (cell.cand_letters[k] == 0) break;
-                    if (k > 0) json += ",";
-                    json += "{\"l\":\"";
-                    json += cell.cand_letters[k];
-                    json += "\",\"c\":";
-                    json += std::to_string(
-                        static_cast<int>(cell.cand_scores[k] * 100));
-                    json += "}";
-                }
-                json += "]";
-                json += "}";
+                w.null();
+                continue;
+            }
+            char ltr = static_cast<char>(std::toupper(
+                static_cast<unsigned char>(cell.letter)));
+            w.begin_object()
+                .key("l").string((ltr >= 'A' && ltr <= 'Z') ? ltr : '?')
+                .key("c").number(static_cast<int>(cell.confidence * 100))
+                .key("s").number(cell.subscript)
+                .key("b").boolean(cell.is_blank);
+            // Top-5 candidates
+            w.key("cands").begin_array();
+            for (int k = 0; k < 5; k++) {
+                if (cell.cand_letters[k] == 0) break;
+                w.begin_object()
+                    .key("l").string(cell.cand_letters[k])
+                    .key("c").number(static_cast<int>(cell.cand_scores[k] * 100))
+                    .end_object();
             }
+            w.end_array().end_object();
         }
-        json += "]";
+        w.end_array();
     }
-    json += "]";
+    w.end_array();
 
-    if (!dr.debug_png.empty()) {
-        json += ",\"debug_image\":\"data:image/png;base64,"
-              + base64_encode(dr.debug_png) + "\"";
-    }
-    if (!dr.log.empty()) {
-        json += ",\"log\":\"" + json_escape(dr.log) + "\"";
-    }
-    json += "}";
-    return json;
+    if (!dr.debug_png.empty()) w.key("debug_image").png_data_uri(dr.debug_png);
+    if (!dr.log.empty()) w.key("log").string(dr.log);
+}
+
+// ---------------------------------------------------------------------------
+// Server metrics, scraped from GET /metrics.  Series are registered once
+// (below and in the lookup tables); recording is lock-free, see metrics.h.
+// ---------------------------------------------------------------------------
+struct ServerMetrics {
+    Gauge analyses_in_flight_opencv = metrics_gauge(
+        "cgptest_analyses_in_flight", "kind=\"opencv\"", "Analyses currently streaming");
+    Gauge analyses_in_flight_gemini = metrics_gauge(
+        "cgptest_analyses_in_flight", "kind=\"gemini\"", "Analyses currently streaming");
+    Histogram analysis_opencv = metrics_histogram(
+        "cgptest_analysis_duration_seconds", "kind=\"opencv\"",
+        "End-to-end analysis time, including streaming the response");
+    Histogram analysis_gemini = metrics_histogram(
+        "cgptest_analysis_duration_seconds", "kind=\"gemini\"",
+        "End-to-end analysis time, including streaming the response");
+    Counter gemini_cache_hits = metrics_counter(
+        "cgptest_cache_lookups_total", "cache=\"gemini\",result=\"hit\"",
+        "Cache lookups by cache and outcome");
+    Counter gemini_cache_misses = metrics_counter(
+        "cgptest_cache_lookups_total", "cache=\"gemini\",result=\"miss\"",
+        "Cache lookups by cache and outcome");
+    Counter board_cache_hits_opencv = metrics_counter(
+        "cgptest_cache_lookups_total", "cache=\"board_opencv\",result=\"hit\"",
+        "Cache lookups by cache and outcome");
+    Counter board_cache_misses_opencv = metrics_counter(
+        "cgptest_cache_lookups_total", "cache=\"board_opencv\",result=\"miss\"",
+        "Cache lookups by cache and outcome");
+    Counter board_cache_hits_gemini = metrics_counter(
+        "cgptest_cache_lookups_total", "cache=\"board_gemini\",result=\"hit\"",
+        "Cache lookups by cache and outcome");
+    Counter board_cache_misses_gemini = metrics_counter(
+        "cgptest_cache_lookups_total", "cache=\"board_gemini\",result=\"miss\"",
+        "Cache lookups by cache and outcome");
+    Histogram woogles_lookup = metrics_histogram(
+        "cgptest_woogles_lookup_duration_seconds", "",
+        "Time spent in woogles_lookup.py");
+    Counter woogles_found = metrics_counter(
+        "cgptest_woogles_lookups_total", "result=\"found\"", "Woogles lookups by outcome");
+    Counter woogles_none = metrics_counter(
+        "cgptest_woogles_lookups_total", "result=\"none\"", "Woogles lookups by outcome");
+    Counter analyses_coalesced_opencv = metrics_counter(
+        "cgptest_analyses_coalesced_total", "kind=\"opencv\"",
+        "Requests served by an identical analysis already in flight");
+    Counter analyses_coalesced_gemini = metrics_counter(
+        "cgptest_analyses_coalesced_total", "kind=\"gemini\"",
+        "Requests served by an identical analysis already in flight");
+    Counter word_crop_batches = metrics_counter(
+        "cgptest_gemini_word_crop_batches_total", "",
+        "Word-crop Gemini requests sent by the batcher (GEMINI_BATCH_MS)");
+    Counter word_crop_batched_requests = metrics_counter(
+        "cgptest_gemini_word_crop_batched_requests_total", "",
+        "Per-analysis word-crop requests packed into those batches");
+    Gauge queue_depth = metrics_gauge(
+        "cgptest_thread_pool_queue_depth", "", "Connections waiting for a worker");
+    Gauge busy_workers = metrics_gauge(
+        "cgptest_thread_pool_busy_workers", "", "Workers handling a connection");
+};
+static ServerMetrics g_metrics;
+
+struct EndpointMetrics {
+    std::string route;
+    Counter requests;
+    Counter errors;  // status >= 400
+    Histogram latency;
+};
+
+// Per-route series.  Paths are reduced to their first segment
+// ("/testdata-image/x.png" -> "/testdata-image") and anything not served
+// here is counted as "other", so the label set stays fixed.
+static EndpointMetrics& endpoint_metrics(const std::string& path) {
+    static std::vector<EndpointMetrics> table = [] {
+        static const char* const routes[] = {
+            "/", "/analyze", "/analyze-gemini", "/fetch-url", "/save-test",
+            "/run-tests", "/eval-save", "/eval-summary", "/eval",
+            "/testdata-list", "/testdata-image", "/testdata-debug",
+            "/testdata-cgp", "/unlabeled-list", "/save-label", "/label",
+            "/metrics", "other"};
+        std::vector<EndpointMetrics> t;
+        for (const char* r : routes) {
+            std::string lbl = std::string("endpoint=\"") + r + "\"";
+            t.push_back({r,
+                metrics_counter("cgptest_http_requests_total", lbl, "HTTP requests by route"),
+                metrics_counter("cgptest_http_errors_total", lbl,
+                                "HTTP responses with status >= 400 by route"),
+                metrics_histogram("cgptest_http_request_duration_seconds", lbl,
+                                  "Request time by route, including streamed bodies")});
+        }
+        return t;
+    }();
+    std::string route = path.substr(0, path.find('/', 1));
+    for (auto& e : table)
+        if (e.route == route) return e;
+    return table.back();
+}
+
+// Gemini models: the main model reads the page and racks, word crops go to
+// both.  Part of the Gemini board cache key.
+static const char* const GEMINI_MAIN_MODEL = "gemini-2.5-flash";
+static const char* const GEMINI_FAST_MODEL = "gemini-2.0-flash";
+
+struct GeminiModelMetrics {
+    std::string model;
+    Counter calls;     // uncached calls
+    Counter retries;   // extra attempts after an empty response
+    Counter failures;  // still empty after the last attempt
+    Histogram latency; // whole call, retries included
+};
+
+static GeminiModelMetrics& gemini_metrics(const std::string& url) {
+    static std::vector<GeminiModelMetrics> table = [] {
+        std::vector<GeminiModelMetrics> t;
+        for (const char* m : {GEMINI_MAIN_MODEL, GEMINI_FAST_MODEL, "other"}) {
+            std::string lbl = std::string("model=\"") + m + "\"";
+            t.push_back({m,
+                metrics_counter("cgptest_gemini_calls_total", lbl, "Uncached Gemini calls"),
+                metrics_counter("cgptest_gemini_retries_total", lbl,
+                                "Gemini retries after an empty response"),
+                metrics_counter("cgptest_gemini_failures_total", lbl,
+                                "Gemini calls with no text after all retries"),
+                metrics_histogram("cgptest_gemini_call_duration_seconds", lbl,
+                                  "Gemini call time, retries included")});
+        }
+        return t;
+    }();
+    size_t a = url.find("models/");
+    size_t b = url.find(':', a == std::string::npos ? 0 : a);
+    std::string model = (a == std::string::npos || b == std::string::npos)
+        ? "" : url.substr(a + 7, b - a - 7);
+    for (auto& g : table)
+        if (g.model == model) return g;
+    return table.back();
+}
+
+// Feed DebugResult::stages into the per-stage histograms.
+static void record_pipeline_stages(const DebugResult& dr) {
+    static const char* const stages[] = {"decode", "detect", "detect_hook", "extract",
+                                         "prior_verify", "classify", "retry", "format",
+                                         "debug_image", "progress"};
+    static std::vector<Histogram> hists = [] {
+        std::vector<Histogram> h;
+        for (const char* st : stages)
+            h.push_back(metrics_histogram("cgptest_pipeline_stage_duration_seconds",
+                                          std::string("stage=\"") + st + "\"",
+                                          "OpenCV pipeline time by stage"));
+        return h;
+    }();
+    for (const StageTiming& st : dr.stages)
+        for (size_t i = 0; i < hists.size(); i++)
+            if (std::strcmp(st.stage, stages[i]) == 0) hists[i].observe_ms(st.ms);
 }
 
 // ---------------------------------------------------------------------------
@@ -408,9 +525,15 @@ static GeminiCallResult call_gemini(const std::string& url,
             result.cached = true;
             result.attempts = 0;
             gemini_log(log_label + " [CACHED]", log_prompt, result.text);
+            g_metrics.gemini_cache_hits.inc();
             return result;
         }
     }
+    g_metrics.gemini_cache_misses.inc();
+
+    GeminiModelMetrics& gm = gemini_metrics(url);
+    gm.calls.inc();
+    ScopedTimer call_timer(gm.latency);
 
     for (int attempt = 0; attempt <= max_retries; attempt++) {
         result.attempts = attempt + 1;
@@ -466,6 +589,8 @@ static GeminiCallResult call_gemini(const std::string& url,
         }
     }
 
+    if (result.attempts > 1) gm.retries.inc(result.attempts - 1);
+    if (result.text.empty()) gm.failures.inc();
     return result;
 }
 
@@ -714,1136 +839,274 @@ static int run_tests_cli() {
 }
 
 // ---------------------------------------------------------------------------
-// Embedded single-page UI.
+// Progress NDJSON line (no cells/cgp, just status + log + image).
 // ---------------------------------------------------------------------------
-static const char* HTML = R"html(<!DOCTYPE html>
-<html lang="en">
-<head>
-<meta charset="utf-8">
-<title>CGP Bot — Test Bench</title>
-<style>
-*{margin:0;padding:0;box-sizing:border-box}
-body{
-  font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',system-ui,sans-serif;
-  background:#1a1a2e;color:#e0e0e0;min-height:100vh;padding:24px;
-}
-h1{font-size:1.4rem;margin-bottom:20px;color:#fff;font-weight:600}
-.layout{display:grid;grid-template-columns:180px 1fr 1fr;gap:20px;max-width:1600px;margin:0 auto}
-.sidebar{display:flex;flex-direction:column;gap:12px}
-.sidebar-panel{background:#16213e;border-radius:12px;padding:14px;border:1px solid #2a2a4a}
-.sidebar-panel h2{font-size:.7rem;text-transform:uppercase;letter-spacing:.1em;color:#888;margin-bottom:10px}
-.test-list{list-style:none}
-.test-list li{padding:4px 6px;border-radius:4px;cursor:pointer;font-size:.75rem;color:#aaa;display:flex;align-items:center;gap:6px}
-.test-list li:hover{background:#1e2d50;color:#fff}
-.test-list li.active{background:#1e2d50;color:#58a6ff}
-.test-list li.running{background:#1a1630;color:#aaf}
-.test-list .dot{width:6px;height:6px;border-radius:50%;flex-shrink:0;background:#555}
-.test-list li.pass .dot{background:#4c4}
-.test-list li.fail .dot{background:#f44}
-.test-list li.running .dot{width:auto;height:auto;background:none;border-radius:0;color:#88f;font-size:.85rem;line-height:1}
-.panel{background:#16213e;border-radius:12px;padding:20px;border:1px solid #2a2a4a}
-.panel h2{font-size:.8rem;text-transform:uppercase;letter-spacing:.1em;color:#888;margin-bottom:12px}
-
-/* drop zone */
-#drop-zone{
-  border:2px dashed #444;border-radius:12px;padding:60px 20px;
-  text-align:center;cursor:pointer;transition:all .2s;background:#1a1a2e;
-}
-#drop-zone.dragover{border-color:#6c63ff;background:#1e1e3f}
-#drop-zone p{color:#666}
-#preview{max-width:100%;max-height:400px;border-radius:8px;display:none;margin-top:12px}
-#debug-img{max-width:100%;max-height:400px;border-radius:8px;display:none;margin-top:12px}
-#debug-log{
-  max-height:200px;overflow-y:auto;font-size:.75rem;color:#8b8;
-  font-family:'SF Mono','Fira Code',monospace;margin-top:8px;
-  background:#0d1117;border-radius:8px;padding:8px;display:none;
-  white-space:pre-wrap;
-}
-
-/* cgp field */
-#cgp-output{
-  width:100%;background:#0d1117;border:1px solid #333;border-radius:8px;
-  color:#58a6ff;font-family:'SF Mono','Fira Code',monospace;font-size:.85rem;
-  padding:12px;resize:vertical;min-height:60px;
-}
-.btn-row{display:flex;gap:8px;justify-content:flex-end;margin-bottom:8px;flex-wrap:wrap}
-.btn{
-  background:#333;border:1px solid #555;color:#ccc;padding:4px 12px;
-  border-radius:4px;cursor:pointer;font-size:.75rem;
-}
-.btn:hover{background:#444}
-
-/* board grid */
-.board-wrapper{display:inline-grid;grid-template-columns:28px auto;grid-template-rows:auto auto;gap:0}
-.col-labels{display:grid;grid-template-columns:repeat(15,36px);gap:1px;padding-left:0;margin-left:0}
-.col-labels span{text-align:center;font-size:.7rem;color:#666;line-height:22px}
-.row-labels-and-board{display:grid;grid-template-columns:28px auto;gap:0}
-.row-labels{display:grid;grid-template-rows:repeat(15,36px);gap:1px}
-.row-labels span{
-  display:flex;align-items:center;justify-content:flex-end;
-  padding-right:4px;font-size:.7rem;color:#666;
-}
-.board{display:grid;grid-template-columns:repeat(15,36px);grid-template-rows:repeat(15,36px);gap:1px;background:#333;border:2px solid #333;border-radius:4px}
-.cell{
-  display:flex;align-items:center;justify-content:center;
-  font-weight:700;font-size:.9rem;position:relative;cursor:pointer;
-}
-.cell.tile{background:#f5deb3;color:#1a1a1a}
-.cell.blank-tile{background:#c8b888;color:#555}
-.cell.tw{background:#c0392b;color:rgba(255,255,255,.55)}
-.cell.dw{background:#e88b8b;color:rgba(255,255,255,.55)}
-.cell.tl{background:#2980b9;color:rgba(255,255,255,.55)}
-.cell.dl{background:#7ec8e3;color:rgba(255,255,255,.55)}
-.cell.normal{background:#1b7a3d}
-.cell.center{background:#e88b8b;color:rgba(255,255,255,.55)}
-.cell .lbl{font-size:.5rem;font-weight:400}
-.cell .sub{position:absolute;bottom:1px;right:2px;font-size:.45rem;font-weight:400;opacity:.7}
-.cell.has-tip{cursor:pointer}
-.cell.selected{outline:2px solid #ffeb3b;outline-offset:-2px;z-index:1}
-.cell.edited{box-shadow:inset 0 0 0 2px rgba(255,165,0,0.6)}
-.cell.diff-wrong{outline:2px solid #f44;outline-offset:-2px;z-index:1}
-.cell.diff-wrong .diff-exp{position:absolute;top:1px;left:2px;font-size:.45rem;color:#f88;font-weight:700}
-#tip{
-  display:none;position:fixed;background:#0d1117;color:#c9d1d9;
-  border:1px solid #444;border-radius:6px;padding:8px 10px;
-  font-size:.75rem;font-family:'SF Mono','Fira Code',monospace;
-  white-space:pre;pointer-events:none;z-index:100;max-width:320px;
-  line-height:1.4;
-}
-
-/* rack */
-.rack{display:flex;gap:4px;margin-top:16px;justify-content:center}
-.rack-tile{
-  width:40px;height:40px;background:#f5deb3;color:#1a1a1a;
-  display:flex;align-items:center;justify-content:center;
-  font-weight:700;font-size:1.1rem;border-radius:4px;
-}
-.rack-tile.blank{background:#c8b888;color:#555}
-
-/* test results */
-.test-results{width:100%;border-collapse:collapse;font-size:.8rem;margin-top:8px}
-.test-results th,.test-results td{padding:4px 8px;border:1px solid #333;text-align:left}
-.test-results th{background:#1a1a2e;color:#888}
-.test-results td{color:#ccc}
-.test-diff{font-size:.75rem;color:#f88;margin-top:4px;font-family:'SF Mono','Fira Code',monospace}
-
-#status{margin-top:8px;font-size:.8rem;color:#666}
-</style>
-</head>
-<body>
-<h1>CGP Bot &mdash; Test Bench</h1>
-<div class="layout">
-  <div class="sidebar">
-    <div class="sidebar-panel">
-      <h2>Test Cases</h2>
-      <ul class="test-list" id="test-list"></ul>
-    </div>
-    <div class="sidebar-panel">
-      <h2>Last Eval</h2>
-      <div id="eval-summary-bar">
-        <div id="eval-summary-acc" style="font-size:.85rem;font-weight:600;color:#4c4;margin-bottom:2px"></div>
-        <div id="eval-summary-time" style="font-size:.7rem;color:#666;margin-bottom:6px"></div>
-        <a href="/eval" target="_blank" style="font-size:.72rem;color:#58a6ff;text-decoration:none">details &rarr;</a>
-        &nbsp;<button class="btn" style="font-size:.65rem;padding:2px 6px" onclick="evalAllGemini()">re-run</button>
-      </div>
-      <div id="eval-summary-none" style="font-size:.72rem;color:#555">
-        No eval yet.<br>
-        <button class="btn" style="font-size:.65rem;padding:2px 6px;margin-top:6px" onclick="evalAllGemini()">Run eval</button>
-      </div>
-    </div>
-  </div>
-  <div>
-    <div class="panel">
-      <h2>Input</h2>
-      <label style="display:flex;align-items:center;gap:8px;margin-bottom:12px;cursor:pointer;font-size:.85rem">
-        <input type="checkbox" id="use-gemini" checked> Use Gemini Flash
-      </label>
-      <div id="drop-zone">
-        <p>Drop a board screenshot here</p>
-        <p style="font-size:.8rem;margin-top:8px">or click to select a file &mdash; also accepts image URLs (e.g. from Discord)</p>
-      </div>
-      <img id="preview">
-      <p id="status"></p>
-    </div>
-    <div class="panel" style="margin-top:20px">
-      <h2>Debug</h2>
-      <img id="debug-img">
-      <pre id="debug-log"></pre>
-      <div id="crops-area" style="display:none;margin-top:12px">
-        <h3 style="font-size:.85rem;color:#aaa;margin-bottom:8px">Verification Crops</h3>
-        <div id="crops-container" style="display:flex;flex-wrap:wrap;gap:8px"></div>
-      </div>
-      <div id="transposed-area" style="display:none;margin-top:16px">
-        <h3 style="font-size:.85rem;color:#aaa;margin-bottom:8px">Transposed Board OCR (columns as rows)</h3>
-        <img id="transposed-img" style="max-width:100%;border-radius:6px;image-rendering:pixelated">
-        <div id="transposed-disagree" style="margin-top:8px;font-size:.75rem;line-height:2"></div>
-      </div>
-      <div id="trail-area" style="display:none;margin-top:16px">
-        <h3 style="font-size:.85rem;color:#aaa;margin-bottom:6px">OCR Trail</h3>
-        <div id="trail-raw-cgp" style="font-family:monospace;font-size:.7rem;color:#888;word-break:break-all;margin-bottom:8px;background:#111;padding:6px;border-radius:4px"></div>
-        <div id="trail-table"></div>
-      </div>
-    </div>
-  </div>
-  <div>
-    <div class="panel">
-      <h2>CGP Output</h2>
-      <div class="btn-row">
-        <button class="btn" onclick="renderFromField()">Render</button>
-        <button class="btn" onclick="copyCGP()">Copy</button>
-        <button class="btn" onclick="saveTest()">Save Test</button>
-        <button class="btn" onclick="evalAllGemini()">Eval All</button>
-        <button class="btn" id="eval-stop-btn" onclick="evalStop()" style="display:none;background:#a33">Stop Eval</button>
-      </div>
-      <textarea id="cgp-output" rows="3" spellcheck="false"></textarea>
-      <div id="woogles-area" style="display:none;margin-top:8px;padding:8px 12px;background:#0f1f0f;border:1px solid #2a3a2a;border-radius:6px;font-size:.82rem"></div>
-    </div>
-    <div class="panel" style="margin-top:20px">
-      <h2>Board</h2>
-      <div id="board-area"></div>
-      <div id="diff-summary" style="display:none;margin-top:10px;font-size:.75rem;font-family:'SF Mono','Fira Code',monospace"></div>
-    </div>
-    <div id="eval-panel" class="panel" style="margin-top:20px;display:none">
-      <h2>Gemini Eval</h2>
-      <div id="eval-results"></div>
-    </div>
-  </div>
-</div>
-<div id="tip"></div>
-<input type="file" id="file-input" accept="image/*" hidden>
-<script>
-const PREMIUM=[
-  [4,0,0,1,0,0,0,4,0,0,0,1,0,0,4],
-  [0,3,0,0,0,2,0,0,0,2,0,0,0,3,0],
-  [0,0,3,0,0,0,1,0,1,0,0,0,3,0,0],
-  [1,0,0,3,0,0,0,1,0,0,0,3,0,0,1],
-  [0,0,0,0,3,0,0,0,0,0,3,0,0,0,0],
-  [0,2,0,0,0,2,0,0,0,2,0,0,0,2,0],
-  [0,0,1,0,0,0,1,0,1,0,0,0,1,0,0],
-  [4,0,0,1,0,0,0,5,0,0,0,1,0,0,4],
-  [0,0,1,0,0,0,1,0,1,0,0,0,1,0,0],
-  [0,2,0,0,0,2,0,0,0,2,0,0,0,2,0],
-  [0,0,0,0,3,0,0,0,0,0,3,0,0,0,0],
-  [1,0,0,3,0,0,0,1,0,0,0,3,0,0,1],
-  [0,0,3,0,0,0,1,0,1,0,0,0,3,0,0],
-  [0,3,0,0,0,2,0,0,0,2,0,0,0,3,0],
-  [4,0,0,1,0,0,0,4,0,0,0,1,0,0,4]
-];
-const PCLS=['normal','dl','tl','dw','tw','center'];
-const PLBL=['','DL','TL','DW','TW','\u2605'];
-
-// Point value -> valid letters (for tooltip display)
-const PTS_LETTERS={1:'AEILNORSTU',2:'DG',3:'BCMP',4:'FHVWY',5:'K',8:'JX',10:'QZ'};
-// Letter -> point value
-const LETTER_PTS={};
-for(const[p,ls]of Object.entries(PTS_LETTERS))for(const c of ls)LETTER_PTS[c]=+p;
-
-// Per-cell detail from the last analysis (15x15, null for empty)
-let cellData=null;
-
-// Editable board state
-let boardLetters=Array.from({length:15},()=>Array(15).fill(''));
-let ocrLetters=null;   // snapshot after OCR, for showing edited indicators
-let selectedCell=null; // {r, c} or null
-
-// Test case tracking
-let currentTestCase=null;   // name of currently loaded test case, or null
-let expectedBoard=null;     // 15x15 array of expected letters (from testdata CGP), or null
-
-// Braille spinner for eval progress
-const BRAILLE='\u280b\u2819\u2839\u2838\u283c\u2834\u2826\u2827\u2807\u280f';
-let _spinInterval=null,_spinFrame=0;
-function startSpinner(name){
-  stopSpinner();
-  _spinFrame=0;
-  for(const li of document.querySelectorAll('#test-list li')){
-    li.classList.toggle('running',li.dataset.name===name);
-    if(li.dataset.name===name){const d=li.querySelector('.dot');if(d)d.textContent=BRAILLE[0];}
-  }
-  _spinInterval=setInterval(()=>{
-    _spinFrame=(_spinFrame+1)%BRAILLE.length;
-    const li=document.querySelector('#test-list li.running');
-    if(li){const d=li.querySelector('.dot');if(d)d.textContent=BRAILLE[_spinFrame];}
-  },100);
-}
-function stopSpinner(){
-  if(_spinInterval){clearInterval(_spinInterval);_spinInterval=null;}
-  for(const li of document.querySelectorAll('#test-list li.running')){
-    li.classList.remove('running');
-    const d=li.querySelector('.dot');if(d)d.textContent='';
-  }
-}
-
-// Parse CGP board string -> 15x15 array of chars ('' = empty)
-function parseCGPBoard(cgp){
-  const board=Array.from({length:15},()=>Array(15).fill(''));
-  const boardStr=cgp.split(' ')[0];
-  const rows=boardStr.split('/');
-  for(let r=0;r<Math.min(rows.length,15);r++){
-    let c=0,i=0;
-    while(i<rows[r].length&&c<15){
-      const ch=rows[r][i];
-      if(ch>='0'&&ch<='9'){
-        let n=0;
-        while(i<rows[r].length&&rows[r][i]>='0'&&rows[r][i]<='9')n=n*10+parseInt(rows[r][i++]);
-        c+=n;
-      }else{board[r][c++]=ch;i++;}
-    }
-  }
-  return board;
-}
-let currentRack='';
-let currentLexicon='';
-let currentBag='';
-let currentRackWarning='';
-let currentInvalidWords=null;
-let currentOccupancy=null;
-
-const dropZone=document.getElementById('drop-zone');
-const preview=document.getElementById('preview');
-const fileInput=document.getElementById('file-input');
-const cgpOut=document.getElementById('cgp-output');
-const status=document.getElementById('status');
-const boardArea=document.getElementById('board-area');
-const debugImg=document.getElementById('debug-img');
-const debugLog=document.getElementById('debug-log');
-
-dropZone.addEventListener('click',()=>fileInput.click());
-fileInput.addEventListener('change',e=>{if(e.target.files.length)handleFile(e.target.files[0])});
-dropZone.addEventListener('dragover',e=>{e.preventDefault();dropZone.classList.add('dragover')});
-dropZone.addEventListener('dragleave',()=>dropZone.classList.remove('dragover'));
-dropZone.addEventListener('drop',e=>{
-  e.preventDefault();dropZone.classList.remove('dragover');
-  if(e.dataTransfer.files.length){
-    handleFile(e.dataTransfer.files[0]);
-  }else{
-    const url=e.dataTransfer.getData('text/uri-list')||e.dataTransfer.getData('text/plain')||'';
-    if(url.startsWith('http')){
-      handleURL(url.trim());
-    }
-  }
-});
-
-function showDebug(data){
-  if(data.debug_image){
-    debugImg.src=data.debug_image;
-    debugImg.style.display='block';
-  }else{
-    debugImg.style.display='none';
-  }
-  if(data.log){
-    debugLog.textContent=data.log;
-    debugLog.style.display='block';
-  }else{
-    debugLog.style.display='none';
-  }
-}
-
-async function processStream(res){
-  const reader=res.body.getReader();
-  const decoder=new TextDecoder();
-  let buf='';
-  while(true){
-    const{done,value}=await reader.read();
-    if(done) break;
-    buf+=decoder.decode(value,{stream:true});
-    let idx;
-    while((idx=buf.indexOf('\n'))!==-1){
-      const line=buf.slice(0,idx).trim();
-      buf=buf.slice(idx+1);
-      if(!line) continue;
-      try{
-        const data=JSON.parse(line);
-        if(data.status) status.textContent=data.status+'\u2026';
-        if(data.debug_image){debugImg.src=data.debug_image;debugImg.style.display='block';}
-        if(data.log){debugLog.textContent=data.log;debugLog.style.display='block';}
-        if(data.crops){
-          const ca=document.getElementById('crops-area');
-          const cc=document.getElementById('crops-container');
-          cc.innerHTML='';
-          for(const crop of data.crops){
-            const d=document.createElement('div');
-            d.style.cssText='text-align:center;background:#1a1a2e;border-radius:6px;padding:6px;min-width:60px';
-            const lbl=crop.initial&&crop.initial!==crop.cur
-              ?`${crop.initial}<span style="color:#fa8">\u2192${crop.cur}</span>`
-              :crop.cur;
-            d.innerHTML=`<img src="${crop.img}" style="width:48px;height:48px;image-rendering:pixelated;border-radius:4px"><div style="font-size:.7rem;color:#ccc;margin-top:4px">${crop.pos}: ${lbl}</div>`;
-            cc.appendChild(d);
-          }
-          ca.style.display='block';
-        }
-        if(data.transposed_image){
-          document.getElementById('transposed-img').src=data.transposed_image;
-          document.getElementById('transposed-area').style.display='block';
-        }
-        if(data.transposed_disagree){
-          const td=document.getElementById('transposed-disagree');
-          if(data.transposed_disagree.length===0){
-            td.innerHTML='<span style="color:#8f8">&#10003; Transposed OCR agrees with main OCR on all occupied cells.</span>';
-          }else{
-            td.innerHTML='Raw OCR disagreements (main\u2192trans): '+data.transposed_disagree.map(
-              x=>`<span style="background:#2a1010;border:1px solid #a33;padding:1px 6px;border-radius:3px;margin:2px;display:inline-block">${x.pos}: <b>${x.orig}</b>&rarr;<b style="color:#f88">${x.trans}</b></span>`
-            ).join(' ');
-          }
-        }
-        if(data.raw_main_cgp){
-          document.getElementById('trail-raw-cgp').textContent='Raw main OCR: '+data.raw_main_cgp;
-          document.getElementById('trail-area').style.display='block';
-        }
-        if(data.ocr_trail&&data.ocr_trail.length>0){
-          const ta=document.getElementById('trail-area');
-          ta.style.display='block';
-          const tbl=document.getElementById('trail-table');
-          let h='<table style="font-size:.72rem;border-collapse:collapse;width:100%">';
-          h+='<tr style="color:#888"><th style="text-align:left;padding:2px 6px">Cell</th><th style="padding:2px 6px">Raw Main</th><th style="padding:2px 6px">Trans OCR</th><th style="padding:2px 6px">Final</th><th style="text-align:left;padding:2px 6px">Note</th></tr>';
-          for(const e of data.ocr_trail){
-            const raw=e.raw||'\u2014';
-            const trans=e.trans||'\u2014';
-            const fin=e.final||'\u2014';
-            let note='corrected',bg='#1a0a1a',nc='#d8a';
-            if(e.trans&&e.trans===e.final&&e.raw!==e.final){note='trans helped';bg='#0a1f0a';nc='#8f8';}
-            else if(e.raw===e.final&&e.trans&&e.trans!==e.final){note='trans wrong';bg='#1f1a00';nc='#bb8';}
-            h+=`<tr style="background:${bg}"><td style="padding:2px 8px;font-weight:bold">${e.pos}</td><td style="text-align:center;padding:2px 8px">${raw}</td><td style="text-align:center;padding:2px 8px">${trans}</td><td style="text-align:center;padding:2px 8px;font-weight:bold">${fin}</td><td style="padding:2px 8px;color:${nc}">${note}</td></tr>`;
-          }
-          h+='</table>';
-          tbl.innerHTML=h;
-        }
-        if(data.cgp){
-          cgpOut.value=data.cgp;
-          cellData=data.cells||null;
-          currentBag=data.bag||'';
-          currentRackWarning=data.rack_warning||'';
-          currentInvalidWords=data.invalid_words||null;
-          currentOccupancy=data.occupancy||null;
-          selectedCell=null;
-          renderBoard(data.cgp);
-          ocrLetters=boardLetters.map(row=>[...row]);
-          if(!data.status) status.textContent='Done.';
-          if(currentTestCase) updateDiffSummary(data.cgp);
-          // Clear previous woogles result while lookup runs
-          const wa=document.getElementById('woogles-area');
-          wa.style.display='none'; wa.innerHTML='';
-        }
-        if('woogles' in data){
-          const w=data.woogles;
-          const wa=document.getElementById('woogles-area');
-          if(w&&w.game_id){
-            const url=`https://woogles.io/game/${w.game_id}?turn=${w.turn}`;
-            const ps=(w.players||[]).join(' vs ');
-            const lex=w.lexicon?` &middot; ${w.lexicon}`:'';
-            const sim=w.similarity!=null?` &middot; sim&nbsp;${w.similarity.toFixed(3)}`:'';
-            wa.innerHTML=`<span style="color:#8f8">&#9654;</span>&nbsp;<a href="${url}" target="_blank" style="color:#58a6ff;font-weight:600">${w.game_id} turn&nbsp;${w.turn}</a>`
-              +(ps?`&nbsp;&nbsp;<span style="color:#aaa">${ps}</span>`:'')
-              +lex+sim;
-          }else{
-            wa.innerHTML='<span style="color:#666">No Woogles match found.</span>';
-          }
-          wa.style.display='block';
-          if(!document.getElementById('status').textContent.startsWith('Error'))
-            status.textContent='Done.';
-        }
-      }catch(e){}
-    }
-  }
-}
-
-async function handleFile(file){
-  preview.src=URL.createObjectURL(file);
-  preview.style.display='block';
-  status.textContent='Uploading\u2026';
-  const form=new FormData();
-  form.append('image',file);
-  try{
-    const endpoint=document.getElementById('use-gemini').checked?'/analyze-gemini':'/analyze';
-    const res=await fetch(endpoint,{method:'POST',body:form});
-    await processStream(res);
-  }catch(err){status.textContent='Error: '+err.message}
+static void write_progress_line(JsonWriter& w, const char* status,
+                                const std::string& log_text,
+                                const std::vector<uint8_t>& debug_png) {
+    w.begin_object().key("status").string(status);
+    if (!log_text.empty()) w.key("log").string(log_text);
+    if (!debug_png.empty()) w.key("debug_image").png_data_uri(debug_png);
+    w.end_object().line();
 }
 
-async function handleURL(url){
-  preview.src=url;
-  preview.style.display='block';
-  status.textContent='Fetching URL\u2026';
-  const useGemini=document.getElementById('use-gemini').checked;
-  try{
-    const res=await fetch('/fetch-url',{
-      method:'POST',
-      headers:{'Content-Type':'application/json'},
-      body:JSON.stringify({url,method:useGemini?'gemini':'template'})
-    });
-    await processStream(res);
-  }catch(err){status.textContent='Error: '+err.message}
+// One entry of a status line's "crops" array: board position or rack slot,
+// current letter, the first OCR's letter when it differed (0: omitted), and
+// the crop image as a data URI.
+static void write_crop_preview(JsonWriter& w, std::string_view pos, char cur,
+                               char initial, std::string_view b64) {
+    w.begin_object().key("pos").string(pos).key("cur").string(cur);
+    if (initial && initial != cur) w.key("initial").string(initial);
+    w.key("img").png_data_uri(b64).end_object();
 }
 
-function parseCGP(cgp){
-  const parts=cgp.trim().split(/\s+/);
-  const boardStr=parts[0]||'';
-  const rackStr=parts[1]||'';
-  const racks=rackStr.split('/');
-  const rack=racks[0]||'';
-
-  const rows=boardStr.split('/');
-  const board=[];
-  for(const row of rows){
-    const cells=[];
-    let i=0;
-    while(i<row.length){
-      if(/[0-9]/.test(row[i])){
-        let n='';
-        while(i<row.length&&/[0-9]/.test(row[i])){n+=row[i];i++}
-        for(let j=0;j<parseInt(n);j++)cells.push('');
-      }else{cells.push(row[i]);i++}
-    }
-    while(cells.length<15)cells.push('');
-    board.push(cells);
-  }
-  while(board.length<15)board.push(Array(15).fill(''));
-  // Extract lexicon: "lex NWL23;" at end of CGP
-  let lexicon='';
-  const lexMatch=cgp.match(/lex\s+(\S+?);/);
-  if(lexMatch) lexicon=lexMatch[1];
-  return{board,rack,lexicon};
-}
+// cells_to_cgp from gemini_parse.h (included later for other uses too)
+#include "gemini_parse.h"
 
-const tipEl=document.getElementById('tip');
-
-function cellTooltip(r,c){
-  if(!cellData||!cellData[r]||!cellData[r][c]) return null;
-  const d=cellData[r][c];
-  const lines=[];
-  lines.push(`[${String.fromCharCode(65+c)}${r+1}]  Letter: ${d.l}  (${d.c}%)`);
-  if(d.b) lines.push('Blank tile (no point value)');
-  if(d.cands&&d.cands.length>0){
-    lines.push('Candidates:');
-    for(const cd of d.cands){
-      const pts=LETTER_PTS[cd.l]||0;
-      const bar='\u2588'.repeat(Math.max(1,Math.round(cd.c/10)));
-      lines.push(`  ${cd.l} (${pts}pt) ${bar} ${cd.c}%`);
+// ---------------------------------------------------------------------------
+// Near-duplicate caches for /analyze and /analyze-gemini (board_cache.h).
+// The pipeline's stage-1 hook fingerprints the detected board and stops on
+// a verified hit; the endpoint then replays the stored result.  Only with
+// CGP_BOARD_CACHE=1 (board_cache_enabled()).
+// ---------------------------------------------------------------------------
+static BoardCache g_board_cache_opencv;  // extra = {rack string}
+static BoardCache g_board_cache_gemini;  // extra = {final fields, Woogles JSON}
+
+struct BoardCacheProbe {
+    BoardCache& cache;
+    std::string key;  // every option that changes the result
+    BoardSignature sig;
+    bool have_sig = false;
+    bool hit = false;
+    CachedBoard value;
+
+    DetectCallback hook() {
+        return [this](const cv::Mat& bgr, const cv::Rect& rect, int cell_size, bool) {
+            if (!board_cache_enabled()) return false;
+            have_sig = compute_board_signature(bgr, rect, cell_size, sig);
+            hit = have_sig && cache.lookup(sig, key, value);
+            return hit;
+        };
     }
-  }
-  return lines.join('\n');
-}
 
-function setupTips(){
-  boardArea.addEventListener('mouseover',e=>{
-    const cell=e.target.closest('.has-tip');
-    if(!cell) return;
-    const r=+cell.dataset.r, c=+cell.dataset.c;
-    const text=cellTooltip(r,c);
-    if(!text){tipEl.style.display='none';return;}
-    tipEl.textContent=text;
-    tipEl.style.display='block';
-  });
-  boardArea.addEventListener('mousemove',e=>{
-    if(tipEl.style.display==='block'){
-      tipEl.style.left=(e.clientX+12)+'px';
-      tipEl.style.top=(e.clientY+12)+'px';
+    void store(const DebugResult& dr, std::vector<std::string> extra) {
+        if (!have_sig) return;
+        CachedBoard v;
+        v.key = key;
+        v.cgp = dr.cgp;
+        std::memcpy(v.cells, dr.cells, sizeof(v.cells));
+        v.extra = std::move(extra);
+        cache.store(sig, v);
     }
-  });
-  boardArea.addEventListener('mouseout',e=>{
-    const cell=e.target.closest('.has-tip');
-    if(cell&&!cell.contains(e.relatedTarget)) tipEl.style.display='none';
-  });
-}
-setupTips();
-
-// --- Board editing ---
-
-function boardToCGP(letters){
-  let rows=[];
-  for(let r=0;r<15;r++){
-    let row='';
-    let empty=0;
-    for(let c=0;c<15;c++){
-      if(!letters[r][c]){
-        empty++;
-      }else{
-        if(empty>0){row+=empty;empty=0;}
-        row+=letters[r][c];
-      }
-    }
-    if(empty>0) row+=empty;
-    rows.push(row);
-  }
-  return rows.join('/');
-}
-
-function syncCGP(){
-  const old=cgpOut.value.trim();
-  const parts=old.split(/\s+/);
-  parts[0]=boardToCGP(boardLetters);
-  cgpOut.value=parts.join(' ');
-}
+};
 
-function renderBoard(cgp){
-  const{board,rack,lexicon}=parseCGP(cgp);
-  for(let r=0;r<15;r++)
-    for(let c=0;c<15;c++)
-      boardLetters[r][c]=board[r][c];
-  currentRack=rack;
-  currentLexicon=lexicon;
-  renderBoardUI();
+// Fill a stage-1-only DebugResult from a cache hit (grid-only debug image).
+static void apply_board_cache_hit(DebugResult& dr, const CachedBoard& hit,
+                                  const std::vector<uint8_t>& buf) {
+    std::memcpy(dr.cells, hit.cells, sizeof(dr.cells));
+    dr.cgp = hit.cgp;
+    dr.debug_png = render_board_debug(buf, dr.board_rect);
+    dr.origin = {};
+    dr.log += "Board cache hit (near-duplicate screenshot)\nCGP: " + dr.cgp + "\n";
 }
 
-function renderBoardUI(){
-  let h='<div class="board-wrapper"><div style="width:28px"></div><div class="col-labels">';
-  for(let c=0;c<15;c++)h+=`<span>${String.fromCharCode(65+c)}</span>`;
-  h+='</div><div class="row-labels-and-board"><div class="row-labels">';
-  for(let r=0;r<15;r++)h+=`<span>${r+1}</span>`;
-  h+='</div><div class="board">';
-  for(let r=0;r<15;r++){
-    for(let c=0;c<15;c++){
-      const ch=boardLetters[r][c];
-      const sel=selectedCell&&selectedCell.r===r&&selectedCell.c===c;
-      const selCls=sel?' selected':'';
-      const edited=ocrLetters&&ocrLetters[r][c]!==boardLetters[r][c];
-      const editCls=edited?' edited':'';
-      const expCh=expectedBoard&&expectedBoard[r]&&expectedBoard[r][c]||'';
-      const diffWrong=expCh&&(expCh!==ch); // expected has something that differs from got
-      const diffCls=diffWrong?' diff-wrong':'';
-      if(!ch){
-        const p=PREMIUM[r][c];
-        const expLabel=diffWrong?`<span class="diff-exp">${expCh.toUpperCase()}</span>`:'';
-        h+=`<div class="cell ${PCLS[p]}${selCls}${editCls}${diffCls}" data-r="${r}" data-c="${c}">${expLabel}<span class="lbl">${PLBL[p]}</span></div>`;
-      }else{
-        const blank=ch===ch.toLowerCase();
-        const cls=blank?'blank-tile':'tile';
-        const cd=cellData&&cellData[r]&&cellData[r][c];
-        const hasTip=cd?'has-tip':'';
-        let sub='';
-        if(cd&&cd.s>0) sub=`<span class="sub">${cd.s}</span>`;
-        else if(cd&&!cd.b){
-          const ep=LETTER_PTS[ch.toUpperCase()];
-          if(ep) sub=`<span class="sub" style="opacity:.35">${ep}</span>`;
+// ---------------------------------------------------------------------------
+// Single-flight analyses.  Concurrent requests for the same image and mode
+// (double uploads, re-run scripts) share one run: the first request runs
+// the analysis, later ones follow its output.  Nothing is recorded until a
+// follower attaches; a follower gets the line the leader sent last (the
+// final result if it joined at the very end) and everything after it.  A
+// flight ends with its analysis, so a request after that runs again (and
+// hits the board and Gemini caches).
+// ---------------------------------------------------------------------------
+class AnalysisFlights {
+public:
+    using Image = std::shared_ptr<std::vector<uint8_t>>;
+
+    // Streams the analysis of image in mode (which must name every option
+    // that changes the output) to sink: runs `analyze` if no such analysis
+    // is in flight, else follows the running one (counting it in `joined`).
+    void run(const std::string& mode, const Image& image, httplib::DataSink& sink,
+             const Counter& joined,
+             const std::function<void(httplib::DataSink&)>& analyze) {
+        std::string key = mode + '\n' + std::to_string(image->size()) + ':'
+            + std::to_string(feature_image_hash(*image));
+        std::shared_ptr<Flight> f;
+        bool lead = false;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            auto& slot = flights_[key];
+            if (!slot) {
+                slot = std::make_shared<Flight>();
+                slot->image = image;
+                lead = true;
+            }
+            f = slot;
+        }
+        if (!lead) {
+            // The key is a 64-bit hash; only identical bytes may share.
+            if (*f->image != *image) {
+                analyze(sink);
+                return;
+            }
+            joined.inc();
+            follow(*f, sink);
+            return;
         }
-        const expLabel=diffWrong?`<span class="diff-exp">${expCh.toUpperCase()}</span>`:'';
-        h+=`<div class="cell ${cls} ${hasTip}${selCls}${editCls}${diffCls}" data-r="${r}" data-c="${c}">${expLabel}${ch.toUpperCase()}${sub}</div>`;
-      }
-    }
-  }
-  h+='</div></div></div>';
-  if(currentRack){
-    h+='<div class="rack">';
-    for(const ch of currentRack){
-      if(ch==='?')h+='<div class="rack-tile blank">?</div>';
-      else h+=`<div class="rack-tile">${ch.toUpperCase()}</div>`;
-    }
-    h+='</div>';
-  }
-  if(currentLexicon){
-    h+=`<div style="text-align:center;margin-top:8px;font-size:.75rem;color:#888">Lexicon: ${currentLexicon}</div>`;
-  }
-  if(currentBag){
-    h+=`<div style="text-align:center;margin-top:6px;font-size:.75rem;color:#888">Bag: ${currentBag}</div>`;
-  }
-  if(currentRackWarning){
-    h+=`<div style="text-align:center;margin-top:6px;font-size:.75rem;color:#e44;font-weight:bold">\u26a0 ${currentRackWarning}</div>`;
-  }
-  if(currentInvalidWords&&currentInvalidWords.length>0){
-    h+=`<div style="text-align:center;margin-top:8px;padding:8px;background:#2a1515;border:1px solid #e44;border-radius:6px">`;
-    h+=`<div style="font-size:.75rem;color:#e44;font-weight:bold;margin-bottom:4px">\u26a0 Invalid words</div>`;
-    for(const iw of currentInvalidWords){
-      h+=`<div style="font-size:.8rem;color:#f88;font-family:'SF Mono','Fira Code',monospace">${iw.word} <span style="color:#888">(${iw.pos})</span></div>`;
-    }
-    h+=`</div>`;
-  }
-  if(currentOccupancy){
-    h+=`<div style="margin-top:12px;text-align:center"><div style="font-size:.7rem;color:#888;margin-bottom:4px">Occupancy Mask</div>`;
-    h+=`<div style="display:inline-grid;grid-template-columns:repeat(15,12px);gap:1px">`;
-    for(let r=0;r<15;r++)for(let c=0;c<15;c++){
-      const occ=currentOccupancy[r]&&currentOccupancy[r][c];
-      const bg=occ?'#4a8':'#333';
-      h+=`<div style="width:12px;height:12px;background:${bg};border-radius:1px"></div>`;
-    }
-    h+=`</div></div>`;
-  }
-  boardArea.innerHTML=h;
-}
-
-// Click to select a cell
-boardArea.addEventListener('click',e=>{
-  const cell=e.target.closest('[data-r]');
-  if(!cell){selectedCell=null;renderBoardUI();return;}
-  selectedCell={r:+cell.dataset.r,c:+cell.dataset.c};
-  renderBoardUI();
-});
-
-// Keyboard editing
-document.addEventListener('keydown',e=>{
-  if(!selectedCell) return;
-  if(document.activeElement===cgpOut) return;
-  const{r,c}=selectedCell;
-
-  if(e.key==='Escape'){
-    selectedCell=null;
-    renderBoardUI();
-    return;
-  }
-  if(e.key==='ArrowUp'){e.preventDefault();if(r>0)selectedCell.r--;renderBoardUI();return;}
-  if(e.key==='ArrowDown'){e.preventDefault();if(r<14)selectedCell.r++;renderBoardUI();return;}
-  if(e.key==='ArrowLeft'){e.preventDefault();if(c>0)selectedCell.c--;renderBoardUI();return;}
-  if(e.key==='ArrowRight'){e.preventDefault();if(c<14)selectedCell.c++;renderBoardUI();return;}
-
-  if(e.key==='Backspace'||e.key==='Delete'){
-    e.preventDefault();
-    boardLetters[r][c]='';
-    if(c>0) selectedCell.c--;
-    syncCGP();renderBoardUI();return;
-  }
-  if(e.key==='.'){
-    e.preventDefault();
-    boardLetters[r][c]='';
-    if(c<14) selectedCell.c++;
-    syncCGP();renderBoardUI();return;
-  }
-  // Shift+letter = regular tile (uppercase)
-  if(/^[A-Z]$/.test(e.key)){
-    e.preventDefault();
-    boardLetters[r][c]=e.key;
-    if(c<14) selectedCell.c++;
-    syncCGP();renderBoardUI();return;
-  }
-  // Plain letter = blank tile (lowercase)
-  if(/^[a-z]$/.test(e.key)){
-    e.preventDefault();
-    boardLetters[r][c]=e.key;
-    if(c<14) selectedCell.c++;
-    syncCGP();renderBoardUI();return;
-  }
-});
-
-function renderFromField(){
-  selectedCell=null;
-  cellData=null;
-  ocrLetters=null;
-  renderBoard(cgpOut.value);
-}
-function copyCGP(){navigator.clipboard.writeText(cgpOut.value)}
-
-// --- Save test case ---
-async function saveTest(){
-  const cgp=cgpOut.value.trim();
-  if(!cgp){status.textContent='No CGP to save.';return;}
-  status.textContent='Saving test case\u2026';
-  try{
-    const res=await fetch('/save-test',{
-      method:'POST',
-      headers:{'Content-Type':'application/json'},
-      body:JSON.stringify({cgp})
-    });
-    const data=await res.json();
-    if(data.error){status.textContent='Error: '+data.error;return;}
-    status.textContent='Saved: '+data.saved;
-  }catch(err){status.textContent='Error: '+err.message}
-}
-
-// --- Run tests ---
-async function runTests(){
-  status.textContent='Running tests\u2026';
-  try{
-    const res=await fetch('/run-tests');
-    const data=await res.json();
-    if(data.error){status.textContent='Error: '+data.error;return;}
-    displayTestResults(data);
-    status.textContent='Tests complete.';
-  }catch(err){status.textContent='Error: '+err.message}
-}
-
-function displayTestResults(results){
-  const panel=document.getElementById('test-results-panel');
-  const container=document.getElementById('test-results');
-  if(!results.length){container.innerHTML='<p style="color:#888">No test cases found.</p>';panel.style.display='block';return;}
-  let h='<table class="test-results"><tr><th>Test</th><th>Total</th><th>Correct</th><th>Wrong</th><th>Accuracy</th></tr>';
-  for(const r of results){
-    const pct=r.total>0?(r.correct/r.total*100).toFixed(1):'0.0';
-    const color=r.wrong===0?'#4c4':'#f88';
-    h+=`<tr><td>${r.name}</td><td>${r.total}</td><td>${r.correct}</td><td style="color:${color}">${r.wrong}</td><td>${pct}%</td></tr>`;
-  }
-  h+='</table>';
-  for(const r of results){
-    if(r.diffs&&r.diffs.length>0){
-      h+=`<div class="test-diff"><strong>${r.name} diffs:</strong><br>`;
-      for(const d of r.diffs){
-        h+=`${d.pos}: expected &lsquo;${d.exp}&rsquo; got &lsquo;${d.got}&rsquo;<br>`;
-      }
-      h+='</div>';
-    }
-  }
-  container.innerHTML=h;
-  panel.style.display='block';
-}
-
-function relTime(ts){
-  const d=Math.floor((Date.now()/1000)-ts);
-  if(d<60)return 'just now';
-  if(d<3600)return Math.round(d/60)+'m ago';
-  if(d<86400)return Math.round(d/3600)+'h ago';
-  return Math.round(d/86400)+'d ago';
-}
-
-let testCaseNames=[];
-
-// --- Load test cases into sidebar list ---
-async function loadTestList(){
-  try{
-    const res=await fetch('/testdata-list');
-    const cases=await res.json();
-    testCaseNames=cases.map(c=>c.name);
-    const list=document.getElementById('test-list');
-    list.innerHTML='';
-    for(const tc of cases){
-      const li=document.createElement('li');
-      li.dataset.name=tc.name;
-      li.innerHTML=`<span class="dot"></span>${tc.name}`;
-      li.onclick=()=>loadTestCase(tc.name);
-      list.appendChild(li);
-    }
-  }catch(e){}
-  loadEvalSummary();
-}
-
-// --- Load and display compact eval summary ---
-async function loadEvalSummary(){
-  try{
-    const r=await fetch('/eval-summary');
-    if(!r.ok)throw new Error();
-    const d=await r.json();
-    const pct=(d.correct/d.total_cells*100).toFixed(1);
-    const wrong=d.total_cells-d.correct;
-    document.getElementById('eval-summary-acc').textContent=
-      pct+'% ('+d.correct+'/'+d.total_cells+(wrong?' \u2022 '+wrong+' wrong':'')+')';
-    document.getElementById('eval-summary-time').textContent=relTime(d.timestamp);
-    document.getElementById('eval-summary-bar').style.display='block';
-    document.getElementById('eval-summary-none').style.display='none';
-    // apply pass/fail dots if case results available
-    if(d.cases){
-      const byName={};
-      for(const c of d.cases)byName[c.name]=c;
-      for(const li of document.querySelectorAll('#test-list li')){
-        const c=byName[li.dataset.name];
-        if(c){li.classList.toggle('pass',c.wrong===0);li.classList.toggle('fail',c.wrong>0);}
-      }
-    }
-  }catch(e){
-    document.getElementById('eval-summary-bar').style.display='none';
-    document.getElementById('eval-summary-none').style.display='block';
-  }
-}
 
-// --- Load and submit a test case image ---
-async function loadTestCase(name){
-  if(!name)return;
-  currentTestCase=name;
-  expectedBoard=null;
-  document.getElementById('diff-summary').style.display='none';
-  // highlight active in sidebar
-  for(const li of document.querySelectorAll('#test-list li')){
-    li.classList.toggle('active',li.dataset.name===name);
-  }
-  // Fetch expected CGP
-  try{
-    const r=await fetch('/testdata-cgp/'+encodeURIComponent(name));
-    if(r.ok){const t=await r.text();expectedBoard=parseCGPBoard(t.trim());}
-  }catch(e){}
-  // Fetch image and submit
-  try{
-    const r=await fetch('/testdata-image/'+encodeURIComponent(name));
-    if(!r.ok){status.textContent='Error loading test image.';return;}
-    const blob=await r.blob();
-    const file=new File([blob],name+'.png',{type:'image/png'});
-    preview.src=URL.createObjectURL(blob);
-    preview.style.display='block';
-    handleFile(file);
-  }catch(e){status.textContent='Error: '+e.message;}
-}
+        // Ends the flight even if the analysis throws.
+        struct Land {
+            AnalysisFlights& self;
+            const std::string& key;
+            Flight& f;
+            ~Land() {
+                {
+                    std::lock_guard<std::mutex> lk(self.mu_);
+                    self.flights_.erase(key);
+                }
+                {
+                    std::lock_guard<std::mutex> lk(f.mu);
+                    f.done = true;
+                }
+                f.cv.notify_all();
+            }
+        } land{*this, key, *f};
 
-// --- Update diff summary after a result comes in ---
-function updateDiffSummary(gotCGP){
-  const ds=document.getElementById('diff-summary');
-  if(!expectedBoard||!gotCGP){ds.style.display='none';return;}
-  const got=parseCGPBoard(gotCGP);
-  const diffs=[];
-  for(let r=0;r<15;r++)for(let c=0;c<15;c++){
-    const e=expectedBoard[r][c]||'';
-    const g=got[r][c]||'';
-    if(e||g){
-      if(e!==g){
-        const pos=String.fromCharCode(65+c)+(r+1);
-        diffs.push(`${pos}:exp=${e||'.'} got=${g||'.'}`);
-      }
+        // The leader's own client may go away; the flight carries on for
+        // the followers.
+        httplib::DataSink tee;
+        tee.write = [&](const char* data, size_t len) {
+            bool notify;
+            {
+                std::lock_guard<std::mutex> lk(f->mu);
+                notify = f->followed;
+                if (notify) f->chunks.emplace_back(data, len);
+                else f->last.assign(data, len);  // reuses its capacity
+            }
+            if (notify) f->cv.notify_all();
+            return sink.write(data, len);
+        };
+        tee.is_writable = [&] { return sink.is_writable(); };
+        tee.done = [&] { sink.done(); };
+        analyze(tee);
     }
-  }
-  if(diffs.length===0){
-    ds.innerHTML='<span style="color:#4c4">\u2713 Board matches expected ('+currentTestCase+')</span>';
-  }else{
-    ds.innerHTML=`<span style="color:#f88">\u2717 ${diffs.length} diff(s) vs ${currentTestCase}: </span>`
-      +diffs.map(d=>`<span style="color:#f88">${d}</span>`).join(' ');
-  }
-  ds.style.display='block';
-}
 
-// --- Eval helpers ---
-function stageAccFromBoards(cgpStr,expBoard){
-  if(!cgpStr||!expBoard)return null;
-  const got=parseCGPBoard(cgpStr);
-  let sc=0,st=0;
-  for(let r=0;r<15;r++)for(let c=0;c<15;c++){
-    const e=expBoard[r][c]||'',g=got[r][c]||'';
-    if(e||g){st++;if(e===g)sc++;}
-  }
-  return st?((sc/st)*100).toFixed(1):null;
-}
-function occAccFromBoards(occCGP,expBoard){
-  if(!occCGP||!expBoard)return null;
-  const occ=parseCGPBoard(occCGP);
-  let os=0;
-  for(let r=0;r<15;r++)for(let c=0;c<15;c++)
-    if(!!(expBoard[r][c])===!!(occ[r][c]))os++;
-  return ((os/225)*100).toFixed(1);
-}
-// Shared braille spinner for eval table cells
-let _evalSpinIv=null,_evalSpinF=0;
-function startEvalSpinner(){
-  if(_evalSpinIv)return;
-  _evalSpinF=0;
-  _evalSpinIv=setInterval(()=>{
-    _evalSpinF=(_evalSpinF+1)%BRAILLE.length;
-    for(const el of document.querySelectorAll('.eval-spin'))
-      el.textContent=BRAILLE[_evalSpinF];
-  },100);
-}
-function stopEvalSpinner(){
-  if(_evalSpinIv){clearInterval(_evalSpinIv);_evalSpinIv=null;}
-  for(const el of document.querySelectorAll('.eval-spin'))el.textContent='—';
-}
-const EVAL_SCOLS=['occ','raw','realigned','trans','retry','wc'];
-function evalSetCell(n,col,val){
-  const el=document.getElementById('ec-'+n+'-'+col);
-  if(el)el.innerHTML=val!=null?(val+'%'):'—';
-}
-
-// --- Eval stop ---
-let _evalStopped=false;
-function evalStop(){_evalStopped=true;document.getElementById('eval-stop-btn').style.display='none';}
-
-// --- Eval all test cases sequentially via Gemini ---
-async function evalAllGemini(){
-  _evalStopped=false;
-  document.getElementById('eval-stop-btn').style.display='';
-  const panel=document.getElementById('eval-panel');
-  const results=document.getElementById('eval-results');
-  panel.style.display='block';
-
-  let cases=[];
-  try{const r=await fetch('/testdata-list');cases=await r.json();}
-  catch(e){results.innerHTML='<div style="color:#f88">Error fetching test list.</div>';return;}
-  if(!cases.length){results.innerHTML='<div style="color:#888">No test cases found.</div>';return;}
-
-  const TH=`<tr><th>Case</th><th>Cells</th><th>Correct</th><th>Wrong</th><th>Board%</th><th style="color:#68a">Occ%</th><th style="color:#68a">Raw%</th><th style="color:#68a">Align%</th><th style="color:#68a">Trans%</th><th style="color:#68a">Retry%</th><th style="color:#68a">WC%</th><th>Exp scores</th><th>Got scores</th><th>&#9654;</th><th>Game</th></tr>`;
-  results.innerHTML=`<table class="test-results" id="eval-table">${TH}</table><div id="eval-running" style="color:#888;margin-top:6px"></div>`;
-  const tbl=document.getElementById('eval-table');
-  startEvalSpinner();
-
-  let totalCells=0,totalCorrect=0,totalWrong=0,scoresCorrect=0,scoresTotal=0;
-  const caseResults=[];
-  const SP=`<span class="eval-spin" style="color:#88f">${BRAILLE[0]}</span>`;
-
-  for(const tc of cases){
-    if(_evalStopped){document.getElementById('eval-running').textContent='Stopped.';break;}
-    document.getElementById('eval-running').textContent='Running: '+tc.name+'...';
-    startSpinner(tc.name);
-
-    let expCGP='',expBoard=null,expScores=null;
-    if(tc.has_expected){
-      try{const r=await fetch('/testdata-cgp/'+encodeURIComponent(tc.name));expCGP=(await r.text()).trim();}catch(e){}
-      if(expCGP){
-        expBoard=parseCGPBoard(expCGP);
-        const sm=expCGP.match(/\/\s*(\d+)\s+(\d+)/);
-        if(sm)expScores=[parseInt(sm[1]),parseInt(sm[2])];
-      }
-    }
+private:
+    struct Flight {
+        Image image;  // the leader's upload, compared on join
+        std::mutex mu;
+        std::condition_variable cv;
+        std::string last;                // latest chunk, until followed
+        bool followed = false;           // from then on, chunks are recorded
+        std::deque<std::string> chunks;  // deque: followers write from them unlocked
+        bool done = false;
+    };
 
-    // Pre-insert row with spinners
-    const n=tc.name;
-    const stCols=EVAL_SCOLS.map(col=>`<td id="ec-${n}-${col}">${SP}</td>`).join('');
-    tbl.insertAdjacentHTML('beforeend',
-      `<tr id="eval-row-${n}"><td>${n}</td>`
-      +`<td id="ec-${n}-cells">${SP}</td><td id="ec-${n}-correct">${SP}</td>`
-      +`<td id="ec-${n}-wrong">${SP}</td><td id="ec-${n}-pct">${SP}</td>`
-      +stCols
-      +`<td id="ec-${n}-exps" style="font-family:monospace">${expScores?expScores[0]+' '+expScores[1]:'—'}</td>`
-      +`<td id="ec-${n}-gots" style="font-family:monospace">${SP}</td>`
-      +`<td id="ec-${n}-scok">—</td>`
-      +`<td id="ec-${n}-game">${SP}</td></tr>`);
-
-    // Stream NDJSON and update cells as stages arrive
-    let gotCGP='',stageCGPs={};
-    try{
-      const ir=await fetch('/testdata-image/'+encodeURIComponent(n));
-      if(ir.ok){
-        const blob=await ir.blob();
-        const form=new FormData();
-        form.append('image',new File([blob],n+'.png',{type:'image/png'}));
-        const resp=await fetch('/analyze-gemini',{method:'POST',body:form});
-        const reader=resp.body.getReader(),dec=new TextDecoder();
-        let buf='';
-        while(true){
-          const {done,value}=await reader.read();
-          if(done)break;
-          buf+=dec.decode(value,{stream:true});
-          let nl;
-          while((nl=buf.indexOf('\n'))>=0){
-            const line=buf.slice(0,nl).trim();buf=buf.slice(nl+1);
-            if(!line)continue;
-            try{const d=JSON.parse(line);
-              if(d.cgp)gotCGP=d.cgp;
-              if(d.raw_main_cgp){stageCGPs.raw=d.raw_main_cgp;evalSetCell(n,'raw',stageAccFromBoards(d.raw_main_cgp,expBoard));}
-              if(d.stage==='occupancy'&&d.occupancy_cgp){stageCGPs.occupancy=d.occupancy_cgp;evalSetCell(n,'occ',occAccFromBoards(d.occupancy_cgp,expBoard));}
-              if(d.stage&&d.stage_cgp){
-                stageCGPs[d.stage]=d.stage_cgp;
-                const m={realigned:'realigned',trans:'trans',retry:'retry',wc:'wc'};
-                if(m[d.stage])evalSetCell(n,m[d.stage],stageAccFromBoards(d.stage_cgp,expBoard));
-              }
-              if('woogles' in d){
-                const w=d.woogles;
-                const gc=document.getElementById(`ec-${n}-game`);
-                if(gc){
-                  if(w&&w.game_id){
-                    const url=`https://woogles.io/game/${w.game_id}?turn=${w.turn}`;
-                    gc.innerHTML=`<a href="${url}" target="_blank" style="color:#8cf">${w.game_id}&nbsp;t${w.turn}</a>`;
-                  }else{gc.textContent='—';}
-                }
-              }
-            }catch(e){}
-          }
+    static void follow(Flight& f, httplib::DataSink& sink) {
+        size_t next = 0;
+        std::unique_lock<std::mutex> lk(f.mu);
+        if (!f.followed) {
+            f.followed = true;
+            if (!f.last.empty()) f.chunks.push_back(std::move(f.last));
         }
-      }
-    }catch(e){}
-
-    // Final board comparison
-    let caseCells=0,caseCorrect=0,caseWrong=0;const diffs=[];
-    if(expBoard&&gotCGP){
-      const got=parseCGPBoard(gotCGP);
-      for(let r=0;r<15;r++)for(let c=0;c<15;c++){
-        const e=expBoard[r][c]||'',g=got[r][c]||'';
-        if(e||g){caseCells++;if(e===g)caseCorrect++;
-          else{caseWrong++;diffs.push(String.fromCharCode(65+c)+(r+1)+':'+e+'\u2192'+(g||'.'));}}
-      }
-    }
-    const pct=caseCells?((caseCorrect/caseCells)*100).toFixed(1)+'%':'—';
-    const stageAccs={};
-    const ov=occAccFromBoards(stageCGPs.occupancy,expBoard);if(ov)stageAccs.occ=ov;
-    ['raw','realigned','trans','retry','wc'].forEach(sn=>{
-      const v=stageAccFromBoards(sn==='raw'?stageCGPs.raw:stageCGPs[sn],expBoard);
-      if(v!=null)stageAccs[sn]=v;
-    });
-
-    // Fill in main accuracy columns
-    const wc=caseWrong>0?'color:#f88':'color:#4c4';
-    document.getElementById(`ec-${n}-cells`).textContent=caseCells||'—';
-    document.getElementById(`ec-${n}-correct`).textContent=caseCorrect||'—';
-    document.getElementById(`ec-${n}-wrong`).innerHTML=`<span style="${wc}">${caseWrong||'0'}</span>`;
-    document.getElementById(`ec-${n}-pct`).textContent=pct;
-    // Clear any remaining spinners in stage cells
-    EVAL_SCOLS.forEach(col=>{const el=document.getElementById(`ec-${n}-${col}`);if(el&&el.querySelector('.eval-spin'))el.textContent='—';});
-    if(diffs.length)document.getElementById(`eval-row-${n}`)
-      .insertAdjacentHTML('afterend',`<tr><td colspan="15" style="color:#f88;font-family:'SF Mono',monospace;font-size:.7rem;padding:2px 8px">&nbsp;&nbsp;${diffs.join('  ')}</td></tr>`);
-
-    // Scores
-    let gotSc='—',scOk='—';
-    if(expScores){
-      scoresTotal++;
-      const sm=gotCGP.match(/\/\s*(\d+)\s+(\d+)/);
-      const gs=sm?[parseInt(sm[1]),parseInt(sm[2])]:null;
-      gotSc=gs?gs[0]+' '+gs[1]:'?';
-      if(gs&&gs[0]===expScores[0]&&gs[1]===expScores[1]){scOk='✓';scoresCorrect++;}
-      else scOk='<span style="color:#f88">✗</span>';
+        for (;;) {
+            f.cv.wait(lk, [&] { return next < f.chunks.size() || f.done; });
+            if (next == f.chunks.size()) break;
+            const std::string& chunk = f.chunks[next++];
+            lk.unlock();
+            bool ok = sink.write(chunk.data(), chunk.size());
+            lk.lock();
+            if (!ok) return;  // client went away
+        }
+        lk.unlock();
+        sink.done();
     }
-    document.getElementById(`ec-${n}-gots`).textContent=gotSc;
-    document.getElementById(`ec-${n}-scok`).innerHTML=scOk;
-
-    totalCells+=caseCells;totalCorrect+=caseCorrect;totalWrong+=caseWrong;
-    const gsm=gotCGP?gotCGP.match(/\/\s*(\d+)\s+(\d+)/):null;
-    caseResults.push({name:n,cells:caseCells,correct:caseCorrect,wrong:caseWrong,diffs,
-      exp_cgp:caseWrong>0?expCGP.split(' ')[0]:'',got_cgp:caseWrong>0?gotCGP.split(' ')[0]:'',
-      exp_scores:expScores?expScores[0]+' '+expScores[1]:null,
-      got_scores:gsm?gsm[1]+' '+gsm[2]:null,stage_accs:stageAccs});
-    stopSpinner();
-    for(const li of document.querySelectorAll('#test-list li'))
-      if(li.dataset.name===n){li.classList.toggle('pass',caseWrong===0);li.classList.toggle('fail',caseWrong>0);}
-  }
-
-  stopEvalSpinner();
-  document.getElementById('eval-stop-btn').style.display='none';
-  document.getElementById('eval-running').textContent='';
-  const totPct=totalCells?((totalCorrect/totalCells)*100).toFixed(1)+'%':'—';
-  tbl.insertAdjacentHTML('beforeend',
-    `<tr style="font-weight:bold;border-top:2px solid #555"><td>TOTAL</td><td>${totalCells}</td><td>${totalCorrect}</td><td style="color:${totalWrong?'#f88':'#4c4'}">${totalWrong}</td><td>${totPct}</td><td colspan="6"></td><td colspan="2" style="color:#ccc">${scoresCorrect}/${scoresTotal} scores ✓</td><td></td><td></td></tr>`);
-
-  try{await fetch('/eval-save',{method:'POST',headers:{'Content-Type':'application/json'},
-    body:JSON.stringify({total_cells:totalCells,correct:totalCorrect,
-      scores_correct:scoresCorrect,scores_total:scoresTotal,cases:caseResults})});}catch(e){}
-  loadEvalSummary();
-}
 
-loadTestList();
-renderBoard('15/15/15/15/15/15/15/15/15/15/15/15/15/15/15');
-</script>
-</body>
-</html>)html";
+    std::mutex mu_;
+    std::map<std::string, std::shared_ptr<Flight>> flights_;
+};
+static AnalysisFlights g_flights;
 
-// ---------------------------------------------------------------------------
-// Build a progress NDJSON line (no cells/cgp, just status + log + image).
-// ---------------------------------------------------------------------------
-static std::string make_progress_line(const char* status,
-                                       const std::string& log_text,
-                                       const std::vector<uint8_t>& debug_png) {
-    std::string json = "{\"status\":\"";
-    json += json_escape(status);
-    json += "\"";
-    if (!log_text.empty())
-        json += ",\"log\":\"" + json_escape(log_text) + "\"";
-    if (!debug_png.empty())
-        json += ",\"debug_image\":\"data:image/png;base64,"
-              + base64_encode(debug_png) + "\"";
-    json += "}\n";
-    return json;
+static std::string gemini_flight_mode(bool is_memento, bool skip_woogles) {
+    return std::string("gemini") + (is_memento ? " memento" : "")
+        + (skip_woogles ? " skip_woogles" : "");
 }
 
-// cells_to_cgp from gemini_parse.h (included later for other uses too)
-#include "gemini_parse.h"
-
 // ---------------------------------------------------------------------------
-// Stream processing results as NDJSON (newline-delimited JSON).
+// Stream processing results as NDJSON (newline-delimited JSON).  With
+// prev_cgp (the previous turn during live annotation) only new or changed
+// cells are classified, see process_board_image_with_prior().
 // ---------------------------------------------------------------------------
 static void stream_analyze(const std::vector<uint8_t>& buf,
-                            httplib::DataSink& sink) {
-    DebugResult dr = process_board_image_debug(buf,
-        [&sink](const char* status, const std::string& log_text,
-                const std::vector<uint8_t>& debug_png) {
-            auto line = make_progress_line(status, log_text, debug_png);
-            sink.write(line.data(), line.size());
-        });
+                            httplib::DataSink& sink,
+                            const std::string& prev_cgp = "") {
+    BoardCacheProbe probe{g_board_cache_opencv, "opencv"};
+    JsonWriter out;  // one buffer for every line of the response
+    auto on_progress = [&sink, &out](const char* status, const std::string& log_text,
+                                     const std::vector<uint8_t>& debug_png) {
+        write_progress_line(out, status, log_text, debug_png);
+        out.send(sink);
+    };
+    // The rack needs only the board rect: read it from the detection hook
+    // while the board's cells are classified.  Detection can still move the
+    // rect afterwards (OCR-failure retry); the read is then redone below.
+    DebugResult dr;
+    RackRead rack;
+    cv::Mat rack_img;
+    cv::Rect rack_rect;
+    int rack_cs = 0;
+    StageGraph stages;
+    StageGraph::Node detected = 0;
+    StageGraph::Node board = stages.add("board", [&] {
+        DetectCallback cache_hook = probe.hook();
+        DetectCallback on_detect = [&](const cv::Mat& bgr, const cv::Rect& rect,
+                                       int cell_size, bool is_light) {
+            bool stop = cache_hook(bgr, rect, cell_size, is_light);
+            if (!stop) {
+                rack_img = bgr;  // shares the decoded image, which is never written
+                rack_rect = rect;
+                rack_cs = cell_size;
+            }
+            stages.open(detected);
+            return stop;
+        };
+        dr = prev_cgp.empty()
+            ? process_board_image_debug(buf, on_progress, on_detect)
+            : process_board_image_with_prior(buf, prev_cgp, on_progress);
+    });
+    detected = stages.add_signal("detected", board);
+    stages.add("rack_read", [&] {
+        if (rack_cs > 0) rack = read_rack(rack_img, rack_rect, rack_cs);
+    }, {detected});
+    stages.run();
+    record_pipeline_stages(dr);
+    rack.translate(dr.origin);
+
+    if (probe.have_sig)
+        (probe.hit ? g_metrics.board_cache_hits_opencv
+                   : g_metrics.board_cache_misses_opencv).inc();
+    if (probe.hit) {
+        apply_board_cache_hit(dr, probe.value, buf);
+        out.begin_object();
+        write_result_fields(out, dr, probe.value.extra.at(0));
+        out.key("board_cache").boolean(true).end_object().line();
+        out.send(sink);
+        sink.done();
+        return;
+    }
 
     // Rack tile detection + local OCR
     std::string rack_str;
     if (dr.cell_size > 0) {
-        bool is_light = detect_board_mode(buf,
-            dr.board_rect.x, dr.board_rect.y, dr.cell_size);
-        auto rack_tiles = detect_rack_tiles(buf,
-            dr.board_rect.x, dr.board_rect.y, dr.cell_size, is_light);
-
-        {
-            int n_rt = static_cast<int>(rack_tiles.size());
-            CellResult rack_cr[7] = {};
-            for (int i = 0; i < n_rt && i < 7; i++)
-                rack_cr[i] = classify_rack_tile_full(rack_tiles[i]);
-            refine_rack(rack_cr, std::min(n_rt, 7), dr.cells);
-            alphagram_tiebreak(rack_cr, std::min(n_rt, 7));
-            for (int i = 0; i < n_rt && i < 7; i++) {
-                char ch = rack_cr[i].letter;
-                rack_str += (ch >= 'A' && ch <= 'Z') ? ch : '?';
-            }
+        if (!rack.matches(dr.board_rect, dr.cell_size))
+            rack = read_rack(buf, dr.board_rect, dr.cell_size);
+        const auto& rack_tiles = rack.tiles;
+
+        refine_rack(rack.results, rack.n, dr.cells);
+        alphagram_tiebreak(rack.results, rack.n);
+        for (int i = 0; i < rack.n; i++) {
+            char ch = rack.results[i].letter;
+            rack_str += (ch >= 'A' && ch <= 'Z') ? ch : '?';
         }
 
         // Annotate debug image with rack detections + letters
@@ -1859,11 +1122,12 @@ static void stream_analyze(const std::vector<uint8_t>& buf,
                         cv::Scalar color = rt.is_blank
                             ? cv::Scalar(255, 0, 255)
                             : cv::Scalar(0, 255, 255);
-                        cv::rectangle(img, rt.rect, color, 2);
+                        cv::Rect r = rt.rect - dr.origin;
+                        cv::rectangle(img, r, color, 2);
                         if (i < rack_str.size()) {
                             std::string lbl(1, rack_str[i]);
                             cv::putText(img, lbl,
-                                cv::Point(rt.rect.x + 2, rt.rect.y - 4),
+                                cv::Point(r.x + 2, r.y - 4),
                                 cv::FONT_HERSHEY_SIMPLEX, 0.7, color, 2);
                         }
                     }
@@ -1879,10 +1143,93 @@ static void stream_analyze(const std::vector<uint8_t>& buf,
         }
     }
 
+    if (dr.cell_size > 0) probe.store(dr, {rack_str});
+
     // Final result line (includes cgp, cells, rack, etc.)
-    std::string final_json = make_json_response(dr, rack_str);
-    final_json += "\n";
-    sink.write(final_json.data(), final_json.size());
+    out.begin_object();
+    write_result_fields(out, dr, rack_str);
+    out.end_object().line();
+    out.send(sink);
+    sink.done();
+}
+
+// ---------------------------------------------------------------------------
+// GET /run-tests: score every testdata/ case against its .cgp.  The JSON
+// array is streamed one case at a time, so the first results go out while
+// later screenshots are still being processed.
+// ---------------------------------------------------------------------------
+static void stream_run_tests(const std::vector<fs::directory_entry>& entries,
+                             httplib::DataSink& sink) {
+    JsonWriter out;
+    out.begin_array();
+
+    for (const auto& entry : entries) {
+        std::string name = entry.path().stem().string();
+        std::string img_path = "testdata/" + name + ".png";
+        if (!fs::exists(img_path)) continue;
+
+        std::string expected_cgp;
+        {
+            std::ifstream ifs(entry.path());
+            std::getline(ifs, expected_cgp);
+        }
+
+        std::vector<uint8_t> img_data;
+        {
+            std::ifstream ifs(img_path, std::ios::binary);
+            img_data.assign(std::istreambuf_iterator<char>(ifs),
+                            std::istreambuf_iterator<char>());
+        }
+
+        DebugResult dr;
+        try {
+            dr = process_board_image_debug(img_data);
+            record_pipeline_stages(dr);
+        } catch (const std::exception& ex) {
+            // If OCR fails, report as all-wrong
+            out.begin_object().key("name").string(name)
+                .key("total").number(0).key("correct").number(0).key("wrong").number(0)
+                .key("error").string(ex.what())
+                .key("diffs").begin_array().end_array()
+                .end_object();
+            out.send(sink);
+            continue;
+        }
+
+        auto expected = parse_cgp_board(expected_cgp);
+        auto got = parse_cgp_board(dr.cgp);
+
+        out.begin_object().key("name").string(name);
+        int case_total = 0, case_correct = 0;
+        out.key("diffs").begin_array();
+        for (int r = 0; r < 15; r++) {
+            for (int c = 0; c < 15; c++) {
+                if (expected[r][c] != 0 || got[r][c] != 0) {
+                    case_total++;
+                    if (expected[r][c] == got[r][c]) {
+                        case_correct++;
+                    } else {
+                        std::string pos;
+                        pos += static_cast<char>('A' + c);
+                        pos += std::to_string(r + 1);
+                        out.begin_object().key("pos").string(pos)
+                            .key("exp").string(expected[r][c] ? expected[r][c] : '.')
+                            .key("got").string(got[r][c] ? got[r][c] : '.')
+                            .end_object();
+                    }
+                }
+            }
+        }
+        out.end_array();
+        out.key("total").number(case_total)
+            .key("correct").number(case_correct)
+            .key("wrong").number(case_total - case_correct)
+            .end_object();
+        out.send(sink);
+    }
+
+    out.end_array();
+    out.send(sink);
     sink.done();
 }
 
@@ -2008,7 +1355,51 @@ static std::vector<uint8_t> crop_word_run(
     return png;
 }
 
-// Parse {"key":"value",...} JSON — string values only.
+// Decode the body of a JSON string (the inverse of json_escape_append).
+// \uXXXX becomes UTF-8; surrogate pairs are not combined.
+static std::string json_unescape(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] != '\\' || i + 1 >= s.size()) {
+            out += s[i];
+            continue;
+        }
+        char e = s[++i];
+        switch (e) {
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                unsigned cp = 0;
+                const char* hex = s.data() + i + 1;
+                if (i + 4 >= s.size()
+                        || std::from_chars(hex, hex + 4, cp, 16).ptr != hex + 4) {
+                    out += e;
+                    break;
+                }
+                i += 4;
+                if (cp < 0x80) {
+                    out += static_cast<char>(cp);
+                } else if (cp < 0x800) {
+                    out += static_cast<char>(0xC0 | (cp >> 6));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                } else {
+                    out += static_cast<char>(0xE0 | (cp >> 12));
+                    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default: out += e;  // \" \\ \/
+        }
+    }
+    return out;
+}
+
+// Parse {"key":"value",...} JSON — string values only, unescaped.
 static std::map<std::string, std::string> parse_json_str_map(
         const std::string& text) {
     std::map<std::string, std::string> result;
@@ -2022,7 +1413,7 @@ static std::map<std::string, std::string> parse_json_str_map(
         p++;
         size_t ks = p;
         while (p < text.size() && text[p] != '"') { if (text[p]=='\\') p++; p++; }
-        std::string key = text.substr(ks, p - ks);
+        std::string key = json_unescape(std::string_view(text).substr(ks, p - ks));
         if (p < text.size()) p++;
         while (p < text.size() && text[p] != ':') p++;
         if (p < text.size()) p++;
@@ -2032,7 +1423,7 @@ static std::map<std::string, std::string> parse_json_str_map(
             p++;
             size_t vs = p;
             while (p < text.size() && text[p] != '"') { if (text[p]=='\\') p++; p++; }
-            result[key] = text.substr(vs, p - vs);
+            result[key] = json_unescape(std::string_view(text).substr(vs, p - vs));
             if (p < text.size()) p++;
         } else {
             while (p < text.size() && text[p] != ',' && text[p] != '}') p++;
@@ -2043,6 +1434,169 @@ static std::map<std::string, std::string> parse_json_str_map(
     return result;
 }
 
+// ---------------------------------------------------------------------------
+// Word-crop payloads and cross-analysis batching.
+//
+// Every word-crop request has the same shape: one prompt, then labeled
+// crops, answered with {"LABEL": "LETTERS"}.  Under load (corpus runs, bot
+// bursts) GEMINI_BATCH_MS > 0 holds each request for that long and packs
+// the crops of concurrent analyses that use the same model and prompt
+// into one call.  Labels get an "S<n>/" prefix per analysis and the reply
+// is split back by prefix, so each analysis still sees its own
+// {"LABEL": ...} text.  A batch of one is sent unprefixed, byte-identical
+// to an unbatched request, so .gemini_cache entries stay valid.
+// ---------------------------------------------------------------------------
+struct WordCropImage {
+    std::string label;  // WordRun::label
+    std::string b64;    // PNG, base64
+};
+
+// Split at 200 KB to avoid Gemini timeouts.
+static const size_t WORD_CROP_BATCH_LIMIT = 200 * 1024;
+
+// The images reference `im`, which must outlive the payload's build().
+static void add_word_crop(GeminiPayload& payload, const std::string& label,
+                          const WordCropImage& im) {
+    payload.text(label + ":").png_b64(im.b64);
+}
+
+// Bytes one crop adds to a request.
+static size_t word_crop_part_size(const WordCropImage& im) {
+    GeminiPayload p("");
+    size_t empty = p.size();
+    add_word_crop(p, im.label, im);
+    return p.size() - empty;
+}
+
+class WordCropBatcher {
+public:
+    // Holds requests for window_ms; 0 sends each one directly.
+    void set_window_ms(int ms) { window_ms_ = ms; }
+    int window_ms() const { return window_ms_; }
+
+    // Returns the call result for this analysis's crops only.
+    std::future<GeminiCallResult> submit(const std::string& url,
+                                         const std::string& prompt,
+                                         const std::string& gen_config,
+                                         const std::string& log_label,
+                                         int timeout_sec,
+                                         std::vector<WordCropImage> images) {
+        if (window_ms_ <= 0) {
+            GeminiPayload p(prompt);
+            for (const auto& im : images) add_word_crop(p, im.label, im);
+            return std::async(std::launch::async,
+                [url, log_label, timeout_sec, payload = p.build(gen_config)]() {
+                    return call_gemini(url, payload, log_label, "wc", timeout_sec, 1);
+                });
+        }
+
+        size_t bytes = 0;
+        for (const auto& im : images) bytes += im.label.size() + im.b64.size() + 80;
+        std::string key = url + '\n' + prompt + '\n' + gen_config;
+        std::shared_ptr<Batch> full, fresh;
+        std::future<GeminiCallResult> fut;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            auto& b = open_[key];
+            if (b && !b->waiting.empty() && b->bytes + bytes > WORD_CROP_BATCH_LIMIT) {
+                full = b;
+                b.reset();
+                full->sealed = true;
+            }
+            if (!b) {
+                b = fresh = std::make_shared<Batch>();
+                b->key = key;
+                b->url = url;
+                b->prompt = prompt;
+                b->gen_config = gen_config;
+                b->log_label = log_label;
+            }
+            b->timeout_sec = std::max(b->timeout_sec, timeout_sec);
+            b->bytes += bytes;
+            b->waiting.push_back({std::move(images), {}});
+            fut = b->waiting.back().done.get_future();
+        }
+        if (full) std::thread([this, full] { send(*full); }).detach();
+        if (fresh) {
+            std::thread([this, fresh] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(window_ms_));
+                {
+                    std::lock_guard<std::mutex> lk(mu_);
+                    if (fresh->sealed) return;  // sent when it filled up
+                    fresh->sealed = true;
+                    auto it = open_.find(fresh->key);
+                    if (it != open_.end() && it->second == fresh) open_.erase(it);
+                }
+                send(*fresh);
+            }).detach();
+        }
+        return fut;
+    }
+
+private:
+    struct Pending {
+        std::vector<WordCropImage> images;
+        std::promise<GeminiCallResult> done;
+    };
+    struct Batch {
+        std::string key, url, prompt, gen_config, log_label;
+        int timeout_sec = 0;
+        size_t bytes = 0;
+        bool sealed = false;  // taken out of open_; no more submissions
+        std::vector<Pending> waiting;
+    };
+
+    void send(Batch& b) {
+        size_t n = b.waiting.size();
+        g_metrics.word_crop_batches.inc();
+        g_metrics.word_crop_batched_requests.inc(n);
+
+        std::string prompt = b.prompt;
+        if (n > 1) {
+            prompt += "\\nThe images come from " + std::to_string(n)
+                + " different boards: each label starts with its board, e.g. "
+                  "S1/H11H. Keep the full label as the reply key.";
+        }
+        GeminiPayload payload(prompt);
+        for (size_t i = 0; i < n; i++) {
+            std::string prefix = n > 1 ? "S" + std::to_string(i + 1) + "/" : "";
+            for (const auto& im : b.waiting[i].images)
+                add_word_crop(payload, prefix + im.label, im);
+        }
+        std::string label = b.log_label
+            + (n > 1 ? " x" + std::to_string(n) : "");
+        GeminiCallResult gcr = call_gemini(
+            b.url, payload.build(b.gen_config), label, "wc", b.timeout_sec, 1);
+        if (n == 1) {
+            b.waiting[0].done.set_value(std::move(gcr));
+            return;
+        }
+
+        // Demultiplex {"S2/H11H": "WORMER", ...} into one object per analysis.
+        std::vector<JsonWriter> texts(n);
+        std::vector<bool> any(n, false);
+        for (const auto& [k, v] : parse_json_str_map(gcr.text)) {
+            size_t slash = k.find('/');
+            if (k.empty() || k[0] != 'S' || slash == std::string::npos) continue;
+            size_t i = std::strtoul(k.c_str() + 1, nullptr, 10);
+            if (i < 1 || i > n) continue;
+            if (!any[i - 1]) texts[i - 1].begin_object();
+            any[i - 1] = true;
+            texts[i - 1].key(std::string_view(k).substr(slash + 1)).string(v);
+        }
+        for (size_t i = 0; i < n; i++) {
+            GeminiCallResult r = gcr;
+            r.text = any[i] ? texts[i].end_object().str() : "";
+            b.waiting[i].done.set_value(std::move(r));
+        }
+    }
+
+    int window_ms_ = 0;
+    std::mutex mu_;
+    std::map<std::string, std::shared_ptr<Batch>> open_;  // by url/prompt/config
+};
+static WordCropBatcher g_word_crop_batcher;
+
 // ---------------------------------------------------------------------------
 // Run woogles_lookup.py in a subprocess. Returns raw JSON string or "null".
 // Thread-safe: uses mkstemp for the input temp file.
@@ -2083,18 +1637,25 @@ static std::string run_woogles_lookup(const std::string& cgp,
     std::string cmd = "python3 testgen/scripts/woogles_lookup.py < ";
     cmd += tmp_buf;
     cmd += " 2>/dev/null";
-    FILE* pipe = popen(cmd.c_str(), "r");
     std::string result;
-    if (pipe) {
-        char buf[8192];
-        while (fgets(buf, sizeof(buf), pipe)) result += buf;
-        pclose(pipe);
+    {
+        ScopedTimer timer(g_metrics.woogles_lookup);
+        FILE* pipe = popen(cmd.c_str(), "r");
+        if (pipe) {
+            char buf[8192];
+            while (fgets(buf, sizeof(buf), pipe)) result += buf;
+            pclose(pipe);
+        }
     }
     std::remove(tmp_buf);
 
     while (!result.empty() &&
            (result.back() == '\n' || result.back() == '\r' || result.back() == ' '))
         result.pop_back();
+    if (result.find("\"game_id\"") != std::string::npos)
+        g_metrics.woogles_found.inc();
+    else
+        g_metrics.woogles_none.inc();
     return result.empty() ? "null" : result;
 }
 
@@ -2105,19 +1666,50 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                    httplib::DataSink& sink,
                                    bool is_memento = false,
                                    bool skip_woogles = false) {
+    JsonWriter out;  // one buffer for every line of the response
+    auto send_status = [&](std::string_view text) {
+        out.begin_object().key("status").string(text).end_object().line();
+        out.send(sink);
+    };
+    // Board snapshot after a correction stage, for the UI's stage trail.
+    auto send_stage = [&](const char* stage, const CellResult (&cells)[15][15]) {
+        out.begin_object().key("stage").string(stage)
+            .key("stage_cgp").string(cells_to_cgp(cells)).end_object().line();
+        out.send(sink);
+    };
+
     // Step 1: Run OpenCV pipeline for board detection
-    {
-        std::string msg = "{\"status\":\"Detecting board layout...\"}\n";
-        sink.write(msg.data(), msg.size());
-    }
+    send_status("Detecting board layout...");
 
     DebugResult opencv_dr;
     bool have_opencv = false;
+    BoardCacheProbe probe{g_board_cache_gemini,
+                          gemini_flight_mode(is_memento, skip_woogles) + " "
+                              + GEMINI_MAIN_MODEL + " " + GEMINI_FAST_MODEL};
     try {
-        opencv_dr = process_board_image_debug(buf);
+        opencv_dr = process_board_image_debug(buf, nullptr, probe.hook());
         have_opencv = true;
+        record_pipeline_stages(opencv_dr);
     } catch (...) {}
 
+    // Near-duplicate of an analyzed screenshot: replay it, no Gemini calls.
+    if (probe.have_sig)
+        (probe.hit ? g_metrics.board_cache_hits_gemini
+                   : g_metrics.board_cache_misses_gemini).inc();
+    if (probe.hit) {
+        apply_board_cache_hit(opencv_dr, probe.value, buf);
+        const std::vector<std::string>& extra = probe.value.extra;
+        out.begin_object();
+        write_result_fields(out, opencv_dr);
+        out.members(extra.at(0));
+        out.key("board_cache").boolean(true).end_object().line();
+        if (!skip_woogles)  // stored by a run with the same skip_woogles
+            out.begin_object().key("woogles").raw(extra.at(1)).end_object().line();
+        out.send(sink);
+        sink.done();
+        return;
+    }
+
     // Step 2: Board mode + rack detection
     std::vector<RackTile> rack_tiles;
     bool is_light_mode = false;
@@ -2128,29 +1720,28 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
             rack_tiles = detect_rack_tiles(buf, bx, by, cell_sz,
                                            is_light_mode);
             // Draw rack detections on debug image
-            draw_rack_debug(opencv_dr.debug_png, rack_tiles);
+            draw_rack_debug(opencv_dr.debug_png, rack_tiles, opencv_dr.origin);
             // Report rack detection
             int blank_ct = 0;
             for (const auto& rt : rack_tiles) if (rt.is_blank) blank_ct++;
-            std::string rack_msg = "{\"status\":\"Detected " +
+            std::string rack_msg = "Detected " +
                 std::to_string(rack_tiles.size()) + " rack tile(s)";
             if (blank_ct > 0) rack_msg += " (" + std::to_string(blank_ct) + " blank)";
             int board_bottom = by + 15 * cell_sz;
             rack_msg += ", search y=" + std::to_string(board_bottom + cell_sz/2)
                 + "-" + std::to_string(std::min(static_cast<int>(849), board_bottom + 6*cell_sz));
-            rack_msg += "\"}\n";
-            sink.write(rack_msg.data(), rack_msg.size());
+            send_status(rack_msg);
             // Report detected mode + board rect for UI overlay
-            std::string mode_msg = std::string("{\"status\":\"Board mode: ") +
+            out.begin_object().key("status").string(std::string("Board mode: ") +
                 (is_light_mode ? "light" : "dark") +
-                (is_memento ? " (memento share image)" : "") + "\""
-                + ",\"board_rect\":{\"x\":" + std::to_string(bx)
-                + ",\"y\":" + std::to_string(by)
-                + ",\"w\":" + std::to_string(board_w > 0 ? board_w : 15 * cell_sz)
-                + ",\"h\":" + std::to_string(15 * cell_sz)
-                + ",\"cell_sz\":" + std::to_string(cell_sz)
-                + "}}\n";
-            sink.write(mode_msg.data(), mode_msg.size());
+                (is_memento ? " (memento share image)" : ""));
+            out.key("board_rect").begin_object()
+                .key("x").number(bx).key("y").number(by)
+                .key("w").number(board_w > 0 ? board_w : 15 * cell_sz)
+                .key("h").number(15 * cell_sz)
+                .key("cell_sz").number(cell_sz)
+                .end_object().end_object().line();
+            out.send(sink);
         }
     }
 
@@ -2170,7 +1761,8 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
 
     // Build per-word crop images for focused Gemini OCR.
     std::vector<WordRun> word_runs;
-    std::vector<std::string> wc_payloads;   // one payload per batch
+    std::string wc_prompt;
+    std::vector<std::vector<WordCropImage>> wc_groups;  // one request each
     std::vector<std::future<GeminiCallResult>> wc_futs;
 
     if (have_opencv) {
@@ -2211,7 +1803,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     }
                 }
 
-                std::string wc_prompt =
+                wc_prompt =
                     "Read the letters on Scrabble tiles in each labeled image. "
                     "Images labeled H* are horizontal words; V* are vertical words "
                     "(presented with upright letters reading left to right).\\n"
@@ -2240,38 +1832,33 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     "Reply ONLY as JSON: {\\\"LABEL\\\": \\\"LETTERS\\\", ...}\\n"
                     "Example: {\\\"H11H\\\": \\\"WORMER\\\", \\\"VH8\\\": \\\"WAVES\\\"}";
 
-                // Build batched payloads: split at 200 KB to avoid Gemini timeouts
-                const size_t BATCH_LIMIT = 200 * 1024;
-                std::string cur_payload = "{\"contents\":[{\"parts\":["
-                    "{\"text\":\"" + wc_prompt + "\"}";
+                // Group the crops into requests of at most WORD_CROP_BATCH_LIMIT.
+                size_t group_bytes = 0;
                 int n_crops = 0;
                 for (const auto& wr : word_runs) {
                     auto png = crop_word_run(img_w, timg, cs_t, wr, bx_w, by_w, cw_w, ch_w);
                     if (png.empty()) continue;
-                    std::string b64 = base64_encode(png);
-                    std::string part =
-                        ",{\"text\":\"" + wr.label + ":\"}"
-                        ",{\"inlineData\":{\"mimeType\":\"image/png\","
-                        "\"data\":\"" + b64 + "\"}}";
-                    // Seal current batch and start a new one if over limit
-                    if (n_crops > 0 && cur_payload.size() + part.size() > BATCH_LIMIT) {
-                        wc_payloads.push_back(cur_payload + "]}]}");
-                        cur_payload = "{\"contents\":[{\"parts\":["
-                            "{\"text\":\"" + wc_prompt + "\"}";
+                    WordCropImage im{wr.label, base64_encode(png)};
+                    size_t part_bytes = word_crop_part_size(im);
+                    if (wc_groups.empty() ||
+                            group_bytes + part_bytes > WORD_CROP_BATCH_LIMIT) {
+                        wc_groups.emplace_back();
+                        // Same split as the request text minus its closing "]}]}".
+                        group_bytes = GeminiPayload(wc_prompt).size() - 4;
                     }
-                    cur_payload += part;
+                    wc_groups.back().push_back(std::move(im));
+                    group_bytes += part_bytes;
                     n_crops++;
                 }
-                if (n_crops > 0) wc_payloads.push_back(cur_payload + "]}]}");
                 size_t total_kb = 0;
-                for (const auto& p : wc_payloads) total_kb += p.size() / 1024;
-                std::string wc_msg = "{\"status\":\"Built " + std::to_string(n_crops)
+                for (const auto& g : wc_groups)
+                    for (const auto& im : g) total_kb += im.b64.size() / 1024;
+                send_status("Built " + std::to_string(n_crops)
                     + " word crop images (" + std::to_string(total_kb) + " KB"
-                    + (wc_payloads.size() > 1
-                        ? ", " + std::to_string(wc_payloads.size()) + " batches"
+                    + (wc_groups.size() > 1
+                        ? ", " + std::to_string(wc_groups.size()) + " batches"
                         : "")
-                    + ", 2.0+2.5-flash in parallel)\"}\n";
-                sink.write(wc_msg.data(), wc_msg.size());
+                    + ", 2.0+2.5-flash in parallel)");
             }
         }
     }
@@ -2291,10 +1878,10 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
             }
         }
         mask_dr.cgp = cells_to_cgp(mask_dr.cells) + " / 0 0";
-        std::string intermediate = make_json_response(mask_dr);
-        intermediate = "{\"status\":\"Board detected \\u2014 calling Gemini Flash...\","
-                      + intermediate.substr(1) + "\n";
-        sink.write(intermediate.data(), intermediate.size());
+        out.begin_object().key("status").string("Board detected — calling Gemini Flash...");
+        write_result_fields(out, mask_dr);
+        out.end_object().line();
+        out.send(sink);
 
     }
 
@@ -2304,30 +1891,24 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
         for (int r = 0; r < 15; r++)
             for (int c = 0; c < 15; c++)
                 if (get_occupied(r, c)) occ_cells[r][c].letter = '?';
-        std::string occ_cgp = cells_to_cgp(occ_cells);
-        std::string smsg = "{\"stage\":\"occupancy\",\"occupancy_cgp\":\""
-            + json_escape(occ_cgp) + "\"}\n";
-        sink.write(smsg.data(), smsg.size());
+        out.begin_object().key("stage").string("occupancy")
+            .key("occupancy_cgp").string(cells_to_cgp(occ_cells)).end_object().line();
+        out.send(sink);
     }
 
     // Step 3: Call Gemini Flash
     {
         size_t img_kb = buf.size() / 1024;
-        std::string msg = "{\"status\":\"Calling Gemini Flash ("
-            + std::to_string(img_kb) + " KB image)...\"}\n";
-        sink.write(msg.data(), msg.size());
+        send_status("Calling Gemini Flash (" + std::to_string(img_kb) + " KB image)...");
     }
 
     const char* api_key = std::getenv("GEMINI_API_KEY");
     if (!api_key || !api_key[0]) {
-        std::string err = "{\"status\":\"Error: GEMINI_API_KEY not set in .env\"}\n";
-        sink.write(err.data(), err.size());
+        send_status("Error: GEMINI_API_KEY not set in .env");
         sink.done();
         return;
     }
 
-    std::string b64 = base64_encode(buf);
-
     // Build prompt — include occupancy grid if available
     std::string prompt = "Look at this Scrabble board screenshot. Read every cell "
         "in the 15x15 grid.";
@@ -2481,19 +2062,14 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
             "\\n\\nReturn ONLY the JSON object, no other text.";
     }
 
-    std::string payload = "{\"contents\":[{\"parts\":["
-        "{\"text\":\"" + prompt + "\"},"
-        "{\"inlineData\":{\"mimeType\":\"image/png\",\"data\":\"" + b64 + "\"}}"
-        "]}]}";
+    std::string payload = GeminiPayload(prompt).png(buf).build();
 
 
-    std::string url = "https://generativelanguage.googleapis.com/v1beta/models/"
-                      "gemini-2.5-flash:generateContent?key=";
-    url += api_key;
+    std::string url = std::string("https://generativelanguage.googleapis.com/v1beta/models/")
+        + GEMINI_MAIN_MODEL + ":generateContent?key=" + api_key;
     // Cheaper/faster model for word crops: no thinking overhead, lower latency.
-    std::string wc_url_20 = "https://generativelanguage.googleapis.com/v1beta/models/"
-                            "gemini-2.0-flash:generateContent?key=";
-    wc_url_20 += api_key;
+    std::string wc_url_20 = std::string("https://generativelanguage.googleapis.com/v1beta/models/")
+        + GEMINI_FAST_MODEL + ":generateContent?key=" + api_key;
 
     auto t0 = std::chrono::steady_clock::now();
     // Launch main OCR and word-crop OCR in parallel
@@ -2504,19 +2080,14 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
     // For each batch, query both gemini-2.0-flash (fast, no thinking) and
     // gemini-2.5-flash (thinking disabled via thinkingBudget=0) in parallel.
     // Results are merged — whichever model reads more words wins for each cell.
-    for (const auto& wcp : wc_payloads) {
-        // 2.0-flash: fast, no thinking by default
-        wc_futs.push_back(std::async(std::launch::async,
-            [&wc_url_20, p = wcp]() {
-                return call_gemini(wc_url_20, p, "wc_2.0", "wc", 30, 1);
-            }));
-        // 2.5-flash with thinking disabled: strip final } and inject thinkingBudget=0
-        std::string wcp_nt = wcp.substr(0, wcp.size() - 1)
-            + ",\"generationConfig\":{\"thinkingConfig\":{\"thinkingBudget\":0}}}";
-        wc_futs.push_back(std::async(std::launch::async,
-            [&url, p = wcp_nt]() {
-                return call_gemini(url, p, "wc_2.5", "wc", 45, 1);
-            }));
+    // With GEMINI_BATCH_MS set these share requests with concurrent analyses.
+    const std::string no_thinking =
+        ",\"generationConfig\":{\"thinkingConfig\":{\"thinkingBudget\":0}}";
+    for (const auto& group : wc_groups) {
+        wc_futs.push_back(g_word_crop_batcher.submit(
+            wc_url_20, wc_prompt, "", "wc_2.0", 30, group));
+        wc_futs.push_back(g_word_crop_batcher.submit(
+            url, wc_prompt, no_thinking, "wc_2.5", 45, group));
     }
     auto gcr = main_fut.get();
     auto t1 = std::chrono::steady_clock::now();
@@ -2524,11 +2095,10 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
     {
         std::string retry_note = gcr.attempts > 1
             ? " after " + std::to_string(gcr.attempts) + " attempts" : "";
-        std::string msg = "{\"status\":\"Gemini responded ("
+        send_status("Gemini responded ("
             + std::to_string(ms) + " ms, "
             + std::to_string(gcr.raw_response.size() / 1024) + " KB"
-            + retry_note + "). Parsing...\"}\n";
-        sink.write(msg.data(), msg.size());
+            + retry_note + "). Parsing...");
     }
 
     std::string text = gcr.text;
@@ -2538,8 +2108,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
             std::string preview = gcr.raw_response.substr(0, 500);
             err_msg = "Failed to parse Gemini response. Raw: " + preview;
         }
-        std::string err = "{\"status\":\"Error: " + json_escape(err_msg) + "\"}\n";
-        sink.write(err.data(), err.size());
+        send_status("Error: " + err_msg);
         sink.done();
         return;
     }
@@ -2585,9 +2154,9 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
     DebugResult dr = {};
     if (!parse_gemini_board(text, dr.cells)) {
         std::string preview = text.substr(0, 300);
-        std::string err = "{\"status\":\"Error: Failed to parse board\","
-            "\"log\":\"" + json_escape("Gemini text:\n" + preview) + "\"}\n";
-        sink.write(err.data(), err.size());
+        out.begin_object().key("status").string("Error: Failed to parse board")
+            .key("log").string("Gemini text:\n" + preview).end_object().line();
+        out.send(sink);
         sink.done();
         return;
     }
@@ -2620,12 +2189,10 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
     }
     if (!wc_futs.empty()) {
         have_word_crop_ocr = !word_crop_map.empty();
-        std::string wmsg = "{\"status\":\"Word crop OCR "
+        send_status("Word crop OCR "
             + std::string(have_word_crop_ocr
                 ? "parsed (" + std::to_string(word_crop_map.size()) + " words)."
-                : "failed to parse.")
-            + "\"}\n";
-        sink.write(wmsg.data(), wmsg.size());
+                : "failed to parse."));
     }
 
     // Save raw OCR snapshot (before any corrections) for trail comparison.
@@ -2635,25 +2202,21 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
     // Stream the raw main OCR board immediately so the user can see it
     // while corrections are being computed.
     {
-        std::string raw_cgp = cells_to_cgp(raw_main_cells);
-        // Build minimal board-cells JSON for the raw board update
-        std::string cells_json = "[";
+        out.begin_object().key("status").string("Raw Gemini OCR — applying corrections...")
+            .key("raw_main_cgp").string(cells_to_cgp(raw_main_cells));
+        // Minimal board-cells JSON for the raw board update
+        out.key("raw_cells").begin_array();
         for (int r = 0; r < 15; r++) {
-            if (r > 0) cells_json += ",";
-            cells_json += "[";
+            out.begin_array();
             for (int c = 0; c < 15; c++) {
-                if (c > 0) cells_json += ",";
                 char ch = raw_main_cells[r][c].letter;
-                if (ch == 0) cells_json += "null";
-                else cells_json += "\"" + std::string(1, ch) + "\"";
+                if (ch == 0) out.null();
+                else out.string(ch);
             }
-            cells_json += "]";
+            out.end_array();
         }
-        cells_json += "]";
-        std::string rmsg = "{\"status\":\"Raw Gemini OCR — applying corrections...\","
-            "\"raw_main_cgp\":\"" + json_escape(raw_cgp) + "\","
-            "\"raw_cells\":" + cells_json + "}\n";
-        sink.write(rmsg.data(), rmsg.size());
+        out.end_array().end_object().line();
+        out.send(sink);
     }
 
     // Transposed OCR corrections (Cases 1 and 3) are applied AFTER realignment
@@ -2676,25 +2239,20 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
             "BLANK tiles are beige with NO letter and NO subscript \\u2014 return '?' for these. "
             "Return ONLY a JSON array of strings, one per image. "
             "Example: [\\\"B\\\", \\\"I\\\", \\\"?\\\"]";
-        std::string rack_payload = "{\"contents\":[{\"parts\":["
-            "{\"text\":\"" + rack_prompt + "\"}";
-        std::string rack_msg = "{\"status\":\"Verifying rack ("
-            + std::to_string(rack_tiles.size()) + " tiles detected)...\",\"crops\":[";
+        GeminiPayload rack_parts(rack_prompt);
+        std::deque<std::string> rack_b64;  // shared with the status message
+        out.begin_object().key("status").string("Verifying rack ("
+            + std::to_string(rack_tiles.size()) + " tiles detected)...");
+        out.key("crops").begin_array();
         for (size_t ri = 0; ri < rack_tiles.size(); ri++) {
-            std::string b64r = base64_encode(rack_tiles[ri].png);
-            rack_payload += ",{\"inlineData\":{\"mimeType\":\"image/png\","
-                "\"data\":\"" + b64r + "\"}}";
-            if (ri > 0) rack_msg += ",";
-            rack_msg += "{\"pos\":\"R" + std::to_string(ri + 1) +
-                "\",\"cur\":\"" +
-                (ri < gemini_rack.size()
-                    ? std::string(1, gemini_rack[ri])
-                    : std::string("?")) +
-                "\",\"img\":\"data:image/png;base64," + b64r + "\"}";
+            const std::string& b64r = rack_b64.emplace_back(base64_encode(rack_tiles[ri].png));
+            rack_parts.png_b64(b64r);
+            write_crop_preview(out, "R" + std::to_string(ri + 1),
+                               ri < gemini_rack.size() ? gemini_rack[ri] : '?', 0, b64r);
         }
-        rack_payload += "]}]}";
-        rack_msg += "]}\n";
-        sink.write(rack_msg.data(), rack_msg.size());
+        std::string rack_payload = rack_parts.build();
+        out.end_array().end_object().line();
+        out.send(sink);
 
         // Launch async Gemini call
         rack_verify_launched = true;
@@ -2841,15 +2399,12 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     + std::to_string(mask_blocks.size()) + " blocks)\n";
             }
         }
-        if (!realign_log.empty()) {
-            std::string msg = "{\"status\":\"Realigned shifted rows: "
-                + json_escape(realign_log) + "\"}\n";
-            sink.write(msg.data(), msg.size());
-        }
+        if (!realign_log.empty())
+            send_status("Realigned shifted rows: " + realign_log);
     }
 
     // Stage snapshot: after realignment (before occupancy enforcement)
-    { std::string s="{\"stage\":\"realigned\",\"stage_cgp\":\""+json_escape(cells_to_cgp(dr.cells))+"\"}\n"; sink.write(s.data(),s.size()); }
+    send_stage("realigned", dr.cells);
 
     // Step 4: Strict occupancy enforcement — clear all non-occupied cells.
     // Save Gemini's original readings for disputed cells (Gemini found a
@@ -2938,20 +2493,14 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     + std::to_string(r + 1) + ":" + old_u + "->" + new_u;
             }
         }
-        if (!wc_fill_detail.empty()) {
-            std::string msg = "{\"status\":\"Word crop OCR filled: "
-                + json_escape(wc_fill_detail) + "\"}\n";
-            sink.write(msg.data(), msg.size());
-        }
-        if (!wc_fix_detail.empty()) {
-            std::string msg = "{\"status\":\"Word crop OCR corrected: "
-                + json_escape(wc_fix_detail) + "\"}\n";
-            sink.write(msg.data(), msg.size());
-        }
+        if (!wc_fill_detail.empty())
+            send_status("Word crop OCR filled: " + wc_fill_detail);
+        if (!wc_fix_detail.empty())
+            send_status("Word crop OCR corrected: " + wc_fix_detail);
     }
 
     // Stage snapshot: after word-crop OCR corrections
-    { std::string s="{\"stage\":\"trans\",\"stage_cgp\":\""+json_escape(cells_to_cgp(dr.cells))+"\"}\n"; sink.write(s.data(),s.size()); }
+    send_stage("trans", dr.cells);
 
     // Step 4.5: Early Woogles check — if occupancy is locked, apply golden
     // data now and skip the disputed-cell retry (which would let Gemini
@@ -3016,8 +2565,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                         }
                         dr.cgp = golden_cgp;
                         disputed.clear();  // no disputed cells to retry
-                        std::string msg = "{\"status\":\"Woogles occupancy locked — applied golden data, skipping retry.\"}\n";
-                        sink.write(msg.data(), msg.size());
+                        send_status("Woogles occupancy locked — applied golden data, skipping retry.");
                     }
                 }
             }
@@ -3044,11 +2592,10 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
         int n_missing = 0, n_disputed = 0;
         for (const auto& rc : retry_cells)
             if (rc.is_disputed) n_disputed++; else n_missing++;
-        std::string msg = "{\"status\":\"Re-querying "
+        send_status("Re-querying "
             + std::to_string(n_missing) + " missed + "
             + std::to_string(n_disputed)
-            + " disputed cell(s)...\"}\n";
-        sink.write(msg.data(), msg.size());
+            + " disputed cell(s)...");
 
         int bx, by, cell_sz;
         if (parse_board_rect_from_log(opencv_dr.log, bx, by, cell_sz)) {
@@ -3074,8 +2621,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     "Return ONLY a JSON array. "
                     "Example: [\\\"F\\\", null, \\\"s\\\", \\\"A\\\"]";
 
-                std::string retry_payload = "{\"contents\":[{\"parts\":["
-                    "{\"text\":\"" + retry_prompt + "\"}";
+                GeminiPayload retry_parts(retry_prompt);
 
                 int pad = cell_sz / 8;
                 for (const auto& rc : retry_cells) {
@@ -3097,10 +2643,9 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                         cv::GaussianBlur(cell_img, cell_img, cv::Size(3, 3), 0);
                     std::vector<uint8_t> png_buf;
                     cv::imencode(".png", cell_img, png_buf);
-                    retry_payload += ",{\"inlineData\":{\"mimeType\":\"image/png\","
-                        "\"data\":\"" + base64_encode(png_buf) + "\"}}";
+                    retry_parts.png(std::move(png_buf));
                 }
-                retry_payload += "]}]}";
+                std::string retry_payload = retry_parts.build();
 
                 auto gcr2 = call_gemini(url, retry_payload,
                     "retry_verify", retry_prompt, 30, 1);
@@ -3132,14 +2677,14 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
         auto conn = check_board_connectivity(dr.cells);
         if (conn.center_empty || !conn.islands.empty()) {
             // Build status message
-            std::string conn_msg = "{\"status\":\"Connectivity: ";
+            std::string conn_msg = "Connectivity: ";
             if (conn.center_empty)
                 conn_msg += "center empty, ";
             if (!conn.islands.empty())
                 conn_msg += std::to_string(conn.islands.size()) + " island(s), ";
             conn_msg += std::to_string(conn.bridge_candidates.size())
-                + " bridge candidate(s)\"}\n";
-            sink.write(conn_msg.data(), conn_msg.size());
+                + " bridge candidate(s)";
+            send_status(conn_msg);
 
             // Build requery list: bridge candidates + island tiles (disputed)
             std::vector<RetryCell> conn_retry;
@@ -3173,8 +2718,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                             "Return ONLY a JSON array. "
                             "Example: [\\\"F\\\", null, \\\"s\\\", \\\"A\\\"]";
 
-                        std::string conn_payload = "{\"contents\":[{\"parts\":["
-                            "{\"text\":\"" + conn_prompt + "\"}";
+                        GeminiPayload conn_parts(conn_prompt);
 
                         int pad = cell_sz / 8;
                         for (const auto& rc : conn_retry) {
@@ -3189,10 +2733,9 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                              cell_img.rows - sy)) = cv::Scalar(128, 128, 128);
                             std::vector<uint8_t> png_buf;
                             cv::imencode(".png", cell_img, png_buf);
-                            conn_payload += ",{\"inlineData\":{\"mimeType\":\"image/png\","
-                                "\"data\":\"" + base64_encode(png_buf) + "\"}}";
+                            conn_parts.png(std::move(png_buf));
                         }
-                        conn_payload += "]}]}";
+                        std::string conn_payload = conn_parts.build();
 
                         auto gcrc = call_gemini(url, conn_payload,
                             "connectivity", conn_prompt, 30, 1);
@@ -3207,9 +2750,8 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                 }
                             }
                             if (filled > 0) {
-                                std::string fmsg = "{\"status\":\"Connectivity: filled "
-                                    + std::to_string(filled) + " cell(s)\"}\n";
-                                sink.write(fmsg.data(), fmsg.size());
+                                send_status("Connectivity: filled "
+                                    + std::to_string(filled) + " cell(s)");
                             }
                         }
                     }
@@ -3219,16 +2761,15 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
             // Re-check connectivity after fixes
             auto conn2 = check_board_connectivity(dr.cells);
             if (!conn2.islands.empty()) {
-                std::string wmsg = "{\"status\":\"Warning: "
+                send_status("Warning: "
                     + std::to_string(conn2.islands.size())
-                    + " island(s) still disconnected\"}\n";
-                sink.write(wmsg.data(), wmsg.size());
+                    + " island(s) still disconnected");
             }
         }
     }
 
     // Stage snapshot: after all retry crops + connectivity
-    { std::string s="{\"stage\":\"retry\",\"stage_cgp\":\""+json_escape(cells_to_cgp(dr.cells))+"\"}\n"; sink.write(s.data(),s.size()); }
+    send_stage("retry", dr.cells);
 
     // Step 6: Bag-math validation — re-query cells with over-counted letters
     if (have_opencv && !gemini_bag.empty()) {
@@ -3311,9 +2852,10 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
 
                     if (!img_v.empty()) {
                         // Build status with crop images so user can inspect
-                        std::string crop_status = "{\"status\":\"Verifying "
+                        out.begin_object().key("status").string("Verifying "
                             + std::to_string(suspects.size()) + " cell(s) ("
-                            + over_letters + " over-counted)...\",\"crops\":[";
+                            + over_letters + " over-counted)...");
+                        out.key("crops").begin_array();
 
                         std::string vfy_prompt =
                             "These are cropped Scrabble tile images. The tile "
@@ -3328,8 +2870,8 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                             "Return ONLY a JSON array of single letters. "
                             "Example: [\\\"I\\\", \\\"H\\\"]";
 
-                        std::string vfy_payload = "{\"contents\":[{\"parts\":["
-                            "{\"text\":\"" + vfy_prompt + "\"}";
+                        GeminiPayload vfy_parts(vfy_prompt);
+                        std::deque<std::string> vfy_b64;  // shared with the status line
 
                         int pad = cell_sz / 8;
                         for (size_t si = 0; si < suspects.size(); si++) {
@@ -3341,31 +2883,24 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                             cv::Mat cell_img = img_v(cv::Rect(cx, cy, cw, ch_));
                             std::vector<uint8_t> png_buf;
                             cv::imencode(".png", cell_img, png_buf);
-                            std::string b64_crop = base64_encode(png_buf);
-                            vfy_payload += ",{\"inlineData\":{\"mimeType\":\"image/png\","
-                                "\"data\":\"" + b64_crop + "\"}}";
+                            const std::string& b64_crop =
+                                vfy_b64.emplace_back(base64_encode(png_buf));
+                            vfy_parts.png_b64(b64_crop);
                             // Add to status crops
-                            if (si > 0) crop_status += ",";
                             char cur_lbl = static_cast<char>(std::toupper(
                                 static_cast<unsigned char>(dr.cells[sp.r][sp.c].letter)));
                             char raw_lbl = raw_main_cells[sp.r][sp.c].letter
                                 ? static_cast<char>(std::toupper(static_cast<unsigned char>(
                                     raw_main_cells[sp.r][sp.c].letter))) : 0;
-                            crop_status += "{\"pos\":\"" +
-                                std::string(1, static_cast<char>('A' + sp.c)) +
-                                std::to_string(sp.r + 1) + "\",\"cur\":\"" +
-                                std::string(1, cur_lbl) + "\"" +
-                                (raw_lbl && raw_lbl != cur_lbl
-                                    ? ",\"initial\":\"" + std::string(1, raw_lbl) + "\""
-                                    : "") +
-                                ",\"img\":\"data:image/png;base64," +
-                                b64_crop + "\"}";
+                            write_crop_preview(out,
+                                static_cast<char>('A' + sp.c) + std::to_string(sp.r + 1),
+                                cur_lbl, raw_lbl, b64_crop);
                         }
-                        vfy_payload += "]}]}";
+                        std::string vfy_payload = vfy_parts.build();
 
                         // Send status with crop previews
-                        crop_status += "]}\n";
-                        sink.write(crop_status.data(), crop_status.size());
+                        out.end_array().end_object().line();
+                        out.send(sink);
 
                         auto gcrv = call_gemini(url, vfy_payload,
                             "verify_board", vfy_prompt, 30, 1);
@@ -3412,15 +2947,12 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                 }
                             }
                             // Report corrections
-                            std::string vfy_result;
                             if (corrections > 0)
-                                vfy_result = "{\"status\":\"Corrected "
-                                    + std::to_string(corrections) + " cell(s): "
-                                    + json_escape(corr_detail) + "\"}\n";
+                                send_status("Corrected " + std::to_string(corrections)
+                                            + " cell(s): " + corr_detail);
                             else
-                                vfy_result = "{\"status\":\"Verification confirmed all "
-                                    + std::to_string(suspects.size()) + " cell(s)\"}\n";
-                            sink.write(vfy_result.data(), vfy_result.size());
+                                send_status("Verification confirmed all "
+                                            + std::to_string(suspects.size()) + " cell(s)");
                         }
                     }
                 }
@@ -3432,10 +2964,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
     if (rack_verify_launched) {
         std::string new_rack = rack_verify_future.get();
         if (!new_rack.empty() && new_rack != gemini_rack) {
-            std::string rmsg = "{\"status\":\"Rack corrected: "
-                + json_escape(gemini_rack) + " -> "
-                + json_escape(new_rack) + "\"}\n";
-            sink.write(rmsg.data(), rmsg.size());
+            send_status("Rack corrected: " + gemini_rack + " -> " + new_rack);
             gemini_rack = new_rack;
         }
     }
@@ -3477,14 +3006,11 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
             std::string note = (have_valid_gemini_lex && gemini_lexicon != "CSW24")
                 ? " (overrides Gemini's " + gemini_lexicon + ")" : "";
             gemini_lexicon = "CSW24";
-            std::string msg = "{\"status\":\"Inferred lexicon CSW24 (CSW-only words: "
-                + json_escape(wlist) + json_escape(note) + ")\"}\n";
-            sink.write(msg.data(), msg.size());
+            send_status("Inferred lexicon CSW24 (CSW-only words: " + wlist + note + ")");
         } else if (!have_valid_gemini_lex) {
             // Gemini gave no valid lexicon and no CSW-only words found.
             gemini_lexicon = "NWL23";
-            std::string msg = "{\"status\":\"Inferred lexicon NWL23 (no CSW-only words found)\"}\n";
-            sink.write(msg.data(), msg.size());
+            send_status("Inferred lexicon NWL23 (no CSW-only words found)");
         }
         // If Gemini gave a valid lexicon and no CSW-only words, keep it as-is.
 
@@ -3547,8 +3073,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                 }
             }
             dr.cgp = golden_cgp;
-            std::string msg = "{\"status\":\"Woogles match found — using golden data, skipping OCR refinement.\"}\n";
-            sink.write(msg.data(), msg.size());
+            send_status("Woogles match found — using golden data, skipping OCR refinement.");
         }
     }
 
@@ -3617,12 +3142,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     if (!iw_list.empty()) iw_list += ", ";
                     iw_list += iw.word + " (" + iw.position + ")";
                 }
-                {
-                    std::string msg = "{\"status\":\"Invalid words ["
-                        + json_escape(g_kwg_lexicon) + "]: "
-                        + json_escape(iw_list) + "\"}\n";
-                    sink.write(msg.data(), msg.size());
-                }
+                send_status("Invalid words [" + g_kwg_lexicon + "]: " + iw_list);
 
                 // Gap filling: check empty cells at endpoints of invalid words
                 // Only look at the cell immediately before/after each invalid
@@ -3660,10 +3180,9 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     }
 
                     if (!gap_set.empty()) {
-                        std::string gmsg = "{\"status\":\"Found "
+                        send_status("Found "
                             + std::to_string(gap_set.size())
-                            + " gap(s) at invalid word endpoints, re-querying...\"}\n";
-                        sink.write(gmsg.data(), gmsg.size());
+                            + " gap(s) at invalid word endpoints, re-querying...");
 
                         std::vector<RetryCell> gap_retry;
                         for (const auto& [gr, gc] : gap_set)
@@ -3692,8 +3211,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                     "Return ONLY a JSON array. "
                                     "Example: [\\\"F\\\", null, \\\"s\\\", \\\"A\\\"]";
 
-                                std::string gap_payload = "{\"contents\":[{\"parts\":["
-                                    "{\"text\":\"" + gap_prompt + "\"}";
+                                GeminiPayload gap_parts(gap_prompt);
 
                                 int pad = cell_sz / 8;
                                 for (const auto& rc : gap_retry) {
@@ -3704,10 +3222,9 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                     cv::Mat cell_img = img_g(cv::Rect(cx, cy, cw, ch));
                                     std::vector<uint8_t> png_buf;
                                     cv::imencode(".png", cell_img, png_buf);
-                                    gap_payload += ",{\"inlineData\":{\"mimeType\":\"image/png\","
-                                        "\"data\":\"" + base64_encode(png_buf) + "\"}}";
+                                    gap_parts.png(std::move(png_buf));
                                 }
-                                gap_payload += "]}]}";
+                                std::string gap_payload = gap_parts.build();
 
                                 auto gcrg = call_gemini(url, gap_payload,
                                     "gap_fill", gap_prompt, 30, 1);
@@ -3748,9 +3265,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                         }
                                     }
                                     if (gap_filled > 0) {
-                                        std::string gfmsg = "{\"status\":\"Gap fill: "
-                                            + json_escape(gap_detail) + "\"}\n";
-                                        sink.write(gfmsg.data(), gfmsg.size());
+                                        send_status("Gap fill: " + gap_detail);
 
                                         // Re-extract words and rebuild invalid list
                                         all_words = extract_words(dr.cells);
@@ -3790,11 +3305,8 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                             if (!iw_list.empty()) iw_list += ", ";
                                             iw_list += iw.word + " (" + iw.position + ")";
                                         }
-                                        if (!invalid.empty()) {
-                                            std::string umsg = "{\"status\":\"After gap fill, invalid: "
-                                                + json_escape(iw_list) + "\"}\n";
-                                            sink.write(umsg.data(), umsg.size());
-                                        }
+                                        if (!invalid.empty())
+                                            send_status("After gap fill, invalid: " + iw_list);
                                     }
                                 }
                             }
@@ -3949,9 +3461,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                     }
 
                     if (!wc_fixed.empty()) {
-                        std::string msg = "{\"status\":\"Word completion: "
-                            + json_escape(wc_detail) + "\"}\n";
-                        sink.write(msg.data(), msg.size());
+                        send_status("Word completion: " + wc_detail);
 
                         // Remove fixed cells from suspects
                         suspects.erase(
@@ -3999,11 +3509,10 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
 
                         if (!img_d.empty()) {
                             // Build crop status for UI debug
-                            std::string crop_status =
-                                "{\"status\":\"Re-querying "
+                            out.begin_object().key("status").string("Re-querying "
                                 + std::to_string(suspects.size())
-                                + " suspect cell(s) from invalid words...\""
-                                + ",\"crops\":[";
+                                + " suspect cell(s) from invalid words...");
+                            out.key("crops").begin_array();
 
                             // Build prompt listing current letters and the
                             // invalid words they participate in
@@ -4023,9 +3532,8 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                 "Return ONLY a JSON array of single letters. "
                                 "Example: [\\\"I\\\", \\\"H\\\"]";
 
-                            std::string dict_payload =
-                                "{\"contents\":[{\"parts\":["
-                                "{\"text\":\"" + dict_prompt + "\"}";
+                            GeminiPayload dict_parts(dict_prompt);
+                            std::deque<std::string> dict_b64;  // shared with the status line
 
                             int pad = cell_sz / 8;
                             for (size_t si = 0; si < suspects.size(); si++) {
@@ -4037,31 +3545,23 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                 cv::Mat cell_img = img_d(cv::Rect(cx, cy, cw, ch_));
                                 std::vector<uint8_t> png_buf;
                                 cv::imencode(".png", cell_img, png_buf);
-                                std::string b64_crop = base64_encode(png_buf);
-                                dict_payload +=
-                                    ",{\"inlineData\":{\"mimeType\":\"image/png\","
-                                    "\"data\":\"" + b64_crop + "\"}}";
-                                if (si > 0) crop_status += ",";
+                                const std::string& b64_crop =
+                                    dict_b64.emplace_back(base64_encode(png_buf));
+                                dict_parts.png_b64(b64_crop);
                                 char cur_ltr = static_cast<char>(std::toupper(
                                     static_cast<unsigned char>(
                                         dr.cells[sp.first][sp.second].letter)));
                                 char raw_ltr = raw_main_cells[sp.first][sp.second].letter
                                     ? static_cast<char>(std::toupper(static_cast<unsigned char>(
                                         raw_main_cells[sp.first][sp.second].letter))) : 0;
-                                crop_status += "{\"pos\":\""
-                                    + std::string(1, static_cast<char>('A' + sp.second))
-                                    + std::to_string(sp.first + 1)
-                                    + "\",\"cur\":\""
-                                    + std::string(1, cur_ltr) + "\""
-                                    + (raw_ltr && raw_ltr != cur_ltr
-                                        ? ",\"initial\":\"" + std::string(1, raw_ltr) + "\""
-                                        : "")
-                                    + ",\"img\":\"data:image/png;base64,"
-                                    + b64_crop + "\"}";
+                                write_crop_preview(out,
+                                    static_cast<char>('A' + sp.second)
+                                        + std::to_string(sp.first + 1),
+                                    cur_ltr, raw_ltr, b64_crop);
                             }
-                            dict_payload += "]}]}";
-                            crop_status += "]}\n";
-                            sink.write(crop_status.data(), crop_status.size());
+                            std::string dict_payload = dict_parts.build();
+                            out.end_array().end_object().line();
+                            out.send(sink);
 
                             // Call Gemini
                             auto gcrd = call_gemini(url, dict_payload,
@@ -4123,14 +3623,8 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                                             di++;
                                     }
                                 }
-                                if (corrections > 0) {
-                                    std::string vmsg =
-                                        "{\"status\":\"Dict corrections: "
-                                        + json_escape(corr_detail)
-                                        + "\"}\n";
-                                    sink.write(vmsg.data(),
-                                               vmsg.size());
-                                }
+                                if (corrections > 0)
+                                    send_status("Dict corrections: " + corr_detail);
                             }
                         }
                     }
@@ -4164,21 +3658,19 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
 
             // Build JSON for UI display
             if (!invalid.empty()) {
-                invalid_words_json = "[";
-                for (size_t i = 0; i < invalid.size(); i++) {
-                    if (i > 0) invalid_words_json += ",";
-                    invalid_words_json += "{\"word\":\""
-                        + json_escape(invalid[i].word)
-                        + "\",\"pos\":\""
-                        + json_escape(invalid[i].position) + "\"}";
-                }
-                invalid_words_json += "]";
+                JsonWriter iw;
+                iw.begin_array();
+                for (const auto& w : invalid)
+                    iw.begin_object().key("word").string(w.word)
+                        .key("pos").string(w.position).end_object();
+                iw.end_array();
+                invalid_words_json = iw.str();
             }
         }
     }
 
     // Stage snapshot: after word completion + dict requery
-    { std::string s="{\"stage\":\"wc\",\"stage_cgp\":\""+json_escape(cells_to_cgp(dr.cells))+"\"}\n"; sink.write(s.data(),s.size()); }
+    send_stage("wc", dr.cells);
 
     // --- Rack validation & auto-correction ---
     // Runs after word corrections so the warning reflects the final board state.
@@ -4319,8 +3811,7 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
     // The async lookup ran on raw OCR which may have been inaccurate (e.g. mementos).
     // The corrected board gives much better letter_accuracy for matching.
     if (!skip_woogles && woogles_json_result == "null" && !dr.cgp.empty()) {
-        std::string s = "{\"status\":\"Woogles: retrying with corrected board...\"}\n";
-        sink.write(s.data(), s.size());
+        send_status("Woogles: retrying with corrected board...");
         woogles_json_result = run_woogles_lookup(
             cells_to_cgp(dr.cells),
             gemini_player1, gemini_player2,
@@ -4359,79 +3850,65 @@ static void stream_analyze_gemini(const std::vector<uint8_t>& buf,
                        + std::to_string(gemini_score1) + " "
                        + std::to_string(gemini_score2)
                        + " lex " + gemini_lexicon + ";";
-                std::string msg = "{\"status\":\"Woogles fallback match — golden scores/lexicon applied.\"}\n";
-                sink.write(msg.data(), msg.size());
+                send_status("Woogles fallback match — golden scores/lexicon applied.");
             }
         }
     }
 
-    std::string final_json = make_json_response(dr);
-    // Inject extra fields before the closing }
-    std::string extra;
-    if (!gemini_bag.empty())
-        extra += ",\"bag\":\"" + json_escape(gemini_bag) + "\"";
-    if (!rack_warning.empty())
-        extra += ",\"rack_warning\":\"" + json_escape(rack_warning) + "\"";
-    if (!invalid_words_json.empty())
-        extra += ",\"invalid_words\":" + invalid_words_json;
+    // Everything after the common result fields goes through its own
+    // writer, so a board cache hit can replay it.
+    JsonWriter fields;
+    if (!gemini_bag.empty()) fields.key("bag").string(gemini_bag);
+    if (!rack_warning.empty()) fields.key("rack_warning").string(rack_warning);
+    if (!invalid_words_json.empty()) fields.key("invalid_words").raw(invalid_words_json);
     // OCR trail: per-cell comparison of raw main / transposed / final
-    {
-        std::string trail = "[";
-        bool first_t = true;
-        for (int r = 0; r < 15; r++) {
-            for (int c = 0; c < 15; c++) {
-                char raw_ch = raw_main_cells[r][c].letter;
-                char fin_ch = dr.cells[r][c].letter;
-                if (raw_ch == 0 && fin_ch == 0) continue;
-                char raw_u = raw_ch ? static_cast<char>(std::toupper(
-                    static_cast<unsigned char>(raw_ch))) : 0;
-                char fin_u = fin_ch ? static_cast<char>(std::toupper(
-                    static_cast<unsigned char>(fin_ch))) : 0;
-                // Skip if raw==final
-                if (raw_u == fin_u) continue;
-                char trans_u = 0;
-                if (!first_t) trail += ",";
-                first_t = false;
-                std::string pos = std::string(1, static_cast<char>('A' + c))
-                    + std::to_string(r + 1);
-                trail += "{\"pos\":\"" + pos + "\","
-                    "\"raw\":\"" + (raw_u ? std::string(1, raw_u) : "") + "\","
-                    "\"trans\":\"" + (trans_u ? std::string(1, trans_u) : "") + "\","
-                    "\"final\":\"" + (fin_u ? std::string(1, fin_u) : "") + "\"}";
-            }
+    fields.key("ocr_trail").begin_array();
+    for (int r = 0; r < 15; r++) {
+        for (int c = 0; c < 15; c++) {
+            char raw_ch = raw_main_cells[r][c].letter;
+            char fin_ch = dr.cells[r][c].letter;
+            if (raw_ch == 0 && fin_ch == 0) continue;
+            char raw_u = raw_ch ? static_cast<char>(std::toupper(
+                static_cast<unsigned char>(raw_ch))) : 0;
+            char fin_u = fin_ch ? static_cast<char>(std::toupper(
+                static_cast<unsigned char>(fin_ch))) : 0;
+            // Skip if raw==final
+            if (raw_u == fin_u) continue;
+            char trans_u = 0;
+            std::string pos = std::string(1, static_cast<char>('A' + c))
+                + std::to_string(r + 1);
+            fields.begin_object().key("pos").string(pos)
+                .key("raw").string(raw_u ? std::string_view(&raw_u, 1) : "")
+                .key("trans").string(trans_u ? std::string_view(&trans_u, 1) : "")
+                .key("final").string(fin_u ? std::string_view(&fin_u, 1) : "")
+                .end_object();
         }
-        trail += "]";
-        extra += ",\"ocr_trail\":" + trail;
-        extra += ",\"raw_main_cgp\":\"" + json_escape(cells_to_cgp(raw_main_cells)) + "\"";
     }
+    fields.end_array();
+    fields.key("raw_main_cgp").string(cells_to_cgp(raw_main_cells));
     // Include occupancy grid so UI can show it
     if (have_opencv) {
-        extra += ",\"occupancy\":[";
+        fields.key("occupancy").begin_array();
         for (int r = 0; r < 15; r++) {
-            if (r > 0) extra += ",";
-            extra += "[";
-            for (int c = 0; c < 15; c++) {
-                if (c > 0) extra += ",";
-                extra += get_occupied(r, c) ? "1" : "0";
-            }
-            extra += "]";
+            fields.begin_array();
+            for (int c = 0; c < 15; c++) fields.number(get_occupied(r, c) ? 1 : 0);
+            fields.end_array();
         }
-        extra += "]";
+        fields.end_array();
     }
     // Include player names in extra fields if available
-    if (!gemini_player1.empty())
-        extra += ",\"player1\":\"" + json_escape(gemini_player1) + "\"";
-    if (!gemini_player2.empty())
-        extra += ",\"player2\":\"" + json_escape(gemini_player2) + "\"";
-    if (!extra.empty())
-        final_json.insert(final_json.size() - 1, extra); // insert before }
-    final_json += "\n";
-    sink.write(final_json.data(), final_json.size());
+    if (!gemini_player1.empty()) fields.key("player1").string(gemini_player1);
+    if (!gemini_player2.empty()) fields.key("player2").string(gemini_player2);
+    out.begin_object();
+    write_result_fields(out, dr);
+    out.members(fields.str()).end_object().line();
+    out.send(sink);
+    probe.store(dr, {fields.str(), skip_woogles ? std::string() : woogles_json_result});
 
     // --- Emit Woogles result (computed async above, with fallback if needed) ---
     if (!skip_woogles) {
-        std::string woogles_line = "{\"woogles\":" + woogles_json_result + "}\n";
-        sink.write(woogles_line.data(), woogles_line.size());
+        out.begin_object().key("woogles").raw(woogles_json_result).end_object().line();
+        out.send(sink);
     }
     sink.done();
 }
@@ -4464,6 +3941,11 @@ static int generate_rack_diag() {
         int n_detected;             // how many tiles detected
     };
 
+    // Pipeline + rack results come from the feature store, so reruns only
+    // pay for images that are new or predate the current pipeline
+    // (PIPELINE_VERSION, models, switches).
+    FeatureStore store(FEATURE_STORE_DEFAULT_PATH);
+
     std::vector<CaseDiag> failures;
     int total_cases = 0, rack_cases = 0, rack_perfect = 0;
     int rack_total_tiles = 0, rack_correct_tiles = 0;
@@ -4495,25 +3977,16 @@ static int generate_rack_diag() {
                             std::istreambuf_iterator<char>());
         }
 
-        DebugResult dr = process_board_image_debug(img_data);
+        const FeatureRecord& rec = store.get(img_data);
 
         std::string expected_rack = parse_cgp_rack(expected_cgp);
-        if (dr.cell_size <= 0 || expected_rack.empty()) {
+        if (rec.cell_size <= 0 || expected_rack.empty()) {
             total_cases++;
             continue;
         }
 
-        bool is_light = detect_board_mode(img_data,
-            dr.board_rect.x, dr.board_rect.y, dr.cell_size);
-        auto rack_tiles = detect_rack_tiles(img_data,
-            dr.board_rect.x, dr.board_rect.y, dr.cell_size, is_light);
-
-        int n_rt = static_cast<int>(rack_tiles.size());
-        CellResult rack_cr[7] = {};
-        for (int i = 0; i < n_rt && i < 7; i++)
-            rack_cr[i] = classify_rack_tile_full(rack_tiles[i]);
-        refine_rack(rack_cr, std::min(n_rt, 7), dr.cells);
-        alphagram_tiebreak(rack_cr, std::min(n_rt, 7));
+        int n_rt = rec.n_rack;
+        const CellResult* rack_cr = rec.rack;
 
         std::string got_rack;
         for (int i = 0; i < n_rt && i < 7; i++) {
@@ -4552,6 +4025,8 @@ static int generate_rack_diag() {
 
         if (rack_ok) continue;  // Only collect failures
 
+        auto rack_tiles = stored_rack_tiles(rec, img_data);
+
         // Build annotated image: decode, draw board rect + rack tile rects
         cv::Mat raw_mat(1, static_cast<int>(img_data.size()), CV_8UC1,
                         img_data.data());
@@ -4559,7 +4034,7 @@ static int generate_rack_diag() {
         if (img.empty()) continue;
 
         // Draw board rect in green
-        cv::Rect br = dr.board_rect;
+        cv::Rect br = rec.rect();
         cv::rectangle(img, br, cv::Scalar(0, 200, 0), 2);
 
         // Draw each rack tile rect
@@ -4621,7 +4096,11 @@ static int generate_rack_diag() {
     std::printf("\n%d rack cases, %d perfect, tiles %d/%d (%.1f%%)\n",
                 rack_cases, rack_perfect,
                 rack_correct_tiles, rack_total_tiles, rack_tile_pct);
-    std::printf("%d failures to diagnose\n", (int)failures.size());
+    std::printf("%d failures to diagnose (%d images from feature store)\n",
+                (int)failures.size(), store.hits());
+    if (!store.save())
+        std::fprintf(stderr, "Failed to write feature store %s\n",
+                     FEATURE_STORE_DEFAULT_PATH);
 
     // Generate HTML
     std::ofstream html("rack_diag.html");
@@ -4756,6 +4235,100 @@ h1{font-size:1.5rem;margin-bottom:8px;color:#fff}
 
 // ---------------------------------------------------------------------------
 
+// ---------------------------------------------------------------------------
+// Conditional GET and content negotiation for the embedded pages and the
+// eval JSON.  Responses carry an ETag with Cache-Control: no-cache, so the
+// browser revalidates each load and usually gets an empty 304.
+// ---------------------------------------------------------------------------
+static bool accepts_encoding(const httplib::Request& req, const char* encoding) {
+    std::string header = req.get_header_value("Accept-Encoding");
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) end = header.size();
+        std::string item = header.substr(pos, end - pos);
+        pos = end + 1;
+        size_t semi = item.find(';');
+        std::string token = item.substr(0, semi);
+        token.erase(0, token.find_first_not_of(' '));
+        token.erase(token.find_last_not_of(' ') + 1);
+        if (token != encoding) continue;
+        // "gzip;q=0" explicitly refuses the encoding.
+        size_t q = item.find("q=", semi == std::string::npos ? item.size() : semi);
+        return q == std::string::npos || std::atof(item.c_str() + q + 2) > 0;
+    }
+    return false;
+}
+
+static bool etag_matches(const httplib::Request& req, const std::string& etag) {
+    std::string inm = req.get_header_value("If-None-Match");
+    return inm == "*" || inm.find(etag) != std::string::npos;
+}
+
+static void serve_web_asset(const httplib::Request& req, httplib::Response& res,
+                            const char* route) {
+    const WebAsset* asset = find_web_asset(route);
+    if (!asset) {
+        res.status = 404;
+        return;
+    }
+    const unsigned char* data = asset->raw;
+    size_t size = asset->raw_size;
+    const char* encoding = nullptr;
+    if (asset->br && accepts_encoding(req, "br")) {
+        data = asset->br;
+        size = asset->br_size;
+        encoding = "br";
+    } else if (accepts_encoding(req, "gzip")) {
+        data = asset->gzip;
+        size = asset->gzip_size;
+        encoding = "gzip";
+    }
+
+    // Each encoding is a different representation, so it gets its own tag.
+    std::string etag = asset->etag;
+    if (encoding) etag.insert(etag.size() - 1, std::string("-") + encoding);
+    res.set_header("ETag", etag);
+    res.set_header("Cache-Control", "no-cache");
+    res.set_header("Vary", "Accept-Encoding");
+    if (etag_matches(req, etag)) {
+        res.status = 304;
+        return;
+    }
+    if (encoding) res.set_header("Content-Encoding", encoding);
+    // A sized content provider goes out as-is; with set_content() an
+    // httplib built with zlib would compress the compressed body again.
+    res.set_content_provider(
+        size, asset->content_type,
+        [data](size_t offset, size_t length, httplib::DataSink& sink) {
+            return sink.write(reinterpret_cast<const char*>(data) + offset, length);
+        });
+}
+
+// ---------------------------------------------------------------------------
+// httplib's thread pool, plus queue depth / busy worker gauges.
+// ---------------------------------------------------------------------------
+class MeteredTaskQueue : public httplib::TaskQueue {
+public:
+    explicit MeteredTaskQueue(size_t n) : pool_(n) {}
+
+    bool enqueue(std::function<void()> fn) override {
+        g_metrics.queue_depth.inc();
+        bool ok = pool_.enqueue([fn = std::move(fn)]() {
+            g_metrics.queue_depth.dec();
+            ScopedGauge busy(g_metrics.busy_workers);
+            fn();
+        });
+        if (!ok) g_metrics.queue_depth.dec();
+        return ok;
+    }
+
+    void shutdown() override { pool_.shutdown(); }
+
+private:
+    httplib::ThreadPool pool_;
+};
+
 int main(int argc, char* argv[]) {
     load_dotenv();
 
@@ -4801,8 +4374,32 @@ int main(int argc, char* argv[]) {
 
     httplib::Server svr;
 
-    svr.Get("/", [](const httplib::Request&, httplib::Response& res) {
-        res.set_content(HTML, "text/html");
+    svr.new_task_queue = [] {
+        return new MeteredTaskQueue(CPPHTTPLIB_THREAD_POOL_COUNT);
+    };
+
+    // Per-route request metrics.  The same worker thread runs routing and
+    // the logger (which fires after any chunked body has been streamed),
+    // so the start time can live in a thread_local.
+    static thread_local auto t_request_start = std::chrono::steady_clock::now();
+    svr.set_pre_routing_handler([](const httplib::Request&, httplib::Response&) {
+        t_request_start = std::chrono::steady_clock::now();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    svr.set_logger([](const httplib::Request& req, const httplib::Response& res) {
+        EndpointMetrics& em = endpoint_metrics(req.path);
+        em.requests.inc();
+        if (res.status >= 400) em.errors.inc();
+        em.latency.observe(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t_request_start).count());
+    });
+
+    svr.Get("/", [](const httplib::Request& req, httplib::Response& res) {
+        serve_web_asset(req, res, "/");
+    });
+
+    svr.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(metrics_scrape(), "text/plain; version=0.0.4");
     });
 
     svr.Post("/analyze", [](const httplib::Request& req, httplib::Response& res) {
@@ -4814,6 +4411,8 @@ int main(int argc, char* argv[]) {
         const auto& file = req.get_file_value("image");
         auto buf = std::make_shared<std::vector<uint8_t>>(
             file.content.begin(), file.content.end());
+        std::string prev_cgp = req.has_file("prev_cgp")
+            ? req.get_file_value("prev_cgp").content : "";
 
         // Store for test case saving
         {
@@ -4824,8 +4423,14 @@ int main(int argc, char* argv[]) {
         res.set_header("X-Content-Type-Options", "nosniff");
         res.set_chunked_content_provider(
             "application/x-ndjson",
-            [buf](size_t /*offset*/, httplib::DataSink& sink) {
-                stream_analyze(*buf, sink);
+            [buf, prev_cgp](size_t /*offset*/, httplib::DataSink& sink) {
+                ScopedGauge in_flight(g_metrics.analyses_in_flight_opencv);
+                ScopedTimer timer(g_metrics.analysis_opencv);
+                g_flights.run("opencv " + prev_cgp, buf, sink,
+                              g_metrics.analyses_coalesced_opencv,
+                              [&](httplib::DataSink& tee) {
+                                  stream_analyze(*buf, tee, prev_cgp);
+                              });
                 return false;
             });
     });
@@ -4855,7 +4460,13 @@ int main(int argc, char* argv[]) {
         res.set_chunked_content_provider(
             "application/x-ndjson",
             [buf, is_memento, skip_woogles](size_t /*offset*/, httplib::DataSink& sink) {
-                stream_analyze_gemini(*buf, sink, is_memento, skip_woogles);
+                ScopedGauge in_flight(g_metrics.analyses_in_flight_gemini);
+                ScopedTimer timer(g_metrics.analysis_gemini);
+                g_flights.run(gemini_flight_mode(is_memento, skip_woogles), buf,
+                              sink, g_metrics.analyses_coalesced_gemini,
+                              [&](httplib::DataSink& tee) {
+                                  stream_analyze_gemini(*buf, tee, is_memento, skip_woogles);
+                              });
                 return false;
             });
     });
@@ -4912,9 +4523,17 @@ int main(int argc, char* argv[]) {
             "application/x-ndjson",
             [buf_ptr, use_gemini](size_t /*offset*/, httplib::DataSink& sink) {
                 if (use_gemini)
-                    stream_analyze_gemini(*buf_ptr, sink);
+                    g_flights.run(gemini_flight_mode(false, false), buf_ptr,
+                                  sink, g_metrics.analyses_coalesced_gemini,
+                                  [&](httplib::DataSink& tee) {
+                                      stream_analyze_gemini(*buf_ptr, tee);
+                                  });
                 else
-                    stream_analyze(*buf_ptr, sink);
+                    g_flights.run("opencv ", buf_ptr, sink,
+                                  g_metrics.analyses_coalesced_opencv,
+                                  [&](httplib::DataSink& tee) {
+                                      stream_analyze(*buf_ptr, tee);
+                                  });
                 return false;
             });
     });
@@ -4982,84 +4601,12 @@ int main(int argc, char* argv[]) {
             if (e.path().extension() == ".cgp") entries.push_back(e);
         std::sort(entries.begin(), entries.end());
 
-        std::string json = "[";
-        bool first = true;
-
-        for (const auto& entry : entries) {
-            std::string name = entry.path().stem().string();
-            std::string img_path = "testdata/" + name + ".png";
-            if (!fs::exists(img_path)) continue;
-
-            std::string expected_cgp;
-            {
-                std::ifstream ifs(entry.path());
-                std::getline(ifs, expected_cgp);
-            }
-
-            std::vector<uint8_t> img_data;
-            {
-                std::ifstream ifs(img_path, std::ios::binary);
-                img_data.assign(std::istreambuf_iterator<char>(ifs),
-                                std::istreambuf_iterator<char>());
-            }
-
-            DebugResult dr;
-            try {
-                dr = process_board_image_debug(img_data);
-            } catch (const std::exception& ex) {
-                // If OCR fails, report as all-wrong
-                if (!first) json += ",";
-                first = false;
-                json += "{\"name\":\"" + json_escape(name) + "\"";
-                json += ",\"total\":0,\"correct\":0,\"wrong\":0";
-                json += ",\"error\":\"" + json_escape(ex.what()) + "\"";
-                json += ",\"diffs\":[]}";
-                continue;
-            }
-
-            auto expected = parse_cgp_board(expected_cgp);
-            auto got = parse_cgp_board(dr.cgp);
-
-            int case_total = 0, case_correct = 0;
-            std::string diffs = "[";
-            bool dfirst = true;
-
-            for (int r = 0; r < 15; r++) {
-                for (int c = 0; c < 15; c++) {
-                    if (expected[r][c] != 0 || got[r][c] != 0) {
-                        case_total++;
-                        if (expected[r][c] == got[r][c]) {
-                            case_correct++;
-                        } else {
-                            if (!dfirst) diffs += ",";
-                            dfirst = false;
-                            std::string pos;
-                            pos += static_cast<char>('A' + c);
-                            pos += std::to_string(r + 1);
-                            std::string exp_s = expected[r][c]
-                                ? std::string(1, expected[r][c]) : ".";
-                            std::string got_s = got[r][c]
-                                ? std::string(1, got[r][c]) : ".";
-                            diffs += "{\"pos\":\"" + pos
-                                   + "\",\"exp\":\"" + exp_s
-                                   + "\",\"got\":\"" + got_s + "\"}";
-                        }
-                    }
-                }
-            }
-            diffs += "]";
-
-            if (!first) json += ",";
-            first = false;
-            json += "{\"name\":\"" + json_escape(name) + "\"";
-            json += ",\"total\":" + std::to_string(case_total);
-            json += ",\"correct\":" + std::to_string(case_correct);
-            json += ",\"wrong\":" + std::to_string(case_total - case_correct);
-            json += ",\"diffs\":" + diffs + "}";
-        }
-
-        json += "]";
-        res.set_content(json, "application/json");
+        res.set_chunked_content_provider(
+            "application/json",
+            [entries = std::move(entries)](size_t /*offset*/, httplib::DataSink& sink) {
+                stream_run_tests(entries, sink);
+                return false;
+            });
     });
 
     // POST /eval-save — save eval results to testdata/last_eval.json
@@ -5078,10 +4625,22 @@ int main(int argc, char* argv[]) {
         res.set_content("{\"ok\":true}", "application/json");
     });
 
-    // GET /eval-summary — compact summary from last_eval.json
-    svr.Get("/eval-summary", [](const httplib::Request&, httplib::Response& res) {
+    // GET /eval-summary — last_eval.json, also loaded by the /eval page.
+    // The ETag follows the file's size and mtime, so reloads get a 304
+    // until /eval-save writes a new run.
+    svr.Get("/eval-summary", [](const httplib::Request& req, httplib::Response& res) {
         std::string path = "testdata/last_eval.json";
-        if (!fs::exists(path)) { res.status = 404; return; }
+        std::error_code ec;
+        auto size = fs::file_size(path, ec);
+        if (ec) { res.status = 404; return; }
+        auto mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+        char etag[64];
+        std::snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+                      static_cast<unsigned long long>(size),
+                      static_cast<unsigned long long>(mtime));
+        res.set_header("ETag", etag);
+        res.set_header("Cache-Control", "no-cache");
+        if (etag_matches(req, etag)) { res.status = 304; return; }
         std::ifstream ifs(path);
         std::string body((std::istreambuf_iterator<char>(ifs)),
                           std::istreambuf_iterator<char>());
@@ -5089,155 +4648,8 @@ int main(int argc, char* argv[]) {
     });
 
     // GET /eval — full eval results page
-    svr.Get("/eval", [](const httplib::Request&, httplib::Response& res) {
-        std::string path = "testdata/last_eval.json";
-        std::string json;
-        if (fs::exists(path)) {
-            std::ifstream ifs(path);
-            json.assign(std::istreambuf_iterator<char>(ifs),
-                        std::istreambuf_iterator<char>());
-        }
-        // Escape for embedding in JS
-        std::string json_esc;
-        for (char c : json) {
-            if (c == '\\') json_esc += "\\\\";
-            else if (c == '`') json_esc += "\\`";
-            else if (c == '$') json_esc += "\\$";
-            else json_esc += c;
-        }
-        std::string html = R"html(<!DOCTYPE html>
-<html lang="en"><head><meta charset="utf-8">
-<title>CGP Bot &mdash; Eval Results</title>
-<style>
-*{margin:0;padding:0;box-sizing:border-box}
-body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',system-ui,sans-serif;
-  background:#1a1a2e;color:#e0e0e0;min-height:100vh;padding:24px}
-h1{font-size:1.2rem;margin-bottom:6px;color:#fff}
-.back{font-size:.8rem;color:#58a6ff;text-decoration:none;display:inline-block;margin-bottom:20px}
-.summary{background:#16213e;border-radius:8px;padding:14px 20px;margin-bottom:20px;border:1px solid #2a2a4a;display:flex;gap:32px;align-items:center;flex-wrap:wrap}
-.stat-val{font-size:1.4rem;font-weight:700;color:#4c4}
-.stat-lbl{font-size:.7rem;color:#888;text-transform:uppercase;letter-spacing:.05em}
-table{width:100%;border-collapse:collapse;font-size:.82rem;margin-bottom:20px}
-th,td{padding:6px 10px;border:1px solid #2a2a4a;text-align:left}
-th{background:#16213e;color:#888;font-size:.72rem;text-transform:uppercase}
-tr:hover td{background:#1a2540}
-.pass{color:#4c4}.fail{color:#f44}
-.ts{font-size:.72rem;color:#666}
-.case-boards{display:flex;gap:20px;flex-wrap:wrap;margin:16px 0 8px;align-items:flex-start}
-.board-box{text-align:center}
-.board-lbl{font-size:.75rem;color:#888;margin-bottom:6px;font-weight:600}
-.mini-board{display:grid;grid-template-columns:repeat(15,22px);grid-template-rows:repeat(15,22px);gap:1px;background:#222;border:1px solid #333;border-radius:4px}
-.mb{display:flex;align-items:center;justify-content:center;font-size:9px;font-weight:700;color:#111}
-.mb.tile{background:#f5deb3;color:#111}
-.mb.blank-tile{background:#b8d8f0;color:#224}
-.mb.tw{background:#c0392b}.mb.dw{background:#e88b8b}.mb.tl{background:#2980b9}.mb.dl{background:#7ec8e3}
-.mb.center{background:#e88b8b}.mb.normal{background:#1b7a3d}
-.mb.wrong-exp{outline:2px solid #f44;outline-offset:-1px;z-index:1}
-.mb.wrong-got{outline:2px solid #f88;outline-offset:-1px;z-index:1}
-.case-section{background:#16213e;border-radius:8px;padding:20px;margin-bottom:24px;border:1px solid #2a2a4a}
-.case-title{font-size:1rem;font-weight:600;margin-bottom:6px}
-.diff-text{font-size:.75rem;color:#f88;font-family:'SF Mono','Fira Code',monospace;margin-bottom:12px;line-height:1.6}
-.case-img{max-height:350px;border-radius:6px;border:1px solid #444}
-.debug-img{max-height:350px;border-radius:6px;border:1px solid #4c4}
-</style></head><body>
-<a href="/" class="back">&larr; Back to test bench</a>
-<h1>Gemini Eval Results</h1>
-<div id="root"><p style="color:#666">No eval data found.</p></div>
-<script>
-const PREMIUM=[
-  [4,0,0,1,0,0,0,4,0,0,0,1,0,0,4],[0,3,0,0,0,2,0,0,0,2,0,0,0,3,0],
-  [0,0,3,0,0,0,1,0,1,0,0,0,3,0,0],[1,0,0,3,0,0,0,1,0,0,0,3,0,0,1],
-  [0,0,0,0,3,0,0,0,0,0,3,0,0,0,0],[0,2,0,0,0,2,0,0,0,2,0,0,0,2,0],
-  [0,0,1,0,0,0,1,0,1,0,0,0,1,0,0],[4,0,0,1,0,0,0,5,0,0,0,1,0,0,4],
-  [0,0,1,0,0,0,1,0,1,0,0,0,1,0,0],[0,2,0,0,0,2,0,0,0,2,0,0,0,2,0],
-  [0,0,0,0,3,0,0,0,0,0,3,0,0,0,0],[1,0,0,3,0,0,0,1,0,0,0,3,0,0,1],
-  [0,0,3,0,0,0,1,0,1,0,0,0,3,0,0],[0,3,0,0,0,2,0,0,0,2,0,0,0,3,0],
-  [4,0,0,1,0,0,0,4,0,0,0,1,0,0,4]];
-const PCLS=['normal','dl','tl','dw','tw','center'];
-function parseCGPBoard(cgp){
-  const b=Array.from({length:15},()=>Array(15).fill(''));
-  const rows=(cgp.split(' ')[0]).split('/');
-  for(let r=0;r<Math.min(rows.length,15);r++){
-    let c=0,i=0;
-    while(i<rows[r].length&&c<15){
-      const ch=rows[r][i];
-      if(ch>='0'&&ch<='9'){let n=0;while(i<rows[r].length&&rows[r][i]>='0'&&rows[r][i]<='9')n=n*10+parseInt(rows[r][i++]);c+=n;}
-      else{b[r][c++]=ch;i++;}
-    }
-  }
-  return b;
-}
-function renderMiniBoard(board,wrongSet,cls){
-  let h=`<div class="mini-board">`;
-  for(let r=0;r<15;r++)for(let c=0;c<15;c++){
-    const ch=board[r][c];
-    const key=String.fromCharCode(65+c)+(r+1);
-    const wrong=wrongSet&&wrongSet.has(key);
-    if(!ch){const p=PREMIUM[r][c];h+=`<div class="mb ${PCLS[p]}${wrong?' '+cls:''}"></div>`;}
-    else{const bl=ch===ch.toLowerCase();h+=`<div class="mb ${bl?'blank-tile':'tile'}${wrong?' '+cls:''}">${ch.toUpperCase()}</div>`;}
-  }
-  h+=`</div>`;
-  return h;
-}
-function relTime(ts){
-  const d=Math.floor(Date.now()/1000-ts);
-  if(d<60)return 'just now';if(d<3600)return Math.round(d/60)+'m ago';
-  if(d<86400)return Math.round(d/3600)+'h ago';return Math.round(d/86400)+'d ago';
-}
-const DATA=)html" + (json.empty() ? "null" : json_esc) + R"html(;
-if(DATA){
-  const pct=(DATA.correct/DATA.total_cells*100).toFixed(1);
-  const wrong=DATA.total_cells-DATA.correct;
-  const ts=new Date(DATA.timestamp*1000).toLocaleString();
-  let h=`<div class="summary">
-    <div><div class="stat-val">${pct}%</div><div class="stat-lbl">Board accuracy</div></div>
-    <div><div class="stat-val" style="color:${wrong?'#f88':'#4c4'}">${wrong}</div><div class="stat-lbl">Wrong cells</div></div>
-    <div><div class="stat-val">${DATA.scores_correct}/${DATA.scores_total}</div><div class="stat-lbl">Scores correct</div></div>
-    <div style="margin-left:auto"><div class="ts">${ts}</div><div class="ts">${relTime(DATA.timestamp)}</div></div>
-  </div>`;
-  // Summary table
-  h+=`<table><tr><th>Case</th><th>Cells</th><th>Correct</th><th>Wrong</th><th>Board%</th><th style="color:#68a">Occ%</th><th style="color:#68a">Raw%</th><th style="color:#68a">Align%</th><th style="color:#68a">Trans%</th><th style="color:#68a">Retry%</th><th style="color:#68a">WC%</th><th>Exp scores</th><th>Got scores</th><th>&#9654;</th></tr>`;
-  for(const c of DATA.cases||[]){
-    const cp=c.cells?((c.correct/c.cells)*100).toFixed(1)+'%':'—';
-    const scOk=c.exp_scores&&c.got_scores?(c.exp_scores===c.got_scores?'<span class="pass">&#10003;</span>':'<span class="fail">&#10007;</span>'):'—';
-    const expSc=c.exp_scores||'—';const gotSc=c.got_scores||'—';
-    const scMismatch=c.exp_scores&&c.got_scores&&c.exp_scores!==c.got_scores;
-    const sa=c.stage_accs||{};
-    function s(k){return sa[k]!=null?sa[k]+'%':'—';}
-    const stageCols=`<td>${s('occ')}</td><td>${s('raw')}</td><td>${s('realigned')}</td><td>${s('trans')}</td><td>${s('retry')}</td><td>${s('wc')}</td>`;
-    h+=`<tr><td>${c.name}</td><td>${c.cells||'—'}</td><td>${c.correct||'—'}</td><td class="${c.wrong>0?'fail':'pass'}">${c.wrong||'0'}</td><td>${cp}</td>${stageCols}<td style="font-family:monospace;${scMismatch?'color:#f88':''}">${expSc}</td><td style="font-family:monospace;${scMismatch?'color:#f88':''}">${gotSc}</td><td>${scOk}</td></tr>`;
-    if(c.diffs&&c.diffs.length)h+=`<tr><td colspan="14" style="color:#f88;font-family:'SF Mono',monospace;font-size:.7rem;padding:2px 8px">&nbsp;&nbsp;${c.diffs.join('&nbsp;&nbsp;')}</td></tr>`;
-  }
-  h+=`<tr style="font-weight:bold;border-top:2px solid #444">
-    <td>TOTAL</td><td>${DATA.total_cells}</td><td>${DATA.correct}</td>
-    <td class="${wrong?'fail':'pass'}">${wrong}</td><td>${pct}%</td>
-    <td colspan="6"></td>
-    <td colspan="3" style="color:#ccc">${DATA.scores_correct}/${DATA.scores_total} scores &#10003;</td></tr></table>`;
-  // Failing case boards
-  for(const c of DATA.cases||[]){
-    if(!c.wrong||!c.exp_cgp||!c.got_cgp)continue;
-    const expBoard=parseCGPBoard(c.exp_cgp);
-    const gotBoard=parseCGPBoard(c.got_cgp);
-    // build sets of wrong positions for each board
-    const expWrong=new Set(),gotWrong=new Set();
-    for(const d of c.diffs||[]){
-      const pos=d.split(':')[0];expWrong.add(pos);gotWrong.add(pos);
-    }
-    h+=`<div class="case-section">
-      <div class="case-title">${c.name} &mdash; ${c.wrong} wrong cell${c.wrong>1?'s':''} (${c.cells} total, ${(c.correct/c.cells*100).toFixed(1)}%)</div>
-      <div class="diff-text">${(c.diffs||[]).join('&nbsp;&nbsp;')}</div>
-      <div class="case-boards">
-        <div class="board-box"><div class="board-lbl">Screenshot</div><img src="/testdata-image/${c.name}" class="case-img"></div>
-        <div class="board-box"><div class="board-lbl">Board Detection</div><img src="/testdata-debug/${c.name}" class="debug-img" loading="lazy"></div>
-        <div class="board-box"><div class="board-lbl">Expected</div>${renderMiniBoard(expBoard,expWrong,'wrong-exp')}</div>
-        <div class="board-box"><div class="board-lbl">Got</div>${renderMiniBoard(gotBoard,gotWrong,'wrong-got')}</div>
-      </div>
-    </div>`;
-  }
-  document.getElementById('root').innerHTML=h;
-}
-</script></body></html>)html";
-        res.set_content(html, "text/html");
+    svr.Get("/eval", [](const httplib::Request& req, httplib::Response& res) {
+        serve_web_asset(req, res, "/eval");
     });
 
     // GET /testdata-list -> [{name, has_expected, has_image}]
@@ -5309,6 +4721,7 @@ if(DATA){
                                   std::istreambuf_iterator<char>());
         // Run board detection with debug output
         DebugResult dr = process_board_image_debug(buf);
+        record_pipeline_stages(dr);
         if (dr.debug_png.empty()) { res.status = 500; return; }
         res.set_content(std::string(dr.debug_png.begin(), dr.debug_png.end()), "image/png");
     });
@@ -5370,276 +4783,20 @@ if(DATA){
     });
 
     // GET /label -> labeling UI for unlabeled screenshots
-    svr.Get("/label", [](const httplib::Request&, httplib::Response& res) {
-        static const char* LABEL_HTML = R"html(<!DOCTYPE html>
-<html>
-<head>
-<meta charset="utf-8">
-<title>CGP Labeler</title>
-<style>
-body{margin:0;background:#1a1a2e;color:#ccc;font-family:'SF Mono',monospace;font-size:13px}
-#top{display:flex;align-items:center;gap:12px;padding:10px 16px;background:#111;border-bottom:1px solid #333}
-#top h2{margin:0;font-size:1rem;color:#8cf}
-#progress{color:#888;font-size:.85rem}
-#main{display:flex;gap:0;height:calc(100vh - 46px)}
-#left{flex:0 0 420px;padding:12px;overflow-y:auto;border-right:1px solid #333}
-#right{flex:1;padding:12px;display:flex;flex-direction:column;gap:8px;overflow-y:auto}
-#screenshot-wrap{position:relative;display:inline-block;line-height:0}
-#screenshot{max-width:100%;max-height:300px;object-fit:contain;border:1px solid #444;border-radius:4px}
-#overlay{position:absolute;top:0;left:0;pointer-events:none;border-radius:4px}
-#case-name{color:#8cf;font-size:.9rem;margin-bottom:6px}
-#cgp-input{width:100%;box-sizing:border-box;background:#0d1117;border:1px solid #444;color:#eee;padding:8px;font-family:'SF Mono',monospace;font-size:.8rem;border-radius:4px;resize:vertical;min-height:60px}
-#cgp-input.changed{border-color:#f80}
-.btn{padding:7px 18px;border:none;border-radius:4px;cursor:pointer;font-family:inherit;font-size:.85rem;font-weight:600}
-#btn-accept{background:#2a6;color:#fff}
-#btn-skip{background:#444;color:#ccc}
-#btn-accept:hover{background:#3b7}
-#btn-skip:hover{background:#555}
-#board-wrap{background:#0d1117;border:1px solid #333;border-radius:4px;padding:8px;overflow:auto}
-table.board{border-collapse:collapse}
-table.board td{width:28px;height:28px;text-align:center;vertical-align:middle;font-size:11px;font-weight:700;border:1px solid #2a2a3a;position:relative;box-sizing:border-box}
-.TW{background:#b22}
-.DW{background:#d88}
-.TL{background:#26a}
-.DL{background:#8af}
-.star{background:#d88}
-.tile{background:#e8d5a0;color:#222;border-radius:2px;font-size:12px}
-.blank-tile{background:#b8d8f0;color:#224;border-radius:2px;font-size:12px}
-#woogles-info{font-size:.8rem;color:#8f8;min-height:18px}
-#status-line{font-size:.8rem;color:#888;min-height:18px}
-#done-msg{display:none;padding:40px;text-align:center;color:#8f8;font-size:1.2rem}
-</style>
-</head>
-<body>
-<div id="top">
-  <h2>CGP Labeler</h2>
-  <span id="progress"></span>
-  <span id="status-line"></span>
-</div>
-<div id="done-msg">All cases labeled!</div>
-<div id="main">
-  <div id="left">
-    <div id="case-name"></div>
-    <div id="screenshot-wrap">
-      <img id="screenshot" src="" alt="screenshot">
-      <canvas id="overlay"></canvas>
-    </div>
-  </div>
-  <div id="right">
-    <div id="board-wrap"><table class="board" id="board-table"></table></div>
-    <div id="woogles-info"></div>
-    <textarea id="cgp-input" rows="3" spellcheck="false"></textarea>
-    <div style="display:flex;gap:8px">
-      <button class="btn" id="btn-accept">Accept ✓</button>
-      <button class="btn" id="btn-skip">Skip →</button>
-    </div>
-  </div>
-</div>
-<script>
-const BOARD_BONUSES={
-  '0,0':'TW','0,7':'TW','0,14':'TW','7,0':'TW','7,14':'TW','14,0':'TW','14,7':'TW','14,14':'TW',
-  '1,1':'DW','2,2':'DW','3,3':'DW','4,4':'DW','1,13':'DW','2,12':'DW','3,11':'DW','4,10':'DW',
-  '10,4':'DW','11,3':'DW','12,2':'DW','13,1':'DW','10,10':'DW','11,11':'DW','12,12':'DW','13,13':'DW',
-  '7,7':'star',
-  '5,1':'TL','5,5':'TL','5,9':'TL','5,13':'TL','9,1':'TL','9,5':'TL','9,9':'TL','9,13':'TL',
-  '1,5':'TL','1,9':'TL','13,5':'TL','13,9':'TL',
-  '0,3':'DL','0,11':'DL','2,6':'DL','2,8':'DL','3,0':'DL','3,7':'DL','3,14':'DL',
-  '6,2':'DL','6,6':'DL','6,8':'DL','6,12':'DL','7,3':'DL','7,11':'DL',
-  '8,2':'DL','8,6':'DL','8,8':'DL','8,12':'DL','11,0':'DL','11,7':'DL','11,14':'DL',
-  '12,6':'DL','12,8':'DL','14,3':'DL','14,11':'DL',
-};
-function renderBoard(cgp){
-  const tbl=document.getElementById('board-table');
-  tbl.innerHTML='';
-  const boardStr=cgp.split(' ')[0];
-  const rows=boardStr.split('/');
-  const board=Array.from({length:15},()=>Array(15).fill(null));
-  for(let r=0;r<15&&r<rows.length;r++){
-    let c=0,i=0;
-    while(i<rows[r].length&&c<15){
-      const ch=rows[r][i];
-      if(ch>='0'&&ch<='9'){
-        let n=0;
-        while(i<rows[r].length&&rows[r][i]>='0'&&rows[r][i]<='9')n=n*10+(rows[r][i++].charCodeAt(0)-48);
-        c+=n;
-      }else{board[r][c++]=ch;i++;}
-    }
-  }
-  for(let r=0;r<15;r++){
-    const tr=document.createElement('tr');
-    for(let c=0;c<15;c++){
-      const td=document.createElement('td');
-      const key=r+','+c;
-      const ch=board[r][c];
-      if(ch){
-        const blank=ch===ch.toLowerCase()&&ch!==ch.toUpperCase()||ch===ch.toLowerCase()&&ch>='a'&&ch<='z';
-        td.className=blank?'blank-tile':'tile';
-        td.textContent=ch.toUpperCase();
-      }else{
-        const bonus=BOARD_BONUSES[key]||'';
-        if(bonus)td.className=bonus;
-        td.textContent=bonus==='star'?'★':bonus==='TW'?'TW':bonus==='DW'?'DW':bonus==='TL'?'TL':bonus==='DL'?'DL':'';
-        if(bonus)td.style.fontSize='8px';
-      }
-      tr.appendChild(td);
-    }
-    tbl.appendChild(tr);
-  }
-}
-
-let cases=[], idx=0, pendingRect=null;
-
-function drawOverlay(rect){
-  const img=document.getElementById('screenshot');
-  const canvas=document.getElementById('overlay');
-  if(!img.naturalWidth||!rect)return;
-  const scaleX=img.clientWidth/img.naturalWidth;
-  const scaleY=img.clientHeight/img.naturalHeight;
-  canvas.width=img.clientWidth;
-  canvas.height=img.clientHeight;
-  canvas.style.width=img.clientWidth+'px';
-  canvas.style.height=img.clientHeight+'px';
-  const ctx=canvas.getContext('2d');
-  ctx.clearRect(0,0,canvas.width,canvas.height);
-  ctx.strokeStyle='#0f0';
-  ctx.lineWidth=2;
-  ctx.strokeRect(rect.x*scaleX, rect.y*scaleY, rect.w*scaleX, rect.h*scaleY);
-}
-
-async function loadCases(){
-  const r=await fetch('/unlabeled-list');
-  cases=await r.json();
-  if(!cases.length){
-    document.getElementById('main').style.display='none';
-    document.getElementById('done-msg').style.display='block';
-    return;
-  }
-  showCase(0);
-}
-
-function updateProgress(){
-  document.getElementById('progress').textContent=`${idx+1} / ${cases.length}`;
-}
-
-async function showCase(i){
-  if(i>=cases.length){
-    document.getElementById('main').style.display='none';
-    document.getElementById('done-msg').style.display='block';
-    return;
-  }
-  idx=i;
-  updateProgress();
-  const name=cases[i];
-  document.getElementById('case-name').textContent=name;
-  pendingRect=null;
-  const imgEl=document.getElementById('screenshot');
-  imgEl.onload=()=>{if(pendingRect)drawOverlay(pendingRect);};
-  imgEl.src='/testdata-image/'+encodeURIComponent(name);
-  const cvs=document.getElementById('overlay');
-  cvs.width=0; cvs.height=0;
-  document.getElementById('cgp-input').value='';
-  document.getElementById('cgp-input').className='';
-  document.getElementById('woogles-info').textContent='';
-  document.getElementById('board-table').innerHTML='';
-
-  // Stream analysis
-  const setStatus=s=>document.getElementById('status-line').textContent=s;
-  setStatus('Analyzing...');
-  try{
-    const ir=await fetch('/testdata-image/'+encodeURIComponent(name));
-    const blob=await ir.blob();
-    const form=new FormData();
-    const isMem=name.includes('_memento');
-    form.append('image',new File([blob],name+(isMem?'_memento':'')+'.png',{type:'image/png'}));
-    const resp=await fetch('/analyze-gemini',{method:'POST',body:form});
-    const reader=resp.body.getReader(),dec=new TextDecoder();
-    let buf='';
-    while(true){
-      const {done,value}=await reader.read();
-      if(done)break;
-      buf+=dec.decode(value,{stream:true});
-      let nl;
-      while((nl=buf.indexOf('\n'))>=0){
-        const line=buf.slice(0,nl).trim();buf=buf.slice(nl+1);
-        if(!line)continue;
-        try{
-          const d=JSON.parse(line);
-          if(d.status)setStatus(d.status);
-          if(d.board_rect){pendingRect=d.board_rect;drawOverlay(pendingRect);}
-          if(d.cgp&&d.cells){
-            document.getElementById('cgp-input').value=d.cgp;
-            renderBoard(d.cgp);
-          }
-          if('woogles' in d){
-            const w=d.woogles;
-            if(w&&w.game_id){
-              const url=`https://woogles.io/game/${w.game_id}?turn=${w.turn}`;
-              document.getElementById('woogles-info').innerHTML=
-                `<a href="${url}" target="_blank" style="color:#8cf">${w.game_id} turn ${w.turn}</a>`
-                +` (sim ${(w.similarity*100).toFixed(0)}%)`
-                +(w.golden_cgp?` — <span style="color:#8f8">golden CGP available</span>`:'');
-              // Auto-fill golden CGP if available
-              if(w.golden_cgp){
-                document.getElementById('cgp-input').value=w.golden_cgp;
-                renderBoard(w.golden_cgp);
-              }
-            }else{
-              document.getElementById('woogles-info').textContent='No Woogles match.';
-            }
-          }
-        }catch(e){}
-      }
-    }
-    setStatus('Done.');
-  }catch(e){setStatus('Error: '+e);}
-}
-
-document.getElementById('cgp-input').addEventListener('input',function(){
-  this.className='changed';
-  try{renderBoard(this.value);}catch(e){}
-});
-
-document.getElementById('btn-accept').onclick=async function(){
-  const name=cases[idx];
-  const cgp=document.getElementById('cgp-input').value.trim();
-  if(!cgp){alert('No CGP to save.');return;}
-  const r=await fetch('/save-label',{method:'POST',
-    headers:{'Content-Type':'application/json'},
-    body:JSON.stringify({name,cgp})});
-  const j=await r.json();
-  if(j.ok){
-    document.getElementById('status-line').textContent=`Saved ${name}.cgp`;
-    // Remove from list and advance
-    cases.splice(idx,1);
-    if(cases.length===0){
-      document.getElementById('main').style.display='none';
-      document.getElementById('done-msg').style.display='block';
-    }else{
-      showCase(Math.min(idx,cases.length-1));
-    }
-  }else{alert('Save failed.');}
-};
-
-document.getElementById('btn-skip').onclick=function(){
-  showCase((idx+1)%cases.length);
-};
-
-document.addEventListener('keydown',function(e){
-  if(e.key==='Enter'&&(e.metaKey||e.ctrlKey))document.getElementById('btn-accept').click();
-  if(e.key==='ArrowRight'&&(e.metaKey||e.ctrlKey))document.getElementById('btn-skip').click();
-});
-
-loadCases();
-</script>
-</body>
-</html>)html";
-        res.set_content(LABEL_HTML, "text/html");
+    svr.Get("/label", [](const httplib::Request& req, httplib::Response& res) {
+        serve_web_asset(req, res, "/label");
     });
 
     const char* port_env = std::getenv("PORT");
     int port = port_env ? std::atoi(port_env) : 8080;
+    if (const char* batch_env = std::getenv("GEMINI_BATCH_MS"))
+        g_word_crop_batcher.set_window_ms(std::atoi(batch_env));
 
     std::cout << "CGP test bench -> http://localhost:" << port << "\n";
+    std::cout << "Pixel kernels: " << cpu_kernels().isa << "\n";
+    if (g_word_crop_batcher.window_ms() > 0)
+        std::cout << "Word-crop batching: " << g_word_crop_batcher.window_ms()
+                  << " ms window\n";
 
     if (!svr.listen("127.0.0.1", port)) {
         std::cerr << "Failed to bind to port " << port << "\n";
@@ -0,0 +1,33 @@
+#pragma once
+// Static pages of the test bench, embedded at build time.
+//
+// cmake/embed_web_assets.cmake turns every web/*.html into byte arrays in a
+// generated web_assets.cpp: the page itself, a gzip copy and, when the
+// brotli tool was found at configure time, a brotli copy.  The ETag is
+// derived from the page contents, so it changes exactly when the page does.
+// web/index.html is served at "/", web/<name>.html at "/<name>".
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+struct WebAsset {
+    const char* route;          // "/", "/eval", "/label"
+    const char* content_type;
+    const char* etag;           // quoted strong validator
+    const unsigned char* raw;
+    size_t raw_size;
+    const unsigned char* gzip;
+    size_t gzip_size;
+    const unsigned char* br;    // nullptr if brotli was unavailable
+    size_t br_size;
+};
+
+extern const WebAsset WEB_ASSETS[];
+extern const int WEB_ASSET_COUNT;
+
+inline const WebAsset* find_web_asset(const std::string& route) {
+    for (int i = 0; i < WEB_ASSET_COUNT; i++)
+        if (route == WEB_ASSETS[i].route) return &WEB_ASSETS[i];
+    return nullptr;
+}
@@ -1,5 +1,6 @@
 #!/usr/bin/env bash
 # Run all testdata images through the Gemini OCR server and report accuracy.
+# For throughput and latency percentiles use the load_test tool instead.
 # Usage: ./test_server.sh [host]
 # Default host: http://localhost:8080
 
@@ -0,0 +1,83 @@
+// libcgpvision C ABI with no tile model: calls that need the CNN must
+// return CGPV_E_INTERNAL instead of crashing, and the others must fall back
+// to template matching.
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../src/cgpvision.h"
+
+// --- Tests ---
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+// Registered at static-init time but run from main(), after CGP_TILE_MODEL
+// is set and before the library first looks for the model.
+static std::vector<void (*)()>& registered() {
+    static std::vector<void (*)()> tests;
+    return tests;
+}
+
+#define TEST(name) \
+    static void test_##name(); \
+    static struct Register_##name { \
+        Register_##name() { registered().push_back(test_##name); } \
+    } register_##name; \
+    static void test_##name()
+
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        std::cerr << "  FAIL: " << msg << "\n"; \
+        return; \
+    } \
+} while(0)
+
+#define PASS(name) do { \
+    tests_passed++; \
+    std::cout << "  PASS: " << name << "\n"; \
+} while(0)
+
+// A 40x40 BGR crop with vertical stripes: textured enough that the blank
+// check does not short-circuit classification.
+static std::vector<uint8_t> striped_tile(cgpv_image& img) {
+    const int size = 40;
+    std::vector<uint8_t> px(size * size * 3);
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            for (int ch = 0; ch < 3; ch++)
+                px[(y * size + x) * 3 + ch] = (x / 4) % 2 ? 230 : 30;
+    img = {px.data(), size, size, size * 3, 3};
+    return px;
+}
+
+TEST(cnn_without_model) {
+    tests_run++;
+    cgpv_image img;
+    auto px = striped_tile(img);
+    cgpv_cell cell = {};
+    float scores[26];
+    int rc = cgpv_classify_tiles(&img, 1, CGPV_METHOD_CNN, scores, &cell);
+    ASSERT(rc == CGPV_E_INTERNAL, "expected CGPV_E_INTERNAL, got " << rc);
+    PASS("cnn_without_model");
+}
+
+TEST(auto_falls_back_to_templates) {
+    tests_run++;
+    cgpv_image img;
+    auto px = striped_tile(img);
+    cgpv_cell cell = {};
+    int rc = cgpv_classify_tiles(&img, 1, CGPV_METHOD_AUTO, nullptr, &cell);
+    ASSERT(rc == CGPV_OK, "expected CGPV_OK, got " << rc);
+    PASS("auto_falls_back_to_templates");
+}
+
+int main() {
+    // Only candidate for the tile model; it does not exist.
+    setenv("CGP_TILE_MODEL", "/nonexistent/tile_model.onnx", 1);
+    std::cout << "Running cgpvision no-model tests...\n";
+    for (auto test : registered()) test();
+    std::cout << "\n" << tests_passed << "/" << tests_run << " tests passed.\n";
+    return tests_passed == tests_run ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// process_board_image_with_prior on real screenshots: whatever the prior
+// says, the resulting CGP must equal a full analysis of the same image.
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/board.h"
+
+// Source directory set by CMake
+#ifndef SOURCE_DIR
+#define SOURCE_DIR "."
+#endif
+
+static std::string read_file(const std::string& path) {
+    // Try relative path first, then prepend SOURCE_DIR
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        std::string full = std::string(SOURCE_DIR) + "/" + path;
+        f.open(full, std::ios::binary);
+    }
+    if (!f) return {};
+    return std::string(std::istreambuf_iterator<char>(f), {});
+}
+
+static std::vector<uint8_t> read_image(const std::string& path) {
+    std::string s = read_file(path);
+    return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+// Replaces the first board occurrence of each `from[i]` with `to[i]`.
+static std::string substitute_letters(std::string cgp, const std::string& from,
+                                      const std::string& to) {
+    size_t board_end = cgp.find(' ');
+    for (size_t i = 0; i < from.size(); i++) {
+        size_t at = cgp.find(from[i]);
+        if (at < board_end) cgp[at] = to[i];
+    }
+    return cgp;
+}
+
+// Two turns of the same game, same theme.
+static const char* EARLIER = "testdata/AmSAGtDHDU_t04_light_desktop";
+static const char* LATER = "testdata/AmSAGtDHDU_t09_light_desktop";
+
+// --- Tests ---
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+// Registered at static-init time but run from main(): the pipeline's own
+// statics (model pools, templates) live in other translation units.
+static std::vector<void (*)()>& registered() {
+    static std::vector<void (*)()> tests;
+    return tests;
+}
+
+#define TEST(name) \
+    static void test_##name(); \
+    static struct Register_##name { \
+        Register_##name() { registered().push_back(test_##name); } \
+    } register_##name; \
+    static void test_##name()
+
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        std::cerr << "  FAIL: " << msg << "\n"; \
+        return; \
+    } \
+} while(0)
+
+#define PASS(name) do { \
+    tests_passed++; \
+    std::cout << "  PASS: " << name << "\n"; \
+} while(0)
+
+// The earlier turn's ground truth is a correct prior for the later image.
+TEST(correct_prior) {
+    tests_run++;
+    auto img = read_image(std::string(LATER) + ".png");
+    std::string prior = read_file(std::string(EARLIER) + ".cgp");
+    ASSERT(!img.empty() && !prior.empty(), "testdata missing");
+
+    DebugResult full = process_board_image_debug(img);
+    DebugResult with = process_board_image_with_prior(img, prior);
+    ASSERT(with.cgp == full.cgp,
+           "prior " << with.cgp << " != full " << full.cgp);
+    ASSERT(with.log.find("Prior rejected") == std::string::npos,
+           "correct prior was rejected");
+    PASS("correct_prior");
+}
+
+// A few prior tiles replaced by look-alikes: each must fail verification
+// and be reclassified from the image, not pinned to the wrong letter.
+TEST(wrong_letters_in_prior) {
+    tests_run++;
+    auto img = read_image(std::string(LATER) + ".png");
+    std::string truth = read_file(std::string(EARLIER) + ".cgp");
+    ASSERT(!img.empty() && !truth.empty(), "testdata missing");
+    std::string prior = substitute_letters(truth, "EON", "FQM");
+    ASSERT(prior != truth, "substitution changed nothing");
+
+    DebugResult full = process_board_image_debug(img);
+    DebugResult with = process_board_image_with_prior(img, prior);
+    for (char want : std::string("FQM")) {
+        std::string line = std::string("] expected ") + want + " ";
+        ASSERT(with.log.find(line) != std::string::npos,
+               "wrong prior letter " << want << " was verified");
+    }
+    // Three mismatches stay under PRIOR_MAX_MISMATCH: the rest of the prior
+    // must still be used, not thrown away for a full analysis.
+    ASSERT(with.log.find("Prior rejected") == std::string::npos,
+           "prior with three wrong letters was rejected");
+    ASSERT(with.cgp == full.cgp,
+           "prior " << with.cgp << " != full " << full.cgp);
+    PASS("wrong_letters_in_prior");
+}
+
+// A prior from another position entirely: rejected, full analysis runs.
+TEST(unrelated_prior) {
+    tests_run++;
+    auto img = read_image(std::string(EARLIER) + ".png");
+    std::string prior = read_file(std::string(LATER) + ".cgp");
+    ASSERT(!img.empty() && !prior.empty(), "testdata missing");
+    // Every letter shifted by one: nothing should verify.
+    std::string shifted = prior;
+    for (size_t i = 0; i < shifted.find(' '); i++) {
+        char& ch = shifted[i];
+        if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>('A' + (ch - 'A' + 1) % 26);
+    }
+
+    DebugResult full = process_board_image_debug(img);
+    DebugResult with = process_board_image_with_prior(img, shifted);
+    ASSERT(with.log.find("Prior rejected") != std::string::npos,
+           "unrelated prior was accepted");
+    ASSERT(with.cgp == full.cgp,
+           "prior " << with.cgp << " != full " << full.cgp);
+    PASS("unrelated_prior");
+}
+
+int main() {
+    std::cout << "Running prior-position tests...\n";
+    for (auto test : registered()) test();
+    std::cout << "\n" << tests_passed << "/" << tests_run << " tests passed.\n";
+    return tests_passed == tests_run ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+// BoardSequence on real screenshots: a frame reclassified incrementally
+// after an earlier one must read the same as the frame analysed alone.
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "../src/sequence.h"
+
+// Source directory set by CMake
+#ifndef SOURCE_DIR
+#define SOURCE_DIR "."
+#endif
+
+static cv::Mat read_frame(const std::string& path) {
+    // Try relative path first, then prepend SOURCE_DIR
+    cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
+    if (img.empty()) img = cv::imread(std::string(SOURCE_DIR) + "/" + path, cv::IMREAD_COLOR);
+    return img;
+}
+
+static std::string board_letters(const CellResult cells[15][15]) {
+    std::string out;
+    for (int r = 0; r < 15; r++)
+        for (int c = 0; c < 15; c++)
+            out += cells[r][c].letter ? cells[r][c].letter : '.';
+    return out;
+}
+
+// Consecutive turns of one game (PEON played between them), same theme and
+// screen size, so the second frame takes the incremental path.
+static const char* EARLIER = "testdata/We9r93HF6q_t04_memento.png";
+static const char* LATER = "testdata/We9r93HF6q_t05_memento.png";
+
+// --- Tests ---
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+// Registered at static-init time but run from main(): the pipeline's own
+// statics (model pools, templates) live in other translation units.
+static std::vector<void (*)()>& registered() {
+    static std::vector<void (*)()> tests;
+    return tests;
+}
+
+#define TEST(name) \
+    static void test_##name(); \
+    static struct Register_##name { \
+        Register_##name() { registered().push_back(test_##name); } \
+    } register_##name; \
+    static void test_##name()
+
+#define ASSERT(cond, msg) do { \
+    if (!(cond)) { \
+        std::cerr << "  FAIL: " << msg << "\n"; \
+        return; \
+    } \
+} while(0)
+
+#define PASS(name) do { \
+    tests_passed++; \
+    std::cout << "  PASS: " << name << "\n"; \
+} while(0)
+
+// The later frame pushed after the earlier one (only changed cells
+// extracted and reclassified) against a fresh sequence that sees it first.
+TEST(incremental_matches_full) {
+    tests_run++;
+    cv::Mat a = read_frame(EARLIER), b = read_frame(LATER);
+    ASSERT(!a.empty() && !b.empty(), "testdata missing");
+
+    BoardSequence seq;
+    SequenceFrame f1 = seq.push(a);
+    ASSERT(f1.board_found, "no board in " << EARLIER);
+    SequenceFrame f2 = seq.push(b);
+    ASSERT(f2.board_found, "lost the board on the second frame");
+    ASSERT(!f2.redetected && f2.cells_changed > 0 && f2.cells_changed < 225,
+           "second frame not incremental: redetected=" << f2.redetected
+           << ", " << f2.cells_changed << " cells changed");
+
+    BoardSequence fresh;
+    SequenceFrame ref = fresh.push(b);
+    ASSERT(ref.board_found, "no board in " << LATER);
+    ASSERT(board_letters(seq.cells()) == board_letters(fresh.cells()),
+           "board differs:\n  seq   " << board_letters(seq.cells())
+           << "\n  fresh " << board_letters(fresh.cells()));
+    ASSERT(f2.cgp == ref.cgp, "cgp " << f2.cgp << " != " << ref.cgp);
+    ASSERT(f2.position_changed, "position change not reported");
+    PASS("incremental_matches_full");
+}
+
+// A repeated frame changes nothing and reclassifies nothing.
+TEST(repeated_frame) {
+    tests_run++;
+    cv::Mat a = read_frame(EARLIER);
+    ASSERT(!a.empty(), "testdata missing");
+
+    BoardSequence seq;
+    SequenceFrame f1 = seq.push(a);
+    ASSERT(f1.board_found, "no board in " << EARLIER);
+    SequenceFrame f2 = seq.push(a);
+    ASSERT(!f2.redetected, "redetected on an identical frame");
+    ASSERT(f2.cells_changed == 0, f2.cells_changed << " cells changed");
+    ASSERT(!f2.rack_changed, "rack re-read on an identical frame");
+    ASSERT(!f2.position_changed && f2.cgp == f1.cgp, "position changed");
+    PASS("repeated_frame");
+}
+
+int main() {
+    std::cout << "Running frame-sequence tests...\n";
+    for (auto test : registered()) test();
+    std::cout << "\n" << tests_passed << "/" << tests_run << " tests passed.\n";
+    return tests_passed == tests_run ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Train the board-corner heatmap CNN (optional stage-1 seed).
+
+The model sees the whole screenshot at a fixed size and predicts one heatmap
+per board corner; board.cpp corner_net_seed() turns confident, square peaks
+into the starting rect for the precision and gridline refinement and skips
+the coarse/fine grid search.  Preprocessing must match corner_net_seed():
+  1. Resize the whole image to 256x256 (INTER_AREA, aspect not preserved)
+  2. BGR, float [0, 1], NCHW
+Output: 4 x 64 x 64 sigmoid heatmaps, corners in order TL, TR, BR, BL.
+
+Labels are the board rects the grid search finds (cgpvision.detect_board),
+cached in --labels so the library is only needed once.  Create the cache
+before installing a corner model, so labels come from the full search.
+
+Usage:
+  python train_corner_model.py --data testdata --epochs 80
+  python train_corner_model.py --data testdata more_screens --labels corner_rects.json
+"""
+import argparse
+import json
+import random
+from pathlib import Path
+
+import cv2
+import numpy as np
+import torch
+import torch.nn as nn
+import torch.optim as optim
+from torch.utils.data import Dataset, DataLoader
+
+# Must match board.cpp CORNER_INPUT_SIZE / CORNER_GRID
+INPUT_SIZE = 256
+GRID = 64
+SIGMA = 1.5  # heatmap gaussian, in grid cells
+
+try:
+    import cgpvision
+except (ImportError, OSError):  # library not built
+    cgpvision = None
+
+
+def load_labels(dirs, path):
+    """{image path: [x, y, w, h]}, detecting boards not yet in the cache."""
+    labels = json.loads(Path(path).read_text()) if Path(path).exists() else {}
+    images = [p for d in dirs for p in sorted(Path(d).iterdir())
+              if p.suffix.lower() in ('.png', '.jpg', '.jpeg')]
+    missing = [p for p in images if str(p) not in labels]
+    if missing and cgpvision is None:
+        raise SystemExit(f"{len(missing)} images without labels and libcgpvision "
+                         "is not built (see cgpvision.py)")
+    for p in missing:
+        img = cv2.imread(str(p), cv2.IMREAD_COLOR)
+        try:
+            b = cgpvision.detect_board(img)
+            labels[str(p)] = [b.x, b.y, b.width, b.height]
+        except cgpvision.CgpVisionError:
+            labels[str(p)] = None
+    if missing:
+        Path(path).write_text(json.dumps(labels, indent=1))
+        print(f"Labelled {len(missing)} images -> {path}")
+    return {p: r for p, r in labels.items() if r and Path(p).exists()}
+
+
+def corners_of(rect):
+    x, y, w, h = rect
+    return np.array([[x, y], [x + w, y], [x + w, y + h], [x, y + h]], np.float32)
+
+
+def augment(img, corners):
+    """Random crop/pad around the board, colour jitter, JPEG round trip."""
+    h, w = img.shape[:2]
+    x0, y0 = corners.min(0)
+    x1, y1 = corners.max(0)
+    # Crop: keep the whole board, drop a random share of the margins.
+    cx0 = int(random.uniform(0, max(0, x0)) * random.random())
+    cy0 = int(random.uniform(0, max(0, y0)) * random.random())
+    cx1 = w - int(random.uniform(0, max(0, w - x1)) * random.random())
+    cy1 = h - int(random.uniform(0, max(0, h - y1)) * random.random())
+    img = img[cy0:cy1, cx0:cx1]
+    corners = corners - np.array([cx0, cy0], np.float32)
+    # Pad: a plain border as on a wider screen.
+    if random.random() < 0.3:
+        pad = [random.randint(0, img.shape[0] // 4) for _ in range(2)] + \
+              [random.randint(0, img.shape[1] // 4) for _ in range(2)]
+        colour = [random.randint(0, 255)] * 3
+        img = cv2.copyMakeBorder(img, pad[0], pad[1], pad[2], pad[3],
+                                 cv2.BORDER_CONSTANT, value=colour)
+        corners = corners + np.array([pad[2], pad[0]], np.float32)
+    img = cv2.convertScaleAbs(img, alpha=random.uniform(0.85, 1.15),
+                              beta=random.uniform(-20, 20))
+    if random.random() < 0.5:
+        ok, enc = cv2.imencode('.jpg', img, [cv2.IMWRITE_JPEG_QUALITY,
+                                             random.randint(30, 95)])
+        img = cv2.imdecode(enc, cv2.IMREAD_COLOR)
+    return img, corners
+
+
+def make_sample(img, corners):
+    h, w = img.shape[:2]
+    x = cv2.resize(img, (INPUT_SIZE, INPUT_SIZE), interpolation=cv2.INTER_AREA)
+    x = x.astype(np.float32).transpose(2, 0, 1) / 255.0
+    gy, gx = np.mgrid[0:GRID, 0:GRID].astype(np.float32)
+    maps = np.empty((4, GRID, GRID), np.float32)
+    for k, (px, py) in enumerate(corners):
+        # board.cpp maps heatmap cell centres back with (i + 0.5) * size / GRID
+        hx = px * GRID / w - 0.5
+        hy = py * GRID / h - 0.5
+        maps[k] = np.exp(-((gx - hx) ** 2 + (gy - hy) ** 2) / (2 * SIGMA ** 2))
+    return torch.from_numpy(x), torch.from_numpy(maps)
+
+
+class CornerDataset(Dataset):
+    def __init__(self, labels, augment=False, repeat=1):
+        self.items = list(labels.items()) * repeat
+        self.augment = augment
+
+    def __len__(self):
+        return len(self.items)
+
+    def __getitem__(self, idx):
+        path, rect = self.items[idx]
+        img = cv2.imread(path, cv2.IMREAD_COLOR)
+        corners = corners_of(rect)
+        if self.augment:
+            img, corners = augment(img, corners)
+        return make_sample(img, corners)
+
+
+def block(cin, cout):
+    return nn.Sequential(nn.Conv2d(cin, cout, 3, padding=1), nn.BatchNorm2d(cout),
+                         nn.ReLU())
+
+
+class CornerCNN(nn.Module):
+    """256 -> 64 heatmaps via an 8x8 bottleneck for whole-image context."""
+
+    def __init__(self):
+        super().__init__()
+        self.stem = nn.Sequential(block(3, 16), nn.MaxPool2d(2),      # 128
+                                  block(16, 24), nn.MaxPool2d(2))     # 64
+        self.down = nn.Sequential(block(24, 32), nn.MaxPool2d(2),     # 32
+                                  block(32, 48), nn.MaxPool2d(2),     # 16
+                                  block(48, 64), nn.MaxPool2d(2),     # 8
+                                  block(64, 64))
+        self.up = nn.Upsample(scale_factor=8, mode='bilinear', align_corners=False)
+        self.head = nn.Sequential(block(24 + 64, 32), nn.Conv2d(32, 4, 1))
+
+    def forward(self, x):
+        s = self.stem(x)
+        g = self.up(self.down(s))
+        return torch.sigmoid(self.head(torch.cat([s, g], 1)))
+
+
+def peak_error(pred, target):
+    """Mean corner distance in heatmap cells (argmax vs argmax)."""
+    b = pred.shape[0]
+    p = pred.view(b, 4, -1).argmax(-1)
+    t = target.view(b, 4, -1).argmax(-1)
+    dx = (p % GRID - t % GRID).float()
+    dy = (p // GRID - t // GRID).float()
+    return torch.sqrt(dx * dx + dy * dy).mean().item()
+
+
+def run_epoch(model, loader, device, optimizer=None):
+    model.train(optimizer is not None)
+    total_loss, total_err, n = 0.0, 0.0, 0
+    with torch.set_grad_enabled(optimizer is not None):
+        for x, y in loader:
+            x, y = x.to(device), y.to(device)
+            pred = model(x)
+            # Heatmaps are mostly background: weight the peaks up.
+            loss = (((pred - y) ** 2) * (1 + 20 * y)).mean()
+            if optimizer is not None:
+                optimizer.zero_grad()
+                loss.backward()
+                optimizer.step()
+            total_loss += loss.item() * x.size(0)
+            total_err += peak_error(pred, y) * x.size(0)
+            n += x.size(0)
+    return total_loss / max(1, n), total_err / max(1, n)
+
+
+def export_onnx(model, path, device):
+    model.eval()
+    dummy = torch.randn(1, 3, INPUT_SIZE, INPUT_SIZE).to(device)
+    torch.onnx.export(model, dummy, path,
+                      input_names=['input'], output_names=['heatmaps'],
+                      opset_version=11)
+    print(f"Exported ONNX model to {path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Train board-corner heatmap CNN')
+    parser.add_argument('--data', nargs='+', required=True,
+                        help='Directories of screenshots (e.g. testdata)')
+    parser.add_argument('--labels', type=str, default='corner_rects.json',
+                        help='Board rect cache (created/extended as needed)')
+    parser.add_argument('--epochs', type=int, default=80)
+    parser.add_argument('--batch-size', type=int, default=16)
+    parser.add_argument('--lr', type=float, default=0.002)
+    parser.add_argument('--repeat', type=int, default=20,
+                        help='Augmented copies of each image per epoch')
+    parser.add_argument('--val-split', type=float, default=0.15)
+    parser.add_argument('--output', type=str, default='models/corner_model_best.pt')
+    parser.add_argument('--onnx', type=str, default='models/corner_model.onnx')
+    args = parser.parse_args()
+
+    device = torch.device('mps' if torch.backends.mps.is_available()
+                          else 'cuda' if torch.cuda.is_available()
+                          else 'cpu')
+    print(f"Device: {device}")
+
+    labels = load_labels(args.data, args.labels)
+    # Split by screenshot, not by augmented copy.
+    paths = sorted(labels)
+    random.Random(42).shuffle(paths)
+    n_val = max(1, int(len(paths) * args.val_split))
+    val = {p: labels[p] for p in paths[:n_val]}
+    train = {p: labels[p] for p in paths[n_val:]}
+    print(f"Train: {len(train)} images x{args.repeat}, Val: {len(val)} images")
+
+    train_loader = DataLoader(CornerDataset(train, augment=True, repeat=args.repeat),
+                              batch_size=args.batch_size, shuffle=True, num_workers=2)
+    val_loader = DataLoader(CornerDataset(val), batch_size=args.batch_size,
+                            shuffle=False, num_workers=2)
+
+    model = CornerCNN().to(device)
+    optimizer = optim.Adam(model.parameters(), lr=args.lr)
+    scheduler = optim.lr_scheduler.CosineAnnealingLR(optimizer, T_max=args.epochs)
+
+    best_err = float('inf')
+    for epoch in range(1, args.epochs + 1):
+        train_loss, train_err = run_epoch(model, train_loader, device, optimizer)
+        val_loss, val_err = run_epoch(model, val_loader, device)
+        scheduler.step()
+        print(f"Epoch {epoch:3d}/{args.epochs}  train_loss={train_loss:.5f} "
+              f"train_err={train_err:.2f}  val_loss={val_loss:.5f} val_err={val_err:.2f}")
+        if val_err < best_err:
+            best_err = val_err
+            torch.save(model.state_dict(), args.output)
+            print(f"  -> Saved best model (val_err={val_err:.2f} cells)")
+
+    model.load_state_dict(torch.load(args.output, map_location=device,
+                                     weights_only=True))
+    export_onnx(model, args.onnx, device)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+"""Train the multi-head tile CNN (optional; replaces the occupancy chain).
+
+One network over every board cell, with four heads: occupancy (empty / tile /
+phantom), letter (A-Z, the designated letter for blanks), blank, and the
+printed point value.  board.cpp classify_cells_heads() runs it once over all
+225 cells and skips is_tile(), the board-colour filter, the tooltip filter
+and is_blank_tile().  Preprocessing must match compute_tile_heads_batch():
+  1. Cut the cell with the 8% inset of extract_cells()
+  2. Resize to 48x48 (INTER_AREA), BGR, float [0, 1], NCHW
+Outputs, raw logits: occupancy (N, 3), letter (N, 26), blank (N, 2),
+subscript (N, 11).  The server loads the model only with CGP_TILE_HEADS=1;
+compare it against tile_model.onnx with eval_local first.
+
+Labels come from the .cgp ground truth next to each screenshot.  Phantoms are
+cells the heuristic chain calls occupied but the CGP says are empty (tooltips,
+badges, overlays); the board rect and that occupancy come from
+cgpvision.occupancy() and are cached in --labels.  Create the cache before
+installing a heads model, so it reflects the heuristic passes.
+
+Usage:
+  python train_tile_heads.py --data testdata --epochs 40
+  python train_tile_heads.py --data testdata more_screens --labels heads_labels.json
+"""
+import argparse
+import json
+import random
+from pathlib import Path
+
+import cv2
+import numpy as np
+import torch
+import torch.nn as nn
+import torch.nn.functional as F
+import torch.optim as optim
+from torch.utils.data import Dataset, DataLoader
+
+# Must match board.cpp HEADS_INPUT_SIZE / OCC_* / HEADS_SUB_CLASSES
+INPUT_SIZE = 48
+OCC_EMPTY, OCC_TILE, OCC_PHANTOM = 0, 1, 2
+SUB_CLASSES = 11
+INSET = 0.08
+
+POINTS = dict(zip("ABCDEFGHIJKLMNOPQRSTUVWXYZ",
+                  [1, 3, 3, 2, 1, 4, 2, 4, 1, 8, 5, 1, 3,
+                   1, 1, 3, 10, 1, 1, 1, 1, 4, 4, 8, 4, 10]))
+
+try:
+    import cgpvision
+except (ImportError, OSError):  # library not built
+    cgpvision = None
+
+
+def parse_cgp(text):
+    """15x15 list of letters ('' = empty) from the board part of a CGP."""
+    grid = [[''] * 15 for _ in range(15)]
+    for r, row in enumerate(text.split(' ')[0].split('/')[:15]):
+        c, i = 0, 0
+        while i < len(row) and c < 15:
+            if row[i].isdigit():
+                j = i
+                while j < len(row) and row[j].isdigit():
+                    j += 1
+                c += int(row[i:j])
+                i = j
+            else:
+                grid[r][c] = row[i]
+                c += 1
+                i += 1
+    return grid
+
+
+def load_labels(dirs, path):
+    """{image path: {"rect": [x, y, w, h], "occ": 225 x '0'/'1'}} from the cache,
+    running the heuristic pipeline on images not yet in it."""
+    labels = json.loads(Path(path).read_text()) if Path(path).exists() else {}
+    images = [p for d in dirs for p in sorted(Path(d).iterdir())
+              if p.suffix.lower() in ('.png', '.jpg') and p.with_suffix('.cgp').exists()]
+    missing = [p for p in images if str(p) not in labels]
+    if missing and cgpvision is None:
+        raise SystemExit(f"{len(missing)} images without labels and libcgpvision "
+                         "is not built (see cgpvision.py)")
+    for p in missing:
+        img = cv2.imread(str(p), cv2.IMREAD_COLOR)
+        try:
+            occ, b = cgpvision.occupancy(img)
+            labels[str(p)] = {"rect": [b.x, b.y, b.width, b.height],
+                              "occ": ''.join('1' if o else '0' for o in occ.flat)}
+        except cgpvision.CgpVisionError:
+            labels[str(p)] = None
+    if missing:
+        Path(path).write_text(json.dumps(labels, indent=1))
+        print(f"Labelled {len(missing)} images -> {path}")
+    return {p: l for p, l in labels.items() if l and Path(p).exists()}
+
+
+def cell_crop(img, rect, r, c):
+    """Same integer cell cut as board.cpp extract_cells() (no sub-pixel grid)."""
+    x, y, w, h = rect
+    cw, ch = w / 15.0, h / 15.0
+    x0 = min(max(x + int(c * cw + cw * INSET), 0), img.shape[1] - 1)
+    y0 = min(max(y + int(r * ch + ch * INSET), 0), img.shape[0] - 1)
+    x1 = max(x0 + 1, min(x + int((c + 1) * cw - cw * INSET), img.shape[1]))
+    y1 = max(y0 + 1, min(y + int((r + 1) * ch - ch * INSET), img.shape[0]))
+    return img[y0:y1, x0:x1]
+
+
+def build_samples(labels):
+    """(crop, occ, letter, blank, subscript) per cell; letter/blank/subscript
+    are -1 where they do not apply (ignored by the loss)."""
+    samples = []
+    skipped = 0
+    for path, lab in sorted(labels.items()):
+        truth = parse_cgp(Path(path).with_suffix('.cgp').read_text())
+        # A misplaced grid would mislabel every cell: require the heuristic
+        # occupancy to agree with the CGP on nearly every tile.
+        missed = sum(1 for r in range(15) for c in range(15)
+                     if truth[r][c] and lab["occ"][r * 15 + c] == '0')
+        if missed > 2:
+            skipped += 1
+            continue
+        img = cv2.imread(path, cv2.IMREAD_COLOR)
+        for r in range(15):
+            for c in range(15):
+                t = truth[r][c]
+                crop = cell_crop(img, lab["rect"], r, c)
+                if not t:
+                    occ = OCC_PHANTOM if lab["occ"][r * 15 + c] == '1' else OCC_EMPTY
+                    samples.append((crop, occ, -1, -1, 0))
+                    continue
+                blank = t.islower()
+                samples.append((crop, OCC_TILE, ord(t.upper()) - ord('A'),
+                                int(blank), 0 if blank else POINTS[t.upper()]))
+    print(f"{len(samples)} cells from {len(labels) - skipped} boards "
+          f"({skipped} skipped: grid disagrees with CGP)")
+    return samples
+
+
+def augment(img):
+    """Small shift/scale, colour jitter and JPEG round trip on a cell crop."""
+    h, w = img.shape[:2]
+    if random.random() < 0.5:
+        s = random.uniform(0.94, 1.06)
+        m = np.float32([[s, 0, random.uniform(-0.04, 0.04) * w],
+                        [0, s, random.uniform(-0.04, 0.04) * h]])
+        img = cv2.warpAffine(img, m, (w, h), borderMode=cv2.BORDER_REPLICATE)
+    img = cv2.convertScaleAbs(img, alpha=random.uniform(0.85, 1.15),
+                              beta=random.uniform(-20, 20))
+    if random.random() < 0.3:
+        ok, enc = cv2.imencode('.jpg', img, [cv2.IMWRITE_JPEG_QUALITY,
+                                             random.randint(40, 95)])
+        img = cv2.imdecode(enc, cv2.IMREAD_COLOR)
+    return img
+
+
+class HeadsDataset(Dataset):
+    def __init__(self, samples, augment=False):
+        self.samples = samples
+        self.augment = augment
+
+    def __len__(self):
+        return len(self.samples)
+
+    def __getitem__(self, idx):
+        crop, occ, letter, blank, sub = self.samples[idx]
+        if self.augment:
+            crop = augment(crop)
+        x = cv2.resize(crop, (INPUT_SIZE, INPUT_SIZE), interpolation=cv2.INTER_AREA)
+        x = x.astype(np.float32).transpose(2, 0, 1) / 255.0
+        return torch.from_numpy(x), torch.tensor([occ, letter, blank, sub])
+
+
+def block(cin, cout):
+    return nn.Sequential(nn.Conv2d(cin, cout, 3, padding=1), nn.BatchNorm2d(cout),
+                         nn.ReLU())
+
+
+class TileHeadsCNN(nn.Module):
+    """Shared 48 -> 6 trunk, one linear head per output."""
+
+    def __init__(self):
+        super().__init__()
+        self.trunk = nn.Sequential(block(3, 32), nn.MaxPool2d(2),     # 24
+                                   block(32, 64), nn.MaxPool2d(2),    # 12
+                                   block(64, 96), nn.MaxPool2d(2),    # 6
+                                   block(96, 128), nn.Flatten(),
+                                   nn.Dropout(0.3),
+                                   nn.Linear(128 * 6 * 6, 256), nn.ReLU())
+        self.occupancy = nn.Linear(256, 3)
+        self.letter = nn.Linear(256, 26)
+        self.blank = nn.Linear(256, 2)
+        self.subscript = nn.Linear(256, SUB_CLASSES)
+
+    def forward(self, x):
+        f = self.trunk(x)
+        return self.occupancy(f), self.letter(f), self.blank(f), self.subscript(f)
+
+
+def run_epoch(model, loader, device, optimizer=None):
+    """Mean loss and per-head accuracy (letter/blank/subscript on tiles only)."""
+    model.train(optimizer is not None)
+    total_loss, n = 0.0, 0
+    correct = [0, 0, 0, 0]
+    counted = [0, 0, 0, 0]
+    with torch.set_grad_enabled(optimizer is not None):
+        for x, y in loader:
+            x, y = x.to(device), y.to(device)
+            outs = model(x)
+            tile = y[:, 0] == OCC_TILE
+            loss = F.cross_entropy(outs[0], y[:, 0])
+            if tile.any():
+                for k in (1, 2, 3):
+                    loss = loss + F.cross_entropy(outs[k][tile], y[tile, k])
+            if optimizer is not None:
+                optimizer.zero_grad()
+                loss.backward()
+                optimizer.step()
+            total_loss += loss.item() * x.size(0)
+            n += x.size(0)
+            for k in range(4):
+                mask = tile if k else torch.ones_like(tile)
+                pred = outs[k].argmax(1)
+                correct[k] += (pred[mask] == y[mask, k]).sum().item()
+                counted[k] += mask.sum().item()
+    acc = [c / max(1, m) for c, m in zip(correct, counted)]
+    return total_loss / max(1, n), acc
+
+
+def export_onnx(model, path, device):
+    model.eval()
+    dummy = torch.randn(1, 3, INPUT_SIZE, INPUT_SIZE).to(device)
+    torch.onnx.export(model, dummy, path, input_names=['input'],
+                      output_names=['occupancy', 'letter', 'blank', 'subscript'],
+                      dynamic_axes={'input': {0: 'batch'}}, opset_version=11)
+    print(f"Exported ONNX model to {path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Train multi-head tile CNN')
+    parser.add_argument('--data', nargs='+', required=True,
+                        help='Directories of screenshots with .cgp ground truth')
+    parser.add_argument('--labels', type=str, default='heads_labels.json',
+                        help='Board rect + heuristic occupancy cache')
+    parser.add_argument('--epochs', type=int, default=40)
+    parser.add_argument('--batch-size', type=int, default=256)
+    parser.add_argument('--lr', type=float, default=0.001)
+    parser.add_argument('--val-split', type=float, default=0.15)
+    parser.add_argument('--output', type=str, default='models/tile_heads_best.pt')
+    parser.add_argument('--onnx', type=str, default='models/tile_heads.onnx')
+    args = parser.parse_args()
+
+    device = torch.device('mps' if torch.backends.mps.is_available()
+                          else 'cuda' if torch.cuda.is_available()
+                          else 'cpu')
+    print(f"Device: {device}")
+
+    labels = load_labels(args.data, args.labels)
+    # Split by screenshot, not by cell.
+    paths = sorted(labels)
+    random.Random(42).shuffle(paths)
+    n_val = max(1, int(len(paths) * args.val_split))
+    val = build_samples({p: labels[p] for p in paths[:n_val]})
+    train = build_samples({p: labels[p] for p in paths[n_val:]})
+
+    train_loader = DataLoader(HeadsDataset(train, augment=True),
+                              batch_size=args.batch_size, shuffle=True, num_workers=2)
+    val_loader = DataLoader(HeadsDataset(val), batch_size=args.batch_size,
+                            shuffle=False, num_workers=2)
+
+    model = TileHeadsCNN().to(device)
+    optimizer = optim.Adam(model.parameters(), lr=args.lr)
+    scheduler = optim.lr_scheduler.CosineAnnealingLR(optimizer, T_max=args.epochs)
+
+    best_loss = float('inf')
+    for epoch in range(1, args.epochs + 1):
+        train_loss, _ = run_epoch(model, train_loader, device, optimizer)
+        val_loss, acc = run_epoch(model, val_loader, device)
+        scheduler.step()
+        print(f"Epoch {epoch:3d}/{args.epochs}  train_loss={train_loss:.4f} "
+              f"val_loss={val_loss:.4f}  occ={acc[0]:.4f} letter={acc[1]:.4f} "
+              f"blank={acc[2]:.4f} sub={acc[3]:.4f}")
+        if val_loss < best_loss:
+            best_loss = val_loss
+            torch.save(model.state_dict(), args.output)
+            print(f"  -> Saved best model (val_loss={val_loss:.4f})")
+
+    model.load_state_dict(torch.load(args.output, map_location=device,
+                                     weights_only=True))
+    export_onnx(model, args.onnx, device)
+
+
+if __name__ == '__main__':
+    main()
@@ -7,6 +7,8 @@ Preprocessing must exactly match board.cpp preprocess_for_cnn():
   3. Polarity normalize: invert if mean < 128 (ensure light background)
   4. Histogram equalize
   5. Convert to float [0, 1]
+When libcgpvision.so is built (see cgpvision.py), steps 1-4 run through the
+C++ code itself, so training and inference cannot drift apart.
 
 Usage:
   # Train from scratch on board + rack data:
@@ -17,8 +19,14 @@ Usage:
 
   # Train with board data, augmented with rack data:
   python train_tile_model.py --data training_data --aux-data rack_training_data --aux-weight 3 --epochs 60
+
+Data directories may be either ImageFolder-style (A/ through Z/ of PNGs) or
+packed shards written by extract_crops / extract_rack_crops (index.json +
+shard_NNN.bin).  Shard crops are already preprocessed and are memory-mapped,
+so no image decoding happens during training.
 """
 import argparse
+import json
 import os
 import random
 from pathlib import Path
@@ -35,9 +43,17 @@ from torch.utils.data import Dataset, DataLoader, ConcatDataset, WeightedRandomS
 CNN_INPUT_SIZE = 48
 NUM_CLASSES = 26
 
+try:
+    import cgpvision
+except (ImportError, OSError):  # library not built
+    cgpvision = None
+
 
 def preprocess(img_bgr):
     """Replicate C++ preprocess_for_cnn exactly."""
+    if cgpvision is not None:
+        img = np.ascontiguousarray(img_bgr)
+        return cgpvision.preprocess_tile(img).astype(np.float32) / 255.0
     resized = cv2.resize(img_bgr, (CNN_INPUT_SIZE, CNN_INPUT_SIZE),
                          interpolation=cv2.INTER_AREA)
     if len(resized.shape) == 3:
@@ -55,6 +71,169 @@ def preprocess(img_bgr):
     return gray.astype(np.float32) / 255.0
 
 
+def augment_image(img):
+    """Random geometric/compression/brightness jitter.  Works on BGR crops
+    and on single-channel preprocessed shard crops alike."""
+    h, w = img.shape[:2]
+
+    # Random small rotation (-5 to +5 degrees)
+    if random.random() < 0.3:
+        angle = random.uniform(-5, 5)
+        M = cv2.getRotationMatrix2D((w / 2, h / 2), angle, 1.0)
+        img = cv2.warpAffine(img, M, (w, h), borderMode=cv2.BORDER_REPLICATE)
+
+    # Random small translation (up to 8% of size)
+    if random.random() < 0.3:
+        dx = random.randint(-max(1, w // 12), max(1, w // 12))
+        dy = random.randint(-max(1, h // 12), max(1, h // 12))
+        M = np.float32([[1, 0, dx], [0, 1, dy]])
+        img = cv2.warpAffine(img, M, (w, h), borderMode=cv2.BORDER_REPLICATE)
+
+    # Random scale (90%-110%)
+    if random.random() < 0.3:
+        scale = random.uniform(0.9, 1.1)
+        new_w, new_h = int(w * scale), int(h * scale)
+        img = cv2.resize(img, (new_w, new_h))
+        # Crop/pad back to original size
+        if new_w > w:
+            x0 = (new_w - w) // 2
+            img = img[:, x0:x0 + w]
+        elif new_w < w:
+            pad = w - new_w
+            img = cv2.copyMakeBorder(img, 0, 0, pad // 2, pad - pad // 2,
+                                     cv2.BORDER_REPLICATE)
+        if new_h > h:
+            y0 = (new_h - h) // 2
+            img = img[y0:y0 + h, :]
+        elif new_h < h:
+            pad = h - new_h
+            img = cv2.copyMakeBorder(img, pad // 2, pad - pad // 2, 0, 0,
+                                     cv2.BORDER_REPLICATE)
+
+    # JPEG compression simulation
+    if random.random() < 0.3:
+        quality = random.randint(15, 70)
+        _, buf = cv2.imencode('.jpg', img, [cv2.IMWRITE_JPEG_QUALITY, quality])
+        img = cv2.imdecode(buf, cv2.IMREAD_UNCHANGED)
+
+    # Random brightness/contrast
+    if random.random() < 0.2:
+        alpha = random.uniform(0.8, 1.2)  # contrast
+        beta = random.randint(-20, 20)     # brightness
+        img = cv2.convertScaleAbs(img, alpha=alpha, beta=beta)
+
+    return img
+
+
+def is_shard_dir(root):
+    return (Path(root) / "index.json").exists()
+
+
+SHARD_MAGIC = b"CGPSHRD1"
+SHARD_HEADER_SIZE = 64
+
+
+class ShardDataset(Dataset):
+    """Packed shards written by the extract_* tools (see src/shard.h).
+
+    Crops are stored already preprocessed (48x48 uint8), so __getitem__ is a
+    memmap slice plus a divide.  Only classes named A-Z are used; other
+    classes in the shard (e.g. rack "_blank") are dropped.
+    """
+
+    def __init__(self, root_dirs, augment=False):
+        self.augment = augment
+        self.shards = []    # (path, count, crops_offset, labels_offset)
+        self.samples = []   # (shard_idx, record_idx, label_idx)
+        self._maps = {}     # shard_idx -> (crops, labels), opened per process
+
+        if isinstance(root_dirs, (str, Path)):
+            root_dirs = [root_dirs]
+
+        for root in root_dirs:
+            root = Path(root)
+            with open(root / "index.json") as f:
+                index = json.load(f)
+            if index.get("crop_size") != CNN_INPUT_SIZE:
+                raise ValueError(f"{root}: crop_size {index.get('crop_size')} "
+                                 f"!= {CNN_INPUT_SIZE}")
+            # Map shard class ids onto A-Z
+            remap = {}
+            for ci, name in enumerate(index["classes"]):
+                if len(name) == 1 and 'A' <= name <= 'Z':
+                    remap[ci] = ord(name) - ord('A')
+            if not remap:
+                print(f"Warning: {root} has no A-Z classes, skipping")
+                continue
+
+            for shard in index["shards"]:
+                path = root / shard["file"]
+                with open(path, "rb") as f:
+                    hdr = f.read(SHARD_HEADER_SIZE)
+                if hdr[:8] != SHARD_MAGIC:
+                    raise ValueError(f"{path}: bad shard magic")
+                (version, count, crop_w, crop_h, _num_classes, crops_off,
+                 labels_off) = np.frombuffer(hdr, dtype='<u4', count=7, offset=8)
+                if crop_w != CNN_INPUT_SIZE or crop_h != CNN_INPUT_SIZE:
+                    raise ValueError(f"{path}: unexpected crop size")
+                si = len(self.shards)
+                self.shards.append((str(path), int(count), int(crops_off),
+                                    int(labels_off)))
+                labels = np.fromfile(path, dtype='<i4', count=int(count),
+                                     offset=int(labels_off))
+                for ri, lbl in enumerate(labels):
+                    li = remap.get(int(lbl))
+                    if li is not None:
+                        self.samples.append((si, ri, li))
+
+        print(f"  Loaded {len(self.samples)} samples from {len(self.shards)} "
+              f"shard(s) in {root_dirs}")
+
+    def _crops(self, si):
+        m = self._maps.get(si)
+        if m is None:
+            path, count, crops_off, _ = self.shards[si]
+            m = np.memmap(path, dtype=np.uint8, mode='r', offset=crops_off,
+                          shape=(count, CNN_INPUT_SIZE, CNN_INPUT_SIZE))
+            self._maps[si] = m
+        return m
+
+    def __len__(self):
+        return len(self.samples)
+
+    def __getitem__(self, idx):
+        si, ri, label = self.samples[idx]
+        crop = self._crops(si)[ri]
+        if self.augment:
+            # Augment the preprocessed crop, then re-normalize polarity and
+            # contrast the same way inference does.
+            gray = preprocess(augment_image(np.array(crop)))
+        else:
+            gray = crop.astype(np.float32) / 255.0
+        tensor = torch.from_numpy(gray).unsqueeze(0)  # 1xHxW
+        return tensor, label
+
+    def __getstate__(self):
+        # memmaps are reopened lazily in each DataLoader worker
+        state = self.__dict__.copy()
+        state['_maps'] = {}
+        return state
+
+
+def load_dataset(root_dirs, augment=False):
+    """Build a dataset from a mix of ImageFolder and shard directories."""
+    if isinstance(root_dirs, (str, Path)):
+        root_dirs = [root_dirs]
+    shard_dirs = [d for d in root_dirs if is_shard_dir(d)]
+    folder_dirs = [d for d in root_dirs if not is_shard_dir(d)]
+    parts = []
+    if shard_dirs:
+        parts.append(ShardDataset(shard_dirs, augment=augment))
+    if folder_dirs:
+        parts.append(TileDataset(folder_dirs, augment=augment))
+    return parts[0] if len(parts) == 1 else ConcatDataset(parts)
+
+
 class TileDataset(Dataset):
     """ImageFolder-style dataset for tile crops. Expects dirs A/ through Z/."""
 
@@ -91,63 +270,12 @@ class TileDataset(Dataset):
             return torch.zeros(1, CNN_INPUT_SIZE, CNN_INPUT_SIZE), label
 
         if self.augment:
-            img = self._augment(img)
+            img = augment_image(img)
 
         gray = preprocess(img)
         tensor = torch.from_numpy(gray).unsqueeze(0)  # 1xHxW
         return tensor, label
 
-    def _augment(self, img):
-        h, w = img.shape[:2]
-
-        # Random small rotation (-5 to +5 degrees)
-        if random.random() < 0.3:
-            angle = random.uniform(-5, 5)
-            M = cv2.getRotationMatrix2D((w / 2, h / 2), angle, 1.0)
-            img = cv2.warpAffine(img, M, (w, h), borderMode=cv2.BORDER_REPLICATE)
-
-        # Random small translation (up to 8% of size)
-        if random.random() < 0.3:
-            dx = random.randint(-max(1, w // 12), max(1, w // 12))
-            dy = random.randint(-max(1, h // 12), max(1, h // 12))
-            M = np.float32([[1, 0, dx], [0, 1, dy]])
-            img = cv2.warpAffine(img, M, (w, h), borderMode=cv2.BORDER_REPLICATE)
-
-        # Random scale (90%-110%)
-        if random.random() < 0.3:
-            scale = random.uniform(0.9, 1.1)
-            new_w, new_h = int(w * scale), int(h * scale)
-            img = cv2.resize(img, (new_w, new_h))
-            # Crop/pad back to original size
-            if new_w > w:
-                x0 = (new_w - w) // 2
-                img = img[:, x0:x0 + w]
-            elif new_w < w:
-                pad = w - new_w
-                img = cv2.copyMakeBorder(img, 0, 0, pad // 2, pad - pad // 2,
-                                         cv2.BORDER_REPLICATE)
-            if new_h > h:
-                y0 = (new_h - h) // 2
-                img = img[y0:y0 + h, :]
-            elif new_h < h:
-                pad = h - new_h
-                img = cv2.copyMakeBorder(img, pad // 2, pad - pad // 2, 0, 0,
-                                         cv2.BORDER_REPLICATE)
-
-        # JPEG compression simulation
-        if random.random() < 0.3:
-            quality = random.randint(15, 70)
-            _, buf = cv2.imencode('.jpg', img, [cv2.IMWRITE_JPEG_QUALITY, quality])
-            img = cv2.imdecode(buf, cv2.IMREAD_COLOR)
-
-        # Random brightness/contrast
-        if random.random() < 0.2:
-            alpha = random.uniform(0.8, 1.2)  # contrast
-            beta = random.randint(-20, 20)     # brightness
-            img = cv2.convertScaleAbs(img, alpha=alpha, beta=beta)
-
-        return img
-
 
 class TileCNN(nn.Module):
     """Must match the architecture in board.cpp / existing ONNX model."""
@@ -237,7 +365,7 @@ def export_onnx(model, path, device):
 def main():
     parser = argparse.ArgumentParser(description='Train tile CNN model')
     parser.add_argument('--data', nargs='+', required=True,
-                        help='Training data directories (ImageFolder format)')
+                        help='Training data directories (ImageFolder or shard format)')
     parser.add_argument('--aux-data', nargs='*', default=[],
                         help='Auxiliary data to oversample (e.g., rack crops)')
     parser.add_argument('--aux-weight', type=int, default=3,
@@ -260,13 +388,13 @@ def main():
 
     # Load datasets
     print("Loading primary data...")
-    primary = TileDataset(args.data, augment=not args.no_augment)
+    primary = load_dataset(args.data, augment=not args.no_augment)
 
     datasets = [primary]
     if args.aux_data:
         print(f"Loading auxiliary data (weight={args.aux_weight})...")
         for _ in range(args.aux_weight):
-            aux = TileDataset(args.aux_data, augment=not args.no_augment)
+            aux = load_dataset(args.aux_data, augment=not args.no_augment)
             datasets.append(aux)
 
     full_dataset = ConcatDataset(datasets) if len(datasets) > 1 else primary